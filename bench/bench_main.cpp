@@ -0,0 +1,201 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+
+#include "encoding_util/encoding_util.hpp"
+
+#ifndef ENCODING_UTIL_BENCH_MAX_BYTES
+    #define ENCODING_UTIL_BENCH_MAX_BYTES (int64_t(1) << 30)
+#endif
+
+// ========== 测试语料 ==========
+namespace {
+
+enum class Corpus { ASCII, GBK, UTF8, MIXED_GBK, MIXED_UTF8 };
+
+const char* corpus_name(Corpus corpus) {
+    switch (corpus) {
+        case Corpus::ASCII: return "ascii";
+        case Corpus::GBK: return "gbk";
+        case Corpus::UTF8: return "utf8";
+        case Corpus::MIXED_GBK: return "mixed_gbk";
+        case Corpus::MIXED_UTF8: return "mixed_utf8";
+    }
+    return "";
+}
+
+bool corpus_is_gbk(Corpus corpus) { return corpus == Corpus::GBK || corpus == Corpus::MIXED_GBK; }
+
+// 重复一段典型文本直到 size 字节，末尾截断到字符边界
+std::string make_corpus(Corpus corpus, size_t size) {
+    const std::string chinese = "编码检测与转换的吞吐量测试，覆盖常用汉字、全角标点与数字：你好世界，一二三。";
+    const std::string text = corpus_is_gbk(corpus) ? encoding_util::utf8_to_gbk(chinese) : chinese;
+    std::string unit;
+    switch (corpus) {
+        case Corpus::ASCII: unit = "2024-06-01 12:00:00 [INFO] request_id=4f2a9c status=200 latency_ms=12\n"; break;
+        case Corpus::GBK:
+        case Corpus::UTF8: unit = text; break;
+        case Corpus::MIXED_GBK:
+        case Corpus::MIXED_UTF8:
+            // 以 ASCII 为主、夹带少量中文字段的日志行
+            unit = "2024-06-01 12:00:00 [INFO] request_id=4f2a9c user=" +
+                   text.substr(0, corpus_is_gbk(corpus) ? 8 : 12) + " status=200 latency_ms=12\n";
+            break;
+    }
+
+    std::string s;
+    s.reserve(size + unit.size());
+    while (s.size() < size) s += unit;
+    s.resize(size);
+    const size_t tail = corpus_is_gbk(corpus) ? encoding_util::detail::gbk_incomplete_tail_size(s.data(), s.size())
+                                              : encoding_util::detail::utf8_incomplete_tail_size(s.data(), s.size());
+    s.resize(s.size() - tail);
+    return s;
+}
+
+// 只缓存最近一次用到的语料，避免 1 GiB 级别的输入同时驻留多份
+const std::string& corpus_of_size(Corpus corpus, size_t size) {
+    static Corpus cached_corpus = Corpus::ASCII;
+    static size_t cached_size = 0;
+    static std::string cached;
+    if (corpus != cached_corpus || size != cached_size || cached.empty()) {
+        cached = std::string();
+        cached = make_corpus(corpus, size);
+        cached_corpus = corpus;
+        cached_size = size;
+    }
+    return cached;
+}
+
+// ========== 注册工具 ==========
+// 每个用例在给定语料与 16 B ~ ENCODING_UTIL_BENCH_MAX_BYTES 的输入长度上运行，按输入字节数报告吞吐量
+template <typename Kernel>
+void register_case(const std::string& name, std::initializer_list<Corpus> corpora, Kernel kernel) {
+    for (Corpus corpus : corpora) {
+        const std::string full_name = name + "/" + corpus_name(corpus);
+        benchmark::RegisterBenchmark(full_name.c_str(),
+                                     [corpus, kernel](benchmark::State& state) {
+                                         const std::string& input =
+                                             corpus_of_size(corpus, static_cast<size_t>(state.range(0)));
+                                         std::string out;
+                                         for (auto _ : state) {
+                                             out.clear();
+                                             kernel(std::string_view(input), out);
+                                             benchmark::ClobberMemory();
+                                         }
+                                         state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                                                                 static_cast<int64_t>(input.size()));
+                                     })
+            ->RangeMultiplier(16)
+            ->Range(16, ENCODING_UTIL_BENCH_MAX_BYTES);
+    }
+}
+
+// 平台自带的转换器 (iconv / Win32)，不受 ENCODING_UTIL_USE_NATIVE_CODEC 影响
+void system_gbk_to_utf8(std::string_view in, std::string& out) {
+#ifdef _WIN32
+    if (encoding_util::detail::convert_win32(in, 936, CP_UTF8, out)) throw std::runtime_error("convert_win32 failed");
+#else
+    if (encoding_util::detail::iconv_convert(in, "UTF-8", "GBK", out)) throw std::runtime_error("iconv failed");
+#endif
+}
+
+void system_utf8_to_gbk(std::string_view in, std::string& out) {
+#ifdef _WIN32
+    if (encoding_util::detail::convert_win32(in, CP_UTF8, 936, out)) throw std::runtime_error("convert_win32 failed");
+#else
+    if (encoding_util::detail::iconv_convert(in, "GBK", "UTF-8", out)) throw std::runtime_error("iconv failed");
+#endif
+}
+
+#ifdef _WIN32
+const char* const kSystemBackend = "win32";
+#else
+const char* const kSystemBackend = "iconv";
+#endif
+
+void register_all() {
+    using encoding_util::ErrorPolicy;
+    const std::initializer_list<Corpus> all = {Corpus::ASCII, Corpus::GBK, Corpus::UTF8, Corpus::MIXED_GBK,
+                                               Corpus::MIXED_UTF8};
+    const std::initializer_list<Corpus> gbk_inputs = {Corpus::ASCII, Corpus::GBK, Corpus::MIXED_GBK};
+    const std::initializer_list<Corpus> utf8_inputs = {Corpus::ASCII, Corpus::UTF8, Corpus::MIXED_UTF8};
+
+    // --- 检测 ---
+    register_case("detect_encoding", all, [](std::string_view in, std::string&) {
+        benchmark::DoNotOptimize(encoding_util::detect_encoding(in));
+    });
+    register_case("detect_encoding_parallel", all, [](std::string_view in, std::string&) {
+        benchmark::DoNotOptimize(encoding_util::detect_encoding(in, encoding_util::ParallelOptions{}));
+    });
+    register_case("is_valid_gbk", gbk_inputs, [](std::string_view in, std::string&) {
+        benchmark::DoNotOptimize(encoding_util::detail::is_valid_gbk(in.data(), in.size()));
+    });
+    register_case("validate_utf8", utf8_inputs, [](std::string_view in, std::string&) {
+        bool is_all_ascii = false;
+        benchmark::DoNotOptimize(encoding_util::detail::validate_utf8(in.data(), in.size(), is_all_ascii));
+    });
+
+    // --- GBK -> UTF-8，各后端并列 ---
+    register_case(std::string("gbk_to_utf8/") + kSystemBackend, gbk_inputs, system_gbk_to_utf8);
+    register_case("gbk_to_utf8/native", gbk_inputs, [](std::string_view in, std::string& out) {
+        if (encoding_util::detail::native_convert(in, true, encoding_util::detail::native_gbk_segment_to_utf8, out)) {
+            throw std::runtime_error("native_convert failed");
+        }
+    });
+    register_case("gbk_to_utf8/default", gbk_inputs,
+                  [](std::string_view in, std::string& out) { encoding_util::gbk_to_utf8(in, out); });
+    register_case("gbk_to_utf8/converter", gbk_inputs, [](std::string_view in, std::string& out) {
+        static encoding_util::Converter converter(encoding_util::Encoding::GBK, encoding_util::Encoding::UTF8);
+        converter.convert(in, out);
+    });
+    register_case("gbk_to_utf8/parallel", gbk_inputs, [](std::string_view in, std::string& out) {
+        out = encoding_util::gbk_to_utf8(in, encoding_util::ParallelOptions{});
+    });
+    register_case("gbk_to_utf8/replace", gbk_inputs, [](std::string_view in, std::string& out) {
+        encoding_util::gbk_to_utf8(in, out, ErrorPolicy::REPLACE);
+    });
+
+    // --- UTF-8 -> GBK，各后端并列 ---
+    register_case(std::string("utf8_to_gbk/") + kSystemBackend, utf8_inputs, system_utf8_to_gbk);
+    register_case("utf8_to_gbk/native", utf8_inputs, [](std::string_view in, std::string& out) {
+        if (encoding_util::detail::native_convert(in, false, encoding_util::detail::native_utf8_segment_to_gbk, out)) {
+            throw std::runtime_error("native_convert failed");
+        }
+    });
+    register_case("utf8_to_gbk/default", utf8_inputs,
+                  [](std::string_view in, std::string& out) { encoding_util::utf8_to_gbk(in, out); });
+    register_case("utf8_to_gbk/converter", utf8_inputs, [](std::string_view in, std::string& out) {
+        static encoding_util::Converter converter(encoding_util::Encoding::UTF8, encoding_util::Encoding::GBK);
+        converter.convert(in, out);
+    });
+    register_case("utf8_to_gbk/parallel", utf8_inputs, [](std::string_view in, std::string& out) {
+        out = encoding_util::utf8_to_gbk(in, encoding_util::ParallelOptions{});
+    });
+    register_case("utf8_to_gbk/replace", utf8_inputs, [](std::string_view in, std::string& out) {
+        encoding_util::utf8_to_gbk(in, out, ErrorPolicy::REPLACE);
+    });
+
+    // --- 智能转换 ---
+    register_case("to_utf8", all, [](std::string_view in, std::string& out) { encoding_util::to_utf8(in, out); });
+    register_case("to_u8string", all, [](std::string_view in, std::string&) {
+        static std::u8string out;
+        out.clear();
+        encoding_util::to_u8string(in, out);
+        benchmark::DoNotOptimize(out.data());
+    });
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    register_all();
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
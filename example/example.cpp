@@ -1,11 +1,28 @@
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
 #include "encoding_util/encoding_util.hpp"
 
 
-int main() {
+namespace fs = std::filesystem;
+
+// 在临时目录中生成一个小的 GBK 目录树，供未指定目录时演示
+static fs::path make_demo_tree(const std::string& gbk_str) {
+    const fs::path root = fs::temp_directory_path() / "encoding_util_example_gbk";
+    fs::remove_all(root);
+    fs::create_directories(root / "sub");
+    for (const char* name : {"a.txt", "b.txt", "sub/c.txt"}) {
+        std::ofstream out(root / name, std::ios::binary);
+        for (int i = 0; i < 1000; ++i) out << gbk_str << ' ' << i << '\n';
+    }
+    return root;
+}
+
+int main(int argc, char* argv[]) {
 #ifdef _WIN32
     SetConsoleOutputCP(CP_UTF8);  // 设置控制台输出为 UTF-8 编码
 #endif
@@ -47,5 +64,35 @@ int main() {
         std::cerr << "Successfully caught expected exception: " << e.what() << std::endl;
     }
 
+    // --- 4. 批量转换目录树：example [GBK 源目录] [UTF-8 目标目录] ---
+    std::cout << "\n--- 4. Pipelined Directory Transcoding (GBK -> UTF-8) ---" << std::endl;
+    try {
+        const fs::path src_root = argc >= 3 ? fs::path(argv[1]) : make_demo_tree(gbk_str);
+        const fs::path dst_root =
+            argc >= 3 ? fs::path(argv[2]) : fs::temp_directory_path() / "encoding_util_example_utf8";
+
+        std::vector<encoding_util::FileTranscodeJob> jobs;
+        for (const fs::directory_entry& entry : fs::recursive_directory_iterator(src_root)) {
+            if (!entry.is_regular_file()) continue;
+            const fs::path dst = dst_root / fs::relative(entry.path(), src_root);
+            fs::create_directories(dst.parent_path());
+            jobs.push_back({entry.path(), dst});
+        }
+
+        const auto results =
+            encoding_util::transcode_files(jobs, encoding_util::Encoding::GBK, encoding_util::Encoding::UTF8);
+        for (size_t i = 0; i < jobs.size(); ++i) {
+            std::cout << jobs[i].src.string() << ": ";
+            if (results[i].ok) {
+                std::cout << results[i].bytes_read << " -> " << results[i].bytes_written << " bytes" << std::endl;
+            } else {
+                std::cout << "failed, " << results[i].error << std::endl;
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Directory transcoding failed: " << e.what() << std::endl;
+        return 1;
+    }
+
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,382 @@
+// 差分模糊测试目标：同一段输入交给同一功能的每一种实现，结果必须逐位一致，否则打印输入并 abort()。
+// - UTF-8 / GBK / Big5 / GB18030 验证：标量参照与 SSE2、AVX2、NEON 各内核以及运行时派发的版本；
+// - 编码检测：旧的多遍标量检测、单遍联合检测、增量检测 (随机切块) 与多线程检测；
+// - GBK <-> UTF-8 转换：系统转换器 (iconv / Win32) 与内置码表，覆盖全部 ErrorPolicy；
+//   另外比较智能转换与先检测再转换、流式转换 (随机切块) 与整体转换、多线程转换与单线程转换；
+// - UTF-16 / UTF-32 转换：向量化内核与逐字符的严格解码。
+// 用 Clang 的 -fsanitize=fuzzer 编译即为 libFuzzer 目标；其他编译器与 replay_main.cpp 链接，回放语料或随机输入。
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "encoding_util/encoding_util.hpp"
+
+namespace {
+
+namespace eu = encoding_util;
+namespace detail = encoding_util::detail;
+
+using eu::ConvertError;
+using eu::EncodingAnalysis;
+using eu::ErrorPolicy;
+
+// ========== 差异报告 ==========
+std::string_view g_input;  // 当前输入，出现差异时打印
+
+[[noreturn]] void report_mismatch(const char* what, int line) {
+    std::fprintf(stderr, "fuzz_differential: 结果不一致 (%s，第 %d 行)，输入 %zu 字节：\n", what, line,
+                 g_input.size());
+    for (size_t i = 0; i < g_input.size(); ++i) {
+        std::fprintf(stderr, "\\x%02X", static_cast<unsigned char>(g_input[i]));
+        if (i % 32 == 31) std::fputc('\n', stderr);
+    }
+    std::fputc('\n', stderr);
+    std::abort();
+}
+
+#define FUZZ_EXPECT(condition)                                   \
+    do {                                                         \
+        if (!(condition)) report_mismatch(#condition, __LINE__); \
+    } while (false)
+
+bool same_error(const ConvertError& a, const ConvertError& b) { return a.code == b.code && a.offset == b.offset; }
+
+bool same_analysis(const EncodingAnalysis& a, const EncodingAnalysis& b) {
+    return a.encoding == b.encoding && a.is_all_ascii == b.is_all_ascii && a.utf8_invalid_at == b.utf8_invalid_at &&
+           a.gbk_invalid_at == b.gbk_invalid_at;
+}
+
+/// 由输入本身决定的伪随机切块长度 (1~max_chunk)，同一输入每次回放都切在同样的位置
+class Splitter {
+public:
+    Splitter(std::string_view input, size_t max_chunk) : max_chunk_(max_chunk) {
+        for (const char c : input) state_ = (state_ ^ static_cast<unsigned char>(c)) * 0x100000001B3ULL;
+    }
+
+    size_t next(size_t remaining) {
+        return std::min<size_t>(remaining, 1 + detail::splitmix64(state_) % max_chunk_);
+    }
+
+private:
+    uint64_t state_ = 0xCBF29CE484222325ULL;
+    size_t max_chunk_;
+};
+
+// ========== 验证器 ==========
+void check_find_non_ascii(std::string_view s) {
+    size_t expected = 0;
+    while (expected < s.size() && static_cast<unsigned char>(s[expected]) < 0x80) ++expected;
+    FUZZ_EXPECT(detail::find_non_ascii(s.data(), s.size()) == expected);
+#if defined(ENCODING_UTIL_SIMD_X86)
+    FUZZ_EXPECT(detail::find_non_ascii_sse2(s.data(), s.size()) == expected);
+    if (detail::cpu_has_avx2()) FUZZ_EXPECT(detail::find_non_ascii_avx2(s.data(), s.size()) == expected);
+#elif defined(ENCODING_UTIL_SIMD_NEON)
+    FUZZ_EXPECT(detail::find_non_ascii_neon(s.data(), s.size()) == expected);
+#endif
+}
+
+void check_utf8_validators(std::string_view s) {
+    std::vector<detail::Utf8PrefixValidator> kernels = {&detail::validate_utf8_prefix};
+#if defined(ENCODING_UTIL_SIMD_X86)
+    kernels.push_back(&detail::validate_utf8_prefix_sse2);
+    if (detail::cpu_has_avx2()) kernels.push_back(&detail::validate_utf8_prefix_avx2);
+#elif defined(ENCODING_UTIL_SIMD_NEON)
+    kernels.push_back(&detail::validate_utf8_prefix_neon);
+#endif
+    int ref_pending = 0;
+    bool ref_ascii = true;
+    const size_t ref = detail::validate_utf8_prefix_scalar(s.data(), s.size(), ref_pending, ref_ascii);
+    for (const auto kernel : kernels) {
+        int pending = 0;
+        bool ascii = true;
+        FUZZ_EXPECT(kernel(s.data(), s.size(), pending, ascii) == ref);
+        // 未完的字节数与 ASCII 标志只在整段合法时才有意义
+        if (ref == s.size()) FUZZ_EXPECT(pending == ref_pending && ascii == ref_ascii);
+    }
+
+    bool scalar_ascii = false, ascii = false;
+    FUZZ_EXPECT(detail::validate_utf8(s.data(), s.size(), ascii) ==
+                detail::validate_utf8_scalar(s.data(), s.size(), scalar_ascii));
+    FUZZ_EXPECT(ascii == scalar_ascii);
+}
+
+void check_gbk_validators(std::string_view s) {
+    std::vector<detail::GbkPrefixValidator> kernels = {&detail::validate_gbk_prefix};
+    std::vector<detail::GbkBig5PrefixValidator> big5_kernels = {&detail::validate_gbk_prefix_big5};
+#if defined(ENCODING_UTIL_SIMD_X86)
+    kernels.push_back(&detail::validate_gbk_prefix_blocks<&detail::load_gbk_masks_sse2>);
+    big5_kernels.push_back(
+        &detail::validate_gbk_prefix_big5_blocks<&detail::load_gbk_masks_sse2, &detail::load_big5_masks_sse2>);
+    if (detail::cpu_has_avx2()) {
+        kernels.push_back(&detail::validate_gbk_prefix_blocks<&detail::load_gbk_masks_avx2>);
+        big5_kernels.push_back(
+            &detail::validate_gbk_prefix_big5_blocks<&detail::load_gbk_masks_avx2, &detail::load_big5_masks_avx2>);
+    }
+#elif defined(ENCODING_UTIL_SIMD_NEON)
+    kernels.push_back(&detail::validate_gbk_prefix_blocks<&detail::load_gbk_masks_neon>);
+    big5_kernels.push_back(
+        &detail::validate_gbk_prefix_big5_blocks<&detail::load_gbk_masks_neon, &detail::load_big5_masks_neon>);
+#endif
+    bool ref_pending = false;
+    const size_t ref = detail::validate_gbk_prefix_scalar(s.data(), s.size(), ref_pending);
+    for (const auto kernel : kernels) {
+        bool pending = false;
+        FUZZ_EXPECT(kernel(s.data(), s.size(), pending) == ref);
+        if (ref == s.size()) FUZZ_EXPECT(pending == ref_pending);
+    }
+    FUZZ_EXPECT(detail::is_valid_gbk(s.data(), s.size()) == (ref == s.size() && !ref_pending));
+
+    detail::Big5Evidence ref_evidence;
+    unsigned char ref_lead = 0;
+    FUZZ_EXPECT(detail::validate_gbk_prefix_big5_scalar(s.data(), s.size(), ref_lead, ref_evidence) == ref);
+    for (const auto kernel : big5_kernels) {
+        detail::Big5Evidence evidence;
+        unsigned char lead = 0;
+        FUZZ_EXPECT(kernel(s.data(), s.size(), lead, evidence) == ref);
+        // 证据只对合法的前缀有意义
+        if (ref == s.size()) {
+            FUZZ_EXPECT((lead != 0) == (ref_lead != 0) && evidence.is_big5() == ref_evidence.is_big5());
+        }
+    }
+
+    int ref_gb18030 = 0, gb18030 = 0;
+    const size_t gb18030_valid = detail::validate_gb18030_prefix_scalar(s.data(), s.size(), ref_gb18030);
+    FUZZ_EXPECT(detail::validate_gb18030_prefix(s.data(), s.size(), gb18030) == gb18030_valid);
+    if (gb18030_valid == s.size()) FUZZ_EXPECT(gb18030 == ref_gb18030);
+}
+
+// ========== 编码检测 ==========
+// 旧的多遍检测逻辑 (各编码的标量验证器依次判定)，作为参照
+eu::Encoding two_pass_detect(std::string_view s) {
+    using eu::Encoding;
+    bool ascii = false;
+    switch (detail::validate_utf8_scalar(s.data(), s.size(), ascii)) {
+        case detail::Utf8Status::VALID: return ascii ? Encoding::ASCII : Encoding::UTF8;
+        case detail::Utf8Status::INCOMPLETE_SEQUENCE: return Encoding::UNKNOWN;
+        case detail::Utf8Status::INVALID_SEQUENCE: break;
+    }
+    if (const Encoding bom = detail::utf16_bom_encoding(s); bom != Encoding::UNKNOWN) return bom;
+    bool pending_lead = false;
+    if (detail::validate_gbk_prefix_scalar(s.data(), s.size(), pending_lead) == s.size() && !pending_lead) {
+        return Encoding::GBK;
+    }
+    int pending = 0;
+    if (detail::validate_gb18030_prefix_scalar(s.data(), s.size(), pending) == s.size() && pending == 0) {
+        return Encoding::GB18030;
+    }
+    return Encoding::UNKNOWN;
+}
+
+void check_detection(std::string_view s) {
+    const EncodingAnalysis analysis = eu::analyze_encoding(s);
+    FUZZ_EXPECT(analysis.encoding == two_pass_detect(s));
+    FUZZ_EXPECT(eu::detect_encoding(s) == analysis.encoding);
+    // 显式选用 Big5 时只会把 GBK 细分为 Big5，其他结论不变
+    const eu::Encoding with_big5 = eu::detect_encoding_with_big5(s);
+    FUZZ_EXPECT(with_big5 == analysis.encoding ||
+                (analysis.encoding == eu::Encoding::GBK && with_big5 == eu::Encoding::BIG5));
+    FUZZ_EXPECT(analysis.is_all_ascii == (detail::find_non_ascii(s.data(), s.size()) == s.size()));
+
+    // 两者都被否定时联合扫描会提前结束，此时只有较早的那个位置是确定的
+    int pending = 0;
+    bool ascii = true;
+    size_t utf8_at = detail::validate_utf8_prefix_scalar(s.data(), s.size(), pending, ascii);
+    if (utf8_at == s.size()) utf8_at = pending > 0 ? s.size() : EncodingAnalysis::npos;
+    bool pending_lead = false;
+    size_t gbk_at = detail::validate_gbk_prefix_scalar(s.data(), s.size(), pending_lead);
+    if (gbk_at == s.size()) gbk_at = pending_lead ? s.size() : EncodingAnalysis::npos;
+    if (utf8_at <= gbk_at) FUZZ_EXPECT(analysis.utf8_invalid_at == utf8_at);
+    if (gbk_at <= utf8_at) FUZZ_EXPECT(analysis.gbk_invalid_at == gbk_at);
+
+    for (const size_t max_chunk : {1, 7, 64, 1000}) {
+        eu::IncrementalDetector detector;
+        Splitter split(s, max_chunk);
+        for (size_t pos = 0; pos < s.size() && !detector.done();) {
+            const size_t len = split.next(s.size() - pos);
+            detector.feed(s.substr(pos, len));
+            pos += len;
+        }
+        FUZZ_EXPECT(same_analysis(detector.finish(), analysis));
+    }
+
+    eu::ParallelOptions options;
+    options.threads = 3;
+    options.min_chunk_size = 16;
+    FUZZ_EXPECT(same_analysis(eu::analyze_encoding(s, options), analysis));
+}
+
+// ========== GBK <-> UTF-8 转换 ==========
+#ifdef _WIN32
+// Windows 代码页 936 把 GBK 用户自定义区映射到 Unicode 私用区，与内置码表 (取自 glibc) 不同，这些输入不参与比较
+bool touches_user_defined_area(std::string_view s, bool source_is_gbk) {
+    const auto* p = reinterpret_cast<const unsigned char*>(s.data());
+    for (size_t i = 0; i < s.size(); ++i) {
+        if (p[i] < 0x80) continue;
+        if (source_is_gbk) {
+            if (i + 1 == s.size()) break;
+            detail::Big5Evidence evidence;
+            detail::add_big5_evidence(p[i], p[i + 1], evidence);
+            if (evidence.user_defined) return true;
+            ++i;
+        } else {
+            char32_t cp = 0;
+            const size_t len = detail::decode_utf8_char(p + i, s.size() - i, cp);
+            if (cp >= 0xE000 && cp <= 0xF8FF) return true;
+            if (len > 0) i += len - 1;
+        }
+    }
+    return false;
+}
+#endif
+
+ConvertError system_convert(std::string_view s, bool source_is_gbk, std::string& out, ErrorPolicy policy) {
+#ifdef _WIN32
+    return source_is_gbk ? detail::convert_win32(s, 936, CP_UTF8, out, policy)
+                         : detail::convert_win32(s, CP_UTF8, 936, out, policy);
+#else
+    return source_is_gbk ? detail::iconv_convert(s, "UTF-8", "GBK", out, policy)
+                         : detail::iconv_convert(s, "GBK", "UTF-8", out, policy);
+#endif
+}
+
+ConvertError native_convert(std::string_view s, bool source_is_gbk, std::string& out, ErrorPolicy policy) {
+    return source_is_gbk ? detail::native_convert(s, true, detail::native_gbk_segment_to_utf8, out, policy)
+                         : detail::native_convert(s, false, detail::native_utf8_segment_to_gbk, out, policy);
+}
+
+void check_backends(std::string_view s) {
+    for (const bool source_is_gbk : {true, false}) {
+#ifdef _WIN32
+        if (touches_user_defined_area(s, source_is_gbk)) continue;
+#endif
+        for (const ErrorPolicy policy :
+             {ErrorPolicy::STRICT, ErrorPolicy::REPLACE, ErrorPolicy::SKIP, ErrorPolicy::ESCAPE}) {
+            std::string system = "x", native = "x";
+            const ConvertError system_error = system_convert(s, source_is_gbk, system, policy);
+            const ConvertError native_error = native_convert(s, source_is_gbk, native, policy);
+            FUZZ_EXPECT(same_error(system_error, native_error));
+            if (!native_error) FUZZ_EXPECT(system == native);
+        }
+    }
+}
+
+// 按切块长度把 s 送入流式转换器，失败时返回 false
+bool transcode_in_chunks(std::string_view s, bool source_is_gbk, size_t max_chunk, std::string& out) {
+    using eu::Encoding;
+    eu::StreamTranscoder transcoder(source_is_gbk ? Encoding::GBK : Encoding::UTF8,
+                                    source_is_gbk ? Encoding::UTF8 : Encoding::GBK);
+    Splitter split(s, max_chunk);
+    try {
+        for (size_t pos = 0; pos < s.size();) {
+            const size_t len = split.next(s.size() - pos);
+            transcoder.feed(s.substr(pos, len), out);
+            pos += len;
+        }
+        transcoder.finish();
+    } catch (const std::runtime_error&) {
+        return false;
+    }
+    return true;
+}
+
+void check_conversion_paths(std::string_view s) {
+    eu::ParallelOptions options;
+    options.threads = 3;
+    options.min_chunk_size = 16;
+    for (const bool source_is_gbk : {true, false}) {
+        std::string whole;
+        const ConvertError error = source_is_gbk ? eu::try_gbk_to_utf8(s, whole) : eu::try_utf8_to_gbk(s, whole);
+
+        for (const size_t max_chunk : {1, 5, 100}) {
+            std::string chunked;
+            FUZZ_EXPECT(transcode_in_chunks(s, source_is_gbk, max_chunk, chunked) == !error);
+            if (!error) FUZZ_EXPECT(chunked == whole);
+        }
+
+        std::string parallel;
+        bool parallel_ok = true;
+        try {
+            parallel = source_is_gbk ? eu::gbk_to_utf8(s, options) : eu::utf8_to_gbk(s, options);
+        } catch (const std::runtime_error&) {
+            parallel_ok = false;
+        }
+        FUZZ_EXPECT(parallel_ok == !error);
+        if (!error) FUZZ_EXPECT(parallel == whole);
+    }
+
+    // 智能转换在乐观转换失败或结果可能有歧义时回到完整检测，结论必须与先检测再转换一致
+    const eu::DetectedView detected(s);
+    std::string fused = "x", reference = "x";
+    FUZZ_EXPECT(same_error(eu::try_to_utf8(s, fused), eu::try_to_utf8(detected, reference)));
+    FUZZ_EXPECT(fused == reference);
+    fused = reference = "x";
+    FUZZ_EXPECT(same_error(eu::try_to_gbk(s, fused), eu::try_to_gbk(detected, reference)));
+    FUZZ_EXPECT(fused == reference);
+}
+
+// ========== UTF-16 / UTF-32 转换 ==========
+template <typename Unit>
+void check_unicode_round_trip(std::string_view s) {
+    // 逐字符严格解码作为参照：得到合法前缀对应的码元与第一个坏序列的位置
+    std::basic_string<Unit> expected;
+    size_t bad_at = ConvertError::npos;
+    const auto* p = reinterpret_cast<const unsigned char*>(s.data());
+    for (size_t i = 0; i < s.size();) {
+        char32_t cp = p[i];
+        const size_t len = p[i] < 0x80 ? 1 : detail::decode_utf8_char(p + i, s.size() - i, cp);
+        if (len == 0) {
+            bad_at = i;
+            break;
+        }
+        Unit units[2];
+        expected.append(units, detail::put_code_point(cp, units));
+        i += len;
+    }
+
+    std::basic_string<Unit> decoded;
+    const ConvertError error = detail::utf8_to_unicode_append(s, decoded);
+    FUZZ_EXPECT(error.offset == bad_at);
+    if (!error) FUZZ_EXPECT(decoded == expected);
+
+    // 合法前缀编码回 UTF-8 必须得到原来的字节
+    std::string encoded;
+    FUZZ_EXPECT(!detail::unicode_to_utf8_append(std::basic_string_view<Unit>(expected), encoded));
+    FUZZ_EXPECT(encoded == s.substr(0, bad_at));
+}
+
+void check_unicode(std::string_view s) {
+    check_unicode_round_trip<char16_t>(s);
+    check_unicode_round_trip<char32_t>(s);
+
+    // GBK 直接解码为 UTF-16 与经由 UTF-8 中转的结果一致
+#ifdef _WIN32
+    if (touches_user_defined_area(s, true)) return;
+#endif
+    std::u16string direct;
+    const ConvertError direct_error = detail::gbk_to_unicode_append(s, direct);
+    std::string utf8;
+    const ConvertError utf8_error = detail::native_convert(s, true, detail::native_gbk_segment_to_utf8, utf8);
+    FUZZ_EXPECT(same_error(direct_error, utf8_error));
+    if (!direct_error) FUZZ_EXPECT(direct == eu::utf8_to_utf16(utf8));
+}
+
+}  // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    const std::string_view s(reinterpret_cast<const char*>(data), size);
+    g_input = s;
+    check_find_non_ascii(s);
+    check_utf8_validators(s);
+    check_gbk_validators(s);
+    check_detection(s);
+    check_backends(s);
+    check_conversion_paths(s);
+    check_unicode(s);
+    return 0;
+}
@@ -0,0 +1,94 @@
+// 不使用 libFuzzer 时 fuzz_differential.cpp 的入口 (GCC、MSVC 以及未开启 -fsanitize=fuzzer 的 Clang)：
+//   fuzz_differential_replay <文件或目录>...  逐个回放语料文件 (例如 libFuzzer 生成的 corpus 或 crash-* 文件)
+//   fuzz_differential_replay [轮数] [种子]    不给路径时按固定种子生成结构化的随机输入，默认 20000 轮
+// 出现差异时 fuzz_differential.cpp 会打印输入并 abort()，进程以非零状态退出。
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+namespace {
+
+void run_one(const std::string& input) {
+    LLVMFuzzerTestOneInput(reinterpret_cast<const uint8_t*>(input.data()), input.size());
+}
+
+bool replay_file(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        std::fprintf(stderr, "无法打开 %s\n", path.string().c_str());
+        return false;
+    }
+    run_one(std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()));
+    return true;
+}
+
+// 由各编码的典型片段拼接而成：ASCII 段的长度使拼接点经常落在 16/32/64 字节块的边界附近，
+// 多字节片段覆盖 GBK 与 UTF-8 都合法的歧义文本、用户自定义区、GB18030 四字节序列和 UTF-16 BOM
+std::string make_structured_input(std::mt19937_64& rng) {
+    static const char* const kPieces[] = {
+        "\xC4\xE3\xBA\xC3\xCA\xC0\xBD\xE7",                  // GBK "你好世界"
+        "\xE4\xBD\xA0\xE5\xA5\xBD\xE4\xB8\x96\xE7\x95\x8C",  // UTF-8 "你好世界"
+        "\xE4\xBD\xA0\xE5\xA5\xBD",                          // 同时是合法的 GBK
+        "\xC3\xA9\xD0\x96",                                  // UTF-8 双字节字符
+        "\xF0\x9F\x98\x82",                                  // UTF-8 四字节字符 (GBK 无法表示)
+        "\xEE\x80\x80\xEF\xA3\xBF",                          // UTF-8 私用区
+        "\x81\x40\xFE\xFE\xA1\xA1",                          // GBK 首字节与第二字节的边界
+        "\xA4\x40\xAA\xA1\xF9\xFE",                          // Big5 常用字与用户自定义区
+        "\x81\x30\x81\x30",                                  // GB18030 四字节序列
+        "\xFF\xFE",                                          // UTF-16LE BOM
+        "\x80",                                              // GBK 单字节欧元符号
+        "\xE4\xBD",                                          // 截断的 UTF-8
+        "\xC0\xAF\xED\xA0\x80\xF4\x90\x80\x80",              // 过长编码、代理区、超出 U+10FFFF
+    };
+    std::string s;
+    const size_t target = rng() % 8 == 0 ? rng() % 4096 : rng() % 300;
+    while (s.size() < target) {
+        const unsigned piece = rng() % (std::size(kPieces) + 3);
+        if (piece < std::size(kPieces)) {
+            s += kPieces[piece];
+        } else if (piece == std::size(kPieces)) {
+            s += static_cast<char>(rng());  // 任意字节
+        } else {
+            s.append(1 + rng() % 70, static_cast<char>('a' + rng() % 26));
+        }
+    }
+    if (!s.empty() && rng() % 3 == 0) s[rng() % s.size()] = static_cast<char>(rng());
+    if (!s.empty() && rng() % 5 == 0) s.resize(rng() % s.size());
+    return s;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    if (argc == 1 || !std::filesystem::exists(argv[1])) {
+        const unsigned long rounds = argc > 1 ? std::stoul(argv[1]) : 20000;
+        std::mt19937_64 rng(argc > 2 ? std::stoull(argv[2]) : 20241014);
+        for (unsigned long round = 0; round < rounds; ++round) run_one(make_structured_input(rng));
+        std::printf("fuzz_differential: %lu 个随机输入全部一致\n", rounds);
+        return 0;
+    }
+
+    size_t replayed = 0;
+    for (int i = 1; i < argc; ++i) {
+        const std::filesystem::path path(argv[i]);
+        if (std::filesystem::is_directory(path)) {
+            for (const auto& entry : std::filesystem::recursive_directory_iterator(path)) {
+                if (!entry.is_regular_file()) continue;
+                if (!replay_file(entry.path())) return 1;
+                ++replayed;
+            }
+        } else {
+            if (!replay_file(path)) return 1;
+            ++replayed;
+        }
+    }
+    std::printf("fuzz_differential: %zu 个语料文件全部一致\n", replayed);
+    return 0;
+}
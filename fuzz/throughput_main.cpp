@@ -0,0 +1,271 @@
+// 按输入类别记录各实现的吞吐量，并检查新实现相对参照实现是否变慢：
+//   fuzz_throughput [--tolerance 比例] [--rounds 轮数] [目录...]
+// 每个目录是一个输入类别 (其中的文件拼接为一段输入)；不给目录时使用内置的合成语料，每类约 1 MiB。
+// 计时前先把每类输入交给 fuzz_differential.cpp 做逐位比较。每一对实现交替计时若干轮 (默认 9 轮)，
+// 新实现吞吐量的中位数低于参照实现中位数的 (1 - tolerance) 倍 (默认 5%)，且新实现最快的一轮也不及参照实现最慢的一轮时，
+// 才算变慢，进程以非零状态退出；两者都受内存带宽限制等差距落在噪声内的情况不会误报。
+// 计时结果受机器负载影响，因此不注册到 CTest，在接受新的内核或后端之前用 Release 构建在安静的机器上手动运行。
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "encoding_util/encoding_util.hpp"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+namespace {
+
+namespace eu = encoding_util;
+namespace detail = encoding_util::detail;
+
+struct Corpus {
+    std::string name;
+    std::string data;
+};
+
+// ========== 语料 ==========
+// 按比例混合 ASCII 单词与给定的多字节字符，ratio 为多字节字符所占的比例 (0~100)
+std::string make_text(std::mt19937_64& rng, const std::vector<std::string_view>& chars, unsigned ratio) {
+    constexpr size_t kSize = 1 << 20;
+    std::string s;
+    s.reserve(kSize + 16);
+    while (s.size() < kSize) {
+        if (!chars.empty() && rng() % 100 < ratio) {
+            s += chars[rng() % chars.size()];
+        } else {
+            s.append(1 + rng() % 8, static_cast<char>('a' + rng() % 26));
+            s += ' ';
+        }
+    }
+    return s;
+}
+
+std::vector<Corpus> builtin_corpora() {
+    const std::vector<std::string_view> utf8 = {"\xE4\xBD\xA0", "\xE5\xA5\xBD", "\xE4\xB8\x96", "\xE7\x95\x8C",
+                                                "\xE7\xBC\x96", "\xE7\xA0\x81", "\xC3\xA9"};
+    const std::vector<std::string_view> gbk = {"\xC4\xE3", "\xBA\xC3", "\xCA\xC0", "\xBD\xE7", "\xB1\xE0", "\xC2\xEB"};
+    const std::vector<std::string_view> big5 = {"\xA7\x41", "\xA6\x6E", "\xA5\x40", "\xAC\xC9", "\xBD\x73"};
+    std::mt19937_64 rng(20241014);
+    return {
+        {"ascii", make_text(rng, {}, 0)},
+        {"utf8_mixed", make_text(rng, utf8, 10)},
+        {"utf8_cjk", make_text(rng, utf8, 95)},
+        {"gbk_mixed", make_text(rng, gbk, 10)},
+        {"gbk_cjk", make_text(rng, gbk, 95)},
+        {"big5_cjk", make_text(rng, big5, 95)},
+    };
+}
+
+bool load_corpus(const std::filesystem::path& dir, Corpus& corpus) {
+    corpus.name = dir.filename().string();
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(dir)) {
+        if (!entry.is_regular_file()) continue;
+        std::ifstream file(entry.path(), std::ios::binary);
+        if (!file) {
+            std::fprintf(stderr, "无法打开 %s\n", entry.path().string().c_str());
+            return false;
+        }
+        corpus.data.append(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+    return true;
+}
+
+// ========== 计时 ==========
+// 一轮至少运行 50 ms，单位 MB/s
+double measure(const std::function<void()>& run, size_t bytes) {
+    using Clock = std::chrono::steady_clock;
+    size_t iterations = 0;
+    const auto start = Clock::now();
+    auto elapsed = Clock::duration::zero();
+    do {
+        run();
+        ++iterations;
+        elapsed = Clock::now() - start;
+    } while (elapsed < std::chrono::milliseconds(50));
+    const double seconds = std::chrono::duration<double>(elapsed).count();
+    return static_cast<double>(bytes) * static_cast<double>(iterations) / seconds / 1e6;
+}
+
+double median(std::vector<double> samples) {
+    std::sort(samples.begin(), samples.end());
+    const size_t mid = samples.size() / 2;
+    return samples.size() % 2 ? samples[mid] : (samples[mid - 1] + samples[mid]) / 2;
+}
+
+/// 同一功能的参照实现与待接受的实现；applies 为空表示适用于所有语料
+struct Pair {
+    const char* name;
+    std::function<void(std::string_view)> reference;
+    std::function<void(std::string_view)> candidate;
+    std::function<bool(std::string_view)> applies;
+};
+
+// 防止被测调用的结果被优化掉
+volatile size_t g_sink;
+
+// 验证器遇到第一个坏字节就返回，只在整段合法的语料上比较才是在比较同样的工作量
+bool is_ascii(std::string_view s) { return detail::find_non_ascii(s.data(), s.size()) == s.size(); }
+
+bool is_utf8(std::string_view s) {
+    bool ascii = false;
+    return detail::validate_utf8_scalar(s.data(), s.size(), ascii) == detail::Utf8Status::VALID;
+}
+
+bool is_gbk(std::string_view s) {
+    bool pending = false;
+    return detail::validate_gbk_prefix_scalar(s.data(), s.size(), pending) == s.size();
+}
+
+eu::ConvertError system_convert(std::string_view s, bool source_is_gbk, std::string& out) {
+#ifdef _WIN32
+    return source_is_gbk ? detail::convert_win32(s, 936, CP_UTF8, out, eu::ErrorPolicy::REPLACE)
+                         : detail::convert_win32(s, CP_UTF8, 936, out, eu::ErrorPolicy::REPLACE);
+#else
+    return source_is_gbk ? detail::iconv_convert(s, "UTF-8", "GBK", out, eu::ErrorPolicy::REPLACE)
+                         : detail::iconv_convert(s, "GBK", "UTF-8", out, eu::ErrorPolicy::REPLACE);
+#endif
+}
+
+eu::ConvertError native_convert(std::string_view s, bool source_is_gbk, std::string& out) {
+    return source_is_gbk ? detail::native_convert(s, true, detail::native_gbk_segment_to_utf8, out,
+                                                  eu::ErrorPolicy::REPLACE)
+                         : detail::native_convert(s, false, detail::native_utf8_segment_to_gbk, out,
+                                                  eu::ErrorPolicy::REPLACE);
+}
+
+std::vector<Pair> make_pairs() {
+    std::vector<Pair> pairs;
+    pairs.push_back({"find_non_ascii",
+                     [](std::string_view s) {
+                         size_t i = 0;
+                         while (i < s.size() && static_cast<unsigned char>(s[i]) < 0x80) ++i;
+                         g_sink = i;
+                     },
+                     [](std::string_view s) { g_sink = detail::find_non_ascii(s.data(), s.size()); }, is_ascii});
+    pairs.push_back({"validate_utf8",
+                     [](std::string_view s) {
+                         bool ascii = false;
+                         g_sink = static_cast<size_t>(detail::validate_utf8_scalar(s.data(), s.size(), ascii));
+                     },
+                     [](std::string_view s) {
+                         bool ascii = false;
+                         g_sink = static_cast<size_t>(detail::validate_utf8(s.data(), s.size(), ascii));
+                     },
+                     is_utf8});
+    pairs.push_back({"validate_gbk",
+                     [](std::string_view s) {
+                         bool pending = false;
+                         g_sink = detail::validate_gbk_prefix_scalar(s.data(), s.size(), pending);
+                     },
+                     [](std::string_view s) {
+                         bool pending = false;
+                         g_sink = detail::validate_gbk_prefix(s.data(), s.size(), pending);
+                     },
+                     is_gbk});
+    pairs.push_back({"validate_gb18030",
+                     [](std::string_view s) {
+                         int pending = 0;
+                         g_sink = detail::validate_gb18030_prefix_scalar(s.data(), s.size(), pending);
+                     },
+                     [](std::string_view s) {
+                         int pending = 0;
+                         g_sink = detail::validate_gb18030_prefix(s.data(), s.size(), pending);
+                     },
+                     is_gbk});
+    // 旧的多遍检测 (先验证 UTF-8，失败后再验证 GBK) 对比单遍联合检测
+    pairs.push_back({"detect",
+                     [](std::string_view s) {
+                         bool ascii = false;
+                         if (detail::validate_utf8_scalar(s.data(), s.size(), ascii) == detail::Utf8Status::VALID) {
+                             g_sink = ascii;
+                             return;
+                         }
+                         bool pending = false;
+                         g_sink = detail::validate_gbk_prefix_scalar(s.data(), s.size(), pending);
+                     },
+                     [](std::string_view s) { g_sink = static_cast<size_t>(eu::analyze_encoding(s).encoding); },
+                     {}});
+    for (const bool source_is_gbk : {true, false}) {
+        pairs.push_back({source_is_gbk ? "gbk_to_utf8" : "utf8_to_gbk",
+                         [source_is_gbk](std::string_view s) {
+                             std::string out;
+                             system_convert(s, source_is_gbk, out);
+                             g_sink = out.size();
+                         },
+                         [source_is_gbk](std::string_view s) {
+                             std::string out;
+                             native_convert(s, source_is_gbk, out);
+                             g_sink = out.size();
+                         },
+                         source_is_gbk ? is_gbk : is_utf8});
+    }
+    return pairs;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    double tolerance = 0.05;
+    int rounds = 9;
+    std::vector<Corpus> corpora;
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg(argv[i]);
+        if (arg == "--tolerance" && i + 1 < argc) {
+            tolerance = std::stod(argv[++i]);
+            continue;
+        }
+        if (arg == "--rounds" && i + 1 < argc) {
+            rounds = std::max(1, std::stoi(argv[++i]));
+            continue;
+        }
+        Corpus corpus;
+        if (!load_corpus(argv[i], corpus)) return 1;
+        corpora.push_back(std::move(corpus));
+    }
+    if (corpora.empty()) corpora = builtin_corpora();
+
+    const std::vector<Pair> pairs = make_pairs();
+    bool slower = false;
+    std::printf("%-12s %-18s %12s %12s %8s   (%d 轮的中位数)\n", "corpus", "function", "ref MB/s", "new MB/s", "ratio",
+                rounds);
+    for (const Corpus& corpus : corpora) {
+        // 不一致时 fuzz_differential.cpp 打印输入并 abort()
+        LLVMFuzzerTestOneInput(reinterpret_cast<const uint8_t*>(corpus.data.data()), corpus.data.size());
+        for (const Pair& pair : pairs) {
+            const std::string_view s(corpus.data);
+            if (pair.applies && !pair.applies(s)) continue;
+            // 交替计时，使频率调节与机器负载的变化同样落在两者身上
+            std::vector<double> references, candidates;
+            for (int round = 0; round < rounds; ++round) {
+                references.push_back(measure([&] { pair.reference(s); }, s.size()));
+                candidates.push_back(measure([&] { pair.candidate(s); }, s.size()));
+            }
+            const double reference = median(references);
+            const double candidate = median(candidates);
+            // 两组测量有重叠 (新实现最快的一轮不慢于参照实现最慢的一轮) 时差距视为噪声
+            const bool overlaps = *std::max_element(candidates.begin(), candidates.end()) >=
+                                  *std::min_element(references.begin(), references.end());
+            const bool regressed = candidate < reference * (1 - tolerance) && !overlaps;
+            slower = slower || regressed;
+            std::printf("%-12s %-18s %12.1f %12.1f %7.2fx%s\n", corpus.name.c_str(), pair.name, reference,
+                        candidate, candidate / reference, regressed ? "  SLOWER" : "");
+        }
+    }
+    if (slower) {
+        std::printf("fuzz_throughput: 有实现慢于参照实现超过 %.0f%%\n", tolerance * 100);
+        return 1;
+    }
+    std::printf("fuzz_throughput: 全部逐位一致且不慢于参照实现\n");
+    return 0;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#define ENCODING_UTIL_COMPILED_HPP 1
+
+// 编译版 (非 header-only) 的精简公共头文件，配合 CMake 目标 EncodingUtil::encoding_util_static 使用。
+// 只声明以 std::string 为结果的常用接口，实现 (SIMD 内核、码表、iconv / Win32 后端) 只在 src/encoding_util.cpp
+// 中编译一次，因此包含本文件不会引入 <windows.h>、<iconv.h> 或码表；只有 ASCII 检查这类热路径留作内联。
+// 需要追加/定长缓冲区、流式、批量、并行或文件接口时，请改用 header-only 的 encoding_util.hpp。
+
+#include <string>
+#include <string_view>
+
+#include "detail/common.hpp"
+
+namespace encoding_util {
+namespace compiled {
+
+// ========== 检测接口 ==========
+/**
+ * @brief 检查字符串是否只含 ASCII 字节，内联实现，不经过库。
+ */
+inline bool is_ascii(std::string_view sv) noexcept {
+    return detail::find_non_ascii_scalar(sv.data(), sv.size()) == sv.size();
+}
+
+/**
+ * @brief 检测字节序列的编码并给出各候选编码被否定的位置，与 encoding_util.hpp 中的同名函数相同。
+ */
+EncodingAnalysis analyze_encoding(std::string_view sv);
+
+/**
+ * @brief 检测字节序列的编码格式，与 encoding_util.hpp 中的同名函数相同 (但不能在编译期求值)。
+ */
+Encoding detect_encoding(std::string_view sv);
+
+/**
+ * @brief 检测编码并允许把合法的 GBK 输入判为 Big5，与 encoding_util.hpp 中的同名函数相同。
+ */
+Encoding detect_encoding_with_big5(std::string_view sv);
+
+/**
+ * @brief 检查一个字符串是否为有效的 UTF-8 或 ASCII 编码。
+ */
+bool is_utf8(std::string_view sv);
+
+/**
+ * @brief 检查一个字符串是否为有效的 GBK 或 ASCII 编码。
+ */
+bool is_gbk(std::string_view sv);
+
+// ========== 转换接口 ==========
+/**
+ * @brief 将 GBK 编码的字符串转换为 UTF-8。
+ * @throws std::runtime_error 坏序列且 policy 为 STRICT 时，或系统转换接口出错时。
+ */
+std::string gbk_to_utf8(std::string_view gbk_sv, ErrorPolicy policy = ErrorPolicy::STRICT);
+
+/**
+ * @brief 将 UTF-8 编码的字符串转换为 GBK。
+ * @throws std::runtime_error 坏序列或无法表示的字符且 policy 为 STRICT 时，或系统转换接口出错时。
+ */
+std::string utf8_to_gbk(std::string_view utf8_sv, ErrorPolicy policy = ErrorPolicy::STRICT);
+
+/**
+ * @brief 在任意两种支持的编码之间转换。
+ * @throws std::runtime_error 如果编码组合不受支持或转换失败。
+ */
+std::string convert(std::string_view input, Encoding from, Encoding to);
+
+/**
+ * @brief (智能转换) 检测编码后转换为 UTF-8，输入已是 UTF-8 或 ASCII 时直接返回其拷贝。
+ * @throws std::runtime_error 如果输入编码未知或转换失败。
+ */
+std::string to_utf8(std::string_view sv);
+
+/**
+ * @brief (智能转换) 检测编码后转换为 GBK，输入已是 GBK 或 ASCII 时直接返回其拷贝。
+ * @throws std::runtime_error 如果输入编码未知或转换失败。
+ */
+std::string to_gbk(std::string_view sv);
+
+// ========== 不抛异常的转换接口 ==========
+// 结果追加到 out 末尾，失败时 out 保持原样；错误信息的含义与 encoding_util.hpp 中的同名接口相同。
+
+ConvertError try_gbk_to_utf8(std::string_view gbk_sv, std::string& out,
+                             ErrorPolicy policy = ErrorPolicy::STRICT) noexcept;
+ConvertError try_utf8_to_gbk(std::string_view utf8_sv, std::string& out,
+                             ErrorPolicy policy = ErrorPolicy::STRICT) noexcept;
+ConvertError try_convert(std::string_view input, Encoding from, Encoding to, std::string& out) noexcept;
+ConvertError try_to_utf8(std::string_view sv, std::string& out) noexcept;
+ConvertError try_to_gbk(std::string_view sv, std::string& out) noexcept;
+}  // namespace compiled
+
+// 让 encoding_util::to_utf8(...) 等写法无需修改即可使用编译版。同一个翻译单元需要同时包含两者时，
+// encoding_util.hpp 必须在前，此后以 encoding_util:: 限定的调用仍解析到 header-only 的实现
+using namespace compiled;
+
+}  // namespace encoding_util
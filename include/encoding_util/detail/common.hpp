@@ -0,0 +1,125 @@
+#pragma once
+
+// encoding_util.hpp 与 compiled.hpp 共用的公共类型与 ASCII 快速路径，两者可以出现在同一个翻译单元中。
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+namespace encoding_util {
+
+/**
+ * @enum Encoding
+ * @brief 表示字符编码类型的枚举。
+ */
+enum class Encoding {
+    UNKNOWN,  // 未知编码
+    ASCII,    // 纯ASCII
+    GBK,      // GBK编码
+    UTF8,     // UTF-8编码
+    GB18030,  // GB18030编码 (含四字节序列，GBK的超集)
+    BIG5,     // Big5编码 (繁体中文)
+    UTF16LE,  // 带BOM的UTF-16小端序
+    UTF16BE   // 带BOM的UTF-16大端序
+};
+
+/**
+ * @struct EncodingAnalysis
+ * @brief analyze_encoding() 的结果：检测出的编码，以及各候选编码被否定的位置。
+ */
+struct EncodingAnalysis {
+    static constexpr size_t npos = std::string_view::npos;
+
+    Encoding encoding = Encoding::UNKNOWN;  // 与 detect_encoding() 的结果相同
+    bool is_all_ascii = true;               // 输入是否全部为ASCII字节
+    size_t utf8_invalid_at = npos;  // UTF-8 被否定的字节偏移；输入在多字节序列中间截断时为输入长度；未被否定为 npos
+    size_t gbk_invalid_at = npos;   // GBK 被否定的字节偏移，含义同上
+};
+
+// ========== 转换错误码 ==========
+/**
+ * @enum ConvertErrc
+ * @brief 转换失败的原因。
+ */
+enum class ConvertErrc {
+    NONE,                 // 转换成功
+    UNKNOWN_ENCODING,     // 输入的编码无法识别 (智能转换接口)，或指定的编码不受支持
+    INVALID_SEQUENCE,     // 输入包含无效的字节序列
+    INCOMPLETE_SEQUENCE,  // 输入在一个不完整的多字节字符处结束
+    UNREPRESENTABLE,      // 输入中的字符无法在目标编码中表示
+    SYSTEM_ERROR,         // 系统转换接口 (iconv / Win32) 本身出错
+};
+
+/**
+ * @enum ErrorPolicy
+ * @brief 转换时遇到无效输入或目标编码无法表示的字符时的处理策略。
+ * @details 无效或不完整的输入序列一律先视为 U+FFFD，再按目标编码能否表示它来处理。
+ */
+enum class ErrorPolicy {
+    STRICT,   // 报告错误 (抛出异常或返回 ConvertError)
+    REPLACE,  // 替换为 '?' (目标为 GBK) 或 U+FFFD (目标为 UTF-8)
+    SKIP,     // 直接丢弃
+    ESCAPE,   // 写成 "&#x1F602;" 形式的十六进制字符引用；目标为 UTF-8 时无效输入仍写作 U+FFFD
+};
+
+/**
+ * @struct ConvertError
+ * @brief 不抛异常的转换接口返回的错误信息，code 为 NONE 时表示成功。
+ */
+struct ConvertError {
+    static constexpr size_t npos = std::string_view::npos;
+
+    ConvertErrc code = ConvertErrc::NONE;
+    size_t offset = npos;  // 出错的字符在输入中的字节偏移，无法定位时为 npos
+    int system_error = 0;  // SYSTEM_ERROR 时对应的 errno 或 GetLastError()
+
+    /// 是否发生了错误。
+    constexpr explicit operator bool() const noexcept { return code != ConvertErrc::NONE; }
+
+    /// 生成可读的错误描述。
+    std::string message() const {
+        std::string text;
+        switch (code) {
+            case ConvertErrc::NONE: return "转换成功。";
+            case ConvertErrc::UNKNOWN_ENCODING: text = "输入字符串的编码无法识别"; break;
+            case ConvertErrc::INVALID_SEQUENCE: text = "输入包含无效的字节序列"; break;
+            case ConvertErrc::INCOMPLETE_SEQUENCE: text = "输入在一个不完整的多字节字符处结束"; break;
+            case ConvertErrc::UNREPRESENTABLE: text = "字符串中包含无法在目标编码中表示的字符"; break;
+            case ConvertErrc::SYSTEM_ERROR: text = "系统转换接口出错，错误码：" + std::to_string(system_error); break;
+        }
+        if (offset != npos) text += "，偏移：" + std::to_string(offset);
+        return text + "。";
+    }
+};
+
+namespace detail {
+// ---------- ASCII 快速跳过 ----------
+/**
+ * @brief (内部实现) 按 8 字节一组查找第一个非ASCII字节(>= 0x80)的标量版本。
+ * @return 第一个非ASCII字节的偏移；若全部为ASCII则返回 size。
+ */
+inline size_t find_non_ascii_scalar(const char* data, size_t size) {
+    constexpr uint64_t kHighBits = 0x8080808080808080ULL;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, sizeof(word));
+        if (const uint64_t high = word & kHighBits; high != 0) {
+            if constexpr (std::endian::native == std::endian::little) {
+                return i + static_cast<size_t>(std::countr_zero(high)) / 8;
+            } else {
+                return i + static_cast<size_t>(std::countl_zero(high)) / 8;
+            }
+        }
+    }
+    for (; i < size; ++i) {
+        if (static_cast<unsigned char>(data[i]) > 0x7F) return i;
+    }
+    return i;
+}
+}  // namespace detail
+
+}  // namespace encoding_util
@@ -1,334 +1,6419 @@
 #pragma once
 
+// compiled.hpp 把编译版接口引入了 encoding_util 命名空间，之后再包含本文件会使其中的调用产生歧义
+#if defined(ENCODING_UTIL_COMPILED_HPP)
+    #error "encoding_util.hpp 必须在 compiled.hpp 之前包含"
+#endif
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <cmath>
+#include <concepts>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <memory_resource>
+#include <span>
 #include <stdexcept>
 #include <string>
 #include <string_view>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <variant>
 #include <vector>
+#include <version>
+#if defined(__cpp_lib_expected)
+    #include <expected>
+#endif
+
+// 运行时统计所需的头文件，只在定义 ENCODING_UTIL_ENABLE_METRICS 时引入
+#if defined(ENCODING_UTIL_ENABLE_METRICS)
+    #include <chrono>
+    #include <mutex>
+#endif
 
 // 平台相关的头文件
 #ifdef _WIN32
     #include <windows.h>
 #else
     #include <errno.h>
+    #include <fcntl.h>
     #include <iconv.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <sys/uio.h>
+    #include <unistd.h>
+    // 定义 ENCODING_UTIL_USE_IO_URING 后，transcode_files() 在 Linux 上通过系统调用直接使用 io_uring，不依赖 liburing。
+    // 默认不开启，以免每个包含本头文件的翻译单元都引入 <linux/io_uring.h>
+    #if defined(ENCODING_UTIL_USE_IO_URING) && defined(__linux__) && __has_include(<linux/io_uring.h>)
+        #include <linux/io_uring.h>
+        #include <sys/syscall.h>
+        #if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+            #define ENCODING_UTIL_IO_URING 1
+        #endif
+    #endif
+#endif
+
+#include "detail/common.hpp"
+#include "detail/gbk_tables.hpp"
+
+// SIMD 相关的头文件，定义 ENCODING_UTIL_NO_SIMD 可强制只使用标量实现
+#if !defined(ENCODING_UTIL_NO_SIMD)
+    #if defined(__x86_64__) || defined(_M_X64)
+        #define ENCODING_UTIL_SIMD_X86 1
+        #ifdef _MSC_VER
+            #include <intrin.h>
+        #endif
+        #include <immintrin.h>
+    #elif defined(__aarch64__) || defined(_M_ARM64)
+        #define ENCODING_UTIL_SIMD_NEON 1
+        #include <arm_neon.h>
+    #endif
+#endif
+
+// GCC/Clang 需要为使用 AVX2 指令的函数单独开启目标特性，MSVC 则无需处理
+#if defined(ENCODING_UTIL_SIMD_X86) && (defined(__GNUC__) || defined(__clang__))
+    #define ENCODING_UTIL_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+    #define ENCODING_UTIL_TARGET_AVX2
 #endif
 
 namespace encoding_util {
 
+// ========== 运行时统计 (可选) ==========
+// 定义 ENCODING_UTIL_ENABLE_METRICS 后，检测、系统转换器 (iconv / Win32)、内置码表与智能转换接口会记录
+// 调用次数、输入字节数与耗时分布，抛出的异常也会计数，通过 metrics::snapshot() 导出；
+// 计数器按线程存放，只有所属线程写入，使用 relaxed 原子操作。未定义时记录点都是空函数，不产生任何开销。
+namespace metrics {
+
 /**
- * @enum Encoding
- * @brief 表示字符编码类型的枚举。
+ * @brief 被统计的操作。
  */
-enum class Encoding {
-    UNKNOWN,  // 未知编码
-    ASCII,    // 纯ASCII
-    GBK,      // GBK编码
-    UTF8      // UTF-8编码
+enum class Operation {
+    DETECT,          // 编码检测 (detect_encoding / analyze_encoding，含智能转换内部的检测)
+    SYSTEM_CONVERT,  // 系统转换器：iconv_convert / convert_win32
+    NATIVE_CONVERT,  // 内置码表转换
+    SMART_CONVERT,   // 智能转换：to_utf8 / to_gbk 及其变体 (耗时包含其中的检测与转换)
+    PASSTHROUGH,     // 智能转换中输入已是目标编码、直接复制或借用输入的情形 (不单独计时)
 };
 
-namespace detail {
+inline constexpr size_t kNumOperations = 5;
 
-enum class Utf8Status { VALID, INVALID_SEQUENCE, INCOMPLETE_SEQUENCE };
+// 耗时直方图：第 k 个桶统计耗时在 [2^(k-1), 2^k) 纳秒内的调用 (第 0 个桶为不足 1 纳秒，最后一个桶包含更长的耗时)
+inline constexpr size_t kLatencyBuckets = 32;
 
 /**
- * @brief (内部实现) 检查一个字节序列是否是合法的GBK编码。
- * @details
- * GBK编码规则如下：
- * - 单字节: 范围 `0x00` - `0x7F`。 (二进制: `0xxxxxxx`)
- * - 双字节:
- *   - 高位字节 (Lead Byte):  范围 `0x81` - `0xFE`。
- *   - 低位字节 (Trail Byte): 范围 `0x40` - `0xFE`，但不包括 `0x7F`。
+ * @brief 操作的名称，可直接用作导出到监控系统的指标名。
  */
-inline bool is_valid_gbk(const char* data, size_t size) {
-    for (size_t i = 0; i < size; ++i) {
-        unsigned char byte = data[i];
-        if (byte <= 0x7F) continue;           // 单字节ASCII
-        if (byte >= 0x81 && byte <= 0xFE) {   // 双字节首字节
-            if (i + 1 >= size) return false;  // 缺少第二字节
-            unsigned char trail_byte = data[++i];
-            if (trail_byte < 0x40 || trail_byte > 0xFE || trail_byte == 0x7F) return false;  // 第二字节无效
-        } else {
-            return false;  // 非法首字节
-        }
+constexpr const char* operation_name(Operation operation) {
+    switch (operation) {
+        case Operation::DETECT: return "detect";
+        case Operation::SYSTEM_CONVERT: return "system_convert";
+        case Operation::NATIVE_CONVERT: return "native_convert";
+        case Operation::SMART_CONVERT: return "smart_convert";
+        case Operation::PASSTHROUGH: return "passthrough";
     }
-    return true;
+    return "";
 }
 
 /**
- * @brief (内部实现) 验证一个字节序列是否是UTF-8，并返回详细状态。
- * @details
- * UTF-8 编码规则：
- *    - 单字节: `0xxxxxxx`
- *    - 双字节: `110xxxxx 10xxxxxx`
- *    - 三字节: `1110xxxx 10xxxxxx 10xxxxxx`
- *    - 四字节: `11110xxx 10xxxxxx 10xxxxxx 10xxxxxx`
+ * @brief 单个操作的统计。
  */
-inline Utf8Status validate_utf8(const char* data, size_t size, bool& out_is_all_ascii) {
-    out_is_all_ascii = true;
-    int bytes_to_check = 0;
-    for (size_t i = 0; i < size; ++i) {
-        unsigned char byte = static_cast<unsigned char>(data[i]);
-        if (byte > 0x7F) out_is_all_ascii = false;  // 非ASCII
-        if (bytes_to_check > 0) {
-            if ((byte & 0xC0) != 0x80) return Utf8Status::INVALID_SEQUENCE;  // 非法后续字节
-            bytes_to_check--;
-        } else if (byte >= 0xC2 && byte <= 0xDF) {
-            bytes_to_check = 1;  // 2字节序列
-        } else if (byte >= 0xE0 && byte <= 0xEF) {
-            bytes_to_check = 2;  // 3字节序列
-        } else if (byte >= 0xF0 && byte <= 0xF4) {
-            bytes_to_check = 3;  // 4字节序列
-        } else if (byte >= 0x80) {
-            return Utf8Status::INVALID_SEQUENCE;  // 非法首字节
-        }
+struct OperationStats {
+    uint64_t calls = 0;                               // 调用次数
+    uint64_t bytes = 0;                               // 输入字节数之和
+    std::array<uint64_t, kLatencyBuckets> latency{};  // 耗时直方图，桶的划分见 kLatencyBuckets
+};
+
+/**
+ * @brief 所有线程 (含已退出的线程) 的统计之和。
+ */
+struct Snapshot {
+    std::array<OperationStats, kNumOperations> operations{};
+    uint64_t exceptions = 0;  // 本库抛出的 std::runtime_error 个数
+
+    OperationStats& operator[](Operation operation) { return operations[static_cast<size_t>(operation)]; }
+    const OperationStats& operator[](Operation operation) const {
+        return operations[static_cast<size_t>(operation)];
     }
-    return (bytes_to_check == 0) ? Utf8Status::VALID : Utf8Status::INCOMPLETE_SEQUENCE;
-}
-}  // namespace detail
+};
 
+// 是否在编译时开启了统计
+#if defined(ENCODING_UTIL_ENABLE_METRICS)
+inline constexpr bool kEnabled = true;
+#else
+inline constexpr bool kEnabled = false;
+#endif
+}  // namespace metrics
 
+namespace detail {
+#if defined(ENCODING_UTIL_ENABLE_METRICS)
 /**
- * @brief 检测给定字节序列的编码格式。
- *
- * @details
- * 此函数通过严格的规则验证来判断编码。
- * 检测逻辑：
- * 1. 优先验证是否为UTF-8。
- *    - 如果是完整的UTF-8，则返回 Encoding::UTF8 或 Encoding::ASCII。
- *    - 如果是不完整的UTF-8，立即返回 Encoding::UNKNOWN，因为它很可能是被截断的文件。
- * 2. 如果是无效的UTF-8序列，再检查是否为合法的GBK编码。
- * 3. 如果是GBK，则返回 Encoding::GBK。
- * 4. 如果所有检查都失败，则返回 Encoding::UNKNOWN。
+ * @brief (内部实现) 单个线程的计数器，只由所属线程写入，快照时由其他线程读取。
  */
-inline Encoding detect_encoding(std::string_view sv) {
-    if (sv.empty()) return Encoding::ASCII;
+struct ThreadMetrics {
+    struct Operation {
+        std::atomic<uint64_t> calls{0};
+        std::atomic<uint64_t> bytes{0};
+        std::array<std::atomic<uint64_t>, metrics::kLatencyBuckets> latency{};
+    };
+
+    std::array<Operation, metrics::kNumOperations> operations;
+    std::atomic<uint64_t> exceptions{0};
 
-    bool is_all_ascii = false;
-    detail::Utf8Status utf8_status = detail::validate_utf8(sv.data(), sv.size(), is_all_ascii);
+    // 只有一个写入者，读-改-写不必是原子的，避免带锁前缀的指令
+    static void add(std::atomic<uint64_t>& counter, uint64_t n) {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
 
-    switch (utf8_status) {
-        case detail::Utf8Status::VALID: return is_all_ascii ? Encoding::ASCII : Encoding::UTF8;
-        case detail::Utf8Status::INCOMPLETE_SEQUENCE:
-            return Encoding::UNKNOWN;  // 不完整的UTF-8序列被视为未知，以避免误判
-        case detail::Utf8Status::INVALID_SEQUENCE:
-            // 如果不是有效的UTF-8，继续检查是否为GBK
-            if (detail::is_valid_gbk(sv.data(), sv.size())) {
-                return Encoding::GBK;
+    void accumulate_into(metrics::Snapshot& total) const {
+        for (size_t op = 0; op < metrics::kNumOperations; ++op) {
+            total.operations[op].calls += operations[op].calls.load(std::memory_order_relaxed);
+            total.operations[op].bytes += operations[op].bytes.load(std::memory_order_relaxed);
+            for (size_t k = 0; k < metrics::kLatencyBuckets; ++k) {
+                total.operations[op].latency[k] += operations[op].latency[k].load(std::memory_order_relaxed);
             }
-            return Encoding::UNKNOWN;
+        }
+        total.exceptions += exceptions.load(std::memory_order_relaxed);
     }
-    return Encoding::UNKNOWN;
+};
+
+/**
+ * @brief (内部实现) 登记所有存活线程的计数器；线程退出时把它的计数并入 retired。
+ * reset() 只记录当时的总和作为基线，不改动其他线程的计数器。
+ */
+struct MetricsRegistry {
+    std::mutex mutex;
+    std::vector<const ThreadMetrics*> threads;
+    metrics::Snapshot retired;
+    metrics::Snapshot baseline;
+
+    metrics::Snapshot total_locked() const {
+        metrics::Snapshot total = retired;
+        for (const ThreadMetrics* thread : threads) thread->accumulate_into(total);
+        return total;
+    }
+};
+
+inline MetricsRegistry& metrics_registry() {
+    static MetricsRegistry registry;
+    return registry;
 }
 
 /**
- * @brief 检查一个字符串是否为有效的 UTF-8 或 ASCII 编码。
- * @param sv 要检查的字符串视图。
- * @return 如果是 UTF-8 或 ASCII，则为 true；否则为 false。
+ * @brief (内部实现) 当前线程的计数器，首次使用时登记，线程退出时注销。
  */
-inline bool is_utf8(std::string_view sv) {
-    Encoding enc = detect_encoding(sv);
-    return enc == Encoding::UTF8 || enc == Encoding::ASCII;
+inline ThreadMetrics& thread_metrics() {
+    struct Slot {
+        ThreadMetrics metrics;
+        Slot() {
+            MetricsRegistry& registry = metrics_registry();
+            const std::lock_guard<std::mutex> lock(registry.mutex);
+            registry.threads.push_back(&metrics);
+        }
+        ~Slot() {
+            MetricsRegistry& registry = metrics_registry();
+            const std::lock_guard<std::mutex> lock(registry.mutex);
+            metrics.accumulate_into(registry.retired);
+            std::erase(registry.threads, &metrics);
+        }
+    };
+    thread_local Slot slot;
+    return slot.metrics;
+}
+
+inline uint64_t metrics_now_ns() {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+            .count());
 }
 
 /**
- * @brief 检查一个字符串是否为有效的 GBK 或 ASCII 编码。
- * @param sv 要检查的字符串视图。
- * @return 如果是 GBK 或 ASCII，则为 true；否则为 false。
+ * @brief (内部实现) 记录一次不计时的操作。
  */
-inline bool is_gbk(std::string_view sv) {
-    Encoding enc = detect_encoding(sv);
-    return enc == Encoding::GBK || enc == Encoding::ASCII;
+inline void record_operation(metrics::Operation operation, size_t bytes) {
+    ThreadMetrics::Operation& stats = thread_metrics().operations[static_cast<size_t>(operation)];
+    ThreadMetrics::add(stats.calls, 1);
+    ThreadMetrics::add(stats.bytes, bytes);
 }
 
-#ifdef _WIN32
+inline void record_exception() { ThreadMetrics::add(thread_metrics().exceptions, 1); }
 
-// ========== Windows 平台实现 (Win32 API) ==========
-namespace detail {
-inline std::string convert_win32(std::string_view input, UINT from_cp, UINT to_cp) {
-    if (input.empty()) {
-        return "";
+/**
+ * @brief (内部实现) 构造时记录一次操作，析构时把经过的时间记入该操作的耗时直方图。
+ */
+class OperationProbe {
+public:
+    OperationProbe(metrics::Operation operation, size_t bytes)
+        : stats_(thread_metrics().operations[static_cast<size_t>(operation)]) {
+        ThreadMetrics::add(stats_.calls, 1);
+        ThreadMetrics::add(stats_.bytes, bytes);
+        start_ns_ = metrics_now_ns();
     }
-
-    if (input.size() > INT_MAX) {
-        throw std::runtime_error("WinAPI错误：输入字符串过大，无法处理。");
+    ~OperationProbe() {
+        const uint64_t elapsed = metrics_now_ns() - start_ns_;
+        const size_t bucket = std::min<size_t>(std::bit_width(elapsed), metrics::kLatencyBuckets - 1);
+        ThreadMetrics::add(stats_.latency[bucket], 1);
     }
-    const int input_len = static_cast<int>(input.size());
+    OperationProbe(const OperationProbe&) = delete;
+    OperationProbe& operator=(const OperationProbe&) = delete;
 
-    // --- 步骤 1: 将任何源编码转换为标准中间格式 UTF-16 ---
-    const DWORD mb_flags = (from_cp == CP_UTF8) ? MB_ERR_INVALID_CHARS : 0;
-    int wide_len = MultiByteToWideChar(from_cp, mb_flags, input.data(), input_len, nullptr, 0);
-    if (wide_len == 0) {
-        throw std::runtime_error("WinAPI错误：计算宽字符缓冲区大小时失败。错误码：" + std::to_string(GetLastError()));
-    }
+private:
+    ThreadMetrics::Operation& stats_;
+    uint64_t start_ns_ = 0;
+};
+#else
+// 未开启统计时的空实现，调用会被完全优化掉
+struct OperationProbe {
+    constexpr OperationProbe(metrics::Operation, size_t) noexcept {}
+};
+constexpr void record_operation(metrics::Operation, size_t) noexcept {}
+constexpr void record_exception() noexcept {}
+#endif
+
+/**
+ * @brief (内部实现) 抛出 std::runtime_error，开启统计时同时计数。
+ */
+[[noreturn]] inline void throw_runtime_error(const std::string& what) {
+    record_exception();
+    throw std::runtime_error(what);
+}
+}  // namespace detail
 
-    std::vector<wchar_t> wstr(wide_len);
-    if (MultiByteToWideChar(from_cp, mb_flags, input.data(), input_len, wstr.data(), wide_len) == 0) {
-        throw std::runtime_error("WinAPI错误：源编码转换为宽字符失败。错误码：" + std::to_string(GetLastError()));
+namespace metrics {
+/**
+ * @brief 汇总所有线程自上次 reset() 以来的统计。未开启统计时返回全零的结果。
+ * @details 其他线程的计数器用 relaxed 原子操作读取，快照与并发写入之间不保证各计数器彼此一致。
+ */
+inline Snapshot snapshot() {
+#if defined(ENCODING_UTIL_ENABLE_METRICS)
+    detail::MetricsRegistry& registry = detail::metrics_registry();
+    const std::lock_guard<std::mutex> lock(registry.mutex);
+    Snapshot total = registry.total_locked();
+    for (size_t op = 0; op < kNumOperations; ++op) {
+        total.operations[op].calls -= registry.baseline.operations[op].calls;
+        total.operations[op].bytes -= registry.baseline.operations[op].bytes;
+        for (size_t k = 0; k < kLatencyBuckets; ++k) {
+            total.operations[op].latency[k] -= registry.baseline.operations[op].latency[k];
+        }
     }
+    total.exceptions -= registry.baseline.exceptions;
+    return total;
+#else
+    return {};
+#endif
+}
 
+/**
+ * @brief 将统计清零 (之后的 snapshot() 只包含此后发生的操作)。
+ */
+inline void reset() {
+#if defined(ENCODING_UTIL_ENABLE_METRICS)
+    detail::MetricsRegistry& registry = detail::metrics_registry();
+    const std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.baseline = registry.total_locked();
+#endif
+}
+}  // namespace metrics
 
-    // --- 步骤 2: 将 UTF-16 转换为最终的目标编码 ---
-    // 仅当目标是GBK时，我们才需要检查是否有字符替换。
-    BOOL has_used_default_char = FALSE;
-    BOOL* p_used_default_char = nullptr;
-    if (to_cp == 936) {
-        p_used_default_char = &has_used_default_char;
-    }
+namespace detail {
 
-    // 第一次调用：计算输出大小。
-    // 需要使用确切的 wide_len，第七个参数(lpDefaultChar)和第八个参数(lpUsedDefaultChar)在计算大小时必须为 nullptr。
-    int out_len = WideCharToMultiByte(to_cp, 0, wstr.data(), wide_len, nullptr, 0, nullptr, nullptr);
-    if (out_len == 0) {
-        throw std::runtime_error("WinAPI错误：计算目标编码缓冲区大小时失败。错误码：" + std::to_string(GetLastError()));
-    }
+enum class Utf8Status { VALID, INVALID_SEQUENCE, INCOMPLETE_SEQUENCE };
 
-    std::string result(out_len, '\0');
+#if defined(ENCODING_UTIL_SIMD_X86)
+/**
+ * @brief (内部实现) 检查当前 CPU 与操作系统是否支持 AVX2。
+ */
+inline bool cpu_has_avx2() {
+    #ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+    __cpuid(info, 1);
+    const bool os_saves_ymm = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0;
+    if (!os_saves_ymm || (_xgetbv(0) & 0x6) != 0x6) return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+    #else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+    #endif
+}
+#endif
 
-    // 第二次调用：执行真正的转换。
-    // 使用之前设置好的 p_used_default_char 指针，它要么是 nullptr (对于非GBK转换)，要么指向我们的信号变量。
-    if (WideCharToMultiByte(to_cp, 0, wstr.data(), wide_len, &result[0], out_len, nullptr, p_used_default_char) == 0) {
-        throw std::runtime_error("WinAPI错误：宽字符转换为目标编码失败。错误码：" + std::to_string(GetLastError()));
-    }
+// ---------- ASCII 快速跳过 ----------
+// 绝大多数文本以 ASCII 为主，检测与转换都先用下面的函数整段跳过 ASCII，再处理多字节部分。
+// 标量版本 find_non_ascii_scalar() 在 detail/common.hpp 中，compiled.hpp 的 is_ascii() 也使用它。
 
-    // --- 步骤 3: 仅在必要时进行最终检查 ---
-    // 如果目标是GBK并且信号变量被API设置成了TRUE...
-    if (to_cp == 936 && has_used_default_char) {
-        // ...那么就抛出所期望的异常。
-        throw std::runtime_error("转换失败：字符串中包含无法在目标编码(GBK)中表示的字符。");
-    }
+#if defined(ENCODING_UTIL_SIMD_X86)
 
-    return result;
+inline size_t find_non_ascii_sse2(const char* data, size_t size) {
+    size_t i = 0;
+    for (; i + 64 <= size; i += 64) {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 16));
+        const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 32));
+        const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 48));
+        if (_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d))) != 0) break;
+    }
+    for (; i + 16 <= size; i += 16) {
+        const int mask = _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)));
+        if (mask != 0) return i + static_cast<size_t>(std::countr_zero(static_cast<unsigned>(mask)));
+    }
+    return i + find_non_ascii_scalar(data + i, size - i);
 }
-}  // namespace detail
 
-inline std::string gbk_to_utf8(std::string_view gbk_sv) {
-    return detail::convert_win32(gbk_sv, 936, CP_UTF8);
+ENCODING_UTIL_TARGET_AVX2
+inline size_t find_non_ascii_avx2(const char* data, size_t size) {
+    size_t i = 0;
+    for (; i + 64 <= size; i += 64) {
+        const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + 32));
+        if (_mm256_movemask_epi8(_mm256_or_si256(a, b)) != 0) break;
+    }
+    for (; i + 32 <= size; i += 32) {
+        const int mask = _mm256_movemask_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i)));
+        if (mask != 0) return i + static_cast<size_t>(std::countr_zero(static_cast<unsigned>(mask)));
+    }
+    return i + find_non_ascii_scalar(data + i, size - i);
 }
 
-inline std::string utf8_to_gbk(std::string_view utf8_sv) {
-    return detail::convert_win32(utf8_sv, CP_UTF8, 936);
+#elif defined(ENCODING_UTIL_SIMD_NEON)
+
+inline size_t find_non_ascii_neon(const char* data, size_t size) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+    size_t i = 0;
+    for (; i + 64 <= size; i += 64) {
+        const uint8x16_t any = vorrq_u8(vorrq_u8(vld1q_u8(p + i), vld1q_u8(p + i + 16)),
+                                        vorrq_u8(vld1q_u8(p + i + 32), vld1q_u8(p + i + 48)));
+        if (vmaxvq_u8(any) > 0x7F) break;
+    }
+    for (; i + 16 <= size; i += 16) {
+        if (vmaxvq_u8(vld1q_u8(p + i)) > 0x7F) break;
+    }
+    return i + find_non_ascii_scalar(data + i, size - i);
 }
 
+#endif
+
+using NonAsciiFinder = size_t (*)(const char*, size_t);
+
+/**
+ * @brief (内部实现) 根据当前 CPU 特性选出最快的非ASCII字节查找实现。
+ */
+inline NonAsciiFinder select_non_ascii_finder() {
+#if defined(ENCODING_UTIL_SIMD_X86)
+    return cpu_has_avx2() ? &find_non_ascii_avx2 : &find_non_ascii_sse2;
+#elif defined(ENCODING_UTIL_SIMD_NEON)
+    return &find_non_ascii_neon;
 #else
+    return &find_non_ascii_scalar;
+#endif
+}
 
-// ========== Linux, macOS 等 POSIX 平台实现 (iconv) ==========
-namespace detail {
-inline std::string iconv_convert(std::string_view input, const char* to_encoding, const char* from_encoding) {
-    if (input.empty()) return "";
-    iconv_t cd = iconv_open(to_encoding, from_encoding);
-    if (cd == (iconv_t)-1) throw std::runtime_error("iconv_open: 无法创建转换描述符。");
+/**
+ * @brief (内部实现) 查找第一个非ASCII字节(>= 0x80)，检测与转换共用。
+ * @return 第一个非ASCII字节的偏移；若全部为ASCII则返回 size。
+ */
+inline size_t find_non_ascii(const char* data, size_t size) {
+    if (size < 32) return find_non_ascii_scalar(data, size);
+    static const NonAsciiFinder impl = select_non_ascii_finder();
+    return impl(data, size);
+}
 
-    struct IconvGuard {
-        ~IconvGuard() {
-            if (cd != (iconv_t)-1) iconv_close(cd);
+/**
+ * @brief (内部实现) 从一段非ASCII字节开始，找到下一段值得单独拷贝的ASCII字节的起始位置。
+ * @details
+ * 返回位置一定落在字符边界上：UTF-8 的后续字节都不小于 `0x80`，任何 ASCII 字节都是边界；
+ * GBK 的第二字节可能落在 ASCII 范围内，因此按双字节步进。
+ * 短于 `kMinAsciiRun` 的 ASCII 段留在多字节段中一起转换，以免频繁调用系统转换接口。
+ * @param source_is_gbk 源编码是否为 GBK (否则为 UTF-8)。
+ * @return 下一段ASCII的偏移；若之后没有足够长的ASCII段则返回 size。
+ */
+inline size_t find_ascii_run(const char* data, size_t size, bool source_is_gbk) {
+    constexpr size_t kMinAsciiRun = 16;
+    size_t i = 0;
+    while (i < size) {
+        const unsigned char byte = static_cast<unsigned char>(data[i]);
+        if (byte <= 0x7F) {
+            const size_t run = find_non_ascii(data + i, size - i);
+            if (run >= kMinAsciiRun || i + run == size) return i;
+            i += run;
+        } else {
+            i += (source_is_gbk && byte >= 0x81) ? 2 : 1;
         }
-        iconv_t cd;
-    } guard{cd};
+    }
+    return size;
+}
 
-    size_t in_bytes_left = input.size();
-    char* in_buf = const_cast<char*>(input.data());
-    std::string result;
-    result.reserve(in_bytes_left);
-    std::vector<char> out_buffer(4096);
-
-    while (in_bytes_left > 0) {
-        char* out_buf_ptr = out_buffer.data();
-        size_t out_bytes_left = out_buffer.size();
-        errno = 0;
-        if (iconv(cd, &in_buf, &in_bytes_left, &out_buf_ptr, &out_bytes_left) == (size_t)-1) {
-            if (errno == EILSEQ || errno == EINVAL) {
-                throw std::runtime_error("iconv: 字符串包含目标编码无法表示的字符或无效序列。");
-            }
-            if (errno == E2BIG) {
-                result.append(out_buffer.data(), out_buffer.size() - out_bytes_left);
-                continue;
-            }
-            throw std::runtime_error("iconv: 转换失败，errno: " + std::to_string(errno));
-        }
-        result.append(out_buffer.data(), out_buffer.size() - out_bytes_left);
+/**
+ * @brief (内部实现) 计算 UTF-8 数据末尾尚未完整的多字节字符占用的字节数 (0~3)。
+ * @details 只看最后 3 个字节，非法序列留给转换器报错。
+ */
+inline size_t utf8_incomplete_tail_size(const char* data, size_t size) {
+    const auto* p = reinterpret_cast<const unsigned char*>(data);
+    for (size_t k = 1; k <= 3 && k <= size; ++k) {
+        const unsigned char byte = p[size - k];
+        if ((byte & 0xC0) == 0x80) continue;  // 后续字节，继续向前找首字节
+        if (byte < 0xC0) return 0;
+        const size_t needed = (byte >= 0xF0) ? 4 : (byte >= 0xE0) ? 3 : 2;
+        return needed > k ? k : 0;
     }
-    return result;
+    return 0;
 }
-}  // namespace detail
 
-inline std::string gbk_to_utf8(std::string_view gbk_sv) {
-    return detail::iconv_convert(gbk_sv, "UTF-8", "GBK");
+/**
+ * @brief (内部实现) 判断 GBK 数据的最后一个字节是否为尚缺第二字节的首字节 (返回 1 或 0)。
+ * @details
+ * 不在 0x81~0xFE 内的字节一定是某个字符的结尾，因此只需向前数出末尾连续的 0x81~0xFE 字节：
+ * 它们两两配对，个数为奇数时最后一个字节就是落单的首字节。
+ * @pre data 的起始位置是字符边界。
+ */
+inline size_t gbk_incomplete_tail_size(const char* data, size_t size) {
+    size_t run = 0;
+    while (run < size) {
+        const unsigned char byte = static_cast<unsigned char>(data[size - 1 - run]);
+        if (byte < 0x81 || byte == 0xFF) break;
+        ++run;
+    }
+    return run % 2;
 }
+/**
+ * @brief (内部实现) 可以接收转换结果的连续字节缓冲区，例如 std::string、std::vector<char> 与 std::u8string。
+ */
+template <typename Buffer>
+concept ByteBuffer = sizeof(typename Buffer::value_type) == 1 &&
+                     std::is_trivially_copyable_v<typename Buffer::value_type> &&
+                     requires(Buffer& buffer, size_t n) {
+                         buffer.resize(n);
+                         buffer.data();
+                         { buffer.size() } -> std::convertible_to<size_t>;
+                     };
 
-inline std::string utf8_to_gbk(std::string_view utf8_sv) {
-    return detail::iconv_convert(utf8_sv, "GBK", "UTF-8");
+template <ByteBuffer Buffer>
+inline char* buffer_data(Buffer& buffer) {
+    return reinterpret_cast<char*>(buffer.data());
 }
 
-#endif
+template <ByteBuffer Buffer>
+inline void append_bytes(Buffer& buffer, const char* data, size_t size) {
+    if (size == 0) return;
+    const size_t old_size = buffer.size();
+    buffer.resize(old_size + size);
+    std::memcpy(buffer_data(buffer) + old_size, data, size);
+}
 
-// ========== 智能转换接口 ==========
 /**
- * @brief (智能转换) 将字符串转换为 UTF-8 编码。
- * @details
- * - 如果输入已经是 UTF-8 或 ASCII，则直接返回其拷贝。
- * - 如果输入是 GBK，则执行转换。
- * - 如果输入是 UNKNOWN，则抛出 std::runtime_error。
- * @param sv 输入的字符串视图。
- * @return 转换为 UTF-8 编码的字符串。
- * @throws std::runtime_error 如果输入编码未知或转换失败。
+ * @brief (内部实现) 元素类型为 Char 的分配器，用于让返回字符串的接口从调用方的分配器 (如 arena) 分配。
  */
-inline std::string to_utf8(std::string_view sv) {
-    switch (detect_encoding(sv)) {
-        case Encoding::UTF8:
-        case Encoding::ASCII: return std::string(sv);
-        case Encoding::GBK: return gbk_to_utf8(sv);
-        case Encoding::UNKNOWN:
-        default: throw std::runtime_error("to_utf8: 输入字符串的编码无法识别。");
+template <typename Allocator, typename Char = char>
+concept CharAllocator = std::same_as<typename Allocator::value_type, Char> && requires(Allocator& allocator) {
+    { allocator.allocate(size_t{1}) } -> std::same_as<typename std::allocator_traits<Allocator>::pointer>;
+};
+
+/**
+ * @brief (内部实现) 使用给定分配器的字符串类型。
+ */
+template <typename Allocator, typename Char = char>
+using string_with = std::basic_string<Char, std::char_traits<Char>, Allocator>;
+
+/**
+ * @brief (内部实现) 使用 std::pmr 分配器的缓冲区，例如 std::pmr::string。
+ */
+template <typename Buffer>
+concept PmrBuffer = requires(const Buffer& buffer) {
+    { buffer.get_allocator().resource() } -> std::convertible_to<std::pmr::memory_resource*>;
+};
+
+/**
+ * @brief (内部实现) 转换过程中临时缓冲区使用的内存资源：输出缓冲区使用 std::pmr 分配器时与其相同，否则为默认资源。
+ */
+template <ByteBuffer Buffer>
+inline std::pmr::memory_resource* scratch_resource(const Buffer& buffer) {
+    if constexpr (PmrBuffer<Buffer>) {
+        return buffer.get_allocator().resource();
+    } else {
+        return std::pmr::get_default_resource();
     }
 }
 
 /**
- * @brief (智能转换) 将字符串转换为 GBK 编码。
+ * @brief (内部实现) 计算 GBK 与 UTF-8 互转时输出长度的上界，用于一次性分配目标缓冲区。
  * @details
- * - 如果输入已经是 GBK 或 ASCII，则直接返回其拷贝。
- * - 如果输入是 UTF-8，则执行转换。
- * - 如果输入是 UNKNOWN，则抛出 std::runtime_error。
- * @param sv 输入的字符串视图。
- * @return 转换为 GBK 编码的字符串。
- * @throws std::runtime_error 如果输入编码未知或转换失败。
+ * - UTF-8 -> GBK：每个字符都不会变长，上界就是输入长度。
+ * - GBK -> UTF-8：每个双字节字符多出 1 字节，双字节字符数不超过非ASCII字节数 h，也不超过 size / 2；
+ *   单字节的 0x80 (欧元符号) 会变成 3 字节，需要额外计入。
  */
-inline std::string to_gbk(std::string_view sv) {
-    switch (detect_encoding(sv)) {
-        case Encoding::GBK:
-        case Encoding::ASCII: return std::string(sv);
-        case Encoding::UTF8: return utf8_to_gbk(sv);
-        case Encoding::UNKNOWN:
-        default: throw std::runtime_error("to_gbk: 输入字符串的编码无法识别。");
+inline size_t converted_size_bound(const char* data, size_t size, bool source_is_gbk) {
+    if (!source_is_gbk) return size;
+    constexpr uint64_t kHighBits = 0x8080808080808080ULL;
+    constexpr uint64_t kLowBits = 0x7F7F7F7F7F7F7F7FULL;
+    size_t high = 0;
+    size_t euro = 0;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        if ((word & kHighBits) == 0) continue;
+        high += std::popcount(word & kHighBits);
+        // 与 0x80 异或后值为 0 的字节即为 0x80，按字节精确标记零字节
+        const uint64_t x = word ^ kHighBits;
+        euro += std::popcount(~(((x & kLowBits) + kLowBits) | x | kLowBits));
     }
+    for (; i < size; ++i) {
+        const unsigned char byte = static_cast<unsigned char>(data[i]);
+        high += byte >> 7;
+        euro += byte == 0x80;
+    }
+    return size + std::min(high, size / 2) + 2 * euro;
 }
 
-// ========== C++20 u8string 兼容层 ==========
-// 仅在支持 char8_t 的情况下提供以下函数，__cplusplus 宏在 gcc 10.3 不会被定义为 202002L，故使用 __cpp_char8_t 更准确
-#if defined(__cpp_char8_t)
+/**
+ * @brief (内部实现) 逐字节验证GBK的标量版本，支持从上一次的状态继续验证。
+ * @param pending_lead 输入输出参数，上一段是否以一个尚缺第二字节的首字节结尾。
+ * @return 第一个非法字节的偏移；若全部合法则返回 size。
+ */
+constexpr size_t validate_gbk_prefix_scalar(const char* data, size_t size, bool& pending_lead) {
+    size_t i = 0;
+    if (pending_lead && size > 0) {
+        unsigned char trail_byte = data[0];
+        if (trail_byte < 0x40 || trail_byte > 0xFE || trail_byte == 0x7F) return 0;  // 第二字节无效
+        pending_lead = false;
+        i = 1;
+    }
+    for (; i < size; ++i) {
+        unsigned char byte = data[i];
+        if (byte <= 0x7F) {  // 单字节ASCII，运行时整段跳过
+            if (!std::is_constant_evaluated()) i += find_non_ascii(data + i + 1, size - i - 1);
+            continue;
+        }
+        if (byte >= 0x81 && byte <= 0xFE) {  // 双字节首字节
+            if (i + 1 >= size) {             // 第二字节在下一段中
+                pending_lead = true;
+                return size;
+            }
+            unsigned char trail_byte = data[++i];
+            if (trail_byte < 0x40 || trail_byte > 0xFE || trail_byte == 0x7F) return i;  // 第二字节无效
+        } else {
+            return i;  // 非法首字节
+        }
+    }
+    return size;
+}
+
+// ---------- GBK 向量化验证 ----------
+// GBK 的第二字节可以是 0x40-0xFE 中的任意字节，单看一个字节无法知道它是首字节还是第二字节。
+// 但在合法的 GBK 中，任何小于 0x81 的字节都会结束一个字符，所以一段连续的 0x81-0xFE 字节从头起两两配对，
+// 这与 JSON 字符串中"反斜杠转义下一个字符"是同一个问题：在 64 位掩码上用一次减法即可求出所有第二字节的位置
+// (参见 simdjson 的转义字符扫描)。知道了每个字节的角色，合法性就只是按位与。
 
 /**
- * @brief (智能转换) 将 C++20 u8string (UTF-8) 转换为 GBK 编码的 std::string。
- * @param u8_sv 输入的 u8string_view。
- * @return 转换为 GBK 编码的字符串。
- * @throws std::runtime_error 如果转换失败。
+ * @struct GbkMasks
+ * @brief (内部实现) 64 字节块中各类字节的位掩码，第 k 位对应第 k 个字节。
  */
-inline std::string to_gbk(std::u8string_view u8_sv) {
-    return utf8_to_gbk(std::string_view(reinterpret_cast<const char*>(u8_sv.data()), u8_sv.size()));
+struct GbkMasks {
+    uint64_t lead;        // 0x81-0xFE，可作首字节
+    uint64_t bad_trail;   // 0x00-0x3F、0x7F、0xFF，不能作第二字节
+    uint64_t bad_single;  // 0x80、0xFF，既不是ASCII也不能作首字节
+};
+
+/**
+ * @brief (内部实现) 求出 64 字节块中所有第二字节的位置。
+ * @param carry 输入输出参数，为 1 表示上一块以首字节结尾 (本块第 0 字节是第二字节)。
+ */
+inline uint64_t gbk_trail_positions(uint64_t lead, uint64_t& carry) {
+    constexpr uint64_t kOddBits = 0xAAAAAAAAAAAAAAAAULL;
+    const uint64_t potential_lead = lead & ~carry;
+    const uint64_t maybe_trail = potential_lead << 1;
+    const uint64_t lead_and_terminal = ((maybe_trail | kOddBits) - potential_lead) ^ kOddBits;
+    const uint64_t trail = lead_and_terminal ^ (lead | carry);
+    carry = (lead_and_terminal & lead) >> 63;
+    return trail;
 }
 
 /**
- * @brief (智能转换) 将任意编码的字符串转换为 C++20 u8string (UTF-8)。
- * @details
- * - 如果输入是 GBK，则执行转换。
- * - 如果输入是 UTF-8 或 ASCII，则直接构造 u8string。
- * - 如果输入是 UNKNOWN，则抛出 std::runtime_error。
- * @param sv 输入的字符串视图。
- * @return 转换为 UTF-8 的 u8string。
- * @throws std::runtime_error 如果输入编码未知或转换失败。
+ * @brief (内部实现) 求出 64 字节块中按GBK规则非法的字节位置。
+ * @param carry 同 gbk_trail_positions()。
  */
-inline std::u8string to_u8string(std::string_view sv) {
-    std::string utf8_std_str = to_utf8(sv);
-    return std::u8string(reinterpret_cast<const char8_t*>(utf8_std_str.c_str()), utf8_std_str.length());
+inline uint64_t gbk_error_positions(const GbkMasks& masks, uint64_t& carry) {
+    const uint64_t trail = gbk_trail_positions(masks.lead, carry);
+    return (trail & masks.bad_trail) | (~trail & ~masks.lead & masks.bad_single);
+}
+
+using GbkMaskLoader = GbkMasks (*)(const unsigned char*);
+
+/**
+ * @brief (内部实现) 以 64 字节为一块验证GBK前缀，块内发现错误时回退到标量版本定位错误偏移。
+ * @tparam Load 计算一块 GbkMasks 的函数。
+ */
+template <GbkMaskLoader Load>
+inline size_t validate_gbk_prefix_blocks(const char* data, size_t size, bool& pending_lead) {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+    uint64_t carry = pending_lead ? 1 : 0;
+    size_t i = 0;
+    for (; i + 64 <= size; i += 64) {
+        uint64_t next_carry = carry;
+        if (gbk_error_positions(Load(p + i), next_carry) != 0) break;
+        carry = next_carry;
+    }
+    pending_lead = carry != 0;
+    return i + validate_gbk_prefix_scalar(data + i, size - i, pending_lead);
+}
+
+#if defined(ENCODING_UTIL_SIMD_X86)
+
+inline GbkMasks load_gbk_masks_sse2(const unsigned char* p) {
+    const __m128i x3f = _mm_set1_epi8(0x3F);
+    const __m128i x7f = _mm_set1_epi8(0x7F);
+    const __m128i x80 = _mm_set1_epi8(static_cast<char>(0x80));
+    const __m128i x81 = _mm_set1_epi8(static_cast<char>(0x81));
+    const __m128i xff = _mm_set1_epi8(static_cast<char>(0xFF));
+    GbkMasks masks{0, 0, 0};
+    for (int k = 0; k < 4; ++k) {
+        const __m128i cur = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16 * k));
+        const __m128i is_ff = _mm_cmpeq_epi8(cur, xff);
+        const __m128i lead = _mm_andnot_si128(is_ff, _mm_cmpeq_epi8(_mm_max_epu8(cur, x81), cur));
+        const __m128i below_40 = _mm_cmpeq_epi8(_mm_min_epu8(cur, x3f), cur);
+        const __m128i bad_trail = _mm_or_si128(_mm_or_si128(below_40, _mm_cmpeq_epi8(cur, x7f)), is_ff);
+        const __m128i bad_single = _mm_or_si128(_mm_cmpeq_epi8(cur, x80), is_ff);
+        const int shift = 16 * k;
+        masks.lead |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(lead))) << shift;
+        masks.bad_trail |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(bad_trail))) << shift;
+        masks.bad_single |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(bad_single))) << shift;
+    }
+    return masks;
+}
+
+ENCODING_UTIL_TARGET_AVX2
+inline GbkMasks load_gbk_masks_avx2(const unsigned char* p) {
+    const __m256i x3f = _mm256_set1_epi8(0x3F);
+    const __m256i x7f = _mm256_set1_epi8(0x7F);
+    const __m256i x80 = _mm256_set1_epi8(static_cast<char>(0x80));
+    const __m256i x81 = _mm256_set1_epi8(static_cast<char>(0x81));
+    const __m256i xff = _mm256_set1_epi8(static_cast<char>(0xFF));
+    GbkMasks masks{0, 0, 0};
+    for (int k = 0; k < 2; ++k) {
+        const __m256i cur = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32 * k));
+        const __m256i is_ff = _mm256_cmpeq_epi8(cur, xff);
+        const __m256i lead = _mm256_andnot_si256(is_ff, _mm256_cmpeq_epi8(_mm256_max_epu8(cur, x81), cur));
+        const __m256i below_40 = _mm256_cmpeq_epi8(_mm256_min_epu8(cur, x3f), cur);
+        const __m256i bad_trail = _mm256_or_si256(_mm256_or_si256(below_40, _mm256_cmpeq_epi8(cur, x7f)), is_ff);
+        const __m256i bad_single = _mm256_or_si256(_mm256_cmpeq_epi8(cur, x80), is_ff);
+        const int shift = 32 * k;
+        masks.lead |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(lead))) << shift;
+        masks.bad_trail |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(bad_trail))) << shift;
+        masks.bad_single |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(bad_single))) << shift;
+    }
+    return masks;
+}
+
+#elif defined(ENCODING_UTIL_SIMD_NEON)
+
+/**
+ * @brief (内部实现) 把 4 个比较结果向量 (每字节 0x00/0xFF) 压缩为 64 位掩码。
+ */
+inline uint64_t neon_movemask64(uint8x16_t a, uint8x16_t b, uint8x16_t c, uint8x16_t d) {
+    static const uint8_t kBits[16] = {0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80,
+                                      0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80};
+    const uint8x16_t bits = vld1q_u8(kBits);
+    uint8x16_t sum0 = vpaddq_u8(vandq_u8(a, bits), vandq_u8(b, bits));
+    const uint8x16_t sum1 = vpaddq_u8(vandq_u8(c, bits), vandq_u8(d, bits));
+    sum0 = vpaddq_u8(sum0, sum1);
+    sum0 = vpaddq_u8(sum0, sum0);
+    return vgetq_lane_u64(vreinterpretq_u64_u8(sum0), 0);
+}
+
+inline GbkMasks load_gbk_masks_neon(const unsigned char* p) {
+    uint8x16_t lead[4], bad_trail[4], bad_single[4];
+    for (int k = 0; k < 4; ++k) {
+        const uint8x16_t cur = vld1q_u8(p + 16 * k);
+        const uint8x16_t is_ff = vceqq_u8(cur, vdupq_n_u8(0xFF));
+        lead[k] = vbicq_u8(vcgeq_u8(cur, vdupq_n_u8(0x81)), is_ff);
+        bad_trail[k] = vorrq_u8(vorrq_u8(vcltq_u8(cur, vdupq_n_u8(0x40)), vceqq_u8(cur, vdupq_n_u8(0x7F))), is_ff);
+        bad_single[k] = vorrq_u8(vceqq_u8(cur, vdupq_n_u8(0x80)), is_ff);
+    }
+    return GbkMasks{neon_movemask64(lead[0], lead[1], lead[2], lead[3]),
+                    neon_movemask64(bad_trail[0], bad_trail[1], bad_trail[2], bad_trail[3]),
+                    neon_movemask64(bad_single[0], bad_single[1], bad_single[2], bad_single[3])};
+}
+
+#endif
+
+using GbkPrefixValidator = size_t (*)(const char*, size_t, bool&);
+
+/**
+ * @brief (内部实现) 根据当前 CPU 特性选出最快的GBK验证实现。
+ */
+inline GbkPrefixValidator select_gbk_prefix_validator() {
+#if defined(ENCODING_UTIL_SIMD_X86)
+    return cpu_has_avx2() ? &validate_gbk_prefix_blocks<&load_gbk_masks_avx2>
+                          : &validate_gbk_prefix_blocks<&load_gbk_masks_sse2>;
+#elif defined(ENCODING_UTIL_SIMD_NEON)
+    return &validate_gbk_prefix_blocks<&load_gbk_masks_neon>;
+#else
+    return &validate_gbk_prefix_scalar;
+#endif
+}
+
+/**
+ * @brief (内部实现) 验证GBK前缀，按运行时检测到的 CPU 特性分派到向量化或标量实现。
+ * @details 参数与返回值同 validate_gbk_prefix_scalar()，结果与标量版本完全一致。
+ */
+inline size_t validate_gbk_prefix(const char* data, size_t size, bool& pending_lead) {
+    size_t start = 0;
+    if (!pending_lead) {
+        start = find_non_ascii(data, size);
+        if (start == size) return size;
+    }
+    if (size - start < 64) return start + validate_gbk_prefix_scalar(data + start, size - start, pending_lead);
+    static const GbkPrefixValidator impl = select_gbk_prefix_validator();
+    return start + impl(data + start, size - start, pending_lead);
+}
+
+/**
+ * @brief (内部实现) 检查一个字节序列是否是合法的GBK编码。
+ * @details
+ * GBK编码规则如下：
+ * - 单字节: 范围 `0x00` - `0x7F`。 (二进制: `0xxxxxxx`)
+ * - 双字节:
+ *   - 高位字节 (Lead Byte):  范围 `0x81` - `0xFE`。
+ *   - 低位字节 (Trail Byte): 范围 `0x40` - `0xFE`，但不包括 `0x7F`。
+ *
+ * 可在编译期求值，此时使用标量实现。
+ */
+constexpr bool is_valid_gbk(const char* data, size_t size) {
+    bool pending_lead = false;
+    if (std::is_constant_evaluated()) {
+        return validate_gbk_prefix_scalar(data, size, pending_lead) == size && !pending_lead;
+    }
+    return validate_gbk_prefix(data, size, pending_lead) == size && !pending_lead;
+}
+
+/**
+ * @brief (内部实现) 逐字节验证UTF-8的标量版本，支持从上一次的状态继续验证。
+ * @details
+ * UTF-8 编码规则：
+ *    - 单字节: `0xxxxxxx`
+ *    - 双字节: `110xxxxx 10xxxxxx`
+ *    - 三字节: `1110xxxx 10xxxxxx 10xxxxxx`
+ *    - 四字节: `11110xxx 10xxxxxx 10xxxxxx 10xxxxxx`
+ * @param bytes_to_check 输入输出参数，尚需读取的后续字节数。
+ * @param is_all_ascii 输入输出参数，遇到非ASCII字节时置为 false。
+ * @return 第一个非法字节的偏移；若全部合法则返回 size。
+ */
+constexpr size_t validate_utf8_prefix_scalar(const char* data, size_t size, int& bytes_to_check, bool& is_all_ascii) {
+    for (size_t i = 0; i < size; ++i) {
+        unsigned char byte = static_cast<unsigned char>(data[i]);
+        if (byte > 0x7F) is_all_ascii = false;  // 非ASCII
+        if (bytes_to_check > 0) {
+            if ((byte & 0xC0) != 0x80) return i;  // 非法后续字节
+            bytes_to_check--;
+        } else if (byte >= 0xC2 && byte <= 0xDF) {
+            bytes_to_check = 1;  // 2字节序列
+        } else if (byte >= 0xE0 && byte <= 0xEF) {
+            bytes_to_check = 2;  // 3字节序列
+        } else if (byte >= 0xF0 && byte <= 0xF4) {
+            bytes_to_check = 3;  // 4字节序列
+        } else if (byte >= 0x80) {
+            return i;  // 非法首字节
+        }
+    }
+    return size;
+}
+
+/**
+ * @brief (内部实现) 根据合法前缀的最后三个字节推算还需要的后续字节数。
+ * @pre `pos >= 3`，且 `[0, pos)` 内不存在非法序列。
+ */
+inline int utf8_pending_bytes_at(const unsigned char* p, size_t pos) {
+    if (p[pos - 1] >= 0xF0) return 3;
+    if (p[pos - 1] >= 0xE0) return 2;
+    if (p[pos - 1] >= 0xC0) return 1;
+    if (p[pos - 2] >= 0xF0) return 2;
+    if (p[pos - 2] >= 0xE0) return 1;
+    if (p[pos - 3] >= 0xF0) return 1;
+    return 0;
+}
+
+// ---------- UTF-8 向量化验证 ----------
+// 向量版本逐块检查每个字节：由前 1~3 个字节是否为多字节首字节，推出当前字节"必须是后续字节"，
+// 与它"实际是否为后续字节"比较，不一致即为非法；另外单独检查 C0/C1/F5-FF 这些非法首字节。
+// 该规则与标量状态机完全等价。由于需要读取前 3 个字节，前 3 个字节(以及可能带入的上次状态)
+// 交给标量版本处理；块内发现错误时回退到标量版本重新扫描该块，以得到与标量版本一致的错误偏移。
+
+#if defined(ENCODING_UTIL_SIMD_X86)
+
+/**
+ * @brief (内部实现) 计算 `p[0, 16)` 中按UTF-8规则非法的字节 (对应字节为 0xFF)，需要可读取 `p[-3]`。
+ */
+inline __m128i utf8_errors_sse2(const unsigned char* p) {
+    const __m128i lead2 = _mm_set1_epi8(static_cast<char>(0xC0));
+    const __m128i lead3 = _mm_set1_epi8(static_cast<char>(0xE0));
+    const __m128i lead4 = _mm_set1_epi8(static_cast<char>(0xF0));
+    const __m128i cont_tag = _mm_set1_epi8(static_cast<char>(0x80));
+    const __m128i c0_mask = _mm_set1_epi8(static_cast<char>(0xFE));
+    const __m128i bad_high = _mm_set1_epi8(static_cast<char>(0xF5));
+    // 无符号比较 a >= b 等价于 max(a, b) == a
+    auto ge = [](__m128i a, __m128i b) { return _mm_cmpeq_epi8(_mm_max_epu8(a, b), a); };
+
+    const __m128i cur = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    const __m128i prev1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p - 1));
+    const __m128i prev2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p - 2));
+    const __m128i prev3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p - 3));
+    const __m128i must_be_cont = _mm_or_si128(_mm_or_si128(ge(prev1, lead2), ge(prev2, lead3)), ge(prev3, lead4));
+    const __m128i is_cont = _mm_cmpeq_epi8(_mm_and_si128(cur, lead2), cont_tag);
+    const __m128i bad_lead = _mm_or_si128(_mm_cmpeq_epi8(_mm_and_si128(cur, c0_mask), lead2), ge(cur, bad_high));
+    return _mm_or_si128(_mm_xor_si128(must_be_cont, is_cont), bad_lead);
+}
+
+inline size_t validate_utf8_prefix_sse2(const char* data, size_t size, int& bytes_to_check, bool& is_all_ascii) {
+    const size_t head = size < 3 ? size : 3;
+    const size_t head_end = validate_utf8_prefix_scalar(data, head, bytes_to_check, is_all_ascii);
+    if (head_end < head) return head_end;
+
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+    __m128i high_bits = _mm_setzero_si128();
+    size_t i = head;
+    while (i + 16 <= size) {
+        const __m128i cur = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        if (_mm_movemask_epi8(cur) == 0 && utf8_pending_bytes_at(p, i) == 0) {
+            i += 16;  // 整块ASCII且无待续字节，无需逐字节比较
+            continue;
+        }
+        if (_mm_movemask_epi8(utf8_errors_sse2(p + i)) != 0) {
+            if (_mm_movemask_epi8(high_bits) != 0) is_all_ascii = false;
+            bytes_to_check = utf8_pending_bytes_at(p, i);
+            return i + validate_utf8_prefix_scalar(data + i, size - i, bytes_to_check, is_all_ascii);
+        }
+        high_bits = _mm_or_si128(high_bits, cur);
+        i += 16;
+    }
+    if (_mm_movemask_epi8(high_bits) != 0) is_all_ascii = false;
+    if (i > head) bytes_to_check = utf8_pending_bytes_at(p, i);
+    return i + validate_utf8_prefix_scalar(data + i, size - i, bytes_to_check, is_all_ascii);
+}
+
+/**
+ * @brief (内部实现) `p[0, 64)` 中是否存在按UTF-8规则非法的字节，需要可读取 `p[-3]`。
+ */
+inline bool utf8_block64_has_error_sse2(const unsigned char* p) {
+    const __m128i errors = _mm_or_si128(_mm_or_si128(utf8_errors_sse2(p), utf8_errors_sse2(p + 16)),
+                                        _mm_or_si128(utf8_errors_sse2(p + 32), utf8_errors_sse2(p + 48)));
+    return _mm_movemask_epi8(errors) != 0;
+}
+
+ENCODING_UTIL_TARGET_AVX2
+inline __m256i utf8_errors_avx2(const unsigned char* p) {
+    const __m256i lead2 = _mm256_set1_epi8(static_cast<char>(0xC0));
+    const __m256i lead3 = _mm256_set1_epi8(static_cast<char>(0xE0));
+    const __m256i lead4 = _mm256_set1_epi8(static_cast<char>(0xF0));
+    const __m256i cont_tag = _mm256_set1_epi8(static_cast<char>(0x80));
+    const __m256i c0_mask = _mm256_set1_epi8(static_cast<char>(0xFE));
+    const __m256i bad_high = _mm256_set1_epi8(static_cast<char>(0xF5));
+
+    const __m256i cur = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    const __m256i prev1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p - 1));
+    const __m256i prev2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p - 2));
+    const __m256i prev3 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p - 3));
+    const __m256i must_be_cont =
+        _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(_mm256_max_epu8(prev1, lead2), prev1),
+                                        _mm256_cmpeq_epi8(_mm256_max_epu8(prev2, lead3), prev2)),
+                        _mm256_cmpeq_epi8(_mm256_max_epu8(prev3, lead4), prev3));
+    const __m256i is_cont = _mm256_cmpeq_epi8(_mm256_and_si256(cur, lead2), cont_tag);
+    const __m256i bad_lead = _mm256_or_si256(_mm256_cmpeq_epi8(_mm256_and_si256(cur, c0_mask), lead2),
+                                             _mm256_cmpeq_epi8(_mm256_max_epu8(cur, bad_high), cur));
+    return _mm256_or_si256(_mm256_xor_si256(must_be_cont, is_cont), bad_lead);
+}
+
+ENCODING_UTIL_TARGET_AVX2
+inline size_t validate_utf8_prefix_avx2(const char* data, size_t size, int& bytes_to_check, bool& is_all_ascii) {
+    const size_t head = size < 3 ? size : 3;
+    const size_t head_end = validate_utf8_prefix_scalar(data, head, bytes_to_check, is_all_ascii);
+    if (head_end < head) return head_end;
+
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+    __m256i high_bits = _mm256_setzero_si256();
+    size_t i = head;
+    while (i + 32 <= size) {
+        const __m256i cur = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        if (_mm256_movemask_epi8(cur) == 0 && utf8_pending_bytes_at(p, i) == 0) {
+            i += 32;  // 整块ASCII且无待续字节，无需逐字节比较
+            continue;
+        }
+        if (_mm256_movemask_epi8(utf8_errors_avx2(p + i)) != 0) {
+            if (_mm256_movemask_epi8(high_bits) != 0) is_all_ascii = false;
+            bytes_to_check = utf8_pending_bytes_at(p, i);
+            return i + validate_utf8_prefix_scalar(data + i, size - i, bytes_to_check, is_all_ascii);
+        }
+        high_bits = _mm256_or_si256(high_bits, cur);
+        i += 32;
+    }
+    if (_mm256_movemask_epi8(high_bits) != 0) is_all_ascii = false;
+    if (i > head) bytes_to_check = utf8_pending_bytes_at(p, i);
+    return i + validate_utf8_prefix_scalar(data + i, size - i, bytes_to_check, is_all_ascii);
+}
+
+ENCODING_UTIL_TARGET_AVX2
+inline bool utf8_block64_has_error_avx2(const unsigned char* p) {
+    return _mm256_movemask_epi8(_mm256_or_si256(utf8_errors_avx2(p), utf8_errors_avx2(p + 32))) != 0;
+}
+
+#elif defined(ENCODING_UTIL_SIMD_NEON)
+
+inline uint8x16_t utf8_errors_neon(const unsigned char* p) {
+    const uint8x16_t lead2 = vdupq_n_u8(0xC0);
+    const uint8x16_t lead3 = vdupq_n_u8(0xE0);
+    const uint8x16_t lead4 = vdupq_n_u8(0xF0);
+    const uint8x16_t cont_tag = vdupq_n_u8(0x80);
+    const uint8x16_t c0_mask = vdupq_n_u8(0xFE);
+    const uint8x16_t bad_high = vdupq_n_u8(0xF5);
+
+    const uint8x16_t cur = vld1q_u8(p);
+    const uint8x16_t must_be_cont =
+        vorrq_u8(vorrq_u8(vcgeq_u8(vld1q_u8(p - 1), lead2), vcgeq_u8(vld1q_u8(p - 2), lead3)),
+                 vcgeq_u8(vld1q_u8(p - 3), lead4));
+    const uint8x16_t is_cont = vceqq_u8(vandq_u8(cur, lead2), cont_tag);
+    const uint8x16_t bad_lead = vorrq_u8(vceqq_u8(vandq_u8(cur, c0_mask), lead2), vcgeq_u8(cur, bad_high));
+    return vorrq_u8(veorq_u8(must_be_cont, is_cont), bad_lead);
+}
+
+inline size_t validate_utf8_prefix_neon(const char* data, size_t size, int& bytes_to_check, bool& is_all_ascii) {
+    const size_t head = size < 3 ? size : 3;
+    const size_t head_end = validate_utf8_prefix_scalar(data, head, bytes_to_check, is_all_ascii);
+    if (head_end < head) return head_end;
+
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+    uint8x16_t high_bits = vdupq_n_u8(0);
+    size_t i = head;
+    while (i + 16 <= size) {
+        const uint8x16_t cur = vld1q_u8(p + i);
+        if (vmaxvq_u8(cur) <= 0x7F && utf8_pending_bytes_at(p, i) == 0) {
+            i += 16;  // 整块ASCII且无待续字节，无需逐字节比较
+            continue;
+        }
+        if (vmaxvq_u8(utf8_errors_neon(p + i)) != 0) {
+            if (vmaxvq_u8(high_bits) > 0x7F) is_all_ascii = false;
+            bytes_to_check = utf8_pending_bytes_at(p, i);
+            return i + validate_utf8_prefix_scalar(data + i, size - i, bytes_to_check, is_all_ascii);
+        }
+        high_bits = vorrq_u8(high_bits, cur);
+        i += 16;
+    }
+    if (vmaxvq_u8(high_bits) > 0x7F) is_all_ascii = false;
+    if (i > head) bytes_to_check = utf8_pending_bytes_at(p, i);
+    return i + validate_utf8_prefix_scalar(data + i, size - i, bytes_to_check, is_all_ascii);
+}
+
+inline bool utf8_block64_has_error_neon(const unsigned char* p) {
+    const uint8x16_t errors = vorrq_u8(vorrq_u8(utf8_errors_neon(p), utf8_errors_neon(p + 16)),
+                                       vorrq_u8(utf8_errors_neon(p + 32), utf8_errors_neon(p + 48)));
+    return vmaxvq_u8(errors) != 0;
+}
+
+#endif
+
+using Utf8PrefixValidator = size_t (*)(const char*, size_t, int&, bool&);
+
+/**
+ * @brief (内部实现) 根据当前 CPU 特性选出最快的 UTF-8 验证实现。
+ */
+inline Utf8PrefixValidator select_utf8_prefix_validator() {
+#if defined(ENCODING_UTIL_SIMD_X86)
+    return cpu_has_avx2() ? &validate_utf8_prefix_avx2 : &validate_utf8_prefix_sse2;
+#elif defined(ENCODING_UTIL_SIMD_NEON)
+    return &validate_utf8_prefix_neon;
+#else
+    return &validate_utf8_prefix_scalar;
+#endif
+}
+
+/**
+ * @brief (内部实现) 验证UTF-8前缀，按运行时检测到的 CPU 特性分派到 AVX2/SSE2/NEON 或标量实现。
+ * @details 参数与返回值同 validate_utf8_prefix_scalar()，结果与标量版本完全一致。
+ */
+inline size_t validate_utf8_prefix(const char* data, size_t size, int& bytes_to_check, bool& is_all_ascii) {
+    // 不欠后续字节时，开头的ASCII段不需要经过状态机；纯ASCII输入在这里即可按内存带宽完成
+    size_t start = 0;
+    if (bytes_to_check == 0) {
+        start = find_non_ascii(data, size);
+        if (start == size) return size;
+    }
+    // 短输入的分派与初始化开销不划算，直接走标量版本
+    if (size - start < 64) {
+        return start + validate_utf8_prefix_scalar(data + start, size - start, bytes_to_check, is_all_ascii);
+    }
+    static const Utf8PrefixValidator impl = select_utf8_prefix_validator();
+    return start + impl(data + start, size - start, bytes_to_check, is_all_ascii);
+}
+
+/**
+ * @brief (内部实现) 标量版本的 validate_utf8()，作为向量化实现的参照与后备。
+ */
+constexpr Utf8Status validate_utf8_scalar(const char* data, size_t size, bool& out_is_all_ascii) {
+    out_is_all_ascii = true;
+    int bytes_to_check = 0;
+    if (validate_utf8_prefix_scalar(data, size, bytes_to_check, out_is_all_ascii) < size) {
+        return Utf8Status::INVALID_SEQUENCE;
+    }
+    return (bytes_to_check == 0) ? Utf8Status::VALID : Utf8Status::INCOMPLETE_SEQUENCE;
+}
+
+/**
+ * @brief (内部实现) 验证一个字节序列是否是UTF-8，并返回详细状态。
+ * @details
+ * 规则同 validate_utf8_prefix_scalar()。输入较长时使用 SIMD 实现，每次处理 16/32 字节，
+ * 返回的状态以及 `out_is_all_ascii` 与标量版本完全一致。可在编译期求值，此时使用标量实现。
+ */
+constexpr Utf8Status validate_utf8(const char* data, size_t size, bool& out_is_all_ascii) {
+    if (std::is_constant_evaluated()) return validate_utf8_scalar(data, size, out_is_all_ascii);
+    out_is_all_ascii = true;
+    int bytes_to_check = 0;
+    if (validate_utf8_prefix(data, size, bytes_to_check, out_is_all_ascii) < size) {
+        out_is_all_ascii = false;  // 出现非法序列时必然含有非ASCII字节，与标量版本保持一致
+        return Utf8Status::INVALID_SEQUENCE;
+    }
+    return (bytes_to_check == 0) ? Utf8Status::VALID : Utf8Status::INCOMPLETE_SEQUENCE;
+}
+
+// ---------- 扩展候选：UTF-16 BOM、GB18030、Big5 ----------
+// 这三种编码都只在 UTF-8 被否定之后才需要考虑，因此不进入联合状态机，而是在联合扫描的结论上补充判定：
+// - UTF-16 只认带 BOM 的输入，BOM 的 0xFF/0xFE 在 UTF-8 与 GBK 中都是非法字节，两个候选在开头就会被否定；
+// - GB18030 的四字节序列形如 "首字节 数字 首字节 数字"，GBK 恰好在第一个数字处被否定，从那里接着验证即可；
+// - Big5 的首字节与第二字节范围都是 GBK 的子集，结构上无法区分，只能看字符落在哪个区：
+//   Big5 的标点与常用汉字大多落在 GBK 的用户自定义区 (AAA1-AFFE、F8A1-FEFE、A140-A7A0)，
+//   这些码位在 GBK 中没有标准字符，出现它们且没有 Big5 不允许的字节时可以推定为 Big5。
+//   但合法的 GBK 文本也可能用到自定义区，因此这一推定只在 detect_encoding_with_big5() 中显式选用，
+//   默认的检测总是把合法的 GBK 判为 GBK。
+
+/**
+ * @brief (内部实现) 开头两个字节对应的 UTF-16 BOM，不是 BOM 时返回 Encoding::UNKNOWN。
+ */
+constexpr Encoding utf16_bom_of(char first, char second) {
+    const unsigned char a = static_cast<unsigned char>(first);
+    const unsigned char b = static_cast<unsigned char>(second);
+    if (a == 0xFF && b == 0xFE) return Encoding::UTF16LE;
+    if (a == 0xFE && b == 0xFF) return Encoding::UTF16BE;
+    return Encoding::UNKNOWN;
+}
+
+/**
+ * @brief (内部实现) 根据 BOM 判断输入是否为 UTF-16。
+ * @details 只有 BOM 之后还有内容且总长度为偶数时才成立，单独的 "\xFF\xFE" 仍视为未知。
+ * @return Encoding::UTF16LE、Encoding::UTF16BE，或 Encoding::UNKNOWN。
+ */
+constexpr Encoding utf16_bom_encoding(std::string_view sv) {
+    if (sv.size() <= 2 || sv.size() % 2 != 0) return Encoding::UNKNOWN;
+    return utf16_bom_of(sv[0], sv[1]);
+}
+
+constexpr bool is_ascii_digit(unsigned char byte) { return byte >= 0x30 && byte <= 0x39; }
+
+/**
+ * @brief (内部实现) 逐字节验证GB18030的标量版本，支持从上一次的状态继续验证。
+ * @details
+ * 在 GBK 的规则之上允许四字节序列：`0x81-0xFE 0x30-0x39 0x81-0xFE 0x30-0x39`。
+ * 只检查结构，落在未分配区间的四字节序列留给转换器报错。
+ * @param pending 输入输出参数，当前字符已读入的字节数 (0~3)。
+ * @return 第一个非法字节的偏移；若全部合法则返回 size。
+ */
+constexpr size_t validate_gb18030_prefix_scalar(const char* data, size_t size, int& pending) {
+    for (size_t i = 0; i < size; ++i) {
+        const unsigned char byte = static_cast<unsigned char>(data[i]);
+        const bool lead = byte >= 0x81 && byte <= 0xFE;
+        switch (pending) {
+            case 0:
+                if (lead) {
+                    pending = 1;
+                } else if (byte > 0x7F) {
+                    return i;
+                }
+                break;
+            case 1:
+                if (is_ascii_digit(byte)) {
+                    pending = 2;
+                } else if (byte >= 0x40 && byte <= 0xFE && byte != 0x7F) {
+                    pending = 0;
+                } else {
+                    return i;
+                }
+                break;
+            case 2:
+                if (!lead) return i;
+                pending = 3;
+                break;
+            default:
+                if (!is_ascii_digit(byte)) return i;
+                pending = 0;
+                break;
+        }
+    }
+    return size;
+}
+
+/**
+ * @brief (内部实现) 验证GB18030前缀：双字节部分交给 validate_gbk_prefix() 的向量实现，
+ * 每遇到一个四字节序列 (GBK 在其第二字节处报错) 就用标量版本越过它，再继续按 GBK 验证。
+ * @details 参数与返回值同 validate_gb18030_prefix_scalar()。可在编译期求值，此时使用标量实现。
+ */
+constexpr size_t validate_gb18030_prefix(const char* data, size_t size, int& pending) {
+    if (std::is_constant_evaluated()) return validate_gb18030_prefix_scalar(data, size, pending);
+    size_t i = 0;
+    while (true) {
+        if (pending >= 2) {  // 四字节序列的后半部分
+            const size_t rest = std::min<size_t>(size - i, static_cast<size_t>(4 - pending));
+            const size_t end = i + validate_gb18030_prefix_scalar(data + i, rest, pending);
+            if (end < i + rest) return end;
+            i += rest;
+            if (pending != 0) return size;
+        }
+        bool pending_lead = pending == 1;
+        const size_t end = i + validate_gbk_prefix(data + i, size - i, pending_lead);
+        if (end == size) {
+            pending = pending_lead ? 1 : 0;
+            return size;
+        }
+        // 合法的 GBK 前缀中，数字只会在首字节之后才导致错误，因此这里就是四字节序列的第二字节
+        if (!is_ascii_digit(static_cast<unsigned char>(data[end]))) return end;
+        pending = 2;
+        i = end + 1;
+    }
+}
+
+/**
+ * @struct Big5Evidence
+ * @brief (内部实现) 在合法的 GBK 文本中收集的、区分 GBK 与 Big5 的证据。
+ */
+struct Big5Evidence {
+    bool user_defined = false;  // 出现了落在 GBK 用户自定义区的双字节字符
+    bool not_big5 = false;      // 出现了 Big5 不允许的首字节 (0x81-0xA0、0xFA-0xFE) 或第二字节 (0x80-0xA0)
+
+    constexpr bool is_big5() const noexcept { return user_defined && !not_big5; }
+};
+
+/**
+ * @brief (内部实现) 按一个双字节字符更新 Big5 证据。
+ */
+constexpr void add_big5_evidence(unsigned char lead, unsigned char trail, Big5Evidence& evidence) {
+    const bool high_trail = trail >= 0xA1;
+    if (lead < 0xA1 || lead > 0xF9 || (trail >= 0x80 && !high_trail)) evidence.not_big5 = true;
+    const bool low_row = lead >= 0xA1 && lead <= 0xA7;                   // A140-A7A0
+    const bool high_row = (lead >= 0xAA && lead <= 0xAF) || lead >= 0xF8;  // AAA1-AFFE、F8A1-FEFE
+    if ((low_row && !high_trail) || (high_row && high_trail)) evidence.user_defined = true;
+}
+
+/**
+ * @brief (内部实现) 验证GBK前缀并同时收集 Big5 证据的标量版本，支持分段继续。
+ * @param pending_lead 输入输出参数，上一段末尾尚缺第二字节的首字节，0 表示没有。
+ * @param evidence 输入输出参数，累积合法前缀中的 Big5 证据。
+ * @return 同 validate_gbk_prefix_scalar()。
+ */
+constexpr size_t validate_gbk_prefix_big5_scalar(const char* data, size_t size, unsigned char& pending_lead,
+                                                 Big5Evidence& evidence) {
+    size_t i = 0;
+    if (pending_lead != 0 && size > 0) {
+        const unsigned char trail_byte = data[0];
+        if (trail_byte < 0x40 || trail_byte > 0xFE || trail_byte == 0x7F) return 0;  // 第二字节无效
+        add_big5_evidence(pending_lead, trail_byte, evidence);
+        pending_lead = 0;
+        i = 1;
+    }
+    for (; i < size; ++i) {
+        const unsigned char byte = data[i];
+        if (byte <= 0x7F) {  // 单字节ASCII，运行时整段跳过
+            if (!std::is_constant_evaluated()) i += find_non_ascii(data + i + 1, size - i - 1);
+            continue;
+        }
+        if (byte < 0x81 || byte == 0xFF) return i;  // 非法首字节
+        if (i + 1 >= size) {                       // 第二字节在下一段中
+            pending_lead = byte;
+            return size;
+        }
+        const unsigned char trail_byte = data[++i];
+        if (trail_byte < 0x40 || trail_byte > 0xFE || trail_byte == 0x7F) return i;  // 第二字节无效
+        add_big5_evidence(byte, trail_byte, evidence);
+    }
+    return size;
+}
+
+/**
+ * @struct Big5Masks
+ * @brief (内部实现) 64 字节块中与 Big5 证据有关的各类字节的位掩码，与 GbkMasks 配合使用。
+ * @details
+ * 在合法的 GBK 中，0x80-0xA0 的字节要么是首字节 0x81-0xA0，要么是第二字节 0x80-0xA0，两者 Big5 都不允许，
+ * 因此只需知道块中是否出现过这类字节。没有这类字节时，第二字节不小于 0x80 就等价于不小于 0xA1，
+ * 第二字节的分类可以直接取 GbkMasks::lead。
+ */
+struct Big5Masks {
+    uint64_t bad;       // 块中出现 0x80-0xA0 时不为 0 (不一定是逐字节的掩码)
+    uint64_t low_row;   // 0xA1-0xA7，作首字节时第二字节小于 0xA1 即落在用户自定义区
+    uint64_t high_row;  // 0xAA-0xAF、0xF8-0xFF，作首字节时第二字节不小于 0xA1 即落在用户自定义区
+    uint64_t ge_fa;     // 0xFA-0xFF，不能作 Big5 首字节
+};
+
+using Big5MaskLoader = Big5Masks (*)(const unsigned char*);
+
+/**
+ * @brief (内部实现) 以 64 字节为一块验证GBK前缀，同时收集 Big5 证据。
+ * @details
+ * 第二字节的位置由 gbk_trail_positions() 求出后同时用于两件事：验证 GBK，以及把首字节的分类左移一位
+ * 与第二字节对齐后得到两类 Big5 证据；上一块最后一个字节的分类带入下一块。
+ * 出现 Big5 不允许的字节后结论已经确定，剩下的部分改用 validate_gbk_prefix()。
+ * @pre 从字符边界开始 (pending_lead 为 0)。
+ */
+template <GbkMaskLoader LoadGbk, Big5MaskLoader LoadBig5>
+inline size_t validate_gbk_prefix_big5_blocks(const char* data, size_t size, unsigned char& pending_lead,
+                                              Big5Evidence& evidence) {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+    uint64_t carry = 0;
+    uint64_t prev_low_row = 0, prev_high_row = 0, prev_ge_fa = 0;  // 上一块第 63 字节的分类
+    size_t i = 0;
+    for (; i + 64 <= size && !evidence.not_big5; i += 64) {
+        const GbkMasks gbk = LoadGbk(p + i);
+        uint64_t next_carry = carry;
+        const uint64_t trail = gbk_trail_positions(gbk.lead, next_carry);
+        if (((trail & gbk.bad_trail) | (~trail & ~gbk.lead & gbk.bad_single)) != 0) break;
+
+        const Big5Masks m = LoadBig5(p + i);
+        const uint64_t lead_low_row = (m.low_row << 1) | prev_low_row;
+        const uint64_t lead_high_row = (m.high_row << 1) | prev_high_row;
+        const uint64_t lead_ge_fa = (m.ge_fa << 1) | prev_ge_fa;
+        if ((trail & ((lead_low_row & ~gbk.lead) | (lead_high_row & gbk.lead))) != 0) evidence.user_defined = true;
+        if (m.bad != 0 || (trail & lead_ge_fa) != 0) evidence.not_big5 = true;
+        carry = next_carry;
+        prev_low_row = m.low_row >> 63;
+        prev_high_row = m.high_row >> 63;
+        prev_ge_fa = m.ge_fa >> 63;
+    }
+    if (evidence.not_big5) {
+        bool gbk_pending_lead = carry != 0;
+        const size_t end = i + validate_gbk_prefix(data + i, size - i, gbk_pending_lead);
+        pending_lead = gbk_pending_lead ? p[size - 1] : 0;
+        return end;
+    }
+    pending_lead = carry != 0 ? p[i - 1] : 0;
+    return i + validate_gbk_prefix_big5_scalar(data + i, size - i, pending_lead, evidence);
+}
+
+#if defined(ENCODING_UTIL_SIMD_X86)
+
+inline Big5Masks load_big5_masks_sse2(const unsigned char* p) {
+    const __m128i x80 = _mm_set1_epi8(static_cast<char>(0x80));
+    const __m128i xa0 = _mm_set1_epi8(static_cast<char>(0xA0));
+    const __m128i xa1 = _mm_set1_epi8(static_cast<char>(0xA1));
+    const __m128i xa7 = _mm_set1_epi8(static_cast<char>(0xA7));
+    const __m128i xaa = _mm_set1_epi8(static_cast<char>(0xAA));
+    const __m128i xaf = _mm_set1_epi8(static_cast<char>(0xAF));
+    const __m128i xf8 = _mm_set1_epi8(static_cast<char>(0xF8));
+    const __m128i xfa = _mm_set1_epi8(static_cast<char>(0xFA));
+    Big5Masks masks{0, 0, 0, 0};
+    for (int k = 0; k < 4; ++k) {
+        const __m128i cur = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16 * k));
+        const __m128i bad = _mm_cmpeq_epi8(_mm_min_epu8(_mm_max_epu8(cur, x80), xa0), cur);
+        const __m128i low_row = _mm_cmpeq_epi8(_mm_min_epu8(_mm_max_epu8(cur, xa1), xa7), cur);
+        const __m128i high_row = _mm_or_si128(_mm_cmpeq_epi8(_mm_min_epu8(_mm_max_epu8(cur, xaa), xaf), cur),
+                                              _mm_cmpeq_epi8(_mm_max_epu8(cur, xf8), cur));
+        const __m128i ge_fa = _mm_cmpeq_epi8(_mm_max_epu8(cur, xfa), cur);
+        const int shift = 16 * k;
+        masks.bad |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(bad))) << shift;
+        masks.low_row |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(low_row))) << shift;
+        masks.high_row |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(high_row))) << shift;
+        masks.ge_fa |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(ge_fa))) << shift;
+    }
+    return masks;
+}
+
+/**
+ * @details
+ * 用高、低半字节各查一次表 (vpshufb) 后按位与，一次得到每个字节所属的各个区间 (每个区间占一位)：
+ *   bit0: 0x80-0x9F  bit1: 0xA0  bit2: 0xA1-0xA7  bit3: 0xAA-0xAF  bit4: 0xF8-0xFF  bit5: 0xFA-0xFF
+ * 再把所需的位移到最高位后用 movemask 取出，比逐个阈值比较少用一半的指令。
+ */
+ENCODING_UTIL_TARGET_AVX2
+inline Big5Masks load_big5_masks_avx2(const unsigned char* p) {
+    const __m256i high_nibble_table = _mm256_broadcastsi128_si256(
+        _mm_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 0x01, 0x01, 0x0E, 0, 0, 0, 0, 0x30));
+    const __m256i low_nibble_table = _mm256_broadcastsi128_si256(
+        _mm_setr_epi8(0x03, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x11, 0x11, 0x39, 0x39, 0x39, 0x39, 0x39, 0x39));
+    const __m256i x0f = _mm256_set1_epi8(0x0F);
+    const __m256i bad_bits = _mm256_set1_epi8(0x03);
+    const __m256i high_row_bits = _mm256_set1_epi8(0x18);
+    const __m256i x7f = _mm256_set1_epi8(0x7F);
+    Big5Masks masks{0, 0, 0, 0};
+    for (int k = 0; k < 2; ++k) {
+        const __m256i cur = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32 * k));
+        const __m256i high_nibble = _mm256_and_si256(_mm256_srli_epi16(cur, 4), x0f);
+        const __m256i classes = _mm256_and_si256(_mm256_shuffle_epi8(high_nibble_table, high_nibble),
+                                                 _mm256_shuffle_epi8(low_nibble_table, _mm256_and_si256(cur, x0f)));
+        // 按 16 位左移 k 位后，每个字节的最高位仍取自它自己的第 7-k 位；两位中任一为 1 时，饱和加 0x7F 会使最高位为 1
+        const __m256i low_row = _mm256_slli_epi16(classes, 5);
+        const __m256i high_row = _mm256_adds_epu8(_mm256_and_si256(classes, high_row_bits), x7f);
+        const __m256i ge_fa = _mm256_slli_epi16(classes, 2);
+        const int shift = 32 * k;
+        masks.bad |= static_cast<uint64_t>(_mm256_testz_si256(classes, bad_bits) == 0);
+        masks.low_row |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(low_row))) << shift;
+        masks.high_row |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(high_row))) << shift;
+        masks.ge_fa |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(ge_fa))) << shift;
+    }
+    return masks;
+}
+
+#elif defined(ENCODING_UTIL_SIMD_NEON)
+
+inline Big5Masks load_big5_masks_neon(const unsigned char* p) {
+    uint8x16_t bad = vdupq_n_u8(0), low_row[4], high_row[4], ge_fa[4];
+    for (int k = 0; k < 4; ++k) {
+        const uint8x16_t cur = vld1q_u8(p + 16 * k);
+        bad = vorrq_u8(bad, vandq_u8(vcgeq_u8(cur, vdupq_n_u8(0x80)), vcleq_u8(cur, vdupq_n_u8(0xA0))));
+        low_row[k] = vandq_u8(vcgeq_u8(cur, vdupq_n_u8(0xA1)), vcleq_u8(cur, vdupq_n_u8(0xA7)));
+        high_row[k] = vorrq_u8(vandq_u8(vcgeq_u8(cur, vdupq_n_u8(0xAA)), vcleq_u8(cur, vdupq_n_u8(0xAF))),
+                               vcgeq_u8(cur, vdupq_n_u8(0xF8)));
+        ge_fa[k] = vcgeq_u8(cur, vdupq_n_u8(0xFA));
+    }
+    return Big5Masks{vmaxvq_u8(bad), neon_movemask64(low_row[0], low_row[1], low_row[2], low_row[3]),
+                     neon_movemask64(high_row[0], high_row[1], high_row[2], high_row[3]),
+                     neon_movemask64(ge_fa[0], ge_fa[1], ge_fa[2], ge_fa[3])};
+}
+
+#endif
+
+using GbkBig5PrefixValidator = size_t (*)(const char*, size_t, unsigned char&, Big5Evidence&);
+
+/**
+ * @brief (内部实现) 根据当前 CPU 特性选出最快的GBK验证加 Big5 证据收集实现。
+ */
+inline GbkBig5PrefixValidator select_gbk_big5_prefix_validator() {
+#if defined(ENCODING_UTIL_SIMD_X86)
+    return cpu_has_avx2() ? &validate_gbk_prefix_big5_blocks<&load_gbk_masks_avx2, &load_big5_masks_avx2>
+                          : &validate_gbk_prefix_big5_blocks<&load_gbk_masks_sse2, &load_big5_masks_sse2>;
+#elif defined(ENCODING_UTIL_SIMD_NEON)
+    return &validate_gbk_prefix_big5_blocks<&load_gbk_masks_neon, &load_big5_masks_neon>;
+#else
+    return &validate_gbk_prefix_big5_scalar;
+#endif
+}
+
+/**
+ * @brief (内部实现) 验证GBK前缀并同时收集 Big5 证据，按运行时检测到的 CPU 特性分派到向量化或标量实现。
+ * @details
+ * 参数与返回值同 validate_gbk_prefix_big5_scalar()。返回值与 not_big5、is_big5() 与标量版本一致；
+ * not_big5 成立后不再收集证据，此时 user_defined 没有意义。
+ */
+inline size_t validate_gbk_prefix_big5(const char* data, size_t size, unsigned char& pending_lead,
+                                       Big5Evidence& evidence) {
+    if (evidence.not_big5) {  // 结论已经确定，只需验证GBK
+        bool gbk_pending_lead = pending_lead != 0;
+        const size_t end = validate_gbk_prefix(data, size, gbk_pending_lead);
+        if (!gbk_pending_lead) pending_lead = 0;
+        else if (size > 0) pending_lead = static_cast<unsigned char>(data[size - 1]);
+        return end;
+    }
+    size_t start = 0;
+    if (pending_lead != 0) {  // 向量实现从字符边界开始，先配对上一段留下的首字节
+        start = validate_gbk_prefix_big5_scalar(data, std::min<size_t>(size, 1), pending_lead, evidence);
+        if (start < std::min<size_t>(size, 1)) return start;
+    }
+    start += find_non_ascii(data + start, size - start);
+    if (size - start < 64) return start + validate_gbk_prefix_big5_scalar(data + start, size - start, pending_lead,
+                                                                          evidence);
+    static const GbkBig5PrefixValidator impl = select_gbk_big5_prefix_validator();
+    return start + impl(data + start, size - start, pending_lead, evidence);
+}
+
+/**
+ * @brief (内部实现) UTF-8 已被否定 (且不是因为截断) 时，依次按 UTF-16 BOM、GBK、GB18030 判定编码。
+ * @details 合法的 GBK 总是判为 GBK；Big5 的字节范围是 GBK 的子集，只能经由 detect_encoding_with_big5() 显式选用。
+ * @param gbk_invalid_at GBK 被否定的位置，含义同 EncodingAnalysis::gbk_invalid_at。
+ */
+constexpr Encoding classify_non_utf8(std::string_view sv, size_t gbk_invalid_at) {
+    if (const Encoding bom = utf16_bom_encoding(sv); bom != Encoding::UNKNOWN) return bom;
+    if (gbk_invalid_at == std::string_view::npos) return Encoding::GBK;
+    if (gbk_invalid_at < sv.size() && is_ascii_digit(static_cast<unsigned char>(sv[gbk_invalid_at]))) {
+        int pending = 2;
+        const size_t next = gbk_invalid_at + 1;
+        if (validate_gb18030_prefix(sv.data() + next, sv.size() - next, pending) == sv.size() - next &&
+            pending == 0) {
+            return Encoding::GB18030;
+        }
+    }
+    return Encoding::UNKNOWN;
+}
+
+// ---------- UTF-8/GBK 单遍联合检测 ----------
+// 把 UTF-8 与 GBK 两个状态机合并为一个状态机，每个字节只查一次表就同时推进两者；
+// 当其中一个被否定后，剩下的那个改用各自的快速实现继续，因此整个输入只读一遍。
+namespace fused {
+
+// 字节分类：按 (UTF-8 中的角色, 能否作GBK首字节, 能否作GBK第二字节) 划分出的等价类
+enum ByteClass : uint8_t {
+    kAsciiLow,    // 0x00-0x3F: ASCII，不能作GBK第二字节
+    kAsciiTrail,  // 0x40-0x7E: ASCII，可作GBK第二字节
+    kDel,         // 0x7F
+    kCont80,      // 0x80: UTF-8后续字节，可作GBK第二字节但不能作首字节
+    kContLead,    // 0x81-0xBF: UTF-8后续字节，可作GBK首字节
+    kBadC0,       // 0xC0-0xC1: UTF-8非法首字节
+    kLead2,       // 0xC2-0xDF
+    kLead3,       // 0xE0-0xEF
+    kLead4,       // 0xF0-0xF4
+    kBadF5,       // 0xF5-0xFE: UTF-8非法首字节
+    kFF,          // 0xFF: 两种编码中均非法
+    kNumClasses
+};
+
+// 每一类的代表字节，用来由各自的单编码规则推出联合转移表
+inline constexpr unsigned char kClassRepresentative[kNumClasses] = {
+    0x00, 0x40, 0x7F, 0x80, 0x81, 0xC0, 0xC2, 0xE0, 0xF0, 0xF5, 0xFF};
+
+constexpr uint8_t classify_byte(unsigned char byte) {
+    if (byte < 0x40) return kAsciiLow;
+    if (byte < 0x7F) return kAsciiTrail;
+    if (byte == 0x7F) return kDel;
+    if (byte == 0x80) return kCont80;
+    if (byte < 0xC0) return kContLead;
+    if (byte < 0xC2) return kBadC0;
+    if (byte < 0xE0) return kLead2;
+    if (byte < 0xF0) return kLead3;
+    if (byte < 0xF5) return kLead4;
+    if (byte < 0xFF) return kBadF5;
+    return kFF;
+}
+
+constexpr std::array<uint8_t, 256> make_byte_classes() {
+    std::array<uint8_t, 256> classes{};
+    for (int b = 0; b < 256; ++b) classes[b] = classify_byte(static_cast<unsigned char>(b));
+    return classes;
+}
+
+inline constexpr std::array<uint8_t, 256> kByteClasses = make_byte_classes();
+
+// 单个状态机的状态：UTF-8 为尚需的后续字节数 (0~3)，GBK 为是否在等待第二字节 (0~1)
+inline constexpr int kUtf8Dead = 4;
+inline constexpr int kGbkDead = 2;
+
+constexpr int utf8_step(int state, unsigned char byte) {
+    if (state > 0) return (byte & 0xC0) == 0x80 ? state - 1 : kUtf8Dead;
+    if (byte <= 0x7F) return 0;
+    if (byte >= 0xC2 && byte <= 0xDF) return 1;
+    if (byte >= 0xE0 && byte <= 0xEF) return 2;
+    if (byte >= 0xF0 && byte <= 0xF4) return 3;
+    return kUtf8Dead;
+}
+
+constexpr int gbk_step(int state, unsigned char byte) {
+    if (state == 1) return (byte >= 0x40 && byte <= 0xFE && byte != 0x7F) ? 0 : kGbkDead;
+    if (byte <= 0x7F) return 0;
+    if (byte >= 0x81 && byte <= 0xFE) return 1;
+    return kGbkDead;
+}
+
+// 联合状态编号：两者都存活的 8 个状态排在最前面 (0~7)，便于主循环只用一次比较判断是否有候选被否定
+//   0~7  : utf8 + 4 * gbk
+//   8~9  : UTF-8 已否定，8 + gbk
+//   10~13: GBK 已否定，10 + utf8
+//   14   : 两者均已否定
+inline constexpr uint8_t kNumAliveStates = 8;
+inline constexpr uint8_t kNumStates = 15;
+
+constexpr uint8_t encode_state(int utf8, int gbk) {
+    if (utf8 == kUtf8Dead && gbk == kGbkDead) return 14;
+    if (utf8 == kUtf8Dead) return static_cast<uint8_t>(8 + gbk);
+    if (gbk == kGbkDead) return static_cast<uint8_t>(10 + utf8);
+    return static_cast<uint8_t>(utf8 + 4 * gbk);
+}
+
+constexpr int utf8_part(uint8_t state) {
+    if (state < 8) return state % 4;
+    if (state >= 10 && state < 14) return state - 10;
+    return kUtf8Dead;
+}
+
+constexpr int gbk_part(uint8_t state) {
+    if (state < 8) return state / 4;
+    if (state == 8 || state == 9) return state - 8;
+    return kGbkDead;
+}
+
+constexpr std::array<std::array<uint8_t, kNumClasses>, kNumStates> make_transitions() {
+    std::array<std::array<uint8_t, kNumClasses>, kNumStates> table{};
+    for (uint8_t s = 0; s < kNumStates; ++s) {
+        for (int c = 0; c < kNumClasses; ++c) {
+            const unsigned char byte = kClassRepresentative[c];
+            const int u = utf8_part(s) == kUtf8Dead ? kUtf8Dead : utf8_step(utf8_part(s), byte);
+            const int g = gbk_part(s) == kGbkDead ? kGbkDead : gbk_step(gbk_part(s), byte);
+            table[s][c] = encode_state(u, g);
+        }
+    }
+    return table;
+}
+
+inline constexpr auto kTransitions = make_transitions();
+
+#if defined(ENCODING_UTIL_SIMD_X86) || defined(ENCODING_UTIL_SIMD_NEON)
+    #define ENCODING_UTIL_FUSED_BLOCKS 1
+
+// 两者都存活时，先以 64 字节为一块用向量指令同时验证两种编码，整块无误才整体跳过
+using Utf8BlockChecker = bool (*)(const unsigned char*);
+
+struct BlockKernels {
+    Utf8BlockChecker utf8_has_error;  // 需要可读取块前 3 个字节
+    GbkMaskLoader load_gbk_masks;
+};
+
+inline BlockKernels select_block_kernels() {
+    #if defined(ENCODING_UTIL_SIMD_X86)
+    if (cpu_has_avx2()) return {&utf8_block64_has_error_avx2, &load_gbk_masks_avx2};
+    return {&utf8_block64_has_error_sse2, &load_gbk_masks_sse2};
+    #else
+    return {&utf8_block64_has_error_neon, &load_gbk_masks_neon};
+    #endif
+}
+#endif
+
+
+/**
+ * @brief (内部实现) 从 i 开始推进联合状态机，直到某个候选被否定或到达结尾。
+ * @details 两者都处于字符边界时整段跳过 ASCII；可用 SIMD 时按 64 字节块整体校验，块内出错才逐字节查表。
+ * @param state 输入输出参数，i 处的联合状态；返回时为最后一个被处理字节之后的状态。
+ * @pre `[0, i)` 已按 state 扫描过且没有被否定 (向量块需要回看前 3 个字节)。
+ * @return 导致某个候选被否定的字节偏移 (此时 state >= kNumAliveStates)；否则为 size。
+ */
+inline size_t scan(const char* data, size_t size, size_t i, uint8_t& state) {
+#if defined(ENCODING_UTIL_FUSED_BLOCKS)
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+    static const BlockKernels kernels = select_block_kernels();
+    size_t scalar_until = 0;  // 向量块中发现错误后，逐字节查表定位到该块结束为止
+#endif
+    while (i < size) {
+#if defined(ENCODING_UTIL_FUSED_BLOCKS)
+        if (i >= scalar_until && i >= 3 && size - i >= 64) {
+            uint64_t gbk_carry = static_cast<uint64_t>(gbk_part(state));
+            if (!kernels.utf8_has_error(p + i) && gbk_error_positions(kernels.load_gbk_masks(p + i), gbk_carry) == 0) {
+                i += 64;
+                state = encode_state(utf8_pending_bytes_at(p, i), static_cast<int>(gbk_carry));
+                if (state == 0) i += find_non_ascii(data + i, size - i);
+                continue;
+            }
+            scalar_until = i + 64;
+        }
+#endif
+        state = kTransitions[state][kByteClasses[static_cast<unsigned char>(data[i])]];
+        if (state >= kNumAliveStates) return i;
+        ++i;
+        if (state == 0) i += find_non_ascii(data + i, size - i);  // 两者都在字符边界上，整段跳过 ASCII
+    }
+    return size;
+}
+
+}  // namespace fused
+
+/**
+ * @brief (内部实现) analyze_encoding() 的扫描部分：求出 UTF-8 与 GBK 各自被否定的位置，不判定编码。
+ */
+inline EncodingAnalysis analyze_candidates(std::string_view sv) {
+    EncodingAnalysis result;
+    const char* data = sv.data();
+    const size_t size = sv.size();
+
+    // --- 阶段 1: 两个状态机同时推进，直到其中一个被否定或到达结尾 ---
+    size_t i = find_non_ascii(data, size);
+    result.is_all_ascii = (i == size);
+    uint8_t state = 0;
+    i = fused::scan(data, size, i, state);
+
+    int utf8_pending = fused::utf8_part(state);
+    bool gbk_pending_lead = fused::gbk_part(state) == 1;
+    if (utf8_pending == fused::kUtf8Dead) result.utf8_invalid_at = i;
+    if (fused::gbk_part(state) == fused::kGbkDead) result.gbk_invalid_at = i;
+
+    // --- 阶段 2: 只剩一个候选时，从被否定位置的下一个字节起改用该编码的快速实现 ---
+    if (state >= fused::kNumAliveStates && i < size) {
+        const size_t next = i + 1;
+        if (result.utf8_invalid_at == EncodingAnalysis::npos) {
+            bool ignored_ascii = false;
+            const size_t end =
+                next + validate_utf8_prefix(data + next, size - next, utf8_pending, ignored_ascii);
+            if (end < size) result.utf8_invalid_at = end;
+        } else if (result.gbk_invalid_at == EncodingAnalysis::npos) {
+            const size_t end = next + validate_gbk_prefix(data + next, size - next, gbk_pending_lead);
+            if (end < size) result.gbk_invalid_at = end;
+        }
+    }
+
+    // --- 阶段 3: 结尾仍在多字节序列中间，视为被截断 ---
+    if (result.utf8_invalid_at == EncodingAnalysis::npos && utf8_pending > 0) result.utf8_invalid_at = size;
+    if (result.gbk_invalid_at == EncodingAnalysis::npos && gbk_pending_lead) result.gbk_invalid_at = size;
+    return result;
+}
+
+/**
+ * @brief (内部实现) 由各候选被否定的位置判定编码，单线程与多线程检测共用。
+ */
+inline Encoding resolve_encoding(std::string_view sv, const EncodingAnalysis& analysis) {
+    if (analysis.utf8_invalid_at == EncodingAnalysis::npos) {
+        return analysis.is_all_ascii ? Encoding::ASCII : Encoding::UTF8;
+    }
+    // UTF-8 只会因为截断而在输入长度处被否定；不完整的UTF-8序列被视为未知，以避免误判
+    if (analysis.utf8_invalid_at == sv.size()) return Encoding::UNKNOWN;
+    return classify_non_utf8(sv, analysis.gbk_invalid_at);
+}
+}  // namespace detail
+
+/**
+ * @brief 单遍检测给定字节序列的编码，并给出 UTF-8 与 GBK 各自被否定的位置。
+ *
+ * @details
+ * 规则与 detect_encoding() 完全一致，区别在于只读一遍数据：UTF-8 与 GBK 的状态机合并为一张联合转移表
+ * 同时推进，两者都处于字符边界时整段跳过 ASCII；一旦其中一个被否定，剩下的那个继续用各自的快速实现验证到结尾，
+ * 两者都被否定时立即结束。
+ * UTF-16 BOM 只看开头两个字节；GB18030 从 GBK 被否定的位置接着验证。
+ * @param sv 要检测的字符串视图。
+ * @return 检测结果。
+ */
+inline EncodingAnalysis analyze_encoding(std::string_view sv) {
+    const detail::OperationProbe probe(metrics::Operation::DETECT, sv.size());
+    EncodingAnalysis result = detail::analyze_candidates(sv);
+    result.encoding = detail::resolve_encoding(sv, result);
+    return result;
+}
+
+/**
+ * @brief 检测给定字节序列的编码格式。
+ *
+ * @details
+ * 此函数通过严格的规则验证来判断编码。
+ * 检测逻辑：
+ * 1. 优先验证是否为UTF-8。
+ *    - 如果是完整的UTF-8，则返回 Encoding::UTF8 或 Encoding::ASCII。
+ *    - 如果是不完整的UTF-8，立即返回 Encoding::UNKNOWN，因为它很可能是被截断的文件。
+ * 2. 如果是无效的UTF-8序列，且以 BOM 开头 (`FF FE` / `FE FF`)、总长度为偶数，则返回 Encoding::UTF16LE / UTF16BE。
+ * 3. 再检查是否为合法的GBK编码，是则返回 Encoding::GBK (Big5 的字节范围是 GBK 的子集，见 detect_encoding_with_big5())。
+ * 4. 否则检查是否为合法的 GB18030 (GBK 加上四字节序列)，是则返回 Encoding::GB18030。
+ * 5. 如果所有检查都失败，则返回 Encoding::UNKNOWN。
+ *
+ * UTF-8 与 GBK 的验证在同一遍扫描中完成 (见 analyze_encoding())，GBK 输入不会被读取两遍来验证。
+ * 可在编译期求值 (例如 `static_assert(detect_encoding("你好") == Encoding::UTF8)`)，此时依次使用各个标量验证器。
+ */
+constexpr Encoding detect_encoding(std::string_view sv) {
+    if (std::is_constant_evaluated()) {
+        bool is_all_ascii = true;
+        switch (detail::validate_utf8_scalar(sv.data(), sv.size(), is_all_ascii)) {
+            case detail::Utf8Status::VALID: return is_all_ascii ? Encoding::ASCII : Encoding::UTF8;
+            case detail::Utf8Status::INCOMPLETE_SEQUENCE: return Encoding::UNKNOWN;
+            case detail::Utf8Status::INVALID_SEQUENCE: break;
+        }
+        bool pending_lead = false;
+        size_t gbk_invalid_at = detail::validate_gbk_prefix_scalar(sv.data(), sv.size(), pending_lead);
+        if (gbk_invalid_at == sv.size()) gbk_invalid_at = pending_lead ? sv.size() : std::string_view::npos;
+        return detail::classify_non_utf8(sv, gbk_invalid_at);
+    }
+    return analyze_encoding(sv).encoding;
+}
+
+/**
+ * @brief 检测编码，并允许把合法的 GBK 输入判为 Big5 (需要显式选用)。
+ *
+ * @details
+ * Big5 的首字节与第二字节范围都是 GBK 的子集，detect_encoding() 总是把合法的 GBK 判为 GBK。
+ * 本函数在 detect_encoding() 给出 GBK 时再读一遍输入收集证据：含有落在 GBK 用户自定义区的字符，
+ * 且所有字符都符合 Big5 的范围时返回 Encoding::BIG5。含有自定义区字符的 GBK 文本同样会被判为 Big5，
+ * 因此只应在已知输入可能来自繁体中文环境时使用。其他情况下的结果与 detect_encoding() 相同。
+ * 可在编译期求值。
+ */
+constexpr Encoding detect_encoding_with_big5(std::string_view sv) {
+    const Encoding encoding = detect_encoding(sv);
+    if (encoding != Encoding::GBK) return encoding;
+    unsigned char pending_lead = 0;
+    detail::Big5Evidence big5;
+    if (std::is_constant_evaluated()) {
+        detail::validate_gbk_prefix_big5_scalar(sv.data(), sv.size(), pending_lead, big5);
+    } else {
+        detail::validate_gbk_prefix_big5(sv.data(), sv.size(), pending_lead, big5);
+    }
+    return big5.is_big5() ? Encoding::BIG5 : Encoding::GBK;
+}
+
+/**
+ * @brief 检查一个字符串是否为有效的 UTF-8 或 ASCII 编码。
+ * @param sv 要检查的字符串视图。
+ * @return 如果是 UTF-8 或 ASCII，则为 true；否则为 false。
+ */
+constexpr bool is_utf8(std::string_view sv) {
+    Encoding enc = detect_encoding(sv);
+    return enc == Encoding::UTF8 || enc == Encoding::ASCII;
+}
+
+/**
+ * @brief 检查一个字符串是否为有效的 GBK 或 ASCII 编码。
+ * @param sv 要检查的字符串视图。
+ * @return 如果是 GBK 或 ASCII，则为 true；否则为 false。
+ */
+constexpr bool is_gbk(std::string_view sv) {
+    Encoding enc = detect_encoding(sv);
+    return enc == Encoding::GBK || enc == Encoding::ASCII;
+}
+
+// ========== 增量检测接口 ==========
+/**
+ * @class IncrementalDetector
+ * @brief 分块接收数据的增量编码检测器，可以在结论已经确定时提前结束。
+ * @details
+ * 内部沿用 analyze_encoding() 的联合状态机，状态在多次 feed() 之间保留，因此任意切分输入都与整体检测一致。
+ * 提前结束的策略由 StopPolicy 指定：
+ * - Exhaustive：读到所有候选都被否定或输入结束为止，结果与 analyze_encoding() 完全相同；
+ * - FirstDisproof：UTF-8 与 GBK 之一被否定时立即以另一个作为结论 (假定剩余数据同样合法)；
+ * - AfterEvidence：一个候选被否定后，剩下的候选再连续通过 evidence_bytes 字节的验证即作为结论。
+ * GB18030 候选在 GBK 被四字节序列否定后接替它，总是验证到输入结束；
+ * 以 UTF-16 BOM 开头的输入在非 Exhaustive 策略下读完 BOM 即结束。
+ */
+class IncrementalDetector {
+public:
+    enum class StopPolicy { Exhaustive, FirstDisproof, AfterEvidence };
+
+    explicit IncrementalDetector(StopPolicy policy = StopPolicy::Exhaustive, size_t evidence_bytes = 64 * 1024)
+        : policy_(policy), evidence_bytes_(policy == StopPolicy::FirstDisproof ? 0 : evidence_bytes) {}
+
+    /**
+     * @brief 送入下一块数据。
+     * @return 结论是否已经确定；确定后再送入的数据会被忽略，可以直接调用 finish()。
+     */
+    bool feed(std::string_view chunk) {
+        namespace fused = detail::fused;
+        if (done_ || chunk.empty()) return done_;
+        record_head(chunk);
+        const char* data = chunk.data();
+        const size_t size = chunk.size();
+        size_t i = 0;
+
+        if (!one_dead()) {
+            // 上一块结尾在字符边界上时才能整段跳过 ASCII，否则这些字节可能是 GBK 的第二字节
+            if (state_ == 0) {
+                i = detail::find_non_ascii(data, size);
+                if (i < size) analysis_.is_all_ascii = false;
+            }
+            i = fused::scan(data, size, i, state_);
+            if (i == size) {
+                consumed_ += size;
+                return false;
+            }
+
+            // 至少一个候选在 i 处被否定
+            const bool utf8_dead = fused::utf8_part(state_) == fused::kUtf8Dead;
+            const bool gbk_dead = fused::gbk_part(state_) == fused::kGbkDead;
+            if (utf8_dead) analysis_.utf8_invalid_at = consumed_ + i;
+            if (gbk_dead) disprove_gbk(data, i);
+            utf8_pending_ = utf8_dead ? 0 : fused::utf8_part(state_);
+            gbk_pending_lead_ = !gbk_dead && fused::gbk_part(state_) == 1;
+            ++i;
+            if (utf8_dead && gbk_dead) return feed_extended(data, size, i);
+            if (policy_ == StopPolicy::FirstDisproof && !bom_possible()) return stop(consumed_ + i);
+        } else if (!utf8_alive() && !gbk_alive()) {
+            return feed_extended(data, size, 0);
+        }
+
+        // 只剩一个候选，用它的快速实现继续验证
+        size_t limit = size;
+        if (policy_ == StopPolicy::AfterEvidence) limit = std::min(size, i + (evidence_bytes_ - evidence_seen_));
+        size_t end;
+        if (utf8_alive()) {
+            end = i + detail::validate_utf8_prefix(data + i, limit - i, utf8_pending_, analysis_.is_all_ascii);
+            if (end < limit) {
+                analysis_.utf8_invalid_at = consumed_ + end;
+                // GBK 已被四字节序列否定时，GB18030 从本块第 i 字节起接着验证
+                if (gb18030_alive_) return feed_extended(data, size, i);
+                return stop(consumed_ + end + 1);
+            }
+            // GB18030 与 UTF-8 同步推进，UTF-8 在之后的块中被否定时不必回头重读
+            if (gb18030_alive_ &&
+                detail::validate_gb18030_prefix(data + i, limit - i, gb18030_pending_) < limit - i) {
+                gb18030_alive_ = false;
+            }
+        } else {
+            // 从第 i 字节接着验证，未完的首字节由 gbk_pending_lead_ 跨块带过来
+            end = i + detail::validate_gbk_prefix(data + i, limit - i, gbk_pending_lead_);
+            if (end < limit) {
+                disprove_gbk(data, end);
+                return feed_extended(data, size, end + 1);
+            }
+        }
+        evidence_seen_ += limit - i;
+        if (policy_ == StopPolicy::AfterEvidence && evidence_seen_ >= evidence_bytes_) return stop(consumed_ + limit);
+        if (policy_ == StopPolicy::FirstDisproof && !bom_possible()) return stop(consumed_ + limit);
+        consumed_ += size;
+        return false;
+    }
+
+    /**
+     * @return 结论是否已经确定 (提前结束或所有候选都被否定)。
+     */
+    bool done() const noexcept { return done_; }
+
+    /**
+     * @return 检测器实际处理过的字节数，提前结束后不再增加。
+     */
+    size_t bytes_consumed() const noexcept { return consumed_; }
+
+    /**
+     * @brief 输入结束 (或已提前确定结论) 时给出检测结果。
+     * @details 未提前结束时，结果及各偏移与对全部数据调用 analyze_encoding() 相同；提前结束时 encoding 为推定的结论。
+     */
+    EncodingAnalysis finish() const noexcept {
+        EncodingAnalysis result = analysis_;
+        int utf8_pending = utf8_pending_;
+        bool gbk_pending_lead = gbk_pending_lead_;
+        if (!one_dead()) {
+            utf8_pending = detail::fused::utf8_part(state_);
+            gbk_pending_lead = detail::fused::gbk_part(state_) == 1;
+        }
+
+        if (early_stop_) {
+            // 提前结束时尚未读完数据，结尾处的截断无从谈起
+            if (utf8_alive()) {
+                result.encoding = result.is_all_ascii ? Encoding::ASCII : Encoding::UTF8;
+            } else if (gbk_alive()) {
+                result.encoding = Encoding::GBK;
+            } else {
+                result.encoding = bom_encoding();
+            }
+            return result;
+        }
+
+        const bool utf8_truncated = utf8_alive() && utf8_pending > 0;
+        if (utf8_truncated) result.utf8_invalid_at = consumed_;
+        if (gbk_alive() && gbk_pending_lead) result.gbk_invalid_at = consumed_;
+        if (result.utf8_invalid_at == EncodingAnalysis::npos) {
+            result.encoding = result.is_all_ascii ? Encoding::ASCII : Encoding::UTF8;
+        } else if (utf8_truncated) {
+            result.encoding = Encoding::UNKNOWN;
+        } else if (consumed_ > 2 && consumed_ % 2 == 0 && bom_encoding() != Encoding::UNKNOWN) {
+            result.encoding = bom_encoding();
+        } else if (result.gbk_invalid_at == EncodingAnalysis::npos) {
+            result.encoding = Encoding::GBK;
+        } else if (gb18030_alive_ && gb18030_pending_ == 0) {
+            result.encoding = Encoding::GB18030;
+        } else {
+            result.encoding = Encoding::UNKNOWN;
+        }
+        return result;
+    }
+
+    /**
+     * @brief 清空全部状态，开始检测新的输入。
+     */
+    void reset() noexcept { *this = IncrementalDetector(policy_, evidence_bytes_); }
+
+private:
+    bool utf8_alive() const noexcept { return analysis_.utf8_invalid_at == EncodingAnalysis::npos; }
+    bool gbk_alive() const noexcept { return analysis_.gbk_invalid_at == EncodingAnalysis::npos; }
+    bool one_dead() const noexcept { return !utf8_alive() || !gbk_alive(); }
+
+    void record_head(std::string_view chunk) noexcept {
+        for (size_t k = 0; head_size_ < 2 && k < chunk.size(); ++k) head_[head_size_++] = chunk[k];
+    }
+
+    // 已读入的开头字节仍可能是 UTF-16 BOM
+    bool bom_possible() const noexcept {
+        if (head_size_ == 0) return false;
+        const unsigned char first = static_cast<unsigned char>(head_[0]);
+        if (first != 0xFF && first != 0xFE) return false;
+        return head_size_ == 1 || bom_encoding() != Encoding::UNKNOWN;
+    }
+
+    Encoding bom_encoding() const noexcept {
+        return head_size_ == 2 ? detail::utf16_bom_of(head_[0], head_[1]) : Encoding::UNKNOWN;
+    }
+
+    // GBK 在本块第 pos 字节处被否定；该字节是数字时，它是 GB18030 四字节序列的第二字节
+    void disprove_gbk(const char* data, size_t pos) noexcept {
+        analysis_.gbk_invalid_at = consumed_ + pos;
+        if (detail::is_ascii_digit(static_cast<unsigned char>(data[pos]))) {
+            gb18030_alive_ = true;
+            gb18030_pending_ = 2;
+        }
+    }
+
+    // UTF-8 与 GBK 都已否定，从本块第 i 字节起只剩 GB18030 或带 BOM 的 UTF-16
+    bool feed_extended(const char* data, size_t size, size_t i) noexcept {
+        if (gb18030_alive_) {
+            const size_t end = i + detail::validate_gb18030_prefix(data + i, size - i, gb18030_pending_);
+            if (end < size) {
+                gb18030_alive_ = false;
+                return stop(consumed_ + end + 1);
+            }
+        } else if (!bom_possible()) {
+            return stop(consumed_ + i);
+        } else if (head_size_ == 2 && policy_ != StopPolicy::Exhaustive) {
+            return stop(2);  // BOM 就是输入的前两个字节
+        }
+        consumed_ += size;
+        return false;
+    }
+
+    bool stop(size_t consumed) noexcept {
+        consumed_ = consumed;
+        done_ = true;
+        early_stop_ = utf8_alive() || gbk_alive() || gb18030_alive_ || (head_size_ == 2 && bom_possible());
+        return true;
+    }
+
+    StopPolicy policy_;
+    size_t evidence_bytes_;
+    size_t evidence_seen_ = 0;
+    size_t consumed_ = 0;
+    EncodingAnalysis analysis_;
+    uint8_t state_ = 0;              // 两个候选都存活时的联合状态
+    int utf8_pending_ = 0;           // 只剩 UTF-8 时，还需要的后续字节数
+    bool gbk_pending_lead_ = false;  // 只剩 GBK 时，是否有一个尚缺第二字节的首字节
+    bool gb18030_alive_ = false;     // GBK 被四字节序列否定后，由 GB18030 接着验证
+    int gb18030_pending_ = 0;        // GB18030 当前字符已读入的字节数
+    char head_[2] = {};  // 输入开头的两个字节，用于识别 UTF-16 BOM
+    size_t head_size_ = 0;
+    bool done_ = false;
+    bool early_stop_ = false;
+};
+
+// ========== 抽样检测接口 ==========
+/**
+ * @brief 抽样检测的参数。
+ */
+struct SamplingOptions {
+    size_t window_size = 4096;   // 每个抽样窗口的字节数
+    size_t random_windows = 16;  // 除首尾两个窗口外，在中间区域分层随机抽取的窗口数
+    uint64_t seed = 0;           // 随机抽样的种子，相同的种子总是抽取相同的窗口
+};
+
+/**
+ * @brief 抽样检测的结果。
+ */
+struct SampledDetection {
+    Encoding encoding = Encoding::UNKNOWN;  // 推定的编码
+    double confidence = 0.0;                // 置信度，范围 [0, 1]，完整扫描时为 1
+    size_t bytes_examined = 0;              // 实际读取的字节数
+};
+
+namespace detail {
+/**
+ * @brief (内部实现) 单个抽样窗口的验证结果。
+ */
+struct WindowVerdict {
+    bool has_non_ascii = false;
+    bool utf8_ok = false;
+    bool gbk_ok = false;
+    size_t lookbehind = 0;  // 为对齐 GBK 字符边界在窗口之前读取的字节数
+};
+
+/**
+ * @brief (内部实现) 验证 [begin, end) 窗口，窗口两端先对齐到各自编码的字符边界。
+ * @details
+ * - UTF-8：跳过开头最多 3 个后续字节，即可落在字符边界上；
+ * - GBK：向前数出窗口前连续的 0x81~0xFE 字节，个数为奇数时窗口的第一个字节是第二字节，需要跳过；
+ *   最多向前读取一个窗口长度，连续段更长时无法确定奇偶，两种对齐各验证一次，任一合法即可；
+ * - 窗口并非输入结尾时，去掉末尾被截断的字符。
+ */
+inline WindowVerdict verify_window(const char* data, size_t size, size_t begin, size_t end) {
+    WindowVerdict verdict;
+    verdict.has_non_ascii = find_non_ascii(data + begin, end - begin) < end - begin;
+    if (!verdict.has_non_ascii) return verdict;
+
+    size_t utf8_begin = begin;
+    const size_t utf8_sync_limit = std::min(begin + 3, end);
+    while (utf8_begin < utf8_sync_limit && (static_cast<unsigned char>(data[utf8_begin]) & 0xC0) == 0x80) {
+        ++utf8_begin;
+    }
+    size_t utf8_end = end;
+    if (end < size) utf8_end -= utf8_incomplete_tail_size(data + utf8_begin, end - utf8_begin);
+    bool ignored_ascii = false;
+    verdict.utf8_ok = validate_utf8(data + utf8_begin, utf8_end - utf8_begin, ignored_ascii) == Utf8Status::VALID;
+
+    const size_t lookbehind_limit = std::min(begin, end - begin);
+    size_t lead_run = 0;
+    while (lead_run < lookbehind_limit) {
+        const unsigned char byte = static_cast<unsigned char>(data[begin - 1 - lead_run]);
+        if (byte < 0x81 || byte == 0xFF) break;
+        ++lead_run;
+    }
+    verdict.lookbehind = lead_run < lookbehind_limit ? lead_run + 1 : lead_run;
+    const auto gbk_ok_from = [&](size_t gbk_begin) {
+        gbk_begin = std::min(gbk_begin, end);
+        size_t gbk_end = end;
+        if (end < size) gbk_end -= gbk_incomplete_tail_size(data + gbk_begin, end - gbk_begin);
+        return is_valid_gbk(data + gbk_begin, gbk_end - gbk_begin);
+    };
+    if (lead_run == lookbehind_limit && lead_run < begin) {
+        verdict.gbk_ok = gbk_ok_from(begin) || gbk_ok_from(begin + 1);
+    } else {
+        verdict.gbk_ok = gbk_ok_from(begin + lead_run % 2);
+    }
+    return verdict;
+}
+
+/**
+ * @brief (内部实现) splitmix64 伪随机数，用于确定抽样位置。
+ */
+inline uint64_t splitmix64(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+}  // namespace detail
+
+/**
+ * @brief 抽样检测超大缓冲区的编码，只读取首尾与若干随机位置的窗口，给出推定的编码与置信度。
+ *
+ * @details
+ * 抽样的数据量不小于输入长度时退化为完整的 detect_encoding()，置信度为 1。否则：
+ * - 每个窗口的两端先对齐到字符边界，再分别按 UTF-8 与 GBK 验证；
+ * - 与 detect_encoding() 一样优先 UTF-8：所有含非ASCII字节的窗口都是合法 UTF-8 时推定为 UTF-8，否则看 GBK；
+ * - 置信度 = 支持该结论的窗口占含非ASCII窗口的比例 × (1 - 0.5^含非ASCII窗口数)；
+ *   只有多数窗口支持同一编码时才给出结论，否则为 UNKNOWN；
+ * - 所有窗口都只含 ASCII 时推定为 ASCII，置信度为实际读取的字节占输入的比例。
+ * 抽样结论不构成严格证明：验证失败的字节可能恰好落在未抽到的位置。
+ * 抽样只在 UTF-8 与 GBK 之间推定；GB18030、Big5 与 UTF-16 需要看到完整的输入，请使用完整检测。
+ * @param sv 要检测的字符串视图。
+ * @param options 抽样参数。
+ * @return 推定的编码、置信度与实际读取的字节数。
+ */
+inline SampledDetection detect_encoding(std::string_view sv, const SamplingOptions& options) {
+    SampledDetection result;
+    const size_t size = sv.size();
+    const size_t window = std::max<size_t>(options.window_size, 16);
+    const size_t windows = options.random_windows + 2;
+    if (size / windows <= window) {
+        result.encoding = detect_encoding(sv);
+        result.confidence = 1.0;
+        result.bytes_examined = size;
+        return result;
+    }
+
+    // 首尾各一个窗口，中间区域等分为 random_windows 层，每层随机取一个窗口
+    std::vector<size_t> starts = {0, size - window};
+    const size_t middle = size - 2 * window;
+    const size_t stratum = middle / std::max<size_t>(options.random_windows, 1);
+    uint64_t rng = options.seed;
+    for (size_t k = 0; k < options.random_windows; ++k) {
+        const size_t span = stratum > window ? stratum - window : 0;
+        starts.push_back(window + k * stratum + (span ? detail::splitmix64(rng) % span : 0));
+    }
+
+    size_t evidence = 0;
+    size_t utf8_votes = 0;
+    size_t gbk_votes = 0;
+    for (const size_t start : starts) {
+        const detail::WindowVerdict verdict = detail::verify_window(sv.data(), size, start, start + window);
+        result.bytes_examined += window + verdict.lookbehind;
+        if (!verdict.has_non_ascii) continue;
+        ++evidence;
+        utf8_votes += verdict.utf8_ok;
+        gbk_votes += verdict.gbk_ok;
+    }
+
+    if (evidence == 0) {
+        result.encoding = Encoding::ASCII;
+        result.confidence = static_cast<double>(result.bytes_examined) / static_cast<double>(size);
+        return result;
+    }
+
+    size_t votes = 0;
+    if (utf8_votes == evidence || (utf8_votes >= gbk_votes && utf8_votes * 2 > evidence)) {
+        result.encoding = Encoding::UTF8;
+        votes = utf8_votes;
+    } else if (gbk_votes * 2 > evidence) {
+        result.encoding = Encoding::GBK;
+        votes = gbk_votes;
+    } else {
+        return result;
+    }
+    const double strength = 1.0 - std::ldexp(1.0, -static_cast<int>(std::min<size_t>(evidence, 60)));
+    result.confidence = static_cast<double>(votes) / static_cast<double>(evidence) * strength;
+    return result;
+}
+
+// ========== 转换错误码 ==========
+// ConvertErrc、ErrorPolicy 与 ConvertError 定义在 detail/common.hpp 中
+namespace detail {
+/**
+ * @brief (内部实现) 将错误信息转换为 std::runtime_error 抛出，供抛异常的接口复用不抛异常的实现。
+ */
+[[noreturn]] inline void throw_convert_error(const char* where, const ConvertError& error) {
+    throw_runtime_error(std::string(where) + ": " + error.message());
+}
+}  // namespace detail
+
+// ========== 内置码表实现 (不依赖 iconv / Win32) ==========
+namespace detail {
+/**
+ * @brief (内部实现) 查表解码一个 GBK 双字节字符。
+ * @return 对应的 Unicode 码位，0 表示该组合在 GBK 中未定义。
+ */
+constexpr char32_t gbk_table_decode(unsigned char lead, unsigned char trail) {
+    if (lead < 0x81 || lead == 0xFF || trail < 0x40 || trail == 0xFF) return 0;
+    return gbk_tables::kDecode[(lead - gbk_tables::kLeadFirst) * gbk_tables::kTrailCount +
+                               (trail - gbk_tables::kTrailFirst)];
+}
+
+/**
+ * @brief (内部实现) 查表编码一个非 ASCII 的 Unicode 码位。
+ * @return GBK 编码 (双字节时首字节在高 8 位，欧元符号为单字节 0x80)，0 表示无法用 GBK 表示。
+ */
+constexpr uint16_t gbk_table_encode(char32_t cp) {
+    if (cp == 0x20AC) return 0x80;
+    if (cp > 0xFFFF) return 0;
+    return gbk_tables::kEncodePages[gbk_tables::kEncodeIndex[cp >> 8]][cp & 0xFF];
+}
+
+/**
+ * @brief (内部实现) 严格解码 p 处的一个非 ASCII UTF-8 字符 (拒绝过长编码、代理区与超出 U+10FFFF 的码位)。
+ * @return 字符占用的字节数，序列无效或不完整时返回 0。
+ */
+constexpr size_t decode_utf8_char(const unsigned char* p, size_t size, char32_t& cp) {
+    const unsigned char c0 = p[0];
+    auto cont = [&](size_t i, unsigned char lo = 0x80, unsigned char hi = 0xBF) {
+        return i < size && p[i] >= lo && p[i] <= hi;
+    };
+    if (c0 >= 0xC2 && c0 <= 0xDF) {
+        if (!cont(1)) return 0;
+        cp = (char32_t(c0 & 0x1F) << 6) | (p[1] & 0x3F);
+        return 2;
+    }
+    if (c0 >= 0xE0 && c0 <= 0xEF) {
+        const unsigned char lo = (c0 == 0xE0) ? 0xA0 : 0x80;
+        const unsigned char hi = (c0 == 0xED) ? 0x9F : 0xBF;
+        if (!cont(1, lo, hi) || !cont(2)) return 0;
+        cp = (char32_t(c0 & 0x0F) << 12) | (char32_t(p[1] & 0x3F) << 6) | (p[2] & 0x3F);
+        return 3;
+    }
+    if (c0 >= 0xF0 && c0 <= 0xF4) {
+        const unsigned char lo = (c0 == 0xF0) ? 0x90 : 0x80;
+        const unsigned char hi = (c0 == 0xF4) ? 0x8F : 0xBF;
+        if (!cont(1, lo, hi) || !cont(2) || !cont(3)) return 0;
+        cp = (char32_t(c0 & 0x07) << 18) | (char32_t(p[1] & 0x3F) << 12) | (char32_t(p[2] & 0x3F) << 6) |
+             (p[3] & 0x3F);
+        return 4;
+    }
+    return 0;
+}
+
+/**
+ * @brief (内部实现) 计算 p 处无效 UTF-8 序列的最大有效前缀长度，即 Unicode 推荐的、用一个 U+FFFD 替换的字节数。
+ * @param truncated 输出：这些字节是否为一个合法但被截断的字符 (前缀一直延伸到 size 处)。
+ * @return 至少为 1。
+ */
+constexpr size_t utf8_maximal_subpart(const unsigned char* p, size_t size, bool& truncated) {
+    const unsigned char c0 = p[0];
+    size_t need;
+    unsigned char lo = 0x80, hi = 0xBF;
+    if (c0 >= 0xC2 && c0 <= 0xDF) {
+        need = 2;
+    } else if (c0 >= 0xE0 && c0 <= 0xEF) {
+        need = 3;
+        if (c0 == 0xE0) lo = 0xA0;
+        if (c0 == 0xED) hi = 0x9F;
+    } else if (c0 >= 0xF0 && c0 <= 0xF4) {
+        need = 4;
+        if (c0 == 0xF0) lo = 0x90;
+        if (c0 == 0xF4) hi = 0x8F;
+    } else {
+        truncated = false;
+        return 1;
+    }
+    size_t len = 1;
+    while (len < need && len < size && p[len] >= lo && p[len] <= hi) {
+        ++len;
+        lo = 0x80;
+        hi = 0xBF;
+    }
+    truncated = (len == size && len < need);
+    return len;
+}
+
+/**
+ * @brief (内部实现) 查表将一段 GBK 多字节文本转换为 UTF-8 写入 dst，遇到无效序列时在 error 中记录原因与段内偏移。
+ * @param dst 目标空间，必须至少能容纳 converted_size_bound() 给出的字节数。
+ * @return 写入的字节数。
+ */
+inline size_t native_gbk_segment_to_utf8(const char* data, size_t size, char* dst, ConvertError& error) noexcept {
+    const auto* p = reinterpret_cast<const unsigned char*>(data);
+    size_t out = 0;
+    for (size_t i = 0; i < size;) {
+        const unsigned char c = p[i];
+        if (c < 0x80) {
+            dst[out++] = static_cast<char>(c);
+            ++i;
+            continue;
+        }
+
+        char32_t cp;
+        if (c == 0x80) {
+            cp = 0x20AC;
+            ++i;
+        } else {
+            cp = (i + 1 < size) ? gbk_table_decode(c, p[i + 1]) : 0;
+            if (cp == 0) {
+                const bool truncated = (i + 1 == size) && c != 0xFF;
+                error = {truncated ? ConvertErrc::INCOMPLETE_SEQUENCE : ConvertErrc::INVALID_SEQUENCE, i};
+                return out;
+            }
+            i += 2;
+        }
+
+        if (cp < 0x800) {
+            dst[out++] = static_cast<char>(0xC0 | (cp >> 6));
+        } else {
+            dst[out++] = static_cast<char>(0xE0 | (cp >> 12));
+            dst[out++] = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        }
+        dst[out++] = static_cast<char>(0x80 | (cp & 0x3F));
+    }
+    return out;
+}
+
+/**
+ * @brief (内部实现) 查表将一段 UTF-8 多字节文本转换为 GBK 写入 dst，遇到无效序列或无法表示的字符时在 error 中记录。
+ * @param dst 目标空间，必须至少能容纳 size 字节 (任何 UTF-8 字符转换为 GBK 后都不会变长)。
+ * @return 写入的字节数。
+ */
+inline size_t native_utf8_segment_to_gbk(const char* data, size_t size, char* dst, ConvertError& error) noexcept {
+    const auto* p = reinterpret_cast<const unsigned char*>(data);
+    size_t out = 0;
+    for (size_t i = 0; i < size;) {
+        if (p[i] < 0x80) {
+            dst[out++] = static_cast<char>(p[i++]);
+            continue;
+        }
+
+        char32_t cp = 0;
+        const size_t len = decode_utf8_char(p + i, size - i, cp);
+        if (len == 0) {
+            bool truncated;
+            utf8_maximal_subpart(p + i, size - i, truncated);
+            error = {truncated ? ConvertErrc::INCOMPLETE_SEQUENCE : ConvertErrc::INVALID_SEQUENCE, i};
+            return out;
+        }
+        const uint16_t code = gbk_table_encode(cp);
+        if (code == 0) {
+            error = {ConvertErrc::UNREPRESENTABLE, i};
+            return out;
+        }
+        if (code > 0xFF) dst[out++] = static_cast<char>(code >> 8);
+        dst[out++] = static_cast<char>(code & 0xFF);
+        i += len;
+    }
+    return out;
+}
+
+/**
+ * @brief (内部实现) 将段内的错误信息换算为整个输入中的偏移。
+ * @details 段在输入中间结束时，末尾被截断的字符实际上是被后面的 ASCII 字节打断的，应视为无效序列。
+ */
+inline ConvertError rebase_segment_error(ConvertError error, size_t segment_pos, size_t segment_len,
+                                         size_t input_size) noexcept {
+    if (error.offset != ConvertError::npos) error.offset += segment_pos;
+    if (error.code == ConvertErrc::INCOMPLETE_SEQUENCE && segment_pos + segment_len < input_size) {
+        error.code = ConvertErrc::INVALID_SEQUENCE;
+    }
+    return error;
+}
+
+/**
+ * @brief (内部实现) 转换出错处的一个坏序列：占用的输入字节数，以及它代表的码位 (无效输入记为 U+FFFD)。
+ */
+struct BadSequence {
+    size_t length;
+    char32_t cp;
+};
+
+/**
+ * @brief (内部实现) 检查转换停下的位置，确定非严格模式下要替换掉的字节数。
+ */
+inline BadSequence inspect_bad_sequence(const char* data, size_t size, bool source_is_gbk) {
+    const auto* p = reinterpret_cast<const unsigned char*>(data);
+    if (source_is_gbk) {
+        // 结构上合法但码表中未定义的双字节组合整体替换，否则只替换首字节，其后的字节重新参与转换
+        const bool pair = size >= 2 && p[0] >= 0x81 && p[0] <= 0xFE && p[1] >= 0x40 && p[1] <= 0xFE && p[1] != 0x7F;
+        return {pair ? size_t(2) : size_t(1), 0xFFFD};
+    }
+    char32_t cp = 0;
+    if (const size_t len = decode_utf8_char(p, size, cp)) return {len, cp};  // 合法但 GBK 无法表示
+    bool truncated;
+    return {utf8_maximal_subpart(p, size, truncated), 0xFFFD};
+}
+
+/**
+ * @brief (内部实现) 按策略生成坏序列的替换内容写入 dst (至少 16 字节)。
+ * @return 写入的字节数。
+ */
+inline size_t format_replacement(char* dst, char32_t cp, bool target_is_gbk, ErrorPolicy policy) {
+    if (policy == ErrorPolicy::SKIP) return 0;
+    if (!target_is_gbk) {
+        // 目标为 UTF-8 时只有无效输入会走到这里，统一写作 U+FFFD
+        std::memcpy(dst, "\xEF\xBF\xBD", 3);
+        return 3;
+    }
+    if (policy == ErrorPolicy::REPLACE) {
+        dst[0] = '?';
+        return 1;
+    }
+    static constexpr char kHex[] = "0123456789ABCDEF";
+    size_t n = 0;
+    dst[n++] = '&';
+    dst[n++] = '#';
+    dst[n++] = 'x';
+    int shift = 20;
+    while (shift > 0 && ((cp >> shift) & 0xF) == 0) shift -= 4;
+    for (; shift >= 0; shift -= 4) dst[n++] = kHex[(cp >> shift) & 0xF];
+    dst[n++] = ';';
+    return n;
+}
+
+/**
+ * @brief (内部实现) 将 data 处的坏序列按策略替换后写入 result 的 out 位置。
+ * @details 坏序列在输出上界中所占的份额不小于它自身的长度，只需为替换内容额外扩容，剩余输入仍然放得下。
+ * @return 坏序列占用的输入字节数。
+ */
+template <ByteBuffer Buffer>
+inline size_t replace_bad_sequence(const char* data, size_t size, bool source_is_gbk, ErrorPolicy policy,
+                                   Buffer& result, size_t& out) {
+    const BadSequence bad = inspect_bad_sequence(data, size, source_is_gbk);
+    char replacement[16];
+    const size_t n = format_replacement(replacement, bad.cp, !source_is_gbk, policy);
+    result.resize(result.size() + n);
+    std::memcpy(buffer_data(result) + out, replacement, n);
+    out += n;
+    return bad.length;
+}
+
+/**
+ * @brief (内部实现) 内置码表转换的公共骨架：按输出上界一次性扩容，ASCII 段直接拷贝，多字节段交给 convert_segment。
+ * @details 非严格模式下，convert_segment 在坏序列处停下后就地写入替换内容，再从其后继续，整个输入只读一遍。
+ * @return 转换失败时返回错误信息，此时 result 中可能留有部分输出。
+ */
+template <ByteBuffer Buffer, typename SegmentConverter>
+inline ConvertError native_convert(std::string_view input, bool source_is_gbk, SegmentConverter convert_segment,
+                                   Buffer& result, ErrorPolicy policy = ErrorPolicy::STRICT) {
+    const OperationProbe probe(metrics::Operation::NATIVE_CONVERT, input.size());
+    size_t out = result.size();
+    result.resize(out + converted_size_bound(input.data(), input.size(), source_is_gbk));
+    size_t pos = 0;
+    while (pos < input.size()) {
+        const size_t ascii_len = find_non_ascii(input.data() + pos, input.size() - pos);
+        std::memcpy(buffer_data(result) + out, input.data() + pos, ascii_len);
+        out += ascii_len;
+        pos += ascii_len;
+        if (pos == input.size()) break;
+
+        const size_t segment_end = pos + find_ascii_run(input.data() + pos, input.size() - pos, source_is_gbk);
+        while (pos < segment_end) {
+            ConvertError error;
+            out += convert_segment(input.data() + pos, segment_end - pos, buffer_data(result) + out, error);
+            if (!error) {
+                pos = segment_end;
+            } else if (policy == ErrorPolicy::STRICT) {
+                result.resize(out);
+                return rebase_segment_error(error, pos, segment_end - pos, input.size());
+            } else {
+                pos += error.offset;
+                pos += replace_bad_sequence(input.data() + pos, segment_end - pos, source_is_gbk, policy, result, out);
+            }
+        }
+    }
+    result.resize(out);
+    return {};
+}
+
+// ---------- UTF-16 编解码 ----------
+// UTF-16 与 UTF-8 之间只是码位的重新排列，不需要码表，所有平台都使用下面的内置实现。
+
+/**
+ * @brief (内部实现) 将一个码位按 UTF-8 写入 dst。
+ * @return 写入的字节数 (1~4)。
+ */
+constexpr size_t encode_utf8_char(char32_t cp, char* dst) {
+    if (cp < 0x80) {
+        dst[0] = static_cast<char>(cp);
+        return 1;
+    }
+    if (cp < 0x800) {
+        dst[0] = static_cast<char>(0xC0 | (cp >> 6));
+        dst[1] = static_cast<char>(0x80 | (cp & 0x3F));
+        return 2;
+    }
+    if (cp < 0x10000) {
+        dst[0] = static_cast<char>(0xE0 | (cp >> 12));
+        dst[1] = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        dst[2] = static_cast<char>(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    dst[0] = static_cast<char>(0xF0 | (cp >> 18));
+    dst[1] = static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+    dst[2] = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+    dst[3] = static_cast<char>(0x80 | (cp & 0x3F));
+    return 4;
+}
+
+/**
+ * @brief (内部实现) 将 UTF-8 转换为带 BOM 的 UTF-16 并追加到 result，空输入不产生任何输出。
+ * @details 每个 UTF-8 字节最多对应一个 UTF-16 单元 (四字节序列对应一个代理对)，按 BOM 加 2 * size 字节一次性扩容。
+ * @param big_endian 输出大端序 (UTF-16BE)，否则为小端序 (UTF-16LE)。
+ * @return 转换失败时返回错误信息，此时 result 中可能留有部分输出。
+ */
+template <ByteBuffer Buffer>
+inline ConvertError utf8_to_utf16_append(std::string_view input, bool big_endian, Buffer& result) {
+    if (input.empty()) return {};
+    const auto* p = reinterpret_cast<const unsigned char*>(input.data());
+    const size_t size = input.size();
+    size_t out = result.size();
+    result.resize(out + 2 + 2 * size);
+    char* dst = buffer_data(result);
+    auto put = [&](char32_t unit) {
+        const char high = static_cast<char>(unit >> 8);
+        const char low = static_cast<char>(unit & 0xFF);
+        dst[out++] = big_endian ? high : low;
+        dst[out++] = big_endian ? low : high;
+    };
+
+    put(0xFEFF);
+    for (size_t i = 0; i < size;) {
+        if (p[i] < 0x80) {
+            put(p[i++]);
+            continue;
+        }
+        char32_t cp = 0;
+        const size_t len = decode_utf8_char(p + i, size - i, cp);
+        if (len == 0) {
+            bool truncated;
+            utf8_maximal_subpart(p + i, size - i, truncated);
+            result.resize(out);
+            return {truncated ? ConvertErrc::INCOMPLETE_SEQUENCE : ConvertErrc::INVALID_SEQUENCE, i};
+        }
+        if (cp >= 0x10000) {
+            put(0xD800 + ((cp - 0x10000) >> 10));
+            put(0xDC00 + ((cp - 0x10000) & 0x3FF));
+        } else {
+            put(cp);
+        }
+        i += len;
+    }
+    result.resize(out);
+    return {};
+}
+
+/**
+ * @brief (内部实现) 将 UTF-16 转换为 UTF-8 并追加到 result，开头与字节序一致的 BOM 会被跳过。
+ * @details 每个 UTF-16 单元最多对应 3 个 UTF-8 字节 (代理对的两个单元共对应 4 个字节)。
+ * @param big_endian 输入为大端序 (UTF-16BE)，否则为小端序 (UTF-16LE)。
+ * @return 转换失败时返回错误信息，此时 result 中可能留有部分输出。孤立的代理单元视为无效序列，
+ * 末尾落单的字节或缺少低位代理的高位代理视为不完整序列。
+ */
+template <ByteBuffer Buffer>
+inline ConvertError utf16_to_utf8_append(std::string_view input, bool big_endian, Buffer& result) {
+    const auto* p = reinterpret_cast<const unsigned char*>(input.data());
+    const size_t size = input.size();
+    auto unit_at = [&](size_t k) -> char32_t {
+        return big_endian ? (char32_t(p[k]) << 8 | p[k + 1]) : (char32_t(p[k + 1]) << 8 | p[k]);
+    };
+    size_t i = 0;
+    if (size >= 2 && unit_at(0) == 0xFEFF) i = 2;
+
+    size_t out = result.size();
+    result.resize(out + (size / 2) * 3);
+    char* dst = buffer_data(result);
+    auto fail = [&](ConvertErrc code, size_t offset) {
+        result.resize(out);
+        return ConvertError{code, offset};
+    };
+    while (i + 2 <= size) {
+        char32_t cp = unit_at(i);
+        size_t len = 2;
+        if (cp >= 0xD800 && cp <= 0xDFFF) {
+            if (cp >= 0xDC00) return fail(ConvertErrc::INVALID_SEQUENCE, i);
+            if (i + 4 > size) return fail(ConvertErrc::INCOMPLETE_SEQUENCE, i);
+            const char32_t low = unit_at(i + 2);
+            if (low < 0xDC00 || low > 0xDFFF) return fail(ConvertErrc::INVALID_SEQUENCE, i);
+            cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+            len = 4;
+        }
+        out += encode_utf8_char(cp, dst + out);
+        i += len;
+    }
+    if (i < size) return fail(ConvertErrc::INCOMPLETE_SEQUENCE, i);
+    result.resize(out);
+    return {};
+}
+}  // namespace detail
+
+/**
+ * @namespace native
+ * @brief 基于内置 constexpr 码表的 GBK <-> UTF-8 转换，不经过 iconv 或 Win32 API，在所有平台上结果一致。
+ * @details
+ * 码表与 glibc iconv 的 "GBK" 一致 (单字节 0x80 对应欧元符号 U+20AC)，由 tools/gen_gbk_tables.py 生成。
+ * 定义 ENCODING_UTIL_USE_NATIVE_CODEC 后，gbk_to_utf8() / utf8_to_gbk() 及智能转换接口都会改用这里的实现。
+ */
+namespace native {
+/**
+ * @brief 将 GBK 编码的字符串转换为 UTF-8。
+ * @param policy 遇到无效序列时的处理策略，见 ErrorPolicy。
+ * @throws std::runtime_error 如果 policy 为 STRICT 且输入包含无效或不完整的 GBK 序列。
+ */
+inline std::string gbk_to_utf8(std::string_view gbk_sv, ErrorPolicy policy = ErrorPolicy::STRICT) {
+    std::string result;
+    const ConvertError error =
+        detail::native_convert(gbk_sv, true, detail::native_gbk_segment_to_utf8, result, policy);
+    if (error) detail::throw_convert_error("native", error);
+    return result;
+}
+
+/**
+ * @brief 将 UTF-8 编码的字符串转换为 GBK。
+ * @param policy 遇到无效序列或 GBK 无法表示的字符时的处理策略，见 ErrorPolicy。
+ * @throws std::runtime_error 如果 policy 为 STRICT 且输入包含无效的 UTF-8 序列，或包含 GBK 无法表示的字符。
+ */
+inline std::string utf8_to_gbk(std::string_view utf8_sv, ErrorPolicy policy = ErrorPolicy::STRICT) {
+    std::string result;
+    const ConvertError error =
+        detail::native_convert(utf8_sv, false, detail::native_utf8_segment_to_gbk, result, policy);
+    if (error) detail::throw_convert_error("native", error);
+    return result;
+}
+}  // namespace native
+
+// ========== 编译期转换接口 ==========
+namespace detail {
+/**
+ * @brief (内部实现) 可在编译期求值的 GBK <-> UTF-8 逐字符转换，规则与内置码表实现 (native) 相同。
+ * @param out 目标空间，为 nullptr 时只统计输出长度。
+ * @param written 输出：写入 (或需要) 的字节数；出错时为出错位置之前已转换的部分。
+ * @return 转换错误；offset 为出错字节在输入中的偏移。
+ */
+constexpr ConvertError constexpr_convert(std::string_view input, bool source_is_gbk, char* out,
+                                         size_t& written) noexcept {
+    auto put = [&](unsigned value) {
+        if (out != nullptr) out[written] = static_cast<char>(value);
+        ++written;
+    };
+    written = 0;
+    for (size_t i = 0; i < input.size();) {
+        const auto c = static_cast<unsigned char>(input[i]);
+        if (c < 0x80) {
+            put(c);
+            ++i;
+            continue;
+        }
+
+        if (source_is_gbk) {
+            char32_t cp = 0x20AC;
+            if (c != 0x80) {
+                cp = (i + 1 < input.size()) ? gbk_table_decode(c, static_cast<unsigned char>(input[i + 1])) : 0;
+                if (cp == 0) {
+                    const bool truncated = (i + 1 == input.size()) && c != 0xFF;
+                    return {truncated ? ConvertErrc::INCOMPLETE_SEQUENCE : ConvertErrc::INVALID_SEQUENCE, i};
+                }
+                ++i;
+            }
+            ++i;
+            if (cp < 0x800) {
+                put(0xC0 | (cp >> 6));
+            } else {
+                put(0xE0 | (cp >> 12));
+                put(0x80 | ((cp >> 6) & 0x3F));
+            }
+            put(0x80 | (cp & 0x3F));
+            continue;
+        }
+
+        // 常量求值中不能 reinterpret_cast，先把至多 4 个字节复制出来再解码
+        unsigned char bytes[4] = {};
+        const size_t avail = std::min<size_t>(4, input.size() - i);
+        for (size_t k = 0; k < avail; ++k) bytes[k] = static_cast<unsigned char>(input[i + k]);
+        char32_t cp = 0;
+        const size_t len = decode_utf8_char(bytes, avail, cp);
+        if (len == 0) {
+            bool truncated = false;
+            utf8_maximal_subpart(bytes, avail, truncated);
+            return {truncated ? ConvertErrc::INCOMPLETE_SEQUENCE : ConvertErrc::INVALID_SEQUENCE, i};
+        }
+        const uint16_t code = gbk_table_encode(cp);
+        if (code == 0) return {ConvertErrc::UNREPRESENTABLE, i};
+        if (code > 0xFF) put(code >> 8);
+        put(code & 0xFF);
+        i += len;
+    }
+    return {};
+}
+
+/**
+ * @brief (内部实现) 作为字面量运算符模板参数的字符串字面量，保存包括结尾 '\0' 在内的 N 个字节。
+ */
+template <size_t N>
+struct StringLiteral {
+    char value[N];
+
+    constexpr StringLiteral(const char (&literal)[N]) {  // NOLINT: 需要隐式转换
+        std::copy_n(literal, N, value);
+    }
+    constexpr std::string_view view() const { return {value, N - 1}; }
+};
+
+/**
+ * @brief (内部实现) 编译期转换失败时调用。它不是 constexpr 函数，因此在常量求值中被调用即产生编译错误，
+ * 编译器的诊断信息会指向这里。
+ */
+inline void string_literal_cannot_be_converted(const ConvertError& error) {
+    throw_convert_error("literal", error);
+}
+
+/**
+ * @brief (内部实现) 在编译期转换字面量 S，结果长度同样在编译期确定。
+ */
+template <StringLiteral S, bool SourceIsGbk>
+consteval auto convert_literal() {
+    constexpr size_t size = [] {
+        size_t written = 0;
+        const ConvertError error = constexpr_convert(S.view(), SourceIsGbk, nullptr, written);
+        if (error) string_literal_cannot_be_converted(error);
+        return written;
+    }();
+    std::array<char, size> result{};
+    size_t written = 0;
+    constexpr_convert(S.view(), SourceIsGbk, result.data(), written);
+    return result;
+}
+}  // namespace detail
+
+/**
+ * @namespace literals
+ * @brief 在编译期完成转换的字符串字面量，无需在启动时调用转换接口；编码有误的字面量会直接导致编译失败。
+ * @details
+ * 结果为 `std::array<char, N>`，N 为转换后的字节数 (不含结尾 '\0')，可用 `std::string_view(r.data(), r.size())` 访问。
+ * 源文件需以 UTF-8 作为执行字符集 (GCC/Clang 的默认行为，MSVC 需要 /utf-8)。
+ * @code
+ * using namespace encoding_util::literals;
+ * constexpr auto hello = "你好"_gbk;                  // {'\xC4', '\xE3', '\xBA', '\xC3'}
+ * constexpr auto world = "\xCA\xC0\xBD\xE7"_utf8;  // "世界" 的 UTF-8 编码
+ * @endcode
+ */
+namespace literals {
+/**
+ * @brief 将 UTF-8 字面量在编译期转换为 GBK。含无效 UTF-8 序列或 GBK 无法表示的字符时编译失败。
+ */
+template <detail::StringLiteral S>
+consteval auto operator""_gbk() {
+    return detail::convert_literal<S, false>();
+}
+
+/**
+ * @brief 将 GBK 字面量在编译期转换为 UTF-8。含无效或不完整的 GBK 序列时编译失败。
+ */
+template <detail::StringLiteral S>
+consteval auto operator""_utf8() {
+    return detail::convert_literal<S, true>();
+}
+}  // namespace literals
+
+// ========== 打分检测接口 ==========
+/**
+ * @brief 打分检测的参数。
+ */
+struct ScoringOptions {
+    double utf8_prior = 0.5;  // 两种解释都合法时 UTF-8 的先验概率，取值 (0, 1)；GBK 的先验为 1 - utf8_prior
+};
+
+/**
+ * @brief 打分检测的结果。
+ */
+struct ScoredDetection {
+    Encoding encoding = Encoding::UNKNOWN;  // 推定的编码
+    double utf8_confidence = 0.0;           // 按 UTF-8 解释的置信度，范围 [0, 1]
+    double gbk_confidence = 0.0;            // 按 GBK 解释的置信度，范围 [0, 1]
+};
+
+namespace detail {
+// ---------- 字符频率打分 ----------
+// 把两种解释下的每个非ASCII字符归入少数几个频率类别，按类别的对数权重累加得分；
+// 类别只由码位 (UTF-8) 或首字节/第二字节 (GBK) 查表得到，不分配内存。
+namespace scoring {
+
+enum CharClass : uint8_t {
+    kCommonHanzi,  // GB2312 一级汉字 (常用字)
+    kHanzi,        // GB2312 二级汉字
+    kCjkSymbol,    // 全角标点、CJK 符号、通用标点与货币符号
+    kLetter,       // 常见字母：Latin-1 与拉丁扩展 A 的字母、希腊与西里尔字母、假名、韩文
+    kRareLetter,   // 少见字母：拉丁扩展 B 以及 U+0500~U+07FF 的其余文字
+    kRareHanzi,    // GB2312 以外的汉字 (GBK/3、GBK/4、CJK 扩展区)
+    kRare,         // 用户自定义区、私用区、C1 控制字符等
+    kNumCharClasses
+};
+
+// 每个类别的 log2 权重 (相对频率)，第二列用于单词中的字符 (紧挨着字母)：
+// 字母通常连成单词出现 ("café"、"привет")，而汉字嵌在英文单词中间则较少见
+inline constexpr double kLog2Weight[kNumCharClasses][2] = {
+    {0.0, -2.3},    // kCommonHanzi
+    {-2.0, -4.3},   // kHanzi
+    {-1.0, -2.3},   // kCjkSymbol
+    {-3.3, 0.0},    // kLetter
+    {-6.6, -4.3},   // kRareLetter
+    {-5.6, -7.6},   // kRareHanzi
+    {-9.0, -9.0}};  // kRare
+
+// 码位落在 CJK 统一汉字区时需再查 GBK 码表区分一、二级汉字
+inline constexpr uint8_t kLookupGbk = kNumCharClasses;
+
+// U+0000~U+07FF 按 32 个码位一组分类 (ASCII 部分不会用到)
+constexpr uint8_t low_block_class(int cp) {
+    if (cp < 0xA0) return kRare;
+    if (cp < 0xC0) return kCjkSymbol;
+    if (cp < 0x180) return kLetter;
+    if (cp < 0x240) return kRareLetter;
+    if (cp < 0x360) return kRare;
+    if (cp < 0x500) return kLetter;
+    return kRareLetter;
+}
+
+// U+0800~U+FFFF 按 256 个码位一页分类；与 CJK 标点同页的假名 (U+3040~U+30FF) 由 utf8_char_class() 单独处理
+constexpr uint8_t page_class(int page) {
+    if (page >= 0x20 && page <= 0x27) return kCjkSymbol;
+    if (page == 0x30 || page == 0xFE || page == 0xFF) return kCjkSymbol;
+    if (page >= 0x34 && page <= 0x4D) return kRareHanzi;
+    if (page >= 0x4E && page <= 0x9F) return kLookupGbk;
+    if (page >= 0xAC && page <= 0xD7) return kLetter;
+    if (page == 0xF9 || page == 0xFA) return kRareHanzi;
+    return kRare;
+}
+
+// GBK 双字节字符的类别，只由首字节以及第二字节是否 >= 0xA1 决定
+constexpr uint8_t gbk_pair_class(int lead, bool high_trail) {
+    if (lead >= 0x81 && lead <= 0xA0) return kRareHanzi;                        // GBK/3
+    if (!high_trail) return lead >= 0xAA && lead <= 0xFE ? kRareHanzi : kRare;  // GBK/4，其余为自定义区与 GBK/5
+    if (lead >= 0xA1 && lead <= 0xA3) return kCjkSymbol;
+    if (lead >= 0xA4 && lead <= 0xA9) return kLetter;  // 假名、希腊与西里尔字母、拼音与制表符
+    if (lead >= 0xB0 && lead <= 0xD7) return kCommonHanzi;
+    if (lead >= 0xD8 && lead <= 0xF7) return kHanzi;
+    return kRare;
+}
+
+template <size_t N, typename Classify>
+constexpr std::array<uint8_t, N> make_class_table(Classify classify) {
+    std::array<uint8_t, N> table{};
+    for (size_t i = 0; i < N; ++i) table[i] = classify(static_cast<int>(i));
+    return table;
+}
+
+inline constexpr std::array<uint8_t, 64> kLowClasses =
+    make_class_table<64>([](int block) { return low_block_class(block * 32); });
+inline constexpr std::array<uint8_t, 256> kPageClasses = make_class_table<256>(page_class);
+inline constexpr std::array<uint8_t, 256> kGbkHighTrailClasses =
+    make_class_table<256>([](int lead) { return gbk_pair_class(lead, true); });
+inline constexpr std::array<uint8_t, 256> kGbkLowTrailClasses =
+    make_class_table<256>([](int lead) { return gbk_pair_class(lead, false); });
+
+constexpr uint8_t gbk_char_class(unsigned char lead, unsigned char trail) {
+    return trail >= 0xA1 ? kGbkHighTrailClasses[lead] : kGbkLowTrailClasses[lead];
+}
+
+constexpr uint8_t utf8_char_class(char32_t cp) {
+    if (cp < 0x800) return kLowClasses[cp >> 5];
+    if (cp > 0xFFFF) {
+        if (cp >= 0x1F000 && cp < 0x1FB00) return kCjkSymbol;  // emoji
+        return cp >= 0x20000 && cp < 0x40000 ? kRareHanzi : kRare;
+    }
+    if (cp >= 0x3040 && cp < 0x3100) return kLetter;
+    const uint8_t c = kPageClasses[cp >> 8];
+    if (c != kLookupGbk) return c;
+    const uint16_t code = gbk_table_encode(cp);
+    return code ? gbk_char_class(static_cast<unsigned char>(code >> 8), static_cast<unsigned char>(code))
+                : uint8_t{kRareHanzi};
+}
+
+constexpr bool is_ascii_letter(unsigned char byte) { return (byte | 0x20) >= 'a' && (byte | 0x20) <= 'z'; }
+
+constexpr bool is_letter_class(uint8_t c) { return c == kLetter || c == kRareLetter; }
+
+/**
+ * @brief (内部实现) 按类别为一种解释下的字符序列打分。
+ * @details 前一个字符是字母 (ASCII 字母或字母类)、或后一个字节是 ASCII 字母时，使用词内权重。
+ * @param next_char 返回 i 处非ASCII字符的 {字节数, 类别}，字节数为 0 表示到此为止。
+ */
+template <typename NextChar>
+double score_chars(std::string_view sv, NextChar next_char) {
+    const auto* p = reinterpret_cast<const unsigned char*>(sv.data());
+    double score = 0.0;
+    bool prev_letter = false;
+    for (size_t i = 0; i < sv.size();) {
+        if (p[i] < 0x80) {
+            prev_letter = is_ascii_letter(p[i]);
+            ++i;
+            continue;
+        }
+        const auto [len, c] = next_char(p + i, sv.size() - i);
+        if (len == 0) break;
+        const bool in_word = prev_letter || (i + len < sv.size() && is_ascii_letter(p[i + len]));
+        score += kLog2Weight[c][in_word];
+        prev_letter = is_letter_class(c);
+        i += len;
+    }
+    return score;
+}
+
+/**
+ * @brief (内部实现) 按 UTF-8 解释为合法的 UTF-8 输入打分，返回 log2 得分之和。
+ */
+inline double score_utf8(std::string_view sv) {
+    return score_chars(sv, [](const unsigned char* p, size_t size) {
+        char32_t cp = 0;
+        const size_t len = decode_utf8_char(p, size, cp);
+        return std::pair<size_t, uint8_t>(len, len ? utf8_char_class(cp) : uint8_t{kRare});
+    });
+}
+
+/**
+ * @brief (内部实现) 按 GBK 解释为合法的 GBK 输入打分，返回 log2 得分之和。
+ */
+inline double score_gbk(std::string_view sv) {
+    return score_chars(sv, [](const unsigned char* p, size_t size) {
+        if (size < 2) return std::pair<size_t, uint8_t>(0, kRare);
+        return std::pair<size_t, uint8_t>(2, gbk_char_class(p[0], p[1]));
+    });
+}
+}  // namespace scoring
+}  // namespace detail
+
+/**
+ * @brief 检测编码，并在输入同时是合法 UTF-8 与合法 GBK 时按字符频率给出两种解释各自的置信度。
+ *
+ * @details
+ * detect_encoding(sv) 遇到两种解释都合法的输入时总是选择 UTF-8，短字符串 (如 GBK 的 "学校" 恰好也是合法的
+ * UTF-8) 因此可能被误判。本函数在这种情况下对两种解释分别打分：
+ * - 每个非ASCII字符按码位或首字节/第二字节查表归入频率类别 (一级汉字、二级汉字、CJK 符号、常见字母、
+ *   少见字母、罕用汉字、其他)，累加各类别的 log2 权重；
+ * - 紧挨着字母的字符改用词内权重，使 "café"、"привет" 这类由字母连成的单词倾向 UTF-8；
+ * - 置信度 = 1 / (1 + 2^(GBK 得分 - UTF-8 得分 - log2(utf8_prior / (1 - utf8_prior))))，两者之和为 1；
+ *   置信度相同时推定为 UTF-8，与 detect_encoding() 一致。
+ * 其他情况下不打分：只有一种解释合法时它的置信度为 1、另一种为 0，全 ASCII 时两者均为 1，
+ * encoding 与 detect_encoding(sv) 相同 (GB18030、UTF-16 也照常识别)。
+ * 整个过程只查静态表，不分配内存；两种解释都合法时额外读一遍输入。
+ * @param sv 要检测的字符串视图。
+ * @param options 打分参数。
+ * @return 推定的编码与两种解释各自的置信度。
+ */
+inline ScoredDetection detect_encoding(std::string_view sv, const ScoringOptions& options) {
+    const EncodingAnalysis analysis = analyze_encoding(sv);
+    ScoredDetection result;
+    result.encoding = analysis.encoding;
+    const bool utf8_ok = analysis.utf8_invalid_at == EncodingAnalysis::npos;
+    const bool gbk_ok = analysis.gbk_invalid_at == EncodingAnalysis::npos;
+    if (analysis.is_all_ascii || !utf8_ok || !gbk_ok) {
+        result.utf8_confidence = utf8_ok ? 1.0 : 0.0;
+        result.gbk_confidence = gbk_ok ? 1.0 : 0.0;
+        return result;
+    }
+
+    const double prior = std::clamp(options.utf8_prior, 1e-9, 1.0 - 1e-9);
+    const double margin = detail::scoring::score_utf8(sv) - detail::scoring::score_gbk(sv) + std::log2(prior) -
+                          std::log2(1.0 - prior);
+    result.utf8_confidence = 1.0 / (1.0 + std::exp2(-margin));
+    result.gbk_confidence = 1.0 - result.utf8_confidence;
+    if (result.gbk_confidence > result.utf8_confidence) result.encoding = Encoding::GBK;
+    return result;
+}
+
+#ifdef _WIN32
+
+// ========== Windows 平台实现 (Win32 API) ==========
+namespace detail {
+/**
+ * @brief (内部实现) Win32 API 不报告出错位置，用内置码表重新检查这一段以定位第一个出错的字符。
+ * @param fallback 内置码表未发现问题时 (两者的码表存在细微差异) 使用的错误码，偏移记为段首。
+ * @param resource 暂存转换结果的内存资源，取自输出缓冲区 (见 scratch_resource())。
+ */
+inline ConvertError locate_win32_error(const char* data, size_t size, bool source_is_gbk, ConvertErrc fallback,
+                                       std::pmr::memory_resource* resource) {
+    std::pmr::string scratch(converted_size_bound(data, size, source_is_gbk), '\0', resource);
+    ConvertError error;
+    if (source_is_gbk) {
+        native_gbk_segment_to_utf8(data, size, scratch.data(), error);
+    } else {
+        native_utf8_segment_to_gbk(data, size, scratch.data(), error);
+    }
+    if (!error) error = {fallback, 0};
+    return error;
+}
+
+/// 每次交给 Win32 API 的源字节数上限，也是线程内复用的 UTF-16 缓冲区长度
+inline constexpr int kWin32ChunkSize = 16 * 1024;
+
+/**
+ * @brief (内部实现) 经由 UTF-16 转换一段多字节文本，并将结果追加到 result。
+ * @details
+ * 按字符边界切成不超过 kWin32ChunkSize 字节的块，经由当前线程固定大小的 UTF-16 缓冲区转换，
+ * 峰值内存与输入长度无关。切块前后的长度都按最坏情况估算 (每个源字节最多一个 UTF-16 单元，
+ * 每个单元最多 3 个 UTF-8 字节或 2 个 GBK 字节)，每块只需两次 API 调用，不再单独计算所需大小。
+ * 目标为 GBK 且策略为 REPLACE 时由 lpDefaultChar 在 API 内部就地替换；其它非严格策略下
+ * API 报告的错误由 convert_win32() 处理。
+ * @return 转换失败时返回错误信息 (偏移相对于段首)。
+ */
+template <ByteBuffer Buffer>
+inline ConvertError convert_win32_segment(const char* data, size_t size, UINT from_cp, UINT to_cp, Buffer& result,
+                                          ErrorPolicy policy) {
+    const auto system_error = [] {
+        return ConvertError{ConvertErrc::SYSTEM_ERROR, ConvertError::npos, static_cast<int>(GetLastError())};
+    };
+    const bool source_is_gbk = (from_cp == 936);
+    const bool replace_inline = (to_cp == 936 && policy == ErrorPolicy::REPLACE);
+
+    // 就地替换时让无效的 UTF-8 先变为 U+FFFD，它在 GBK 中无法表示，随后由 lpDefaultChar 替换为 '?'
+    const bool lenient_source = replace_inline || (source_is_gbk && policy == ErrorPolicy::STRICT);
+    const DWORD mb_flags = lenient_source ? 0 : MB_ERR_INVALID_CHARS;
+
+    // 目标是GBK时禁止“近似字符”映射，无法表示的字符要么就地替换为 '?'，要么通过信号变量报告出来。
+    // CP_UTF8 要求 dwFlags、lpDefaultChar 与 lpUsedDefaultChar 均为 0 / nullptr。
+    const DWORD wc_flags = (to_cp == 936) ? WC_NO_BEST_FIT_CHARS : 0;
+    const char* p_default_char = replace_inline ? "?" : nullptr;
+    const int bytes_per_unit = (to_cp == 936) ? 2 : 3;
+
+    thread_local wchar_t wide_buffer[kWin32ChunkSize];
+    size_t pos = 0;
+    while (pos < size) {
+        size_t chunk = std::min(size - pos, static_cast<size_t>(kWin32ChunkSize));
+        if (pos + chunk < size) {
+            // 不在块内切断多字节字符；切点只影响分块，不影响结果
+            chunk -= source_is_gbk ? gbk_incomplete_tail_size(data + pos, chunk)
+                                   : utf8_incomplete_tail_size(data + pos, chunk);
+        }
+        const char* chunk_data = data + pos;
+        const int chunk_len = static_cast<int>(chunk);
+
+        // --- 步骤 1: 将源编码转换为标准中间格式 UTF-16，写入固定缓冲区 ---
+        const int wide_len =
+            MultiByteToWideChar(from_cp, mb_flags, chunk_data, chunk_len, wide_buffer, kWin32ChunkSize);
+        if (wide_len == 0) {
+            if (GetLastError() != ERROR_NO_UNICODE_TRANSLATION) return system_error();
+            if (policy != ErrorPolicy::STRICT) return {ConvertErrc::INVALID_SEQUENCE, pos};
+            ConvertError error = locate_win32_error(chunk_data, chunk, source_is_gbk, ConvertErrc::INVALID_SEQUENCE,
+                                                    scratch_resource(result));
+            error.offset += pos;
+            return error;
+        }
+
+        // --- 步骤 2: 将 UTF-16 直接转换到 result 末尾，按最坏情况预留空间，最后截断 ---
+        const size_t old_size = result.size();
+        const int capacity = wide_len * bytes_per_unit;
+        result.resize(old_size + capacity);
+        BOOL has_used_default_char = FALSE;
+        BOOL* p_used_default_char = (to_cp == 936 && !replace_inline) ? &has_used_default_char : nullptr;
+        char* out_ptr = buffer_data(result) + old_size;
+        const int out_len = WideCharToMultiByte(to_cp, wc_flags, wide_buffer, wide_len, out_ptr, capacity,
+                                                p_default_char, p_used_default_char);
+        if (out_len == 0) return system_error();
+        result.resize(old_size + out_len);
+
+        // --- 步骤 3: 仅在必要时进行最终检查 ---
+        // 如果信号变量被API设置成了TRUE，说明有字符无法在GBK中表示
+        if (has_used_default_char) {
+            if (policy != ErrorPolicy::STRICT) return {ConvertErrc::UNREPRESENTABLE, pos};
+            ConvertError error =
+                locate_win32_error(chunk_data, chunk, false, ConvertErrc::UNREPRESENTABLE, scratch_resource(result));
+            error.offset += pos;
+            return error;
+        }
+        pos += chunk;
+    }
+    return {};
+}
+
+/**
+ * @brief (内部实现) 转换 input 并将结果追加到 result。
+ * @details 系统 API 无法就地跳过或转义坏序列，非严格策略下出错的段改用内置码表按策略重新转换。
+ * @return 转换失败时返回错误信息，此时 result 中可能留有部分输出。
+ */
+template <ByteBuffer Buffer>
+inline ConvertError convert_win32(std::string_view input, UINT from_cp, UINT to_cp, Buffer& result,
+                                  ErrorPolicy policy = ErrorPolicy::STRICT) {
+    const OperationProbe probe(metrics::Operation::SYSTEM_CONVERT, input.size());
+    if (input.empty()) {
+        return {};
+    }
+
+    // 仅把多字节段交给系统 API，GBK 与 UTF-8 都兼容 ASCII，ASCII 段直接拷贝
+    const bool source_is_gbk = (from_cp == 936);
+    size_t pos = 0;
+    while (pos < input.size()) {
+        const size_t ascii_len = find_non_ascii(input.data() + pos, input.size() - pos);
+        append_bytes(result, input.data() + pos, ascii_len);
+        pos += ascii_len;
+        if (pos == input.size()) break;
+
+        const size_t segment_len = find_ascii_run(input.data() + pos, input.size() - pos, source_is_gbk);
+        const size_t segment_start = result.size();
+        ConvertError error = convert_win32_segment(input.data() + pos, segment_len, from_cp, to_cp, result, policy);
+        if (error && policy != ErrorPolicy::STRICT && error.code != ConvertErrc::SYSTEM_ERROR) {
+            result.resize(segment_start);
+            error = native_convert(input.substr(pos, segment_len), source_is_gbk,
+                                   source_is_gbk ? native_gbk_segment_to_utf8 : native_utf8_segment_to_gbk, result,
+                                   policy);
+        }
+        if (error) return rebase_segment_error(error, pos, segment_len, input.size());
+        pos += segment_len;
+    }
+    return {};
+}
+
+/**
+ * @brief (内部实现) 一次性整体转换 input 并将结果追加到 result，用于 GB18030 (54936) 与 Big5 (950) 等代码页。
+ * @details
+ * 这些代码页没有对应的内置码表，分块的切点也不好找 (GB18030 的四字节序列中间夹着 ASCII 数字)，
+ * 因此整体交给系统 API，出错时只能报告错误类型，无法给出偏移。
+ */
+template <ByteBuffer Buffer>
+inline ConvertError convert_win32_whole(std::string_view input, UINT from_cp, UINT to_cp, Buffer& result) {
+    const OperationProbe probe(metrics::Operation::SYSTEM_CONVERT, input.size());
+    if (input.empty()) return {};
+    const auto system_error = [] {
+        return ConvertError{ConvertErrc::SYSTEM_ERROR, ConvertError::npos, static_cast<int>(GetLastError())};
+    };
+    const int input_len = static_cast<int>(input.size());
+    const int wide_len = MultiByteToWideChar(from_cp, MB_ERR_INVALID_CHARS, input.data(), input_len, nullptr, 0);
+    if (wide_len == 0) {
+        if (GetLastError() != ERROR_NO_UNICODE_TRANSLATION) return system_error();
+        return {ConvertErrc::INVALID_SEQUENCE, ConvertError::npos};
+    }
+    std::wstring wide(static_cast<size_t>(wide_len), L'\0');
+    if (MultiByteToWideChar(from_cp, MB_ERR_INVALID_CHARS, input.data(), input_len, wide.data(), wide_len) == 0) {
+        return system_error();
+    }
+
+    // CP_UTF8 与 54936 要求 dwFlags、lpDefaultChar 与 lpUsedDefaultChar 均为 0 / nullptr
+    const bool reports_default_char = (to_cp != CP_UTF8 && to_cp != 54936);
+    const DWORD wc_flags = reports_default_char ? WC_NO_BEST_FIT_CHARS : 0;
+    BOOL has_used_default_char = FALSE;
+    BOOL* p_used_default_char = reports_default_char ? &has_used_default_char : nullptr;
+    const int out_len =
+        WideCharToMultiByte(to_cp, wc_flags, wide.data(), wide_len, nullptr, 0, nullptr, p_used_default_char);
+    if (out_len == 0) return system_error();
+    if (has_used_default_char) return {ConvertErrc::UNREPRESENTABLE, ConvertError::npos};
+    const size_t old_size = result.size();
+    result.resize(old_size + static_cast<size_t>(out_len));
+    if (WideCharToMultiByte(to_cp, wc_flags, wide.data(), wide_len, buffer_data(result) + old_size, out_len, nullptr,
+                            nullptr) == 0) {
+        result.resize(old_size);
+        return system_error();
+    }
+    return {};
+}
+
+inline std::string convert_win32(std::string_view input, UINT from_cp, UINT to_cp) {
+    std::string result;
+    result.reserve(input.size());
+    const ConvertError error = convert_win32(input, from_cp, to_cp, result);
+    if (error) throw_convert_error("WinAPI", error);
+    return result;
+}
+}  // namespace detail
+
+#else
+
+// ========== Linux, macOS 等 POSIX 平台实现 (iconv) ==========
+namespace detail {
+/**
+ * @brief (内部实现) 独占一个 iconv 转换描述符的 RAII 包装，可移动、不可拷贝。
+ */
+struct IconvHandle {
+    IconvHandle() = default;
+    IconvHandle(const char* to_encoding, const char* from_encoding) : cd(iconv_open(to_encoding, from_encoding)) {
+        if (cd == (iconv_t)-1) throw_runtime_error("iconv_open: 无法创建转换描述符。");
+    }
+    IconvHandle(IconvHandle&& other) noexcept : cd(std::exchange(other.cd, (iconv_t)-1)) {}
+    IconvHandle& operator=(IconvHandle&& other) noexcept {
+        if (this != &other) {
+            if (cd != (iconv_t)-1) iconv_close(cd);
+            cd = std::exchange(other.cd, (iconv_t)-1);
+        }
+        return *this;
+    }
+    ~IconvHandle() {
+        if (cd != (iconv_t)-1) iconv_close(cd);
+    }
+
+    iconv_t cd = (iconv_t)-1;
+};
+
+/**
+ * @brief (内部实现) 获取当前线程缓存的 (to, from) 转换描述符，首次使用时才调用 iconv_open。
+ * @details 描述符只在创建它的线程内使用，不会跨线程共享，线程退出时自动关闭。
+ * @return 转换描述符，iconv_open 失败时返回 (iconv_t)-1 且不缓存，errno 由 iconv_open 设置。
+ */
+inline iconv_t thread_local_iconv(const char* to_encoding, const char* from_encoding) {
+    struct Entry {
+        std::string to_encoding;
+        std::string from_encoding;
+        IconvHandle handle;
+    };
+    thread_local std::vector<Entry> cache;
+    for (const Entry& entry : cache) {
+        if (entry.to_encoding == to_encoding && entry.from_encoding == from_encoding) return entry.handle.cd;
+    }
+    iconv_t cd = iconv_open(to_encoding, from_encoding);
+    if (cd == (iconv_t)-1) return cd;
+    cache.push_back({to_encoding, from_encoding, IconvHandle()});
+    cache.back().handle.cd = cd;
+    return cd;
+}
+
+/**
+ * @brief (内部实现) 把 iconv 报告的 errno 换算为错误信息。
+ * @param bad 出错时 iconv 停下的输入位置；segment_end 为当前段的末尾。
+ */
+inline ConvertError iconv_error(int error_number, std::string_view input, const char* bad, const char* segment_end,
+                                bool source_is_gbk) {
+    const size_t offset = static_cast<size_t>(bad - input.data());
+    if (error_number == EINVAL) {
+        // 段在输入中间结束时，被截断的字符实际上是被后面的 ASCII 字节打断的。
+        // glibc 把 0xF5-0xFD 等也当作多字节首字节，UTF-8 源要再确认剩余字节确实是一个合法字符的开头
+        bool truncated = true;
+        if (!source_is_gbk) {
+            utf8_maximal_subpart(reinterpret_cast<const unsigned char*>(bad), static_cast<size_t>(segment_end - bad),
+                                 truncated);
+        }
+        const bool at_end = segment_end == input.data() + input.size();
+        return {at_end && truncated ? ConvertErrc::INCOMPLETE_SEQUENCE : ConvertErrc::INVALID_SEQUENCE, offset};
+    }
+    if (error_number == EILSEQ) {
+        // UTF-8 源的 EILSEQ 既可能是无效序列，也可能是 GBK 无法表示的字符，用严格解码区分
+        char32_t cp = 0;
+        const auto* p = reinterpret_cast<const unsigned char*>(bad);
+        const bool decodable = !source_is_gbk && decode_utf8_char(p, static_cast<size_t>(segment_end - bad), cp) > 0;
+        return {decodable ? ConvertErrc::UNREPRESENTABLE : ConvertErrc::INVALID_SEQUENCE, offset};
+    }
+    return {ConvertErrc::SYSTEM_ERROR, ConvertError::npos, error_number};
+}
+
+/**
+ * @brief (内部实现) 使用给定的转换描述符执行转换并将结果追加到 result，开始前先将描述符复位到初始状态。
+ * @param source_is_gbk 源编码是否为 GBK 这类按双字节切分的编码 (GB18030、Big5 同样如此)。
+ * @return 转换失败时返回错误信息，此时 result 中可能留有部分输出。
+ */
+template <ByteBuffer Buffer>
+inline ConvertError iconv_convert(iconv_t cd, std::string_view input, bool source_is_gbk, Buffer& result,
+                                  ErrorPolicy policy = ErrorPolicy::STRICT) {
+    const OperationProbe probe(metrics::Operation::SYSTEM_CONVERT, input.size());
+    if (input.empty()) return {};
+    // 上一次转换可能中途失败，复位后才能安全复用
+    iconv(cd, nullptr, nullptr, nullptr, nullptr);
+
+    // 按上界一次性扩容，iconv 直接写入 result，最后只截断一次
+    size_t out = result.size();
+    result.resize(out + converted_size_bound(input.data(), input.size(), source_is_gbk));
+
+    // 仅把多字节段交给 iconv，GBK 与 UTF-8 都兼容 ASCII，ASCII 段直接拷贝
+    auto convert_segment = [&](const char* segment, size_t segment_size) -> ConvertError {
+        size_t in_bytes_left = segment_size;
+        char* in_buf = const_cast<char*>(segment);
+        while (in_bytes_left > 0) {
+            char* out_buf_ptr = buffer_data(result) + out;
+            size_t out_bytes_left = result.size() - out;
+            errno = 0;
+            const size_t rc = iconv(cd, &in_buf, &in_bytes_left, &out_buf_ptr, &out_bytes_left);
+            out = result.size() - out_bytes_left;
+            if (rc == (size_t)-1) {
+                if (errno == E2BIG) {
+                    // 上界按 glibc 的映射推算，其它 iconv 实现若有出入则在此补足
+                    result.resize(result.size() + in_bytes_left * 2 + 16);
+                    continue;
+                }
+                if (policy != ErrorPolicy::STRICT && (errno == EILSEQ || errno == EINVAL)) {
+                    // 就地写入替换内容后从坏序列之后继续，不使用各家实现行为不一的 //TRANSLIT 与 //IGNORE
+                    const size_t consumed =
+                        replace_bad_sequence(in_buf, in_bytes_left, source_is_gbk, policy, result, out);
+                    in_buf += consumed;
+                    in_bytes_left -= consumed;
+                    continue;
+                }
+                return iconv_error(errno, input, in_buf, segment + segment_size, source_is_gbk);
+            }
+        }
+        return {};
+    };
+
+    size_t pos = 0;
+    while (pos < input.size()) {
+        const size_t ascii_len = find_non_ascii(input.data() + pos, input.size() - pos);
+        if (result.size() - out < ascii_len) result.resize(out + (input.size() - pos) * 2);
+        std::memcpy(buffer_data(result) + out, input.data() + pos, ascii_len);
+        out += ascii_len;
+        pos += ascii_len;
+        if (pos == input.size()) break;
+
+        const size_t segment_len = find_ascii_run(input.data() + pos, input.size() - pos, source_is_gbk);
+        const ConvertError error = convert_segment(input.data() + pos, segment_len);
+        if (error) {
+            result.resize(out);
+            return error;
+        }
+        pos += segment_len;
+    }
+    result.resize(out);
+    return {};
+}
+
+/**
+ * @brief (内部实现) 使用当前线程缓存的描述符执行转换并将结果追加到 result。
+ */
+template <ByteBuffer Buffer>
+inline ConvertError iconv_convert(std::string_view input, const char* to_encoding, const char* from_encoding,
+                                  Buffer& result, ErrorPolicy policy = ErrorPolicy::STRICT) {
+    if (input.empty()) return {};
+    iconv_t cd = thread_local_iconv(to_encoding, from_encoding);
+    if (cd == (iconv_t)-1) return {ConvertErrc::SYSTEM_ERROR, ConvertError::npos, errno};
+    const std::string_view from(from_encoding);
+    const bool double_byte_source = from == "GBK" || from == "GB18030" || from == "BIG5";
+    return iconv_convert(cd, input, double_byte_source, result, policy);
+}
+
+inline std::string iconv_convert(std::string_view input, const char* to_encoding, const char* from_encoding) {
+    std::string result;
+    const ConvertError error = iconv_convert(input, to_encoding, from_encoding, result);
+    if (error) throw_convert_error("iconv", error);
+    return result;
+}
+}  // namespace detail
+
+#endif
+
+// ========== 基础转换接口 ==========
+// 默认使用平台自带的转换器，定义 ENCODING_UTIL_USE_NATIVE_CODEC 可改用内置码表 (见 native 命名空间)
+namespace detail {
+/**
+ * @brief (内部实现) 将 GBK 字符串转换为 UTF-8 并追加到 out，失败时返回错误信息而不抛出异常。
+ */
+template <ByteBuffer Buffer>
+inline ConvertError try_gbk_to_utf8_append(std::string_view gbk_sv, Buffer& out,
+                                           ErrorPolicy policy = ErrorPolicy::STRICT) {
+#if defined(ENCODING_UTIL_USE_NATIVE_CODEC)
+    return native_convert(gbk_sv, true, native_gbk_segment_to_utf8, out, policy);
+#elif defined(_WIN32)
+    return convert_win32(gbk_sv, 936, CP_UTF8, out, policy);
+#else
+    return iconv_convert(gbk_sv, "UTF-8", "GBK", out, policy);
+#endif
+}
+
+/**
+ * @brief (内部实现) 将 UTF-8 字符串转换为 GBK 并追加到 out，失败时返回错误信息而不抛出异常。
+ */
+template <ByteBuffer Buffer>
+inline ConvertError try_utf8_to_gbk_append(std::string_view utf8_sv, Buffer& out,
+                                           ErrorPolicy policy = ErrorPolicy::STRICT) {
+#if defined(ENCODING_UTIL_USE_NATIVE_CODEC)
+    return native_convert(utf8_sv, false, native_utf8_segment_to_gbk, out, policy);
+#elif defined(_WIN32)
+    return convert_win32(utf8_sv, CP_UTF8, 936, out, policy);
+#else
+    return iconv_convert(utf8_sv, "GBK", "UTF-8", out, policy);
+#endif
+}
+
+/**
+ * @brief (内部实现) 将 GBK 字符串转换为 UTF-8 并追加到 out。
+ */
+template <ByteBuffer Buffer>
+inline void gbk_to_utf8_append(std::string_view gbk_sv, Buffer& out, ErrorPolicy policy = ErrorPolicy::STRICT) {
+    const ConvertError error = try_gbk_to_utf8_append(gbk_sv, out, policy);
+    if (error) throw_convert_error("gbk_to_utf8", error);
+}
+
+/**
+ * @brief (内部实现) 将 UTF-8 字符串转换为 GBK 并追加到 out。
+ */
+template <ByteBuffer Buffer>
+inline void utf8_to_gbk_append(std::string_view utf8_sv, Buffer& out, ErrorPolicy policy = ErrorPolicy::STRICT) {
+    const ConvertError error = try_utf8_to_gbk_append(utf8_sv, out, policy);
+    if (error) throw_convert_error("utf8_to_gbk", error);
+}
+
+/**
+ * @brief (内部实现) 调用 append 向 out 追加内容，返回错误时将 out 恢复到原来的长度。
+ * @details 内存分配失败也转换为 SYSTEM_ERROR (ENOMEM) 返回，保证调用方可以声明为 noexcept。
+ */
+template <typename Buffer, typename TryAppend>
+inline ConvertError try_append_or_rollback(Buffer& out, TryAppend try_append) noexcept {
+    const size_t old_size = out.size();
+    ConvertError error;
+    try {
+        error = try_append(out);
+    } catch (...) {
+        error = {ConvertErrc::SYSTEM_ERROR, ConvertError::npos, ENOMEM};
+    }
+    if (error) out.resize(old_size);
+    return error;
+}
+
+/**
+ * @brief (内部实现) 调用 append 向 out 追加内容，失败时将 out 恢复到原来的长度。
+ * @return 追加的字节数。
+ */
+template <ByteBuffer Buffer, typename Append>
+inline size_t append_or_rollback(Buffer& out, Append append) {
+    const size_t old_size = out.size();
+    try {
+        append(out);
+    } catch (...) {
+        out.resize(old_size);
+        throw;
+    }
+    return out.size() - old_size;
+}
+
+/**
+ * @brief (内部实现) 以调用方提供的定长缓冲区为存储的字节缓冲区，满足 ByteBuffer，转换直接写入其中。
+ * @details 长度超出容量时抛出 std::system_error (std::errc::value_too_large)。
+ */
+class SpanBuffer {
+public:
+    using value_type = char;
+
+    explicit SpanBuffer(std::span<char> storage) noexcept : storage_(storage) {}
+
+    void resize(size_t n) {
+        if (n > storage_.size()) {
+            record_exception();
+            throw std::system_error(std::make_error_code(std::errc::value_too_large), "输出缓冲区不足");
+        }
+        size_ = n;
+    }
+    char* data() noexcept { return storage_.data(); }
+    size_t size() const noexcept { return size_; }
+
+private:
+    std::span<char> storage_;
+    size_t size_ = 0;
+};
+
+/**
+ * @brief (内部实现) 调用 append 把结果直接写入 out。
+ * @return 写入的字节数。
+ */
+template <typename Append>
+inline size_t write_to_span(std::span<char> out, Append append) {
+    SpanBuffer buffer(out);
+    append(buffer);
+    return buffer.size();
+}
+}  // namespace detail
+
+/**
+ * @brief 将 GBK 编码的字符串转换为 UTF-8。
+ * @throws std::runtime_error 如果输入包含无效的 GBK 序列。
+ */
+inline std::string gbk_to_utf8(std::string_view gbk_sv) {
+    std::string result;
+    detail::gbk_to_utf8_append(gbk_sv, result);
+    return result;
+}
+
+/**
+ * @brief 将 GBK 编码的字符串转换为 UTF-8，并追加到调用方提供的缓冲区末尾。
+ * @param out std::string、std::vector<char> 等连续字节缓冲区，转换失败时保持原样。
+ * @return 追加的字节数。
+ * @throws std::runtime_error 如果输入包含无效的 GBK 序列。
+ */
+template <detail::ByteBuffer Buffer>
+inline size_t gbk_to_utf8(std::string_view gbk_sv, Buffer& out) {
+    return detail::append_or_rollback(out, [&](Buffer& buffer) { detail::gbk_to_utf8_append(gbk_sv, buffer); });
+}
+
+/**
+ * @brief 将 GBK 编码的字符串转换为 UTF-8，写入调用方提供的定长缓冲区。
+ * @details 结果直接写入 out，不经过中间缓冲区。转换过程中按上界预留输出空间，out 按输入长度 (转为 GBK)
+ * 或输入长度的 3/2 (转为 UTF-8) 准备即可保证放得下。
+ * @return 写入的字节数。
+ * @throws std::system_error (std::errc::value_too_large) 如果 out 放不下，此时 out 的内容未指定。
+ * @throws std::runtime_error 如果输入包含无效的 GBK 序列。
+ */
+inline size_t gbk_to_utf8(std::string_view gbk_sv, std::span<char> out) {
+    return detail::write_to_span(out, [&](detail::SpanBuffer& buffer) { detail::gbk_to_utf8_append(gbk_sv, buffer); });
+}
+
+/**
+ * @brief 将 UTF-8 编码的字符串转换为 GBK。
+ * @throws std::runtime_error 如果输入包含无效的 UTF-8 序列，或包含 GBK 无法表示的字符。
+ */
+inline std::string utf8_to_gbk(std::string_view utf8_sv) {
+    std::string result;
+    detail::utf8_to_gbk_append(utf8_sv, result);
+    return result;
+}
+
+/**
+ * @brief 将 UTF-8 编码的字符串转换为 GBK，并追加到调用方提供的缓冲区末尾。
+ * @param out std::string、std::vector<char> 等连续字节缓冲区，转换失败时保持原样。
+ * @return 追加的字节数。
+ * @throws std::runtime_error 如果输入包含无效的 UTF-8 序列，或包含 GBK 无法表示的字符。
+ */
+template <detail::ByteBuffer Buffer>
+inline size_t utf8_to_gbk(std::string_view utf8_sv, Buffer& out) {
+    return detail::append_or_rollback(out, [&](Buffer& buffer) { detail::utf8_to_gbk_append(utf8_sv, buffer); });
+}
+
+/**
+ * @brief 将 UTF-8 编码的字符串转换为 GBK，写入调用方提供的定长缓冲区。
+ * @details 结果直接写入 out，不经过中间缓冲区。转换过程中按上界预留输出空间，out 按输入长度 (转为 GBK)
+ * 或输入长度的 3/2 (转为 UTF-8) 准备即可保证放得下。
+ * @return 写入的字节数。
+ * @throws std::system_error (std::errc::value_too_large) 如果 out 放不下，此时 out 的内容未指定。
+ * @throws std::runtime_error 如果输入包含无效的 UTF-8 序列，或包含 GBK 无法表示的字符。
+ */
+inline size_t utf8_to_gbk(std::string_view utf8_sv, std::span<char> out) {
+    return detail::write_to_span(out,
+                                 [&](detail::SpanBuffer& buffer) { detail::utf8_to_gbk_append(utf8_sv, buffer); });
+}
+
+/**
+ * @brief 按指定策略将 GBK 编码的字符串转换为 UTF-8，坏序列在转换过程中就地处理，整个输入只读一遍。
+ * @param policy 遇到无效或不完整的 GBK 序列时的处理策略，见 ErrorPolicy。
+ * @throws std::runtime_error 如果 policy 为 STRICT 且输入包含无效的 GBK 序列。
+ */
+inline std::string gbk_to_utf8(std::string_view gbk_sv, ErrorPolicy policy) {
+    std::string result;
+    detail::gbk_to_utf8_append(gbk_sv, result, policy);
+    return result;
+}
+
+/**
+ * @brief 按指定策略将 GBK 编码的字符串转换为 UTF-8，并追加到调用方提供的缓冲区末尾。
+ * @return 追加的字节数。
+ * @throws std::runtime_error 如果 policy 为 STRICT 且输入包含无效的 GBK 序列，此时 out 保持原样。
+ */
+template <detail::ByteBuffer Buffer>
+inline size_t gbk_to_utf8(std::string_view gbk_sv, Buffer& out, ErrorPolicy policy) {
+    return detail::append_or_rollback(out,
+                                      [&](Buffer& buffer) { detail::gbk_to_utf8_append(gbk_sv, buffer, policy); });
+}
+
+/**
+ * @brief 按指定策略将 UTF-8 编码的字符串转换为 GBK，坏序列在转换过程中就地处理，整个输入只读一遍。
+ * @param policy 遇到无效的 UTF-8 序列或 GBK 无法表示的字符时的处理策略，见 ErrorPolicy。
+ * @throws std::runtime_error 如果 policy 为 STRICT 且输入包含无效的 UTF-8 序列，或包含 GBK 无法表示的字符。
+ */
+inline std::string utf8_to_gbk(std::string_view utf8_sv, ErrorPolicy policy) {
+    std::string result;
+    detail::utf8_to_gbk_append(utf8_sv, result, policy);
+    return result;
+}
+
+/**
+ * @brief 按指定策略将 UTF-8 编码的字符串转换为 GBK，并追加到调用方提供的缓冲区末尾。
+ * @return 追加的字节数。
+ * @throws std::runtime_error 如果 policy 为 STRICT 且转换失败，此时 out 保持原样。
+ */
+template <detail::ByteBuffer Buffer>
+inline size_t utf8_to_gbk(std::string_view utf8_sv, Buffer& out, ErrorPolicy policy) {
+    return detail::append_or_rollback(out,
+                                      [&](Buffer& buffer) { detail::utf8_to_gbk_append(utf8_sv, buffer, policy); });
+}
+
+/**
+ * @brief 将 GBK 编码的字符串转换为 UTF-8，结果 (以及转换过程中的临时缓冲区) 从调用方的分配器分配。
+ * @param alloc 元素类型为 char 的分配器，例如指向 arena 的 std::pmr::polymorphic_allocator<char>。
+ * @throws std::runtime_error 如果 policy 为 STRICT 且输入包含无效的 GBK 序列。
+ */
+template <detail::CharAllocator Allocator>
+inline detail::string_with<Allocator> gbk_to_utf8(std::string_view gbk_sv, const Allocator& alloc,
+                                                  ErrorPolicy policy = ErrorPolicy::STRICT) {
+    detail::string_with<Allocator> result(alloc);
+    detail::gbk_to_utf8_append(gbk_sv, result, policy);
+    return result;
+}
+
+/**
+ * @brief 将 GBK 编码的字符串转换为 UTF-8，结果从给定的内存资源 (如 std::pmr::monotonic_buffer_resource) 分配。
+ * @throws std::runtime_error 如果 policy 为 STRICT 且输入包含无效的 GBK 序列。
+ */
+inline std::pmr::string gbk_to_utf8(std::string_view gbk_sv, std::pmr::memory_resource* resource,
+                                    ErrorPolicy policy = ErrorPolicy::STRICT) {
+    return gbk_to_utf8(gbk_sv, std::pmr::polymorphic_allocator<char>(resource), policy);
+}
+
+/**
+ * @brief 将 UTF-8 编码的字符串转换为 GBK，结果 (以及转换过程中的临时缓冲区) 从调用方的分配器分配。
+ * @param alloc 元素类型为 char 的分配器，例如指向 arena 的 std::pmr::polymorphic_allocator<char>。
+ * @throws std::runtime_error 如果 policy 为 STRICT 且转换失败。
+ */
+template <detail::CharAllocator Allocator>
+inline detail::string_with<Allocator> utf8_to_gbk(std::string_view utf8_sv, const Allocator& alloc,
+                                                  ErrorPolicy policy = ErrorPolicy::STRICT) {
+    detail::string_with<Allocator> result(alloc);
+    detail::utf8_to_gbk_append(utf8_sv, result, policy);
+    return result;
+}
+
+/**
+ * @brief 将 UTF-8 编码的字符串转换为 GBK，结果从给定的内存资源 (如 std::pmr::monotonic_buffer_resource) 分配。
+ * @throws std::runtime_error 如果 policy 为 STRICT 且转换失败。
+ */
+inline std::pmr::string utf8_to_gbk(std::string_view utf8_sv, std::pmr::memory_resource* resource,
+                                    ErrorPolicy policy = ErrorPolicy::STRICT) {
+    return utf8_to_gbk(utf8_sv, std::pmr::polymorphic_allocator<char>(resource), policy);
+}
+
+// ========== 多编码转换接口 ==========
+// GBK 与 UTF-8 之间沿用上面的实现；GB18030 与 Big5 交给系统转换器 (iconv / Win32)，
+// 定义 ENCODING_UTIL_USE_NATIVE_CODEC 时也是如此；UTF-16 使用内置实现；其它组合以 UTF-8 为中转。
+namespace detail {
+/**
+ * @brief (内部实现) 编码是否可以作为转换的一端 (ASCII 只能作为源编码，按 UTF-8 处理)。
+ */
+constexpr bool is_convertible_encoding(Encoding encoding) {
+    return encoding != Encoding::UNKNOWN && encoding != Encoding::ASCII;
+}
+
+/**
+ * @brief (内部实现) 编码是否按双字节单位切分 (GBK、GB18030、Big5)，决定 ASCII 段的查找方式与输出上界的估算。
+ */
+constexpr bool is_double_byte_encoding(Encoding encoding) {
+    return encoding == Encoding::GBK || encoding == Encoding::GB18030 || encoding == Encoding::BIG5;
+}
+
+#ifdef _WIN32
+inline UINT win32_code_page(Encoding encoding) {
+    switch (encoding) {
+        case Encoding::GBK: return 936;
+        case Encoding::GB18030: return 54936;
+        case Encoding::BIG5: return 950;
+        default: return CP_UTF8;
+    }
+}
+#else
+inline const char* iconv_name(Encoding encoding) {
+    switch (encoding) {
+        case Encoding::GBK: return "GBK";
+        case Encoding::GB18030: return "GB18030";
+        case Encoding::BIG5: return "BIG5";
+        default: return "UTF-8";
+    }
+}
+#endif
+
+/**
+ * @brief (内部实现) 用系统转换器在 GBK、GB18030、Big5 与 UTF-8 之间转换，结果追加到 out。
+ */
+template <ByteBuffer Buffer>
+inline ConvertError try_system_convert_append(std::string_view input, Encoding from, Encoding to, Buffer& out) {
+#ifdef _WIN32
+    return convert_win32_whole(input, win32_code_page(from), win32_code_page(to), out);
+#else
+    return iconv_convert(input, iconv_name(to), iconv_name(from), out);
+#endif
+}
+
+/**
+ * @brief (内部实现) 将 from 编码的输入转换为 UTF-8 并追加到 out。
+ * @pre from 不是 Encoding::UNKNOWN。
+ */
+template <ByteBuffer Buffer>
+inline ConvertError try_decode_to_utf8_append(std::string_view input, Encoding from, Buffer& out) {
+    switch (from) {
+        case Encoding::GBK: return try_gbk_to_utf8_append(input, out);
+        case Encoding::UTF16LE:
+        case Encoding::UTF16BE: return utf16_to_utf8_append(input, from == Encoding::UTF16BE, out);
+        case Encoding::GB18030:
+        case Encoding::BIG5: return try_system_convert_append(input, from, Encoding::UTF8, out);
+        default: append_bytes(out, input.data(), input.size()); return {};
+    }
+}
+
+/**
+ * @brief (内部实现) 将 UTF-8 输入转换为 to 编码并追加到 out。
+ * @pre to 满足 is_convertible_encoding()。
+ */
+template <ByteBuffer Buffer>
+inline ConvertError try_encode_from_utf8_append(std::string_view input, Encoding to, Buffer& out) {
+    switch (to) {
+        case Encoding::GBK: return try_utf8_to_gbk_append(input, out);
+        case Encoding::UTF16LE:
+        case Encoding::UTF16BE: return utf8_to_utf16_append(input, to == Encoding::UTF16BE, out);
+        case Encoding::GB18030:
+        case Encoding::BIG5: return try_system_convert_append(input, Encoding::UTF8, to, out);
+        default: append_bytes(out, input.data(), input.size()); return {};
+    }
+}
+
+/**
+ * @brief (内部实现) 将 from 编码的输入转换为 to 编码并追加到 out，失败时返回错误信息而不抛出异常。
+ * @details 两端都不是 UTF-8 时经由当前线程复用的暂存区中转，第二步出错时偏移无法对应回输入，记为 npos。
+ */
+template <ByteBuffer Buffer>
+inline ConvertError try_convert_append(std::string_view input, Encoding from, Encoding to, Buffer& out) {
+    if (from == Encoding::ASCII) from = Encoding::UTF8;  // ASCII 是 UTF-8 的子集
+    if (!is_convertible_encoding(from) || !is_convertible_encoding(to)) {
+        return {ConvertErrc::UNKNOWN_ENCODING, ConvertError::npos};
+    }
+    if (from == to) {
+        append_bytes(out, input.data(), input.size());
+        return {};
+    }
+    if (to == Encoding::UTF8) return try_decode_to_utf8_append(input, from, out);
+    if (from == Encoding::UTF8) return try_encode_from_utf8_append(input, to, out);
+
+    const auto via_utf8 = [&](auto& utf8) {
+        if (const ConvertError error = try_decode_to_utf8_append(input, from, utf8)) return error;
+        ConvertError error = try_encode_from_utf8_append(std::string_view(utf8), to, out);
+        if (error) error.offset = ConvertError::npos;
+        return error;
+    };
+    // 中转的 UTF-8 在输出使用 std::pmr 分配器时从同一内存资源分配 (随 arena 一起释放)，否则复用线程内的暂存区
+    if constexpr (PmrBuffer<Buffer>) {
+        std::pmr::string utf8(scratch_resource(out));
+        return via_utf8(utf8);
+    } else {
+        thread_local std::string utf8;
+        utf8.clear();
+        return via_utf8(utf8);
+    }
+}
+}  // namespace detail
+
+/**
+ * @brief 在任意两种受支持的编码之间转换。
+ * @details
+ * 支持 GBK、GB18030、Big5、UTF-8 与 UTF-16LE / UTF-16BE，ASCII 作为源编码时按 UTF-8 处理：
+ * - GBK 与 UTF-8 之间的转换与 gbk_to_utf8() / utf8_to_gbk() 相同；
+ * - UTF-16 解码时跳过开头的 BOM，编码时总是写出 BOM；
+ * - 源编码与目标编码相同时原样拷贝，不做验证。
+ * @throws std::runtime_error 如果编码不受支持、输入包含无效序列或目标编码无法表示的字符。
+ */
+inline std::string convert(std::string_view input, Encoding from, Encoding to) {
+    std::string result;
+    if (const ConvertError error = detail::try_convert_append(input, from, to, result)) {
+        detail::throw_convert_error("convert", error);
+    }
+    return result;
+}
+
+/**
+ * @brief 在任意两种受支持的编码之间转换，并追加到调用方提供的缓冲区末尾，规则同 convert(input, from, to)。
+ * @return 追加的字节数。
+ * @throws std::runtime_error 如果编码不受支持或转换失败，此时 out 保持原样。
+ */
+template <detail::ByteBuffer Buffer>
+inline size_t convert(std::string_view input, Encoding from, Encoding to, Buffer& out) {
+    return detail::append_or_rollback(out, [&](Buffer& buffer) {
+        if (const ConvertError error = detail::try_convert_append(input, from, to, buffer)) {
+            detail::throw_convert_error("convert", error);
+        }
+    });
+}
+
+/**
+ * @brief 在任意两种受支持的编码之间转换并追加到 out 末尾，不抛出异常，规则同 convert(input, from, to)。
+ * @return 错误信息，失败时 out 保持原样；编码不受支持时为 UNKNOWN_ENCODING。
+ */
+template <detail::ByteBuffer Buffer>
+inline ConvertError try_convert(std::string_view input, Encoding from, Encoding to, Buffer& out) noexcept {
+    return detail::try_append_or_rollback(
+        out, [&](Buffer& buffer) { return detail::try_convert_append(input, from, to, buffer); });
+}
+
+/**
+ * @class Converter
+ * @brief 可复用的单向编码转换器，适合对大量短字符串反复做同一方向的转换。
+ * @details
+ * 支持 convert(input, from, to) 能处理的任意编码组合。转换器在构造时一次性准备好转换资源
+ * (POSIX 上两端都不是 UTF-16 时为独占的 iconv 描述符)，之后每次 convert() 只做转换本身。
+ * 它可移动、不可拷贝；同一个对象不能被多个线程同时使用，每个线程应持有各自的实例。
+ * 未持有 Converter 时，gbk_to_utf8() / utf8_to_gbk() 也会复用当前线程缓存的描述符。
+ */
+class Converter {
+public:
+    /**
+     * @param from 源编码，可以是 GBK、GB18030、Big5、UTF-8、UTF-16LE 或 UTF-16BE。
+     * @param to 目标编码，取值范围同 from，且与源编码不同。
+     * @throws std::runtime_error 如果编码组合不受支持，或无法创建转换描述符。
+     */
+    Converter(Encoding from, Encoding to) : from_(from), to_(to) {
+        if (!detail::is_convertible_encoding(from) || !detail::is_convertible_encoding(to) || from == to) {
+            detail::throw_runtime_error("Converter: 不支持的编码组合。");
+        }
+#if !defined(ENCODING_UTIL_USE_NATIVE_CODEC) && !defined(_WIN32)
+        if (!is_utf16(from) && !is_utf16(to)) {
+            handle_ = detail::IconvHandle(detail::iconv_name(to), detail::iconv_name(from));
+        }
+#endif
+    }
+
+    Converter(const Converter&) = delete;
+    Converter& operator=(const Converter&) = delete;
+    Converter(Converter&&) noexcept = default;
+    Converter& operator=(Converter&&) noexcept = default;
+
+    /**
+     * @brief 转换一个字符串，行为与 convert(input, from(), to()) 相同。
+     * @throws std::runtime_error 如果输入包含无效序列或目标编码无法表示的字符。
+     */
+    std::string convert(std::string_view input) {
+        std::string result;
+        convert(input, result);
+        return result;
+    }
+
+    /**
+     * @brief 转换一个字符串并追加到 out 末尾，转换失败时 out 保持原样。
+     * @return 追加的字节数。
+     * @throws std::runtime_error 如果输入包含无效序列或目标编码无法表示的字符。
+     */
+    template <detail::ByteBuffer Buffer>
+    size_t convert(std::string_view input, Buffer& out) {
+        return detail::append_or_rollback(out, [&](Buffer& buffer) { append_converted(input, buffer); });
+    }
+
+    /**
+     * @brief 转换一个字符串并追加到 out 末尾，不抛出异常。
+     * @return 错误信息，失败时 out 保持原样，offset 指向第一个出错字符在 input 中的位置。
+     */
+    template <detail::ByteBuffer Buffer>
+    ConvertError try_convert(std::string_view input, Buffer& out) noexcept {
+        return detail::try_append_or_rollback(out,
+                                              [&](Buffer& buffer) { return try_append_converted(input, buffer); });
+    }
+
+    Encoding from() const noexcept { return from_; }
+    Encoding to() const noexcept { return to_; }
+
+private:
+    template <detail::ByteBuffer Buffer>
+    ConvertError try_append_converted(std::string_view input, Buffer& out) {
+#if !defined(ENCODING_UTIL_USE_NATIVE_CODEC) && !defined(_WIN32)
+        if (handle_.cd != (iconv_t)-1) {
+            return detail::iconv_convert(handle_.cd, input, detail::is_double_byte_encoding(from_), out);
+        }
+#endif
+        return detail::try_convert_append(input, from_, to_, out);
+    }
+
+    static constexpr bool is_utf16(Encoding encoding) {
+        return encoding == Encoding::UTF16LE || encoding == Encoding::UTF16BE;
+    }
+
+    template <detail::ByteBuffer Buffer>
+    void append_converted(std::string_view input, Buffer& out) {
+        const ConvertError error = try_append_converted(input, out);
+        if (error) detail::throw_convert_error("Converter", error);
+    }
+
+    Encoding from_;
+    Encoding to_;
+#if !defined(ENCODING_UTIL_USE_NATIVE_CODEC) && !defined(_WIN32)
+    detail::IconvHandle handle_;
+#endif
+};
+
+// ========== UTF-16 / UTF-32 宽字符串接口 ==========
+// 与 convert(..., Encoding::UTF16LE) 这类按字节序列化 (带 BOM) 的接口不同，这里直接读写本机字节序的代码单元，
+// 既不写入也不跳过 BOM：char16_t 为 UTF-16，char32_t 为 UTF-32，wchar_t 在 Windows 上为 UTF-16、其它平台为 UTF-32。
+// 宽字符串输入出错时，ConvertError::offset 为代码单元的下标而不是字节偏移。
+namespace detail {
+template <typename Unit>
+concept UnicodeUnit = std::same_as<Unit, char16_t> || std::same_as<Unit, char32_t> || std::same_as<Unit, wchar_t>;
+
+/**
+ * @brief (内部实现) 把 src 开头的 ASCII 字节逐个展开为代码单元写入 dst，遇到第一个非 ASCII 字节时停止。
+ * @details 向量版本按 16 字节整块写出，dst 在返回值之后的部分可能被写入无意义的内容。
+ * @param dst 目标空间，必须至少能容纳 size 个代码单元。
+ * @return 展开的字节数。
+ */
+template <UnicodeUnit Unit>
+inline size_t widen_ascii_prefix(const char* src, size_t size, Unit* dst) noexcept {
+    size_t i = 0;
+#if defined(ENCODING_UTIL_SIMD_X86)
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= size; i += 16) {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        const int mask = _mm_movemask_epi8(bytes);
+        const __m128i lo = _mm_unpacklo_epi8(bytes, zero);
+        const __m128i hi = _mm_unpackhi_epi8(bytes, zero);
+        auto* out = reinterpret_cast<__m128i*>(dst + i);
+        if constexpr (sizeof(Unit) == 2) {
+            _mm_storeu_si128(out, lo);
+            _mm_storeu_si128(out + 1, hi);
+        } else {
+            _mm_storeu_si128(out, _mm_unpacklo_epi16(lo, zero));
+            _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(lo, zero));
+            _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(hi, zero));
+            _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(hi, zero));
+        }
+        // 非 ASCII 字节之前的部分已经写好，直接从它开始交还给调用方，不再逐字节重扫
+        if (mask != 0) return i + static_cast<size_t>(std::countr_zero(static_cast<unsigned>(mask)));
+    }
+#elif defined(ENCODING_UTIL_SIMD_NEON)
+    for (; i + 16 <= size; i += 16) {
+        const uint8x16_t bytes = vld1q_u8(reinterpret_cast<const uint8_t*>(src + i));
+        if (vmaxvq_u8(bytes) > 0x7F) break;
+        const uint16x8_t lo = vmovl_u8(vget_low_u8(bytes));
+        const uint16x8_t hi = vmovl_u8(vget_high_u8(bytes));
+        auto* out = reinterpret_cast<uint8_t*>(dst + i);
+        if constexpr (sizeof(Unit) == 2) {
+            vst1q_u8(out, vreinterpretq_u8_u16(lo));
+            vst1q_u8(out + 16, vreinterpretq_u8_u16(hi));
+        } else {
+            vst1q_u8(out, vreinterpretq_u8_u32(vmovl_u16(vget_low_u16(lo))));
+            vst1q_u8(out + 16, vreinterpretq_u8_u32(vmovl_u16(vget_high_u16(lo))));
+            vst1q_u8(out + 32, vreinterpretq_u8_u32(vmovl_u16(vget_low_u16(hi))));
+            vst1q_u8(out + 48, vreinterpretq_u8_u32(vmovl_u16(vget_high_u16(hi))));
+        }
+    }
+#endif
+    for (; i < size && static_cast<unsigned char>(src[i]) < 0x80; ++i) dst[i] = static_cast<Unit>(src[i]);
+    return i;
+}
+
+/**
+ * @brief (内部实现) 把 src 开头值小于 0x80 的代码单元逐个收窄为 ASCII 字节写入 dst，遇到第一个其它单元时停止。
+ * @details x86 版本按向量整块写出，dst 在返回值之后的部分可能被写入无意义的内容。
+ * @param dst 目标空间，必须至少能容纳 size 个字节。
+ * @return 收窄的代码单元数。
+ */
+template <UnicodeUnit Unit>
+inline size_t narrow_ascii_prefix(const Unit* src, size_t size, char* dst) noexcept {
+    const Unit* const end = src + size;
+    size_t i = 0;
+#if defined(ENCODING_UTIL_SIMD_X86)
+    // 每次处理一个 128 位向量：UTF-16 为 8 个单元，UTF-32 为 4 个单元
+    constexpr ptrdiff_t kStep = 16 / sizeof(Unit);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i high = sizeof(Unit) == 2 ? _mm_set1_epi16(static_cast<short>(0xFF80)) : _mm_set1_epi32(~0x7F);
+    for (const Unit* p = src; end - p >= kStep; p += kStep, i += kStep) {
+        const __m128i units = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        const __m128i masked = _mm_and_si128(units, high);
+        // 每个单元在 ascii 中占 sizeof(Unit) 位，单元小于 0x80 时这些位全为 1
+        unsigned ascii;
+        if constexpr (sizeof(Unit) == 2) {
+            ascii = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi16(masked, zero)));
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(units, units));
+        } else {
+            ascii = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi32(masked, zero)));
+            const int bytes = _mm_cvtsi128_si32(_mm_packus_epi16(_mm_packs_epi32(units, units), zero));
+            std::memcpy(dst + i, &bytes, 4);
+        }
+        if (ascii != 0xFFFF) return i + static_cast<size_t>(std::countr_one(ascii)) / sizeof(Unit);
+    }
+#elif defined(ENCODING_UTIL_SIMD_NEON)
+    for (const Unit* p = src; end - p >= 16; p += 16, i += 16) {
+        const auto* in = reinterpret_cast<const uint8_t*>(p);
+        uint8x16_t bytes;
+        if constexpr (sizeof(Unit) == 2) {
+            const uint16x8_t a = vreinterpretq_u16_u8(vld1q_u8(in));
+            const uint16x8_t b = vreinterpretq_u16_u8(vld1q_u8(in + 16));
+            if (vmaxvq_u16(vorrq_u16(a, b)) > 0x7F) break;
+            bytes = vcombine_u8(vmovn_u16(a), vmovn_u16(b));
+        } else {
+            const uint32x4_t a = vreinterpretq_u32_u8(vld1q_u8(in));
+            const uint32x4_t b = vreinterpretq_u32_u8(vld1q_u8(in + 16));
+            const uint32x4_t c = vreinterpretq_u32_u8(vld1q_u8(in + 32));
+            const uint32x4_t d = vreinterpretq_u32_u8(vld1q_u8(in + 48));
+            if (vmaxvq_u32(vorrq_u32(vorrq_u32(a, b), vorrq_u32(c, d))) > 0x7F) break;
+            const uint16x8_t lo = vcombine_u16(vmovn_u32(a), vmovn_u32(b));
+            const uint16x8_t hi = vcombine_u16(vmovn_u32(c), vmovn_u32(d));
+            bytes = vcombine_u8(vmovn_u16(lo), vmovn_u16(hi));
+        }
+        vst1q_u8(reinterpret_cast<uint8_t*>(dst + i), bytes);
+    }
+#endif
+    for (const Unit* p = src + i; p != end && static_cast<char32_t>(*p) < 0x80; ++p, ++i) dst[i] = static_cast<char>(*p);
+    return i;
+}
+
+#if defined(ENCODING_UTIL_SIMD_X86)
+// 常用汉字都是三字节的 UTF-8 字符 (U+0800~U+FFFF)，下面两个函数每次用一次字节重排处理 4 个这样的字符。
+// 它们只用到 SSSE3 / SSE4.1 的 128 位指令，按 AVX2 派发以沿用已有的 CPU 检测；遇到不满足条件的块即停下，交还给标量实现。
+
+/**
+ * @brief (内部实现) 从 src 开始连续解码合法的三字节字符，每次处理一个 12 字节块，写入 dst。
+ * @param dst 目标空间，必须至少能容纳 size 个代码单元 (每块整块写出)。
+ * @return 消耗的字节数 (3 的倍数)，dst 中有效的代码单元为 (返回值 / 3) 个。
+ */
+template <UnicodeUnit Unit>
+ENCODING_UTIL_TARGET_AVX2 inline size_t decode_utf8_3byte_blocks_avx2(const char* src, size_t size,
+                                                                      Unit* dst) noexcept {
+    // 第 k 个 32 位通道从低到高依次放入字符 k 的第 3、2、1 字节
+    const __m128i shuffle = _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+    const __m128i low6 = _mm_set1_epi32(0x3F);
+    size_t i = 0;
+    for (; i + 16 <= size; i += 12) {
+        const __m128i lanes = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)), shuffle);
+        const __m128i cp = _mm_or_si128(
+            _mm_or_si128(_mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(lanes, 16), _mm_set1_epi32(0x0F)), 12),
+                         _mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(lanes, 8), low6), 6)),
+            _mm_and_si128(lanes, low6));
+        // 结构为 1110xxxx 10xxxxxx 10xxxxxx，且不是过长编码 (< U+0800) 或代理区 (U+D800~U+DFFF)
+        const __m128i well_formed =
+            _mm_cmpeq_epi32(_mm_and_si128(lanes, _mm_set1_epi32(0x00F0C0C0)), _mm_set1_epi32(0x00E08080));
+        const __m128i overlong = _mm_cmplt_epi32(cp, _mm_set1_epi32(0x800));
+        const __m128i surrogate =
+            _mm_cmpeq_epi32(_mm_and_si128(cp, _mm_set1_epi32(0xF800)), _mm_set1_epi32(0xD800));
+        const int valid = _mm_movemask_epi8(_mm_andnot_si128(_mm_or_si128(overlong, surrogate), well_formed));
+        auto* out = reinterpret_cast<__m128i*>(dst + i / 3);
+        if constexpr (sizeof(Unit) == 2) {
+            _mm_storel_epi64(out, _mm_packus_epi32(cp, cp));
+        } else {
+            _mm_storeu_si128(out, cp);
+        }
+        // 块内开头的合法字符照样保留，中英混排时不会因为一个 ASCII 字节而丢掉整块
+        if (valid != 0xFFFF) return i + 3 * (static_cast<size_t>(std::countr_one(static_cast<unsigned>(valid))) / 4);
+    }
+    return i;
+}
+
+/**
+ * @brief (内部实现) 从 src 开始连续把 U+0800~U+FFFF (代理区除外) 的代码单元编码为三字节 UTF-8，每次处理 4 个，写入 dst。
+ * @param dst 目标空间，必须至少能容纳 3 * size 个字节 (每组整组写出)。
+ * @return 消耗的代码单元数，dst 中有效的字节为 3 倍于此。
+ */
+template <UnicodeUnit Unit>
+ENCODING_UTIL_TARGET_AVX2 inline size_t encode_utf8_3byte_blocks_avx2(const Unit* src, size_t size,
+                                                                      char* dst) noexcept {
+    // 把每个通道低 3 个字节 (首字节、第 2、3 字节) 紧凑排列到前 12 个字节
+    const __m128i pack = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    const __m128i low6 = _mm_set1_epi32(0x3F);
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4) {
+        __m128i cp;
+        if constexpr (sizeof(Unit) == 2) {
+            cp = _mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i)));
+        } else {
+            cp = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        }
+        const __m128i in_range = _mm_and_si128(_mm_cmpgt_epi32(cp, _mm_set1_epi32(0x7FF)),
+                                               _mm_cmplt_epi32(cp, _mm_set1_epi32(0x10000)));
+        const __m128i surrogate =
+            _mm_cmpeq_epi32(_mm_and_si128(cp, _mm_set1_epi32(0xF800)), _mm_set1_epi32(0xD800));
+        const int valid = _mm_movemask_epi8(_mm_andnot_si128(surrogate, in_range));
+        const __m128i lanes = _mm_or_si128(
+            _mm_or_si128(_mm_srli_epi32(cp, 12), _mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(cp, 6), low6), 8)),
+            _mm_or_si128(_mm_slli_epi32(_mm_and_si128(cp, low6), 16), _mm_set1_epi32(0x008080E0)));
+        const __m128i bytes = _mm_shuffle_epi8(lanes, pack);
+        char* out = dst + 3 * i;
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out), bytes);
+        const int tail = _mm_cvtsi128_si32(_mm_srli_si128(bytes, 8));
+        std::memcpy(out + 8, &tail, 4);
+        if (valid != 0xFFFF) return i + static_cast<size_t>(std::countr_one(static_cast<unsigned>(valid))) / 4;
+    }
+    return i;
+}
+#endif
+
+template <UnicodeUnit Unit>
+using Utf8BlockDecoder = size_t (*)(const char*, size_t, Unit*) noexcept;
+
+template <UnicodeUnit Unit>
+using Utf8BlockEncoder = size_t (*)(const Unit*, size_t, char*) noexcept;
+
+/**
+ * @brief (内部实现) 选出三字节字符的批量解码实现，当前 CPU 不支持时返回 nullptr。
+ */
+template <UnicodeUnit Unit>
+inline Utf8BlockDecoder<Unit> select_utf8_block_decoder() {
+#if defined(ENCODING_UTIL_SIMD_X86)
+    if (cpu_has_avx2()) return &decode_utf8_3byte_blocks_avx2<Unit>;
+#endif
+    return nullptr;
+}
+
+/**
+ * @brief (内部实现) 选出三字节字符的批量编码实现，当前 CPU 不支持时返回 nullptr。
+ */
+template <UnicodeUnit Unit>
+inline Utf8BlockEncoder<Unit> select_utf8_block_encoder() {
+#if defined(ENCODING_UTIL_SIMD_X86)
+    if (cpu_has_avx2()) return &encode_utf8_3byte_blocks_avx2<Unit>;
+#endif
+    return nullptr;
+}
+
+/**
+ * @brief (内部实现) 按 Unit 的编码形式写入一个码位，UTF-16 中超出 BMP 的码位写作代理对。
+ * @return 写入的代码单元数。
+ */
+template <UnicodeUnit Unit>
+constexpr size_t put_code_point(char32_t cp, Unit* dst) {
+    if constexpr (sizeof(Unit) == 2) {
+        if (cp >= 0x10000) {
+            dst[0] = static_cast<Unit>(0xD800 + ((cp - 0x10000) >> 10));
+            dst[1] = static_cast<Unit>(0xDC00 + ((cp - 0x10000) & 0x3FF));
+            return 2;
+        }
+    }
+    dst[0] = static_cast<Unit>(cp);
+    return 1;
+}
+
+/**
+ * @brief (内部实现) 将 UTF-8 转换为 UTF-16 / UTF-32 代码单元并追加到 result。
+ * @details 每个 UTF-8 字节最多对应一个代码单元 (四字节字符在 UTF-16 中为两个单元)，按输入长度一次性扩容。
+ * @return 转换失败时返回错误信息 (字节偏移)，此时 result 中可能留有部分输出。
+ */
+template <UnicodeUnit Unit>
+inline ConvertError utf8_to_unicode_append(std::string_view input, std::basic_string<Unit>& result) {
+    static const Utf8BlockDecoder<Unit> decode_blocks = select_utf8_block_decoder<Unit>();
+    const auto* p = reinterpret_cast<const unsigned char*>(input.data());
+    const size_t size = input.size();
+    size_t out = result.size();
+    result.resize(out + size);
+    Unit* dst = result.data();
+    size_t i = 0;
+    while (i < size) {
+        const size_t ascii_len = widen_ascii_prefix(input.data() + i, size - i, dst + out);
+        i += ascii_len;
+        out += ascii_len;
+        while (i < size && p[i] >= 0x80) {
+            // 只在接下来至少 4 个字符都是三字节字符时才进入批量解码，中英混排的短片段仍走标量
+            if (decode_blocks != nullptr && size - i >= 16 && (p[i] & 0xF0) == 0xE0 && (p[i + 3] & 0xF0) == 0xE0 &&
+                (p[i + 6] & 0xF0) == 0xE0 && (p[i + 9] & 0xF0) == 0xE0) {
+                const size_t decoded = decode_blocks(input.data() + i, size - i, dst + out);
+                i += decoded;
+                out += decoded / 3;
+                if (decoded > 0) continue;
+            }
+            char32_t cp = 0;
+            const size_t len = decode_utf8_char(p + i, size - i, cp);
+            if (len == 0) {
+                bool truncated;
+                utf8_maximal_subpart(p + i, size - i, truncated);
+                result.resize(out);
+                return {truncated ? ConvertErrc::INCOMPLETE_SEQUENCE : ConvertErrc::INVALID_SEQUENCE, i};
+            }
+            out += put_code_point(cp, dst + out);
+            i += len;
+        }
+    }
+    result.resize(out);
+    return {};
+}
+
+/**
+ * @brief (内部实现) 将 UTF-16 / UTF-32 代码单元转换为 UTF-8 并追加到 result。
+ * @details UTF-16 每个单元最多对应 3 个字节 (代理对的两个单元共 4 个字节)，UTF-32 每个单元最多 4 个字节。
+ * @return 转换失败时返回错误信息 (代码单元下标)，此时 result 中可能留有部分输出。孤立的代理单元与超出
+ * U+10FFFF 的值视为无效序列，末尾缺少低位代理的高位代理视为不完整序列。
+ */
+template <UnicodeUnit Unit, ByteBuffer Buffer>
+inline ConvertError unicode_to_utf8_append(std::basic_string_view<Unit> input, Buffer& result) {
+    static const Utf8BlockEncoder<Unit> encode_blocks = select_utf8_block_encoder<Unit>();
+    const size_t size = input.size();
+    const Unit* const end = input.data() + size;
+    size_t out = result.size();
+    result.resize(out + size * (sizeof(Unit) == 2 ? 3 : 4));
+    char* dst = buffer_data(result);
+    auto fail = [&](ConvertErrc code, size_t offset) {
+        result.resize(out);
+        return ConvertError{code, offset};
+    };
+    size_t i = 0;
+    while (i < size) {
+        const size_t ascii_len = narrow_ascii_prefix(input.data() + i, size - i, dst + out);
+        i += ascii_len;
+        out += ascii_len;
+        while (i < size && static_cast<char32_t>(input[i]) >= 0x80) {
+            const Unit* const p = input.data() + i;
+            char32_t cp = static_cast<char32_t>(*p);
+            // 块编码器自己检查每个单元的范围，这里只看当前单元，不越过它去读后面的单元
+            if (encode_blocks != nullptr && end - p >= 4 && cp >= 0x800) {
+                const size_t encoded = encode_blocks(p, static_cast<size_t>(end - p), dst + out);
+                i += encoded;
+                out += encoded * 3;
+                if (encoded > 0) continue;
+            }
+            size_t len = 1;
+            if (cp >= 0xD800 && cp <= 0xDFFF) {
+                if (sizeof(Unit) != 2 || cp >= 0xDC00) return fail(ConvertErrc::INVALID_SEQUENCE, i);
+                if (i + 1 == size) return fail(ConvertErrc::INCOMPLETE_SEQUENCE, i);
+                const char32_t low = static_cast<char32_t>(input[i + 1]);
+                if (low < 0xDC00 || low > 0xDFFF) return fail(ConvertErrc::INVALID_SEQUENCE, i);
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                len = 2;
+            } else if (cp > 0x10FFFF) {
+                return fail(ConvertErrc::INVALID_SEQUENCE, i);
+            }
+            out += encode_utf8_char(cp, dst + out);
+            i += len;
+        }
+    }
+    result.resize(out);
+    return {};
+}
+
+/**
+ * @brief (内部实现) 查表将一段 GBK 多字节文本解码为代码单元写入 dst，遇到无效序列时在 error 中记录原因与段内偏移。
+ * @param dst 目标空间，必须至少能容纳 size 个代码单元 (GBK 字符都在 BMP 内，每个字节最多对应一个单元)。
+ * @return 写入的代码单元数。
+ */
+template <UnicodeUnit Unit>
+inline size_t native_gbk_segment_to_unicode(const char* data, size_t size, Unit* dst, ConvertError& error) noexcept {
+    const auto* p = reinterpret_cast<const unsigned char*>(data);
+    size_t out = 0;
+    for (size_t i = 0; i < size;) {
+        const unsigned char c = p[i];
+        if (c < 0x80) {
+            dst[out++] = static_cast<Unit>(c);
+            ++i;
+            continue;
+        }
+        if (c == 0x80) {
+            dst[out++] = static_cast<Unit>(0x20AC);
+            ++i;
+            continue;
+        }
+        const char32_t cp = (i + 1 < size) ? gbk_table_decode(c, p[i + 1]) : 0;
+        if (cp == 0) {
+            const bool truncated = (i + 1 == size) && c != 0xFF;
+            error = {truncated ? ConvertErrc::INCOMPLETE_SEQUENCE : ConvertErrc::INVALID_SEQUENCE, i};
+            return out;
+        }
+        dst[out++] = static_cast<Unit>(cp);
+        i += 2;
+    }
+    return out;
+}
+
+/**
+ * @brief (内部实现) 将一段 GBK 多字节文本解码为代码单元写入 dst。
+ * @details Windows 上 UTF-16 输出直接交给 MultiByteToWideChar，与 gbk_to_utf8() 的第一步完全相同，
+ * 因此 gbk_to_utf16(s) 与 utf8_to_utf16(gbk_to_utf8(s)) 的结果一致；其它情况使用内置码表。
+ */
+template <UnicodeUnit Unit>
+inline size_t gbk_segment_to_unicode(const char* data, size_t size, Unit* dst, ConvertError& error) noexcept {
+#if defined(_WIN32) && !defined(ENCODING_UTIL_USE_NATIVE_CODEC)
+    if constexpr (sizeof(Unit) == 2) {
+        size_t pos = 0, out = 0;
+        while (pos < size) {
+            size_t chunk = std::min(size - pos, static_cast<size_t>(kWin32ChunkSize));
+            if (pos + chunk < size) chunk -= gbk_incomplete_tail_size(data + pos, chunk);
+            // 与 convert_win32_segment() 一样，严格模式下 GBK 源不加 MB_ERR_INVALID_CHARS
+            const int chunk_len = static_cast<int>(chunk);
+            const int wide_len =
+                MultiByteToWideChar(936, 0, data + pos, chunk_len, reinterpret_cast<wchar_t*>(dst + out), chunk_len);
+            if (wide_len == 0) {
+                error = {ConvertErrc::SYSTEM_ERROR, ConvertError::npos, static_cast<int>(GetLastError())};
+                return out;
+            }
+            out += static_cast<size_t>(wide_len);
+            pos += chunk;
+        }
+        return out;
+    }
+#endif
+    return native_gbk_segment_to_unicode(data, size, dst, error);
+}
+
+/**
+ * @brief (内部实现) 将 GBK 直接解码为 UTF-16 / UTF-32 代码单元并追加到 result，不经过 UTF-8。
+ * @return 转换失败时返回错误信息 (字节偏移)，此时 result 中可能留有部分输出。
+ */
+template <UnicodeUnit Unit>
+inline ConvertError gbk_to_unicode_append(std::string_view input, std::basic_string<Unit>& result) {
+    const size_t size = input.size();
+    size_t out = result.size();
+    result.resize(out + size);
+    Unit* dst = result.data();
+    size_t i = 0;
+    while (i < size) {
+        const size_t ascii_len = widen_ascii_prefix(input.data() + i, size - i, dst + out);
+        i += ascii_len;
+        out += ascii_len;
+        if (i == size) break;
+
+        const size_t segment_len = find_ascii_run(input.data() + i, size - i, true);
+        ConvertError error;
+        out += gbk_segment_to_unicode(input.data() + i, segment_len, dst + out, error);
+        if (error) {
+            result.resize(out);
+            return rebase_segment_error(error, i, segment_len, size);
+        }
+        i += segment_len;
+    }
+    result.resize(out);
+    return {};
+}
+
+/**
+ * @brief (内部实现) 调用 try_append 生成宽字符串，失败时抛出以 where 开头的异常。
+ */
+template <typename String, typename TryAppend>
+inline String make_or_throw(const char* where, TryAppend try_append) {
+    String result;
+    const ConvertError error = try_append(result);
+    if (error) throw_convert_error(where, error);
+    return result;
+}
+}  // namespace detail
+
+/**
+ * @brief 将 UTF-8 字符串转换为 UTF-16。
+ * @throws std::runtime_error 如果输入包含无效的 UTF-8 序列。
+ */
+inline std::u16string utf8_to_utf16(std::string_view utf8_sv) {
+    return detail::make_or_throw<std::u16string>(
+        "utf8_to_utf16", [&](std::u16string& out) { return detail::utf8_to_unicode_append(utf8_sv, out); });
+}
+
+/**
+ * @brief 将 UTF-8 字符串转换为 UTF-32。
+ * @throws std::runtime_error 如果输入包含无效的 UTF-8 序列。
+ */
+inline std::u32string utf8_to_utf32(std::string_view utf8_sv) {
+    return detail::make_or_throw<std::u32string>(
+        "utf8_to_utf32", [&](std::u32string& out) { return detail::utf8_to_unicode_append(utf8_sv, out); });
+}
+
+/**
+ * @brief 将 UTF-8 字符串转换为 std::wstring (Windows 上为 UTF-16，其它平台为 UTF-32)。
+ * @throws std::runtime_error 如果输入包含无效的 UTF-8 序列。
+ */
+inline std::wstring utf8_to_wide(std::string_view utf8_sv) {
+    return detail::make_or_throw<std::wstring>(
+        "utf8_to_wide", [&](std::wstring& out) { return detail::utf8_to_unicode_append(utf8_sv, out); });
+}
+
+/**
+ * @brief 将 UTF-16 字符串转换为 UTF-8。
+ * @throws std::runtime_error 如果输入包含孤立的代理单元。
+ */
+inline std::string utf16_to_utf8(std::u16string_view utf16_sv) {
+    return detail::make_or_throw<std::string>(
+        "utf16_to_utf8", [&](std::string& out) { return detail::unicode_to_utf8_append(utf16_sv, out); });
+}
+
+/**
+ * @brief 将 UTF-32 字符串转换为 UTF-8。
+ * @throws std::runtime_error 如果输入包含代理区或超出 U+10FFFF 的值。
+ */
+inline std::string utf32_to_utf8(std::u32string_view utf32_sv) {
+    return detail::make_or_throw<std::string>(
+        "utf32_to_utf8", [&](std::string& out) { return detail::unicode_to_utf8_append(utf32_sv, out); });
+}
+
+/**
+ * @brief 将 std::wstring (Windows 上为 UTF-16，其它平台为 UTF-32) 转换为 UTF-8。
+ * @throws std::runtime_error 如果输入不是合法的 UTF-16 / UTF-32。
+ */
+inline std::string wide_to_utf8(std::wstring_view wide_sv) {
+    return detail::make_or_throw<std::string>(
+        "wide_to_utf8", [&](std::string& out) { return detail::unicode_to_utf8_append(wide_sv, out); });
+}
+
+/**
+ * @brief 将 GBK 字符串直接转换为 UTF-16，省去经由 UTF-8 的一次中转。
+ * @throws std::runtime_error 如果输入包含无效的 GBK 序列。
+ */
+inline std::u16string gbk_to_utf16(std::string_view gbk_sv) {
+    return detail::make_or_throw<std::u16string>(
+        "gbk_to_utf16", [&](std::u16string& out) { return detail::gbk_to_unicode_append(gbk_sv, out); });
+}
+
+/**
+ * @brief 将 GBK 字符串直接转换为 std::wstring (Windows 上为 UTF-16，其它平台为 UTF-32)。
+ * @throws std::runtime_error 如果输入包含无效的 GBK 序列。
+ */
+inline std::wstring gbk_to_wide(std::string_view gbk_sv) {
+    return detail::make_or_throw<std::wstring>(
+        "gbk_to_wide", [&](std::wstring& out) { return detail::gbk_to_unicode_append(gbk_sv, out); });
+}
+
+/**
+ * @brief utf8_to_utf16() 的不抛异常版本，结果追加到 out 末尾。
+ * @return 转换失败时返回错误信息 (字节偏移)，此时 out 保持原样。
+ */
+inline ConvertError try_utf8_to_utf16(std::string_view utf8_sv, std::u16string& out) noexcept {
+    return detail::try_append_or_rollback(out, [&](std::u16string& buffer) {
+        return detail::utf8_to_unicode_append(utf8_sv, buffer);
+    });
+}
+
+/**
+ * @brief utf8_to_wide() 的不抛异常版本，结果追加到 out 末尾。
+ * @return 转换失败时返回错误信息 (字节偏移)，此时 out 保持原样。
+ */
+inline ConvertError try_utf8_to_wide(std::string_view utf8_sv, std::wstring& out) noexcept {
+    return detail::try_append_or_rollback(
+        out, [&](std::wstring& buffer) { return detail::utf8_to_unicode_append(utf8_sv, buffer); });
+}
+
+/**
+ * @brief utf16_to_utf8() 的不抛异常版本，结果追加到 out 末尾。
+ * @param out std::string、std::vector<char> 等连续字节缓冲区。
+ * @return 转换失败时返回错误信息 (代码单元下标)，此时 out 保持原样。
+ */
+template <detail::ByteBuffer Buffer>
+inline ConvertError try_utf16_to_utf8(std::u16string_view utf16_sv, Buffer& out) noexcept {
+    return detail::try_append_or_rollback(
+        out, [&](Buffer& buffer) { return detail::unicode_to_utf8_append(utf16_sv, buffer); });
+}
+
+/**
+ * @brief wide_to_utf8() 的不抛异常版本，结果追加到 out 末尾。
+ * @param out std::string、std::vector<char> 等连续字节缓冲区。
+ * @return 转换失败时返回错误信息 (代码单元下标)，此时 out 保持原样。
+ */
+template <detail::ByteBuffer Buffer>
+inline ConvertError try_wide_to_utf8(std::wstring_view wide_sv, Buffer& out) noexcept {
+    return detail::try_append_or_rollback(
+        out, [&](Buffer& buffer) { return detail::unicode_to_utf8_append(wide_sv, buffer); });
+}
+
+/**
+ * @brief gbk_to_utf16() 的不抛异常版本，结果追加到 out 末尾。
+ * @return 转换失败时返回错误信息 (字节偏移)，此时 out 保持原样。
+ */
+inline ConvertError try_gbk_to_utf16(std::string_view gbk_sv, std::u16string& out) noexcept {
+    return detail::try_append_or_rollback(
+        out, [&](std::u16string& buffer) { return detail::gbk_to_unicode_append(gbk_sv, buffer); });
+}
+
+/**
+ * @brief gbk_to_wide() 的不抛异常版本，结果追加到 out 末尾。
+ * @return 转换失败时返回错误信息 (字节偏移)，此时 out 保持原样。
+ */
+inline ConvertError try_gbk_to_wide(std::string_view gbk_sv, std::wstring& out) noexcept {
+    return detail::try_append_or_rollback(
+        out, [&](std::wstring& buffer) { return detail::gbk_to_unicode_append(gbk_sv, buffer); });
+}
+
+// ========== 流式转换接口 ==========
+/**
+ * @class StreamTranscoder
+ * @brief 分块进行 GBK <-> UTF-8 转换的流式转换器，适合无法一次性放入内存的文件或网络流。
+ * @details
+ * 每次 feed() 只转换到最后一个完整字符为止，被块边界截断的多字节字符 (UTF-8 最多 3 字节、GBK 1 字节)
+ * 会保留到下一块再转换，因此任意切分输入得到的结果都与整体转换一致，占用的内存只与块大小有关。
+ * 输入结束后必须调用 finish()，以确认没有残留的不完整字符。
+ * 转换出错抛出异常后，需要调用 reset() 才能开始新的流。
+ */
+class StreamTranscoder {
+public:
+    /**
+     * @param from 源编码，必须是 Encoding::GBK 或 Encoding::UTF8。
+     * @param to 目标编码，必须是 Encoding::GBK 或 Encoding::UTF8，且与源编码不同。
+     * @throws std::runtime_error 如果编码组合不受支持。
+     */
+    StreamTranscoder(Encoding from, Encoding to) : converter_(from, to) {
+        if (!((from == Encoding::GBK && to == Encoding::UTF8) || (from == Encoding::UTF8 && to == Encoding::GBK))) {
+            detail::throw_runtime_error("StreamTranscoder: 仅支持 GBK 与 UTF-8 之间的转换。");
+        }
+    }
+
+    /**
+     * @brief 转换一块输入，并将已经完整的部分追加到 out 末尾。
+     * @return 追加的字节数。
+     * @throws std::runtime_error 如果输入包含无效序列或目标编码无法表示的字符。
+     */
+    template <detail::ByteBuffer Buffer>
+    size_t feed(std::string_view chunk, Buffer& out) {
+        const size_t old_size = out.size();
+        chunk = complete_tail(chunk, out);
+        if (chunk.empty()) return out.size() - old_size;
+
+        const size_t tail = from_gbk() ? detail::gbk_incomplete_tail_size(chunk.data(), chunk.size())
+                                       : detail::utf8_incomplete_tail_size(chunk.data(), chunk.size());
+        converter_.convert(chunk.substr(0, chunk.size() - tail), out);
+        std::memcpy(tail_.data(), chunk.data() + chunk.size() - tail, tail);
+        tail_size_ = tail;
+        return out.size() - old_size;
+    }
+
+    /**
+     * @brief 转换一块输入，返回其中已经完整的部分。
+     * @throws std::runtime_error 如果输入包含无效序列或目标编码无法表示的字符。
+     */
+    std::string feed(std::string_view chunk) {
+        std::string result;
+        feed(chunk, result);
+        return result;
+    }
+
+    /**
+     * @brief 结束当前的流，并为下一个流复位状态。
+     * @throws std::runtime_error 如果输入以一个不完整的多字节字符结尾。
+     */
+    void finish() {
+        const bool truncated = tail_size_ != 0;
+        reset();
+        if (truncated) detail::throw_runtime_error("StreamTranscoder: 输入在一个不完整的多字节字符处结束。");
+    }
+
+    /**
+     * @brief 丢弃残留的不完整字符，开始新的流。
+     */
+    void reset() noexcept { tail_size_ = 0; }
+
+    /**
+     * @return 当前保留、等待下一块补全的字节数。
+     */
+    size_t pending() const noexcept { return tail_size_; }
+
+    Encoding from() const noexcept { return converter_.from(); }
+    Encoding to() const noexcept { return converter_.to(); }
+
+private:
+    bool from_gbk() const noexcept { return converter_.from() == Encoding::GBK; }
+
+    /**
+     * @brief 用 chunk 开头的字节补全上一块残留的字符并转换，返回 chunk 中剩余的部分。
+     */
+    template <detail::ByteBuffer Buffer>
+    std::string_view complete_tail(std::string_view chunk, Buffer& out) {
+        if (tail_size_ == 0) return chunk;
+
+        const auto lead = static_cast<unsigned char>(tail_[0]);
+        const size_t needed = from_gbk() ? 2 : (lead >= 0xF0) ? 4 : (lead >= 0xE0) ? 3 : 2;
+        const size_t take = std::min(needed - tail_size_, chunk.size());
+        std::memcpy(tail_.data() + tail_size_, chunk.data(), take);
+        tail_size_ += take;
+        if (tail_size_ < needed) return chunk.substr(take);
+
+        converter_.convert(std::string_view(tail_.data(), tail_size_), out);
+        tail_size_ = 0;
+        return chunk.substr(take);
+    }
+
+    Converter converter_;
+    std::array<char, 4> tail_{};
+    size_t tail_size_ = 0;
+};
+
+// ========== 预检测视图与检测缓存 ==========
+/**
+ * @class DetectedView
+ * @brief 一段输入及其检测结果。智能转换接口收到 DetectedView 时直接采用其中的结果，不再重新扫描输入。
+ * @details
+ * 同一块不可变的数据需要先后经过 is_utf8()、is_gbk()、to_utf8() 等多个接口时，只需检测一次。
+ * 与 std::string_view 一样不持有数据，调用方必须保证输入在使用期间有效且未被修改。
+ */
+class DetectedView {
+public:
+    /**
+     * @brief 检测 sv 的编码并记录结果。
+     */
+    explicit DetectedView(std::string_view sv) : DetectedView(sv, analyze_encoding(sv)) {}
+
+    /**
+     * @brief 使用已有的检测结果，不再扫描 sv；analysis 必须是对 sv 调用 analyze_encoding() 的结果。
+     */
+    DetectedView(std::string_view sv, const EncodingAnalysis& analysis) noexcept : view_(sv), analysis_(analysis) {}
+
+    std::string_view view() const noexcept { return view_; }
+    Encoding encoding() const noexcept { return analysis_.encoding; }
+    bool is_all_ascii() const noexcept { return analysis_.is_all_ascii; }
+    const EncodingAnalysis& analysis() const noexcept { return analysis_; }
+
+private:
+    std::string_view view_;
+    EncodingAnalysis analysis_;
+};
+
+/**
+ * @brief 返回预先检测出的编码，不扫描输入。
+ */
+inline Encoding detect_encoding(const DetectedView& detected) noexcept {
+    return detected.encoding();
+}
+
+/**
+ * @brief 根据预先检测的结果判断是否为 UTF-8 或 ASCII，不扫描输入。
+ */
+inline bool is_utf8(const DetectedView& detected) noexcept {
+    return detected.encoding() == Encoding::UTF8 || detected.encoding() == Encoding::ASCII;
+}
+
+/**
+ * @brief 根据预先检测的结果判断是否为 GBK 或 ASCII，不扫描输入。
+ */
+inline bool is_gbk(const DetectedView& detected) noexcept {
+    return detected.encoding() == Encoding::GBK || detected.encoding() == Encoding::ASCII;
+}
+
+/**
+ * @class DetectionCache
+ * @brief 按缓冲区身份 (地址、长度与内容抽样哈希) 缓存检测结果的小型无锁缓存，供无法传递 DetectedView 的调用方使用。
+ * @details
+ * 固定 kSlots 个槽位，按地址与长度直接映射，冲突时新结果覆盖旧结果。每个槽位是一个序列锁：
+ * 读取不加锁也不写共享内存，写入时若槽位正被其他线程写入则直接放弃缓存，因此任何调用都不会等待。
+ *
+ * 别名约定：缓存以地址与长度识别缓冲区，哈希只抽取开头、中间与结尾各 kSampleBytes 个字节。
+ * 同一地址、同样长度的缓冲区 (如池化复用的缓冲区) 换了内容而抽样字节恰好相同时，命中的是旧内容的结论。
+ * 为此，命中的结论是 ASCII、UTF-8 或 GBK (智能转换会把输入原样输出的编码) 时，先按该编码重新验证一遍，
+ * 不再成立则当作未命中重新检测，所以转换结果总是合法的目标编码；其它结论不重新验证，
+ * 它们对应的转换器本身会验证输入，但可能按过期的源编码解码。复用缓冲区前调用 clear() 可完全避免过期结论。
+ */
+class DetectionCache {
+public:
+    static constexpr size_t kSlots = 64;
+    static constexpr size_t kSampleBytes = 16;
+
+    /**
+     * @brief 查找 sv 的检测结果，未命中时检测并写入缓存。
+     */
+    DetectedView detect(std::string_view sv) {
+        const uint64_t hash = sample_hash(sv);
+        Slot& slot = slots_[slot_index(sv)];
+        EncodingAnalysis analysis;
+        if (slot.load(sv, hash, analysis) && still_holds(sv, analysis)) return DetectedView(sv, analysis);
+        analysis = analyze_encoding(sv);
+        slot.store(sv, hash, analysis, true);
+        return DetectedView(sv, analysis);
+    }
+
+    /**
+     * @brief 清空所有槽位；可与 detect() 并发调用。
+     */
+    void clear() noexcept {
+        for (Slot& slot : slots_) slot.store({}, 0, EncodingAnalysis{}, false);
+    }
+
+private:
+    class Slot {
+    public:
+        bool load(std::string_view sv, uint64_t hash, EncodingAnalysis& analysis) const noexcept {
+            const uint64_t version = version_.load(std::memory_order_acquire);
+            if (version & 1) return false;  // 正在写入
+            const bool match = data_.load(std::memory_order_relaxed) == reinterpret_cast<uintptr_t>(sv.data()) &&
+                               size_.load(std::memory_order_relaxed) == sv.size() &&
+                               hash_.load(std::memory_order_relaxed) == hash;
+            const uint64_t flags = flags_.load(std::memory_order_relaxed);
+            analysis.encoding = static_cast<Encoding>(flags >> 2);
+            analysis.is_all_ascii = flags & 2;
+            analysis.utf8_invalid_at = utf8_invalid_at_.load(std::memory_order_relaxed);
+            analysis.gbk_invalid_at = gbk_invalid_at_.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            // 版本号不变才说明读到的字段来自同一次写入
+            return match && (flags & 1) && version_.load(std::memory_order_relaxed) == version;
+        }
+
+        void store(std::string_view sv, uint64_t hash, const EncodingAnalysis& analysis, bool occupied) noexcept {
+            uint64_t version = version_.load(std::memory_order_relaxed);
+            if ((version & 1) ||
+                !version_.compare_exchange_strong(version, version + 1, std::memory_order_acquire)) {
+                return;  // 其他线程正在写这个槽位，放弃缓存即可
+            }
+            std::atomic_thread_fence(std::memory_order_release);
+            data_.store(reinterpret_cast<uintptr_t>(sv.data()), std::memory_order_relaxed);
+            size_.store(sv.size(), std::memory_order_relaxed);
+            hash_.store(hash, std::memory_order_relaxed);
+            const uint64_t flags = (static_cast<uint64_t>(analysis.encoding) << 2) |
+                                   (uint64_t{analysis.is_all_ascii} << 1) | uint64_t{occupied};
+            flags_.store(flags, std::memory_order_relaxed);
+            utf8_invalid_at_.store(analysis.utf8_invalid_at, std::memory_order_relaxed);
+            gbk_invalid_at_.store(analysis.gbk_invalid_at, std::memory_order_relaxed);
+            version_.store(version + 2, std::memory_order_release);
+        }
+
+    private:
+        std::atomic<uint64_t> version_{0};  // 奇数表示正在写入
+        std::atomic<uintptr_t> data_{0};
+        std::atomic<size_t> size_{0};
+        std::atomic<uint64_t> hash_{0};
+        std::atomic<uint64_t> flags_{0};  // (encoding << 2) | (is_all_ascii << 1) | 是否已占用
+        std::atomic<size_t> utf8_invalid_at_{0};
+        std::atomic<size_t> gbk_invalid_at_{0};
+    };
+
+    // 会让智能转换原样输出输入的结论，确认 sv 的内容仍然符合
+    static bool still_holds(std::string_view sv, const EncodingAnalysis& analysis) noexcept {
+        switch (analysis.encoding) {
+            case Encoding::ASCII: return detail::find_non_ascii(sv.data(), sv.size()) == sv.size();
+            case Encoding::UTF8: {
+                bool ascii = false;
+                return detail::validate_utf8(sv.data(), sv.size(), ascii) == detail::Utf8Status::VALID && !ascii;
+            }
+            case Encoding::GBK: return detail::is_valid_gbk(sv.data(), sv.size());
+            default: return true;
+        }
+    }
+
+    static size_t slot_index(std::string_view sv) noexcept {
+        uint64_t key = reinterpret_cast<uintptr_t>(sv.data()) ^ (static_cast<uint64_t>(sv.size()) << 32);
+        key *= 0x9E3779B97F4A7C15ull;
+        return static_cast<size_t>(key >> 58) % kSlots;
+    }
+
+    // FNV-1a，只覆盖开头、中间与结尾各 kSampleBytes 个字节
+    static uint64_t sample_hash(std::string_view sv) noexcept {
+        uint64_t hash = 0xCBF29CE484222325ull;
+        const auto mix = [&hash, sv](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) hash = (hash ^ static_cast<unsigned char>(sv[i])) * 0x100000001B3ull;
+        };
+        if (sv.size() <= 3 * kSampleBytes) {
+            mix(0, sv.size());
+            return hash;
+        }
+        const size_t middle = sv.size() / 2 - kSampleBytes / 2;
+        mix(0, kSampleBytes);
+        mix(middle, middle + kSampleBytes);
+        mix(sv.size() - kSampleBytes, sv.size());
+        return hash;
+    }
+
+    std::array<Slot, kSlots> slots_;
+};
+
+// ========== 智能转换接口 ==========
+namespace detail {
+/**
+ * @brief (内部实现) 编码无法识别时的错误信息，偏移为最后一个候选编码被否定的位置。
+ * @details 只有一个候选给出了位置时取该位置，都没有时为 npos。
+ */
+inline ConvertError unknown_encoding_error(const EncodingAnalysis& analysis) {
+    size_t offset = EncodingAnalysis::npos;
+    for (const size_t at : {analysis.utf8_invalid_at, analysis.gbk_invalid_at}) {
+        if (at != EncodingAnalysis::npos && (offset == EncodingAnalysis::npos || at > offset)) offset = at;
+    }
+    return {ConvertErrc::UNKNOWN_ENCODING, offset};
+}
+
+/**
+ * @brief (内部实现) 按已知的检测结果把 sv 转换为 UTF-8 并追加到 out。
+ */
+template <ByteBuffer Buffer>
+inline ConvertError try_detected_to_utf8_append(std::string_view sv, const EncodingAnalysis& analysis, Buffer& out) {
+    switch (analysis.encoding) {
+        case Encoding::UTF8:
+        case Encoding::ASCII:
+            record_operation(metrics::Operation::PASSTHROUGH, sv.size());
+            append_bytes(out, sv.data(), sv.size());
+            return {};
+        case Encoding::GBK: return try_gbk_to_utf8_append(sv, out);
+        case Encoding::UNKNOWN: return unknown_encoding_error(analysis);
+        default: return try_convert_append(sv, analysis.encoding, Encoding::UTF8, out);
+    }
+}
+
+/**
+ * @brief (内部实现) 按已知的检测结果把 sv 转换为 GBK 并追加到 out。
+ */
+template <ByteBuffer Buffer>
+inline ConvertError try_detected_to_gbk_append(std::string_view sv, const EncodingAnalysis& analysis, Buffer& out) {
+    switch (analysis.encoding) {
+        case Encoding::GBK:
+        case Encoding::ASCII:
+            record_operation(metrics::Operation::PASSTHROUGH, sv.size());
+            append_bytes(out, sv.data(), sv.size());
+            return {};
+        case Encoding::UTF8: return try_utf8_to_gbk_append(sv, out);
+        case Encoding::UNKNOWN: return unknown_encoding_error(analysis);
+        default: return try_convert_append(sv, analysis.encoding, Encoding::GBK, out);
+    }
+}
+
+// ---------- 检测与转换合并为一遍 ----------
+// 智能转换不先检测再转换，而是直接按最可能的源编码转换：转换器本身就会逐字节验证输入，成功时检测那一遍便可省去。
+// 只有转换失败 (输入已是目标编码、是其它编码或无效) 时才撤销输出，回到先检测再转换的路径，结果与之完全相同。
+
+/**
+ * @brief (内部实现) 合并路径的结论。
+ */
+enum class FusedOutcome {
+    CONVERTED,    // 已转换并追加到输出
+    PASSTHROUGH,  // 输入已是目标编码，尚未写入输出
+    UNDECIDED,    // 需要完整检测，输出保持原样
+};
+
+/**
+ * @brief (内部实现) 乐观解码出的 UTF-8 中是否含有检测规则会另作判定的字符：私用区字符 (Win32 的 936 代码页把 GBK 用户自定义区
+ * 解码到这里，与内置码表的结果不同) 与欧元符号 (可能来自单字节 0x80，检测时不视为 GBK)。
+ */
+inline bool has_gbk_ambiguous_chars(const char* data, size_t size) {
+    if (std::memchr(data, 0xEE, size) != nullptr) return true;  // U+E000-U+EFFF
+    return std::string_view(data, size).find("\xE2\x82\xAC") != std::string_view::npos;
+}
+
+/**
+ * @brief (内部实现) 不经检测直接转换为 UTF-8：输入是合法的 UTF-8 时直通，否则按 GBK 乐观解码。
+ */
+template <ByteBuffer Buffer>
+inline FusedOutcome fused_to_utf8_append(std::string_view sv, Buffer& out) {
+    bool is_all_ascii = true;
+    const Utf8Status status = validate_utf8(sv.data(), sv.size(), is_all_ascii);
+    if (status == Utf8Status::VALID) return FusedOutcome::PASSTHROUGH;
+    if (status == Utf8Status::INCOMPLETE_SEQUENCE) return FusedOutcome::UNDECIDED;  // 检测会视为未知编码
+    // UTF-8 通常在第一个汉字处就被否定，上面的验证几乎不读多少数据
+    const size_t mark = out.size();
+    if (!try_gbk_to_utf8_append(sv, out) && !has_gbk_ambiguous_chars(buffer_data(out) + mark, out.size() - mark)) {
+        return FusedOutcome::CONVERTED;
+    }
+    out.resize(mark);
+    return FusedOutcome::UNDECIDED;
+}
+
+/**
+ * @brief (内部实现) 不经检测直接转换为 GBK：纯 ASCII 时直通，否则按 UTF-8 乐观编码。
+ * @details 转换器严格验证 UTF-8，转换成功即说明检测也会得出 UTF-8，因此结果与先检测再转换完全一致。
+ */
+template <ByteBuffer Buffer>
+inline FusedOutcome fused_to_gbk_append(std::string_view sv, Buffer& out) {
+    const size_t ascii_len = find_non_ascii(sv.data(), sv.size());
+    if (ascii_len == sv.size()) return FusedOutcome::PASSTHROUGH;
+    const size_t mark = out.size();
+    append_bytes(out, sv.data(), ascii_len);
+    if (!try_utf8_to_gbk_append(sv.substr(ascii_len), out)) return FusedOutcome::CONVERTED;
+    out.resize(mark);
+    return FusedOutcome::UNDECIDED;
+}
+
+template <ByteBuffer Buffer>
+inline ConvertError try_to_utf8_append(std::string_view sv, Buffer& out) {
+    const OperationProbe probe(metrics::Operation::SMART_CONVERT, sv.size());
+    switch (fused_to_utf8_append(sv, out)) {
+        case FusedOutcome::CONVERTED: return {};
+        case FusedOutcome::PASSTHROUGH:
+            record_operation(metrics::Operation::PASSTHROUGH, sv.size());
+            append_bytes(out, sv.data(), sv.size());
+            return {};
+        case FusedOutcome::UNDECIDED: break;
+    }
+    return try_detected_to_utf8_append(sv, analyze_encoding(sv), out);
+}
+
+template <ByteBuffer Buffer>
+inline ConvertError try_to_utf8_append(const DetectedView& detected, Buffer& out) {
+    const OperationProbe probe(metrics::Operation::SMART_CONVERT, detected.view().size());
+    return try_detected_to_utf8_append(detected.view(), detected.analysis(), out);
+}
+
+template <ByteBuffer Buffer>
+inline ConvertError try_to_gbk_append(std::string_view sv, Buffer& out) {
+    const OperationProbe probe(metrics::Operation::SMART_CONVERT, sv.size());
+    switch (fused_to_gbk_append(sv, out)) {
+        case FusedOutcome::CONVERTED: return {};
+        case FusedOutcome::PASSTHROUGH:
+            record_operation(metrics::Operation::PASSTHROUGH, sv.size());
+            append_bytes(out, sv.data(), sv.size());
+            return {};
+        case FusedOutcome::UNDECIDED: break;
+    }
+    return try_detected_to_gbk_append(sv, analyze_encoding(sv), out);
+}
+
+template <ByteBuffer Buffer>
+inline ConvertError try_to_gbk_append(const DetectedView& detected, Buffer& out) {
+    const OperationProbe probe(metrics::Operation::SMART_CONVERT, detected.view().size());
+    return try_detected_to_gbk_append(detected.view(), detected.analysis(), out);
+}
+
+template <ByteBuffer Buffer>
+inline void to_utf8_append(std::string_view sv, Buffer& out) {
+    if (const ConvertError error = try_to_utf8_append(sv, out)) throw_convert_error("to_utf8", error);
+}
+
+template <ByteBuffer Buffer>
+inline void to_utf8_append(const DetectedView& detected, Buffer& out) {
+    if (const ConvertError error = try_to_utf8_append(detected, out)) throw_convert_error("to_utf8", error);
+}
+
+template <ByteBuffer Buffer>
+inline void to_gbk_append(std::string_view sv, Buffer& out) {
+    if (const ConvertError error = try_to_gbk_append(sv, out)) throw_convert_error("to_gbk", error);
+}
+
+template <ByteBuffer Buffer>
+inline void to_gbk_append(const DetectedView& detected, Buffer& out) {
+    if (const ConvertError error = try_to_gbk_append(detected, out)) throw_convert_error("to_gbk", error);
+}
+}  // namespace detail
+
+/**
+ * @brief (智能转换) 将字符串转换为 UTF-8 编码。
+ * @details
+ * - 如果输入已经是 UTF-8 或 ASCII，则直接返回其拷贝。
+ * - 如果输入是 GBK、GB18030 或带 BOM 的 UTF-16，则执行转换 (Big5 需用 detect_encoding_with_big5() 识别后交给 convert())。
+ * - 如果输入是 UNKNOWN，则抛出 std::runtime_error。
+ * @param sv 输入的字符串视图。
+ * @return 转换为 UTF-8 编码的字符串。
+ * @throws std::runtime_error 如果输入编码未知或转换失败。
+ */
+inline std::string to_utf8(std::string_view sv) {
+    std::string result;
+    detail::to_utf8_append(sv, result);
+    return result;
+}
+
+/**
+ * @brief (智能转换) 将字符串转换为 UTF-8 编码，并追加到调用方提供的缓冲区末尾。
+ * @param out std::string、std::vector<char>、std::u8string 等连续字节缓冲区，转换失败时保持原样。
+ * @return 追加的字节数。
+ * @throws std::runtime_error 如果输入编码未知或转换失败。
+ */
+template <detail::ByteBuffer Buffer>
+inline size_t to_utf8(std::string_view sv, Buffer& out) {
+    return detail::append_or_rollback(out, [&](Buffer& buffer) { detail::to_utf8_append(sv, buffer); });
+}
+
+/**
+ * @brief (智能转换) 将字符串转换为 UTF-8 编码，写入调用方提供的定长缓冲区。
+ * @details 结果直接写入 out，不经过中间缓冲区。转换过程中按上界预留输出空间，out 按输入长度 (转为 GBK)
+ * 或输入长度的 3/2 (转为 UTF-8) 准备即可保证放得下。
+ * @return 写入的字节数。
+ * @throws std::system_error (std::errc::value_too_large) 如果 out 放不下，此时 out 的内容未指定。
+ * @throws std::runtime_error 如果输入编码未知或转换失败。
+ */
+inline size_t to_utf8(std::string_view sv, std::span<char> out) {
+    return detail::write_to_span(out, [&](detail::SpanBuffer& buffer) { detail::to_utf8_append(sv, buffer); });
+}
+
+/**
+ * @brief (智能转换) 将字符串转换为 GBK 编码。
+ * @details
+ * - 如果输入已经是 GBK 或 ASCII，则直接返回其拷贝。
+ * - 如果输入是 UTF-8、GB18030 或带 BOM 的 UTF-16，则执行转换 (Big5 需用 detect_encoding_with_big5() 识别后交给 convert())。
+ * - 如果输入是 UNKNOWN，则抛出 std::runtime_error。
+ * @param sv 输入的字符串视图。
+ * @return 转换为 GBK 编码的字符串。
+ * @throws std::runtime_error 如果输入编码未知或转换失败。
+ */
+inline std::string to_gbk(std::string_view sv) {
+    std::string result;
+    detail::to_gbk_append(sv, result);
+    return result;
+}
+
+/**
+ * @brief (智能转换) 将字符串转换为 GBK 编码，并追加到调用方提供的缓冲区末尾。
+ * @param out std::string、std::vector<char> 等连续字节缓冲区，转换失败时保持原样。
+ * @return 追加的字节数。
+ * @throws std::runtime_error 如果输入编码未知或转换失败。
+ */
+template <detail::ByteBuffer Buffer>
+inline size_t to_gbk(std::string_view sv, Buffer& out) {
+    return detail::append_or_rollback(out, [&](Buffer& buffer) { detail::to_gbk_append(sv, buffer); });
+}
+
+/**
+ * @brief (智能转换) 将字符串转换为 GBK 编码，写入调用方提供的定长缓冲区。
+ * @details 结果直接写入 out，不经过中间缓冲区。转换过程中按上界预留输出空间，out 按输入长度 (转为 GBK)
+ * 或输入长度的 3/2 (转为 UTF-8) 准备即可保证放得下。
+ * @return 写入的字节数。
+ * @throws std::system_error (std::errc::value_too_large) 如果 out 放不下，此时 out 的内容未指定。
+ * @throws std::runtime_error 如果输入编码未知或转换失败。
+ */
+inline size_t to_gbk(std::string_view sv, std::span<char> out) {
+    return detail::write_to_span(out, [&](detail::SpanBuffer& buffer) { detail::to_gbk_append(sv, buffer); });
+}
+
+/**
+ * @brief (智能转换) 按 DetectedView 中已有的检测结果转换为 UTF-8，不再重新检测。
+ * @throws std::runtime_error 如果输入编码未知或转换失败。
+ */
+inline std::string to_utf8(const DetectedView& detected) {
+    std::string result;
+    detail::to_utf8_append(detected, result);
+    return result;
+}
+
+/**
+ * @brief (智能转换) 按 DetectedView 中已有的检测结果转换为 GBK，不再重新检测。
+ * @throws std::runtime_error 如果输入编码未知或转换失败。
+ */
+inline std::string to_gbk(const DetectedView& detected) {
+    std::string result;
+    detail::to_gbk_append(detected, result);
+    return result;
+}
+
+/**
+ * @brief (智能转换) 将字符串转换为 UTF-8 编码，结果 (以及转换过程中的临时缓冲区) 从调用方的分配器分配。
+ * @param alloc 元素类型为 char 的分配器，例如指向 arena 的 std::pmr::polymorphic_allocator<char>。
+ * @throws std::runtime_error 如果输入编码未知或转换失败。
+ */
+template <detail::CharAllocator Allocator>
+inline detail::string_with<Allocator> to_utf8(std::string_view sv, const Allocator& alloc) {
+    detail::string_with<Allocator> result(alloc);
+    detail::to_utf8_append(sv, result);
+    return result;
+}
+
+/**
+ * @brief (智能转换) 将字符串转换为 UTF-8 编码，结果从给定的内存资源分配。
+ * @throws std::runtime_error 如果输入编码未知或转换失败。
+ */
+inline std::pmr::string to_utf8(std::string_view sv, std::pmr::memory_resource* resource) {
+    return to_utf8(sv, std::pmr::polymorphic_allocator<char>(resource));
+}
+
+/**
+ * @brief (智能转换) 将字符串转换为 GBK 编码，结果 (以及转换过程中的临时缓冲区) 从调用方的分配器分配。
+ * @param alloc 元素类型为 char 的分配器，例如指向 arena 的 std::pmr::polymorphic_allocator<char>。
+ * @throws std::runtime_error 如果输入编码未知或转换失败。
+ */
+template <detail::CharAllocator Allocator>
+inline detail::string_with<Allocator> to_gbk(std::string_view sv, const Allocator& alloc) {
+    detail::string_with<Allocator> result(alloc);
+    detail::to_gbk_append(sv, result);
+    return result;
+}
+
+/**
+ * @brief (智能转换) 将字符串转换为 GBK 编码，结果从给定的内存资源分配。
+ * @throws std::runtime_error 如果输入编码未知或转换失败。
+ */
+inline std::pmr::string to_gbk(std::string_view sv, std::pmr::memory_resource* resource) {
+    return to_gbk(sv, std::pmr::polymorphic_allocator<char>(resource));
+}
+
+// ========== 不抛异常的转换接口 ==========
+// 错误属于常态的热路径 (如逐条清洗日志) 上，异常的开销远大于转换本身，以下接口改为返回错误信息。
+// 除可能的内存分配失败 (同样作为 SYSTEM_ERROR 返回) 外，它们与对应的抛异常接口行为一致。
+
+/**
+ * @brief 将 GBK 编码的字符串转换为 UTF-8，并追加到 out 末尾，不抛出异常。
+ * @param out std::string、std::vector<char> 等连续字节缓冲区，转换失败时保持原样。
+ * @param policy 坏序列的处理策略；非 STRICT 时只可能返回 SYSTEM_ERROR。
+ * @return 错误信息，成功时 code 为 ConvertErrc::NONE；失败时 offset 为第一个出错字符在输入中的偏移。
+ */
+template <detail::ByteBuffer Buffer>
+inline ConvertError try_gbk_to_utf8(std::string_view gbk_sv, Buffer& out,
+                                    ErrorPolicy policy = ErrorPolicy::STRICT) noexcept {
+    return detail::try_append_or_rollback(
+        out, [&](Buffer& buffer) { return detail::try_gbk_to_utf8_append(gbk_sv, buffer, policy); });
+}
+
+/**
+ * @brief 将 UTF-8 编码的字符串转换为 GBK，并追加到 out 末尾，不抛出异常。
+ * @param out std::string、std::vector<char> 等连续字节缓冲区，转换失败时保持原样。
+ * @param policy 坏序列的处理策略；非 STRICT 时只可能返回 SYSTEM_ERROR。
+ * @return 错误信息，成功时 code 为 ConvertErrc::NONE；失败时 offset 为第一个出错字符在输入中的偏移。
+ */
+template <detail::ByteBuffer Buffer>
+inline ConvertError try_utf8_to_gbk(std::string_view utf8_sv, Buffer& out,
+                                    ErrorPolicy policy = ErrorPolicy::STRICT) noexcept {
+    return detail::try_append_or_rollback(
+        out, [&](Buffer& buffer) { return detail::try_utf8_to_gbk_append(utf8_sv, buffer, policy); });
+}
+
+/**
+ * @brief (智能转换) 将字符串转换为 UTF-8 编码，并追加到 out 末尾，不抛出异常。
+ * @return 错误信息；编码无法识别时为 UNKNOWN_ENCODING，offset 为最后一个候选编码被否定的位置。
+ */
+template <detail::ByteBuffer Buffer>
+inline ConvertError try_to_utf8(std::string_view sv, Buffer& out) noexcept {
+    return detail::try_append_or_rollback(out, [&](Buffer& buffer) { return detail::try_to_utf8_append(sv, buffer); });
+}
+
+/**
+ * @brief (智能转换) 将字符串转换为 GBK 编码，并追加到 out 末尾，不抛出异常。
+ * @return 错误信息；编码无法识别时为 UNKNOWN_ENCODING，offset 为最后一个候选编码被否定的位置。
+ */
+template <detail::ByteBuffer Buffer>
+inline ConvertError try_to_gbk(std::string_view sv, Buffer& out) noexcept {
+    return detail::try_append_or_rollback(out, [&](Buffer& buffer) { return detail::try_to_gbk_append(sv, buffer); });
+}
+
+/**
+ * @brief (智能转换) 按 DetectedView 中已有的检测结果转换为 UTF-8 并追加到 out 末尾，不抛出异常。
+ */
+template <detail::ByteBuffer Buffer>
+inline ConvertError try_to_utf8(const DetectedView& detected, Buffer& out) noexcept {
+    return detail::try_append_or_rollback(out,
+                                          [&](Buffer& buffer) { return detail::try_to_utf8_append(detected, buffer); });
+}
+
+/**
+ * @brief (智能转换) 按 DetectedView 中已有的检测结果转换为 GBK 并追加到 out 末尾，不抛出异常。
+ */
+template <detail::ByteBuffer Buffer>
+inline ConvertError try_to_gbk(const DetectedView& detected, Buffer& out) noexcept {
+    return detail::try_append_or_rollback(out,
+                                          [&](Buffer& buffer) { return detail::try_to_gbk_append(detected, buffer); });
+}
+
+#if defined(__cpp_lib_expected)
+/**
+ * @brief 将 GBK 编码的字符串转换为 UTF-8，以 std::expected 返回结果或错误信息 (需要 C++23 标准库)。
+ */
+inline std::expected<std::string, ConvertError> try_gbk_to_utf8(std::string_view gbk_sv) noexcept {
+    std::string result;
+    if (const ConvertError error = try_gbk_to_utf8(gbk_sv, result)) return std::unexpected(error);
+    return result;
+}
+
+/**
+ * @brief 将 UTF-8 编码的字符串转换为 GBK，以 std::expected 返回结果或错误信息 (需要 C++23 标准库)。
+ */
+inline std::expected<std::string, ConvertError> try_utf8_to_gbk(std::string_view utf8_sv) noexcept {
+    std::string result;
+    if (const ConvertError error = try_utf8_to_gbk(utf8_sv, result)) return std::unexpected(error);
+    return result;
+}
+
+/**
+ * @brief (智能转换) 将字符串转换为 UTF-8 编码，以 std::expected 返回结果或错误信息 (需要 C++23 标准库)。
+ */
+inline std::expected<std::string, ConvertError> try_to_utf8(std::string_view sv) noexcept {
+    std::string result;
+    if (const ConvertError error = try_to_utf8(sv, result)) return std::unexpected(error);
+    return result;
+}
+
+/**
+ * @brief (智能转换) 将字符串转换为 GBK 编码，以 std::expected 返回结果或错误信息 (需要 C++23 标准库)。
+ */
+inline std::expected<std::string, ConvertError> try_to_gbk(std::string_view sv) noexcept {
+    std::string result;
+    if (const ConvertError error = try_to_gbk(sv, result)) return std::unexpected(error);
+    return result;
+}
+#endif
+
+// ========== 免拷贝转换接口 ==========
+/**
+ * @class MaybeOwnedString
+ * @brief 要么借用输入、要么持有转换结果的字符串，供 to_utf8_view() / to_gbk_view() 返回。
+ * @details
+ * 输入已经是目标编码时只记录一个 string_view，不分配内存也不拷贝；只有真正发生转换时才持有新的 std::string。
+ * 借用状态下，调用方必须保证原始输入在结果使用期间一直有效。
+ */
+class MaybeOwnedString {
+public:
+    explicit MaybeOwnedString(std::string_view borrowed) noexcept : value_(borrowed) {}
+    explicit MaybeOwnedString(std::string owned) noexcept : value_(std::move(owned)) {}
+
+    /**
+     * @return 结果内容的视图，只在本对象 (借用状态下还包括原始输入) 有效期间可用。
+     */
+    std::string_view view() const noexcept {
+        if (const auto* owned = std::get_if<std::string>(&value_)) return *owned;
+        return std::get<std::string_view>(value_);
+    }
+    operator std::string_view() const noexcept { return view(); }
+
+    const char* data() const noexcept { return view().data(); }
+    size_t size() const noexcept { return view().size(); }
+    bool empty() const noexcept { return view().empty(); }
+
+    /**
+     * @return 结果是否只是借用了输入 (即没有发生转换)。
+     */
+    bool is_borrowed() const noexcept { return std::holds_alternative<std::string_view>(value_); }
+
+    /**
+     * @brief 取得结果的 std::string，持有状态下直接移出，借用状态下才拷贝。
+     */
+    std::string str() && {
+        if (auto* owned = std::get_if<std::string>(&value_)) return std::move(*owned);
+        return std::string(std::get<std::string_view>(value_));
+    }
+    std::string str() const& { return std::string(view()); }
+
+    friend bool operator==(const MaybeOwnedString& lhs, std::string_view rhs) noexcept { return lhs.view() == rhs; }
+
+private:
+    std::variant<std::string_view, std::string> value_;
+};
+
+namespace detail {
+inline MaybeOwnedString detected_to_utf8_view(std::string_view sv, Encoding encoding) {
+    switch (encoding) {
+        case Encoding::UTF8:
+        case Encoding::ASCII:
+            record_operation(metrics::Operation::PASSTHROUGH, sv.size());
+            return MaybeOwnedString(sv);
+        case Encoding::GBK: return MaybeOwnedString(gbk_to_utf8(sv));
+        case Encoding::UNKNOWN: throw_runtime_error("to_utf8: 输入字符串的编码无法识别。");
+        default: return MaybeOwnedString(convert(sv, encoding, Encoding::UTF8));
+    }
+}
+
+inline MaybeOwnedString detected_to_gbk_view(std::string_view sv, Encoding encoding) {
+    switch (encoding) {
+        case Encoding::GBK:
+        case Encoding::ASCII:
+            record_operation(metrics::Operation::PASSTHROUGH, sv.size());
+            return MaybeOwnedString(sv);
+        case Encoding::UTF8: return MaybeOwnedString(utf8_to_gbk(sv));
+        case Encoding::UNKNOWN: throw_runtime_error("to_gbk: 输入字符串的编码无法识别。");
+        default: return MaybeOwnedString(convert(sv, encoding, Encoding::GBK));
+    }
+}
+}  // namespace detail
+
+/**
+ * @brief (智能转换) 将字符串转换为 UTF-8 编码，输入已是 UTF-8 或 ASCII 时不做拷贝。
+ * @param sv 输入的字符串视图，结果处于借用状态时必须保持有效。
+ * @return 借用 sv 或持有转换结果的 MaybeOwnedString。
+ * @throws std::runtime_error 如果输入编码未知或转换失败。
+ */
+inline MaybeOwnedString to_utf8_view(std::string_view sv) {
+    const detail::OperationProbe probe(metrics::Operation::SMART_CONVERT, sv.size());
+    std::string result;
+    switch (detail::fused_to_utf8_append(sv, result)) {
+        case detail::FusedOutcome::CONVERTED: return MaybeOwnedString(std::move(result));
+        case detail::FusedOutcome::PASSTHROUGH:
+            detail::record_operation(metrics::Operation::PASSTHROUGH, sv.size());
+            return MaybeOwnedString(sv);
+        case detail::FusedOutcome::UNDECIDED: break;
+    }
+    return detail::detected_to_utf8_view(sv, detect_encoding(sv));
+}
+
+/**
+ * @brief (智能转换) 按 DetectedView 中已有的检测结果转换为 UTF-8，输入已是 UTF-8 或 ASCII 时既不检测也不拷贝。
+ * @throws std::runtime_error 如果输入编码未知或转换失败。
+ */
+inline MaybeOwnedString to_utf8_view(const DetectedView& detected) {
+    const detail::OperationProbe probe(metrics::Operation::SMART_CONVERT, detected.view().size());
+    return detail::detected_to_utf8_view(detected.view(), detected.encoding());
+}
+
+/**
+ * @brief (智能转换) 将字符串转换为 GBK 编码，输入已是 GBK 或 ASCII 时不做拷贝。
+ * @param sv 输入的字符串视图，结果处于借用状态时必须保持有效。
+ * @return 借用 sv 或持有转换结果的 MaybeOwnedString。
+ * @throws std::runtime_error 如果输入编码未知或转换失败。
+ */
+inline MaybeOwnedString to_gbk_view(std::string_view sv) {
+    const detail::OperationProbe probe(metrics::Operation::SMART_CONVERT, sv.size());
+    std::string result;
+    switch (detail::fused_to_gbk_append(sv, result)) {
+        case detail::FusedOutcome::CONVERTED: return MaybeOwnedString(std::move(result));
+        case detail::FusedOutcome::PASSTHROUGH:
+            detail::record_operation(metrics::Operation::PASSTHROUGH, sv.size());
+            return MaybeOwnedString(sv);
+        case detail::FusedOutcome::UNDECIDED: break;
+    }
+    return detail::detected_to_gbk_view(sv, detect_encoding(sv));
+}
+
+/**
+ * @brief (智能转换) 按 DetectedView 中已有的检测结果转换为 GBK，输入已是 GBK 或 ASCII 时既不检测也不拷贝。
+ * @throws std::runtime_error 如果输入编码未知或转换失败。
+ */
+inline MaybeOwnedString to_gbk_view(const DetectedView& detected) {
+    const detail::OperationProbe probe(metrics::Operation::SMART_CONVERT, detected.view().size());
+    return detail::detected_to_gbk_view(detected.view(), detected.encoding());
+}
+
+// ========== 批量转换接口 ==========
+/**
+ * @brief 批量转换中单个元素的结果状态。
+ */
+enum class BatchStatus {
+    OK,                 // 转换成功
+    UNKNOWN_ENCODING,   // 输入编码无法识别
+    CONVERSION_FAILED,  // 无效序列或目标编码无法表示的字符
+};
+
+/**
+ * @brief 批量转换的结果：全部输出连续存放在同一块 arena 中，第 i 个元素占 [offsets[i], offsets[i + 1])。
+ * @details 失败的元素对应一段空输出，并在 status 中记录原因；同一个对象可以反复传入以复用已分配的内存。
+ */
+struct BatchResult {
+    std::string arena;
+    std::vector<size_t> offsets;      // 元素数 + 1 个偏移，offsets[0] == 0
+    std::vector<BatchStatus> status;  // 每个元素的状态
+
+    size_t size() const noexcept { return status.size(); }
+    bool ok(size_t i) const noexcept { return status[i] == BatchStatus::OK; }
+    std::string_view operator[](size_t i) const noexcept {
+        return std::string_view(arena).substr(offsets[i], offsets[i + 1] - offsets[i]);
+    }
+
+    void clear() noexcept {
+        arena.clear();
+        offsets.clear();
+        status.clear();
+    }
+};
+
+namespace detail {
+/**
+ * @brief (内部实现) 逐个检测并转换 inputs 到 target 编码，结果追加到 out 的 arena 中，失败只记录在对应元素上。
+ */
+inline void convert_batch(std::span<const std::string_view> inputs, Encoding target, BatchResult& out) {
+    out.clear();
+    size_t total = 0;
+    for (std::string_view input : inputs) total += input.size();
+    out.arena.reserve(total);
+    out.offsets.reserve(inputs.size() + 1);
+    out.status.reserve(inputs.size());
+    out.offsets.push_back(0);
+
+    for (std::string_view input : inputs) {
+        const Encoding source = detect_encoding(input);
+        BatchStatus status = BatchStatus::OK;
+        if (source == Encoding::ASCII || source == target) {
+            out.arena.append(input);
+        } else if (source == Encoding::UNKNOWN) {
+            status = BatchStatus::UNKNOWN_ENCODING;
+        } else {
+            // 失败是批量数据里的常态，走不抛异常的实现
+            const size_t old_size = out.arena.size();
+            const ConvertError error = try_convert_append(input, source, target, out.arena);
+            if (error) {
+                out.arena.resize(old_size);
+                status = BatchStatus::CONVERSION_FAILED;
+            }
+        }
+        out.status.push_back(status);
+        out.offsets.push_back(out.arena.size());
+    }
+}
+}  // namespace detail
+
+/**
+ * @brief (智能转换) 批量将字符串转换为 UTF-8，规则与 to_utf8() 相同，但单个元素失败时不抛出异常。
+ * @details 整批共享当前线程的转换描述符，所有输出写入同一块 arena，复用 out 时稳定状态下不再分配内存。
+ * @param inputs 输入字符串视图。
+ * @param out 输出结果，原有内容会被清空。
+ */
+inline void to_utf8_batch(std::span<const std::string_view> inputs, BatchResult& out) {
+    detail::convert_batch(inputs, Encoding::UTF8, out);
+}
+
+inline BatchResult to_utf8_batch(std::span<const std::string_view> inputs) {
+    BatchResult result;
+    to_utf8_batch(inputs, result);
+    return result;
+}
+
+/**
+ * @brief (智能转换) 批量将字符串转换为 GBK，规则与 to_gbk() 相同，但单个元素失败时不抛出异常。
+ * @details 整批共享当前线程的转换描述符，所有输出写入同一块 arena，复用 out 时稳定状态下不再分配内存。
+ * @param inputs 输入字符串视图。
+ * @param out 输出结果，原有内容会被清空。
+ */
+inline void to_gbk_batch(std::span<const std::string_view> inputs, BatchResult& out) {
+    detail::convert_batch(inputs, Encoding::GBK, out);
+}
+
+inline BatchResult to_gbk_batch(std::span<const std::string_view> inputs) {
+    BatchResult result;
+    to_gbk_batch(inputs, result);
+    return result;
+}
+
+// ========== 并行接口 ==========
+/**
+ * @brief 并行检测与转换的参数。
+ */
+struct ParallelOptions {
+    unsigned threads = 0;                 // 线程数，0 表示使用 std::thread::hardware_concurrency()
+    size_t min_chunk_size = 1024 * 1024;  // 每个线程至少处理的字节数，输入较小时不会拆分
+};
+
+namespace detail {
+/**
+ * @brief (内部实现) 按 options 将 [0, size) 大致等分，每个切分点都向后移动到第一个满足 is_boundary 的位置。
+ * @return 升序的切分点，首尾分别为 0 与 size；找不到合适边界时块数会少于预期。
+ */
+template <typename IsBoundary>
+inline std::vector<size_t> split_at_boundaries(size_t size, const ParallelOptions& options, IsBoundary is_boundary) {
+    size_t parts = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+    parts = std::min(parts, std::max<size_t>(size / std::max<size_t>(options.min_chunk_size, 1), 1));
+
+    std::vector<size_t> cuts = {0};
+    for (size_t k = 1; k < parts; ++k) {
+        size_t pos = std::max(size / parts * k, cuts.back() + 1);
+        while (pos < size && !is_boundary(pos)) ++pos;
+        if (pos >= size) break;
+        cuts.push_back(pos);
+    }
+    cuts.push_back(size);
+    return cuts;
+}
+
+/**
+ * @brief (内部实现) 为每个块各启动一个线程执行 task(块序号)，第 0 块在调用线程上执行。
+ * @details 无法再创建线程时，其余的块在调用线程上依次执行。所有线程结束后，按块的顺序重新抛出第一个异常。
+ */
+template <typename Task>
+inline void run_chunks_in_parallel(size_t chunks, Task task) {
+    std::vector<std::exception_ptr> errors(chunks);
+    auto guarded = [&](size_t k) {
+        try {
+            task(k);
+        } catch (...) {
+            errors[k] = std::current_exception();
+        }
+    };
+    std::vector<std::thread> workers;
+    workers.reserve(chunks > 0 ? chunks - 1 : 0);
+    size_t started = 1;
+    try {
+        for (; started < chunks; ++started) workers.emplace_back(guarded, started);
+    } catch (...) {
+        // 已启动的线程仍在运行，不能让 workers 在可 join 状态下析构
+    }
+    if (chunks > 0) guarded(0);
+    for (size_t k = started; k < chunks; ++k) guarded(k);
+    for (std::thread& worker : workers) worker.join();
+    for (const std::exception_ptr& error : errors) {
+        if (error) std::rethrow_exception(error);
+    }
+}
+
+/**
+ * @brief (内部实现) 在字符边界处切分后并行转换，再按顺序拼接结果。
+ * @details 各块用不抛异常的 try_convert 转换；按顺序取第一个出错的块，把偏移换算为相对整个输入后再抛出，
+ * 使异常信息与单线程转换相同。除最后一块外，块尾的截断序列在整个输入中是被下一块的字节打断的，按无效序列报告。
+ * @param where 异常信息的前缀，与单线程版本一致。
+ */
+template <typename TryConvert, typename IsBoundary>
+inline std::string convert_in_parallel(std::string_view input, const ParallelOptions& options, const char* where,
+                                       TryConvert try_convert, IsBoundary is_boundary) {
+    const std::vector<size_t> cuts = split_at_boundaries(input.size(), options, is_boundary);
+    const size_t chunks = cuts.size() - 1;
+    if (chunks <= 1) {
+        std::string result;
+        const ConvertError error = try_convert(input, result);
+        if (error) throw_convert_error(where, error);
+        return result;
+    }
+
+    std::vector<std::string> parts(chunks);
+    std::vector<ConvertError> errors(chunks);
+    run_chunks_in_parallel(chunks, [&](size_t k) {
+        errors[k] = try_convert(input.substr(cuts[k], cuts[k + 1] - cuts[k]), parts[k]);
+    });
+    for (size_t k = 0; k < chunks; ++k) {
+        ConvertError error = errors[k];
+        if (!error) continue;
+        if (error.offset != ConvertError::npos) error.offset += cuts[k];
+        if (error.code == ConvertErrc::INCOMPLETE_SEQUENCE && k + 1 < chunks) {
+            error.code = ConvertErrc::INVALID_SEQUENCE;
+        }
+        throw_convert_error(where, error);
+    }
+
+    size_t total = 0;
+    for (const std::string& part : parts) total += part.size();
+    std::string result = std::move(parts[0]);
+    result.reserve(total);
+    for (size_t k = 1; k < chunks; ++k) result += parts[k];
+    return result;
+}
+}  // namespace detail
+
+/**
+ * @brief 多线程单遍检测，结果与 analyze_encoding(sv) 相同。
+ * @details
+ * 只在小于 0x40 的字节之后切分：它既不可能是 GBK 的第二字节，也不可能是 UTF-8 的后续字节，
+ * 因此每一块都从两种编码的字符边界开始，可以独立检测，再按顺序合并各块被否定的位置。
+ * 四字节的 GB18030 序列可能被切开，因此 GB18030 的判定在合并之后顺序进行。
+ * @param sv 要检测的字符串视图。
+ * @param options 线程数与最小分块大小。
+ * @return 检测结果。
+ */
+inline EncodingAnalysis analyze_encoding(std::string_view sv, const ParallelOptions& options) {
+    const auto* p = reinterpret_cast<const unsigned char*>(sv.data());
+    const std::vector<size_t> cuts =
+        detail::split_at_boundaries(sv.size(), options, [p](size_t pos) { return p[pos - 1] < 0x40; });
+    const size_t chunks = cuts.size() - 1;
+    if (chunks <= 1) return analyze_encoding(sv);
+
+    const detail::OperationProbe probe(metrics::Operation::DETECT, sv.size());
+    std::vector<EncodingAnalysis> scans(chunks);
+    detail::run_chunks_in_parallel(
+        chunks, [&](size_t k) { scans[k] = detail::analyze_candidates(sv.substr(cuts[k], cuts[k + 1] - cuts[k])); });
+
+    EncodingAnalysis result;
+    for (size_t k = 0; k < chunks; ++k) {
+        const EncodingAnalysis& part = scans[k];
+        result.is_all_ascii = result.is_all_ascii && part.is_all_ascii;
+        if (result.utf8_invalid_at == EncodingAnalysis::npos && part.utf8_invalid_at != EncodingAnalysis::npos) {
+            result.utf8_invalid_at = cuts[k] + part.utf8_invalid_at;
+        }
+        if (result.gbk_invalid_at == EncodingAnalysis::npos && part.gbk_invalid_at != EncodingAnalysis::npos) {
+            result.gbk_invalid_at = cuts[k] + part.gbk_invalid_at;
+        }
+    }
+
+    // 只有最后一块可能在多字节序列中间结束，此时被否定的位置恰好等于输入长度。
+    // GB18030 的续验只在 GBK 被否定后顺序进行
+    result.encoding = detail::resolve_encoding(sv, result);
+    return result;
+}
+
+/**
+ * @brief 多线程检测给定字节序列的编码格式，结果与 detect_encoding(sv) 相同。
+ */
+inline Encoding detect_encoding(std::string_view sv, const ParallelOptions& options) {
+    return analyze_encoding(sv, options).encoding;
+}
+
+/**
+ * @brief 多线程将 GBK 编码的字符串转换为 UTF-8，结果与 gbk_to_utf8(gbk_sv) 相同。
+ * @details 不在 0x81~0xFE 内的字节一定是某个 GBK 字符的结尾，只在这样的字节之后切分。
+ * @throws std::runtime_error 如果输入包含无效的 GBK 序列。
+ */
+inline std::string gbk_to_utf8(std::string_view gbk_sv, const ParallelOptions& options) {
+    const auto* p = reinterpret_cast<const unsigned char*>(gbk_sv.data());
+    return detail::convert_in_parallel(
+        gbk_sv, options, "gbk_to_utf8",
+        [](std::string_view chunk, std::string& out) { return detail::try_gbk_to_utf8_append(chunk, out); },
+        [p](size_t pos) { return p[pos - 1] < 0x81 || p[pos - 1] == 0xFF; });
+}
+
+/**
+ * @brief 多线程将 UTF-8 编码的字符串转换为 GBK，结果与 utf8_to_gbk(utf8_sv) 相同。
+ * @details 只在非后续字节 (即字符的首字节) 之前切分。
+ * @throws std::runtime_error 如果输入包含无效的 UTF-8 序列，或包含 GBK 无法表示的字符。
+ */
+inline std::string utf8_to_gbk(std::string_view utf8_sv, const ParallelOptions& options) {
+    const auto* p = reinterpret_cast<const unsigned char*>(utf8_sv.data());
+    return detail::convert_in_parallel(
+        utf8_sv, options, "utf8_to_gbk",
+        [](std::string_view chunk, std::string& out) { return detail::try_utf8_to_gbk_append(chunk, out); },
+        [p](size_t pos) { return (p[pos] & 0xC0) != 0x80; });
+}
+
+// ========== 文件接口 ==========
+namespace detail {
+/// 文件转换时每次交给 StreamTranscoder 的输入长度，也是累积多少输出后写一次文件
+inline constexpr size_t kFileChunkSize = 1 << 20;
+
+/**
+ * @brief (内部实现) 只读映射整个文件的 RAII 包装，空文件不建立映射。
+ * @details 映射按顺序访问的提示打开 (POSIX 上为 MADV_SEQUENTIAL，Windows 上为 FILE_FLAG_SEQUENTIAL_SCAN)，
+ * 检测与转换直接读取映射的页面，不再把文件拷贝到堆上。
+ * FIFO、设备等不是普通文件的路径报告的长度没有意义，直接拒绝；/proc 下的伪文件是普通文件但长度报告为 0，
+ * 长度为 0 的文件因此改为读到文件结尾，内容保存在堆上。
+ */
+class MappedFile {
+public:
+    explicit MappedFile(const std::filesystem::path& path) {
+#ifdef _WIN32
+        HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                  FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) fail("无法打开文件", GetLastError());
+        if (GetFileType(file) != FILE_TYPE_DISK) {
+            CloseHandle(file);
+            fail("不是普通文件", ERROR_INVALID_FUNCTION);
+        }
+        LARGE_INTEGER file_size;
+        if (!GetFileSizeEx(file, &file_size)) {
+            const DWORD error = GetLastError();
+            CloseHandle(file);
+            fail("无法获取文件大小", error);
+        }
+        size_ = static_cast<size_t>(file_size.QuadPart);
+        if (size_ > 0) {
+            HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (mapping != nullptr) {
+                data_ = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+                CloseHandle(mapping);  // 视图会保持映射对象有效
+            }
+            if (data_ == nullptr) {
+                const DWORD error = GetLastError();
+                CloseHandle(file);
+                fail("无法映射文件", error);
+            }
+            mapped_ = true;
+        }
+        CloseHandle(file);
+#else
+        // O_NONBLOCK 使打开没有写端的 FIFO 时不会阻塞，对普通文件没有影响
+        const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC | O_NONBLOCK);
+        if (fd < 0) fail("无法打开文件", errno);
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            const int error = errno;
+            ::close(fd);
+            fail("无法获取文件大小", error);
+        }
+        if (!S_ISREG(st.st_mode)) {
+            ::close(fd);
+            fail("不是普通文件", EINVAL);
+        }
+        size_ = static_cast<size_t>(st.st_size);
+        if (size_ == 0) {
+            read_to_end(fd);
+        } else {
+            void* mapped = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped == MAP_FAILED) {
+                const int error = errno;
+                ::close(fd);
+                fail("无法映射文件", error);
+            }
+            ::madvise(mapped, size_, MADV_SEQUENTIAL);
+            data_ = static_cast<const char*>(mapped);
+            mapped_ = true;
+        }
+        ::close(fd);  // 映射建立后即可关闭描述符
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile() {
+        if (!mapped_) return;
+#ifdef _WIN32
+        UnmapViewOfFile(data_);
+#else
+        ::munmap(const_cast<char*>(data_), size_);
+#endif
+    }
+
+    std::string_view view() const noexcept { return {data_, size_}; }
+
+private:
+    [[noreturn]] static void fail(const char* what, unsigned long error) {
+        throw_runtime_error(std::string("MappedFile: ") + what + "，错误码：" + std::to_string(error));
+    }
+
+#ifndef _WIN32
+    void read_to_end(int fd) {
+        char chunk[4096];
+        for (;;) {
+            const ssize_t n = ::read(fd, chunk, sizeof(chunk));
+            if (n == 0) break;
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                const int error = errno;
+                ::close(fd);
+                fail("读取文件失败", error);
+            }
+            contents_.append(chunk, static_cast<size_t>(n));
+        }
+        data_ = contents_.data();
+        size_ = contents_.size();
+    }
+#endif
+
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    bool mapped_ = false;
+    std::string contents_;  // 长度未知的文件读到的内容
+};
+
+/**
+ * @brief (内部实现) 以大块顺序写入的方式生成输出文件：内容先写入目标所在目录中新建的临时文件，
+ * commit() 时再整体替换目标文件。
+ * @details 未 commit() 就析构 (转换失败或抛出异常) 时删除临时文件，已存在的目标文件保持原样。
+ * 目标是符号链接时替换它指向的文件；目标已存在时临时文件沿用它的权限位。
+ */
+class FileWriter {
+public:
+    explicit FileWriter(const std::filesystem::path& path) {
+        std::error_code ec;
+        target_ = std::filesystem::weakly_canonical(path, ec);
+        if (ec) target_ = path;
+        // 名字已被占用时换一个后缀重试，独占创建保证不会覆盖已有的文件
+        static std::atomic<uint64_t> counter{0};
+        uint64_t seed = reinterpret_cast<uintptr_t>(&counter) ^ counter.fetch_add(1, std::memory_order_relaxed);
+        for (unsigned attempt = 0;; ++attempt) {
+            temp_ = target_;
+            temp_ += ".tmp" + std::to_string(splitmix64(seed) % 1000000);
+#ifdef _WIN32
+            handle_ = CreateFileW(temp_.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_NEW,
+                                  FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+            if (handle_ != INVALID_HANDLE_VALUE) break;
+            const unsigned long error = GetLastError();
+            if (error != ERROR_FILE_EXISTS || attempt == 16) fail("无法创建文件", error);
+#else
+            fd_ = ::open(temp_.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+            if (fd_ >= 0) break;
+            const int error = errno;
+            if (error != EEXIST || attempt == 16) fail("无法创建文件", error);
+#endif
+        }
+    }
+
+    FileWriter(const FileWriter&) = delete;
+    FileWriter& operator=(const FileWriter&) = delete;
+
+    ~FileWriter() {
+        if (committed_) return;
+#ifdef _WIN32
+        if (handle_ != INVALID_HANDLE_VALUE) CloseHandle(handle_);
+#else
+        if (fd_ >= 0) ::close(fd_);
+#endif
+        std::error_code ec;
+        std::filesystem::remove(temp_, ec);
+    }
+
+    void write(std::string_view bytes) {
+        while (!bytes.empty()) {
+#ifdef _WIN32
+            const DWORD request = static_cast<DWORD>(std::min<size_t>(bytes.size(), 1u << 30));
+            DWORD written = 0;
+            if (!WriteFile(handle_, bytes.data(), request, &written, nullptr)) fail("写入文件失败", GetLastError());
+#else
+            const ssize_t written = ::write(fd_, bytes.data(), bytes.size());
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                fail("写入文件失败", errno);
+            }
+#endif
+            bytes.remove_prefix(static_cast<size_t>(written));
+        }
+    }
+
+    /// 关闭临时文件并检查结果 (部分文件系统直到关闭时才报告写入错误)，再用它替换目标文件。
+    void commit() {
+#ifdef _WIN32
+        if (!CloseHandle(std::exchange(handle_, INVALID_HANDLE_VALUE))) fail("关闭文件失败", GetLastError());
+#else
+        struct stat st;
+        if (::stat(target_.c_str(), &st) == 0) ::fchmod(fd_, st.st_mode & 07777);
+        if (::close(std::exchange(fd_, -1)) != 0) fail("关闭文件失败", errno);
+#endif
+        std::error_code ec;
+        std::filesystem::rename(temp_, target_, ec);
+        if (ec) fail("无法替换目标文件", static_cast<unsigned long>(ec.value()));
+        committed_ = true;
+    }
+
+private:
+    [[noreturn]] static void fail(const char* what, unsigned long error) {
+        throw_runtime_error(std::string("FileWriter: ") + what + "，错误码：" + std::to_string(error));
+    }
+
+    std::filesystem::path target_;
+    std::filesystem::path temp_;
+    bool committed_ = false;
+#ifdef _WIN32
+    HANDLE handle_ = INVALID_HANDLE_VALUE;
+#else
+    int fd_ = -1;
+#endif
+};
+}  // namespace detail
+
+/**
+ * @brief 检测文件的编码，规则与 detect_encoding() 相同。
+ * @details 文件被只读映射到内存，验证器直接读取映射的页面，不会拷贝到堆上。
+ * @throws std::runtime_error 如果文件无法打开或映射，或不是普通文件。
+ */
+inline Encoding detect_file_encoding(const std::filesystem::path& path) {
+    const detail::MappedFile file(path);
+    return detect_encoding(file.view());
+}
+
+/**
+ * @brief (智能转换) 将文件转换为 target 编码后写入 dst，规则与 to_utf8() / to_gbk() 相同。
+ * @details
+ * 源文件被只读映射到内存，先整体检测编码；已是目标编码或纯 ASCII 时原样写出，否则按块交给 StreamTranscoder，
+ * 输出每积累约 1 MiB 写一次文件，内存占用与文件大小无关。
+ * 源文件是 GB18030、Big5 或 UTF-16 时整体交给 convert()，输出在内存中完整生成后再写出。
+ * @param target 目标编码，必须是 Encoding::GBK 或 Encoding::UTF8。
+ * 输出先写入 dst 所在目录中的临时文件，全部成功后才整体替换 dst。
+ * @return 写入 dst 的字节数。
+ * @throws std::runtime_error 如果文件无法读写、源文件不是普通文件、源与目标是同一个文件、编码无法识别或转换失败；
+ * 失败时已存在的 dst 保持原样，也不会留下临时文件。
+ */
+inline size_t convert_file(const std::filesystem::path& src, const std::filesystem::path& dst, Encoding target) {
+    if (target != Encoding::GBK && target != Encoding::UTF8) {
+        detail::throw_runtime_error("convert_file: 目标编码必须是 GBK 或 UTF-8。");
+    }
+    std::error_code ec;
+    if (std::filesystem::equivalent(src, dst, ec)) {
+        // Windows 上无法替换仍被映射读取的源文件，原地转换一律拒绝
+        detail::throw_runtime_error("convert_file: 源文件与目标文件不能相同。");
+    }
+
+    const detail::MappedFile input(src);
+    const std::string_view data = input.view();
+    const Encoding source = detect_encoding(data);
+    if (source == Encoding::UNKNOWN) detail::throw_runtime_error("convert_file: 输入文件的编码无法识别。");
+
+    detail::FileWriter output(dst);
+    size_t written = 0;
+    if (source == Encoding::ASCII || source == target) {
+        output.write(data);
+        written = data.size();
+    } else if (source != Encoding::GBK && source != Encoding::UTF8) {
+        const std::string converted = convert(data, source, target);
+        output.write(converted);
+        written = converted.size();
+    } else {
+        StreamTranscoder transcoder(source, target);
+        std::string buffer;
+        buffer.reserve(detail::kFileChunkSize * 2);
+        for (size_t pos = 0; pos < data.size(); pos += detail::kFileChunkSize) {
+            transcoder.feed(data.substr(pos, detail::kFileChunkSize), buffer);
+            if (buffer.size() >= detail::kFileChunkSize) {
+                output.write(buffer);
+                written += buffer.size();
+                buffer.clear();
+            }
+        }
+        transcoder.finish();
+        output.write(buffer);
+        written += buffer.size();
+    }
+    output.commit();
+    return written;
+}
+
+// ========== 批量文件转换流水线 ==========
+/**
+ * @brief transcode_files() 的单个任务：把 src 转换后写入 dst (已存在时截断)。
+ */
+struct FileTranscodeJob {
+    std::filesystem::path src;
+    std::filesystem::path dst;
+};
+
+/**
+ * @brief transcode_files() 中单个文件的结果，失败时不会留下不完整的 dst。
+ */
+struct FileTranscodeResult {
+    bool ok = false;
+    size_t bytes_read = 0;
+    size_t bytes_written = 0;
+    std::string error;  // 失败原因，与对应异常的 what() 相同
+};
+
+/**
+ * @brief transcode_files() 的选项。
+ * @details 每个线程固定持有两块输入与两块输出缓冲区，在途内存约为 threads * 2 * (chunk_size + 输出块大小)，
+ * 与文件的大小和数量无关。
+ */
+struct PipelineOptions {
+    unsigned threads = 0;                        // 同时处理的文件数，0 表示使用 std::thread::hardware_concurrency()
+    size_t chunk_size = detail::kFileChunkSize;  // 每次读取的字节数
+};
+
+namespace detail {
+#ifdef _WIN32
+using NativeFile = HANDLE;
+#else
+using NativeFile = int;
+#endif
+
+/**
+ * @brief (内部实现) 流水线使用的文件，按偏移读写 (Windows 上以重叠 I/O 方式打开)。
+ */
+class PipelineFile {
+public:
+    PipelineFile(const std::filesystem::path& path, bool for_write) {
+#ifdef _WIN32
+        handle_ = for_write ? CreateFileW(path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+                                          FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED, nullptr)
+                            : CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                          FILE_FLAG_SEQUENTIAL_SCAN | FILE_FLAG_OVERLAPPED, nullptr);
+        if (handle_ == INVALID_HANDLE_VALUE) fail(for_write ? "无法创建文件" : "无法打开文件", GetLastError());
+        LARGE_INTEGER file_size;
+        if (!for_write) {
+            if (!GetFileSizeEx(handle_, &file_size)) fail("无法获取文件大小", GetLastError());
+            size_ = static_cast<uint64_t>(file_size.QuadPart);
+        }
+#else
+        handle_ = for_write ? ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666)
+                            : ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (handle_ < 0) fail(for_write ? "无法创建文件" : "无法打开文件", errno);
+        struct stat st;
+        if (!for_write) {
+            if (::fstat(handle_, &st) != 0) fail("无法获取文件大小", errno);
+            size_ = static_cast<uint64_t>(st.st_size);
+            ::posix_fadvise(handle_, 0, 0, POSIX_FADV_SEQUENTIAL);
+        }
+#endif
+    }
+
+    PipelineFile(const PipelineFile&) = delete;
+    PipelineFile& operator=(const PipelineFile&) = delete;
+
+    ~PipelineFile() { abandon(); }
+
+    NativeFile native() const noexcept { return handle_; }
+    uint64_t size() const noexcept { return size_; }
+
+    /// 放弃并关闭文件，不检查结果，用于出错后的清理。
+    void abandon() noexcept {
+#ifdef _WIN32
+        if (handle_ != INVALID_HANDLE_VALUE) CloseHandle(std::exchange(handle_, INVALID_HANDLE_VALUE));
+#else
+        if (handle_ >= 0) ::close(std::exchange(handle_, -1));
+#endif
+    }
+
+    /// 关闭文件并检查结果，部分文件系统直到关闭时才报告写入错误。
+    void close() {
+#ifdef _WIN32
+        if (!CloseHandle(std::exchange(handle_, INVALID_HANDLE_VALUE))) fail("关闭文件失败", GetLastError());
+#else
+        if (::close(std::exchange(handle_, -1)) != 0) fail("关闭文件失败", errno);
+#endif
+    }
+
+private:
+    [[noreturn]] void fail(const char* what, unsigned long error) {
+        abandon();
+        throw_runtime_error(std::string("transcode_files: ") + what + "，错误码：" + std::to_string(error));
+    }
+
+#ifdef _WIN32
+    HANDLE handle_ = INVALID_HANDLE_VALUE;
+#else
+    int handle_ = -1;
+#endif
+    uint64_t size_ = 0;
+};
+
+#if defined(ENCODING_UTIL_IO_URING)
+/**
+ * @brief (内部实现) 不依赖 liburing 的最小 io_uring 封装，只提交 readv / writev (内核 5.1 起支持) 并收割完成事件。
+ * @details 只由一个线程使用：提交队列的 tail 与完成队列的 head 只有本线程写入，另一端由内核写入，按 acquire / release 访问。
+ */
+class IoUring {
+public:
+    IoUring() = default;
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+    ~IoUring() { release(); }
+
+    /**
+     * @brief 建立容量为 entries 的环；内核不支持或被 seccomp 等禁用时返回 false，调用方应改用同步 I/O。
+     */
+    bool setup(unsigned entries) noexcept {
+        io_uring_params params{};
+        const long fd = ::syscall(__NR_io_uring_setup, entries, &params);
+        if (fd < 0) return false;
+        fd_ = static_cast<int>(fd);
+        sq_entries_ = params.sq_entries;
+
+        sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+#ifdef IORING_FEAT_SINGLE_MMAP
+        const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+#else
+        const bool single_mmap = false;  // 5.4 之前的头文件没有这个特性位，分别映射两个环
+#endif
+        if (single_mmap) sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+        sq_ring_ = map(sq_ring_size_, IORING_OFF_SQ_RING);
+        cq_ring_ = single_mmap ? sq_ring_ : map(cq_ring_size_, IORING_OFF_CQ_RING);
+        sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+        void* sqes = map(sqes_size_, IORING_OFF_SQES);
+        if (sq_ring_ == MAP_FAILED || cq_ring_ == MAP_FAILED || sqes == MAP_FAILED) {
+            if (sqes != MAP_FAILED) ::munmap(sqes, sqes_size_);
+            release();
+            return false;
+        }
+        sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+        char* const sq = static_cast<char*>(sq_ring_);
+        sq_head_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        char* const cq = static_cast<char*>(cq_ring_);
+        cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        return true;
+    }
+
+    bool ready() const noexcept { return fd_ >= 0; }
+
+    /**
+     * @brief 提交一个 readv / writev 请求，iov 在完成前必须保持有效。
+     * @return 是否已交给内核；失败时请求没有进入队列，调用方可直接改用同步 I/O。
+     */
+    bool submit(uint64_t user_data, bool write, int fd, const iovec* iov, uint64_t offset) noexcept {
+        const unsigned tail = *sq_tail_;
+        if (tail - std::atomic_ref<unsigned>(*sq_head_).load(std::memory_order_acquire) >= sq_entries_) return false;
+        const unsigned index = tail & sq_mask_;
+        io_uring_sqe& sqe = sqes_[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = write ? IORING_OP_WRITEV : IORING_OP_READV;
+        sqe.fd = fd;
+        sqe.addr = reinterpret_cast<uint64_t>(iov);
+        sqe.len = 1;
+        sqe.off = offset;
+        sqe.user_data = user_data;
+        sq_array_[index] = index;
+        std::atomic_ref<unsigned>(*sq_tail_).store(tail + 1, std::memory_order_release);
+        long submitted;
+        do {
+            submitted = ::syscall(__NR_io_uring_enter, fd_, 1, 0, 0, nullptr, 0);
+        } while (submitted < 0 && errno == EINTR);
+        if (submitted == 1) return true;
+        // 内核没有取走这一项 (出错时它在读取队列之前返回)，撤回 tail 以免之后被当作新请求提交
+        std::atomic_ref<unsigned>(*sq_tail_).store(tail, std::memory_order_release);
+        return false;
+    }
+
+    /**
+     * @brief 等待并取出一个完成事件。
+     * @return 是否成功；只有在环本身出错时才返回 false。
+     */
+    bool wait(uint64_t& user_data, int& res) noexcept {
+        while (true) {
+            const unsigned head = *cq_head_;
+            if (head != std::atomic_ref<unsigned>(*cq_tail_).load(std::memory_order_acquire)) {
+                const io_uring_cqe& cqe = cqes_[head & cq_mask_];
+                user_data = cqe.user_data;
+                res = cqe.res;
+                std::atomic_ref<unsigned>(*cq_head_).store(head + 1, std::memory_order_release);
+                return true;
+            }
+            if (::syscall(__NR_io_uring_enter, fd_, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 && errno != EINTR) {
+                return false;
+            }
+        }
+    }
+
+private:
+    void* map(size_t size, off_t offset) const noexcept {
+        return ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, offset);
+    }
+
+    void release() noexcept {
+        if (cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_) ::munmap(cq_ring_, cq_ring_size_);
+        if (sq_ring_ != MAP_FAILED) ::munmap(sq_ring_, sq_ring_size_);
+        if (sqes_ != nullptr) ::munmap(sqes_, sqes_size_);
+        if (fd_ >= 0) ::close(fd_);
+        sq_ring_ = cq_ring_ = MAP_FAILED;
+        sqes_ = nullptr;
+        fd_ = -1;
+    }
+
+    int fd_ = -1;
+    unsigned sq_entries_ = 0;
+    void* sq_ring_ = MAP_FAILED;
+    void* cq_ring_ = MAP_FAILED;
+    size_t sq_ring_size_ = 0, cq_ring_size_ = 0, sqes_size_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    unsigned *sq_head_ = nullptr, *sq_tail_ = nullptr, *sq_array_ = nullptr;
+    unsigned *cq_head_ = nullptr, *cq_tail_ = nullptr;
+    unsigned sq_mask_ = 0, cq_mask_ = 0;
+    io_uring_cqe* cqes_ = nullptr;
+};
+#endif  // defined(ENCODING_UTIL_IO_URING)
+
+/**
+ * @brief (内部实现) 每个工作线程独占的异步 I/O 队列，按槽位管理请求，每个槽位同一时刻最多一个请求。
+ * @details
+ * Linux 上定义了 ENCODING_UTIL_USE_IO_URING 时优先使用 io_uring；Windows 上使用重叠 I/O；
+ * 其它平台，或 io_uring 未启用、不可用 (内核过旧、被 seccomp 禁用) 时，
+ * start() 直接以 pread / pwrite 同步完成，流水线退化为逐块读写，但多个文件仍由线程池并行处理。
+ * 请求只完成一部分时 (如被信号打断)，剩余部分在 finish() 中同步补齐。
+ */
+class AsyncIoQueue {
+public:
+    static constexpr unsigned kSlots = 4;
+
+    AsyncIoQueue() {
+#ifdef _WIN32
+        for (Request& request : requests_) {
+            request.overlapped.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+            if (request.overlapped.hEvent == nullptr) {
+                const DWORD error = GetLastError();
+                close_events();
+                throw_runtime_error("transcode_files: 无法创建事件对象，错误码：" + std::to_string(error));
+            }
+        }
+#elif defined(ENCODING_UTIL_IO_URING)
+        ring_.setup(kSlots);
+#endif
+    }
+
+    AsyncIoQueue(const AsyncIoQueue&) = delete;
+    AsyncIoQueue& operator=(const AsyncIoQueue&) = delete;
+
+    ~AsyncIoQueue() {
+        drain();
+#ifdef _WIN32
+        close_events();
+#endif
+    }
+
+    /**
+     * @brief 是否真正异步 (io_uring 或重叠 I/O)。
+     */
+    bool is_async() const noexcept {
+#ifdef _WIN32
+        return true;
+#elif defined(ENCODING_UTIL_IO_URING)
+        return ring_.ready();
+#else
+        return false;
+#endif
+    }
+
+    /**
+     * @brief 在 slot 上开始读取或写入 [offset, offset + size)，data 在 finish(slot) 返回前必须保持有效。
+     */
+    void start(unsigned slot, NativeFile file, char* data, size_t size, uint64_t offset, bool write) noexcept {
+        Request& request = requests_[slot];
+        request.file = file;
+        request.data = data;
+        request.size = size;
+        request.offset = offset;
+        request.write = write;
+        request.transferred = 0;
+        request.error = 0;
+        request.pending = true;
+#ifdef _WIN32
+        request.completed = !issue(request);
+#else
+        request.completed = true;
+    #if defined(ENCODING_UTIL_IO_URING)
+        if (ring_.ready()) {
+            request.iov = {data, size};
+            if (ring_.submit(slot, write, file, &request.iov, offset)) request.completed = false;
+        }
+    #endif
+        if (request.completed) transfer_sync(request);
+#endif
+    }
+
+    /**
+     * @brief 等待 slot 上的请求完成。
+     * @return 实际传输的字节数；读取时小于请求长度表示到达文件末尾。
+     * @throws std::runtime_error 如果读写出错，或写入不完整。
+     */
+    size_t finish(unsigned slot) {
+        Request& request = requests_[slot];
+        wait_for(request);
+        request.pending = false;
+        if (request.error != 0) {
+            throw_runtime_error(std::string("transcode_files: ") + (request.write ? "写入文件失败" : "读取文件失败") +
+                                "，错误码：" + std::to_string(request.error));
+        }
+        if (request.write && request.transferred != request.size) {
+            throw_runtime_error("transcode_files: 写入文件失败，写入的字节数不完整。");
+        }
+        return request.transferred;
+    }
+
+    /**
+     * @brief 等待所有未完成的请求结束并忽略其结果，在出错后释放缓冲区之前调用。
+     */
+    void drain() noexcept {
+        for (Request& request : requests_) {
+            if (!request.pending) continue;
+            wait_for(request);
+            request.pending = false;
+        }
+    }
+
+private:
+    struct Request {
+        NativeFile file{};
+        char* data = nullptr;
+        size_t size = 0;
+        uint64_t offset = 0;
+        size_t transferred = 0;
+        unsigned long error = 0;
+        bool write = false;
+        bool pending = false;    // 已开始、尚未被 finish() / drain() 取走
+        bool completed = false;  // 内核或系统已经完成
+#ifdef _WIN32
+        OVERLAPPED overlapped{};
+#else
+        iovec iov{};
+#endif
+    };
+
+#ifdef _WIN32
+    /**
+     * @brief 为 request 剩余的部分发起一次重叠读写，返回是否已在进行中 (否则 request 已带着错误结束)。
+     */
+    static bool issue(Request& request) noexcept {
+        const uint64_t offset = request.offset + request.transferred;
+        request.overlapped.Offset = static_cast<DWORD>(offset);
+        request.overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+        const DWORD size = static_cast<DWORD>(std::min<size_t>(request.size - request.transferred, 1u << 30));
+        char* const data = request.data + request.transferred;
+        const BOOL ok = request.write ? WriteFile(request.file, data, size, nullptr, &request.overlapped)
+                                      : ReadFile(request.file, data, size, nullptr, &request.overlapped);
+        if (ok) return true;
+        const DWORD error = GetLastError();
+        if (error == ERROR_IO_PENDING) return true;
+        if (error != ERROR_HANDLE_EOF) request.error = error;
+        return false;
+    }
+
+    void wait_for(Request& request) noexcept {
+        while (!request.completed) {
+            DWORD transferred = 0;
+            if (!GetOverlappedResult(request.file, &request.overlapped, &transferred, TRUE)) {
+                const DWORD error = GetLastError();
+                if (error != ERROR_HANDLE_EOF) request.error = error;
+                request.completed = true;
+                break;
+            }
+            request.transferred += transferred;
+            // 一次没有传完 (单次最多 1 GiB) 时接着发起剩余部分
+            if (transferred == 0 || request.transferred == request.size || !issue(request)) request.completed = true;
+        }
+    }
+
+    void close_events() noexcept {
+        for (Request& request : requests_) {
+            if (request.overlapped.hEvent != nullptr) CloseHandle(std::exchange(request.overlapped.hEvent, nullptr));
+        }
+    }
+#else
+    /**
+     * @brief 以 pread / pwrite 同步完成 request 剩余的部分。
+     */
+    static void transfer_sync(Request& request) noexcept {
+        while (request.transferred < request.size) {
+            char* const data = request.data + request.transferred;
+            const size_t size = request.size - request.transferred;
+            const off_t offset = static_cast<off_t>(request.offset + request.transferred);
+            const ssize_t n = request.write ? ::pwrite(request.file, data, size, offset)
+                                            : ::pread(request.file, data, size, offset);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                request.error = static_cast<unsigned long>(errno);
+                return;
+            }
+            if (n == 0) return;  // 读到文件末尾
+            request.transferred += static_cast<size_t>(n);
+        }
+    }
+
+    void wait_for(Request& request) noexcept {
+    #if defined(ENCODING_UTIL_IO_URING)
+        while (!request.completed) {
+            uint64_t slot = 0;
+            int res = 0;
+            if (!ring_.wait(slot, res)) {
+                // 环本身出错时无法再确认内核是否还在使用缓冲区，只能结束进程而不是冒险释放
+                std::terminate();
+            }
+            Request& done = requests_[slot];
+            done.completed = true;
+            // 出错 (包括内核不支持该操作) 时用同步 I/O 重做一遍：真正的错误会在那里得到 errno
+            if (res > 0) done.transferred = static_cast<size_t>(res);
+            if (res < 0 || (res > 0 && done.transferred < done.size)) transfer_sync(done);
+        }
+    #else
+        (void)request;
+    #endif
+    }
+#endif
+
+    std::array<Request, kSlots> requests_{};
+#if defined(ENCODING_UTIL_IO_URING)
+    IoUring ring_;
+#endif
+};
+
+/**
+ * @brief (内部实现) 以双缓冲流水线转换一个文件：读取第 k+1 块、转换第 k 块、写出第 k-1 块同时进行。
+ * @details 槽位 0/1 用于两块输入，2/3 用于两块输出；buffers 在同一线程处理的文件之间复用。
+ */
+inline void transcode_file_pipelined(const FileTranscodeJob& job, Encoding from, Encoding to, size_t chunk_size,
+                                     AsyncIoQueue& io, std::array<std::string, 4>& buffers,
+                                     FileTranscodeResult& result) {
+    std::error_code ec;
+    if (std::filesystem::equivalent(job.src, job.dst, ec)) {
+        throw_runtime_error("transcode_files: 源文件与目标文件不能相同。");
+    }
+    PipelineFile input(job.src, false);
+    PipelineFile output(job.dst, true);
+    try {
+        StreamTranscoder transcoder(from, to);
+        const uint64_t size = input.size();
+        const auto chunk_at = [&](uint64_t pos) {
+            return static_cast<size_t>(std::min<uint64_t>(chunk_size, size - pos));
+        };
+        for (unsigned k = 0; k < 2; ++k) buffers[k].resize(chunk_size);
+
+        bool writing[2] = {false, false};
+        uint64_t read_pos = 0, write_pos = 0;
+        if (size > 0) io.start(0, input.native(), buffers[0].data(), chunk_at(0), 0, false);
+        for (unsigned k = 0; read_pos < size; ++k) {
+            const unsigned cur = k & 1;
+            const size_t length = chunk_at(read_pos);
+            if (io.finish(cur) != length) throw_runtime_error("transcode_files: 源文件在转换过程中被截断。");
+            const uint64_t next = read_pos + length;
+            if (next < size) io.start(cur ^ 1, input.native(), buffers[cur ^ 1].data(), chunk_at(next), next, false);
+
+            std::string& out = buffers[2 + cur];
+            if (std::exchange(writing[cur], false)) io.finish(2 + cur);  // 两块之前的输出已写完，缓冲区可以复用
+            out.clear();
+            transcoder.feed(std::string_view(buffers[cur].data(), length), out);
+            if (!out.empty()) {
+                io.start(2 + cur, output.native(), out.data(), out.size(), write_pos, true);
+                writing[cur] = true;
+                write_pos += out.size();
+            }
+            read_pos = next;
+        }
+        transcoder.finish();
+        for (unsigned cur = 0; cur < 2; ++cur) {
+            if (std::exchange(writing[cur], false)) io.finish(2 + cur);
+        }
+        output.close();
+        result.bytes_read = static_cast<size_t>(size);
+        result.bytes_written = static_cast<size_t>(write_pos);
+    } catch (...) {
+        io.drain();
+        output.abandon();
+        std::filesystem::remove(job.dst, ec);
+        throw;
+    }
+}
+}  // namespace detail
+
+/**
+ * @brief 以流水线方式批量转换文件：每个线程处理一个文件，读取、转换与写入三者重叠进行。
+ * @details
+ * 每个文件按 chunk_size 分块交给 StreamTranscoder，下一块的读取与上一块的写入在当前块转换期间由内核完成
+ * (Linux 上定义 ENCODING_UTIL_USE_IO_URING 时使用 io_uring，Windows 上使用重叠 I/O；其它情况退回到同步的 pread / pwrite)。
+ * 与 convert_file() 不同，源编码由调用方给出而不做检测，因此整个文件只读一遍，适合已知编码的归档批量转换。
+ * @param from 源编码，必须是 Encoding::GBK 或 Encoding::UTF8。
+ * @param to 目标编码，必须是 Encoding::GBK 或 Encoding::UTF8，且与源编码不同。
+ * @return 与 jobs 一一对应的结果；单个文件失败只记录在其结果中，不影响其它文件。
+ * @throws std::runtime_error 如果编码组合不受支持。
+ */
+inline std::vector<FileTranscodeResult> transcode_files(std::span<const FileTranscodeJob> jobs, Encoding from,
+                                                        Encoding to, const PipelineOptions& options = {}) {
+    StreamTranscoder(from, to);  // 提前检查编码组合
+    std::vector<FileTranscodeResult> results(jobs.size());
+    const size_t chunk_size = std::max<size_t>(options.chunk_size, 1);
+    size_t threads = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min(threads, jobs.size());
+
+    std::atomic<size_t> next_job{0};
+    detail::run_chunks_in_parallel(threads, [&](size_t) {
+        detail::AsyncIoQueue io;
+        std::array<std::string, 4> buffers;
+        for (size_t i; (i = next_job.fetch_add(1, std::memory_order_relaxed)) < jobs.size();) {
+            FileTranscodeResult& result = results[i];
+            try {
+                detail::transcode_file_pipelined(jobs[i], from, to, chunk_size, io, buffers, result);
+                result.ok = true;
+            } catch (const std::exception& e) {
+                result.error = e.what();
+            }
+        }
+    });
+    return results;
+}
+
+// ========== C++20 u8string 兼容层 ==========
+// 仅在支持 char8_t 的情况下提供以下函数，__cplusplus 宏在 gcc 10.3 不会被定义为 202002L，故使用 __cpp_char8_t 更准确
+#if defined(__cpp_char8_t)
+
+namespace detail {
+inline std::string_view as_bytes_view(std::u8string_view u8_sv) {
+    return std::string_view(reinterpret_cast<const char*>(u8_sv.data()), u8_sv.size());
+}
+}  // namespace detail
+
+/**
+ * @brief 检测 u8string_view 中字节序列的实际编码。
+ * @details 与 detect_encoding(std::string_view) 相同；char8_t 并不保证内容真的是合法的 UTF-8。
+ * @param u8_sv 要检测的 u8string_view。
+ * @return 检测到的编码类型。
+ */
+inline Encoding detect_encoding(std::u8string_view u8_sv) {
+    return detect_encoding(detail::as_bytes_view(u8_sv));
+}
+
+/**
+ * @brief 检查一个 u8string_view 是否为有效的 UTF-8 或 ASCII 编码。
+ * @param u8_sv 要检查的 u8string_view。
+ * @return 如果是 UTF-8 或 ASCII，则为 true；否则为 false。
+ */
+inline bool is_utf8(std::u8string_view u8_sv) {
+    return is_utf8(detail::as_bytes_view(u8_sv));
+}
+
+/**
+ * @brief (智能转换) 将 C++20 u8string (UTF-8) 转换为 GBK 编码的 std::string。
+ * @param u8_sv 输入的 u8string_view。
+ * @return 转换为 GBK 编码的字符串。
+ * @throws std::runtime_error 如果转换失败。
+ */
+inline std::string to_gbk(std::u8string_view u8_sv) {
+    return utf8_to_gbk(detail::as_bytes_view(u8_sv));
+}
+
+/**
+ * @brief (智能转换) 将任意编码的字符串转换为 C++20 u8string (UTF-8)。
+ * @details
+ * - 如果输入是 GBK，则执行转换。
+ * - 如果输入是 UTF-8 或 ASCII，则直接构造 u8string。
+ * - 如果输入是 UNKNOWN，则抛出 std::runtime_error。
+ * @param sv 输入的字符串视图。
+ * @return 转换为 UTF-8 的 u8string。
+ * @throws std::runtime_error 如果输入编码未知或转换失败。
+ */
+inline std::u8string to_u8string(std::string_view sv) {
+    // 直接写入 u8string 的存储：无需转换时只拷贝一次，GBK 输入也不经过中间的 std::string
+    std::u8string result;
+    detail::to_utf8_append(sv, result);
+    return result;
+}
+
+/**
+ * @brief (智能转换) 将任意编码的字符串转换为 UTF-8，并追加到调用方提供的 u8string 末尾。
+ * @return 追加的字节数。
+ * @throws std::runtime_error 如果输入编码未知或转换失败，此时 out 保持原样。
+ */
+inline size_t to_u8string(std::string_view sv, std::u8string& out) {
+    return to_utf8(sv, out);
+}
+
+/**
+ * @brief (智能转换) 将任意编码的字符串转换为 UTF-8 的 u8string，结果从调用方的分配器分配。
+ * @param alloc 元素类型为 char8_t 的分配器，例如 std::pmr::polymorphic_allocator<char8_t>。
+ * @throws std::runtime_error 如果输入编码未知或转换失败。
+ */
+template <detail::CharAllocator<char8_t> Allocator>
+inline detail::string_with<Allocator, char8_t> to_u8string(std::string_view sv, const Allocator& alloc) {
+    detail::string_with<Allocator, char8_t> result(alloc);
+    detail::to_utf8_append(sv, result);
+    return result;
+}
+
+/**
+ * @brief (智能转换) 将任意编码的字符串转换为 UTF-8 的 std::pmr::u8string，结果从给定的内存资源分配。
+ * @throws std::runtime_error 如果输入编码未知或转换失败。
+ */
+inline std::pmr::u8string to_u8string(std::string_view sv, std::pmr::memory_resource* resource) {
+    return to_u8string(sv, std::pmr::polymorphic_allocator<char8_t>(resource));
+}
+
+/**
+ * @brief (智能转换) 将 C++20 u8string (UTF-8) 转换为 GBK，结果从调用方的分配器分配。
+ * @throws std::runtime_error 如果转换失败。
+ */
+template <detail::CharAllocator Allocator>
+inline detail::string_with<Allocator> to_gbk(std::u8string_view u8_sv, const Allocator& alloc) {
+    return utf8_to_gbk(detail::as_bytes_view(u8_sv), alloc);
+}
+
+/**
+ * @brief (智能转换) 将 C++20 u8string (UTF-8) 转换为 GBK，结果从给定的内存资源分配。
+ * @throws std::runtime_error 如果转换失败。
+ */
+inline std::pmr::string to_gbk(std::u8string_view u8_sv, std::pmr::memory_resource* resource) {
+    return utf8_to_gbk(detail::as_bytes_view(u8_sv), resource);
+}
+
+/**
+ * @brief 将 C++20 u8string (UTF-8) 转换为 UTF-16。
+ * @throws std::runtime_error 如果输入包含无效的 UTF-8 序列。
+ */
+inline std::u16string utf8_to_utf16(std::u8string_view u8_sv) {
+    return utf8_to_utf16(detail::as_bytes_view(u8_sv));
+}
+
+/**
+ * @brief 将 C++20 u8string (UTF-8) 转换为 std::wstring (Windows 上为 UTF-16，其它平台为 UTF-32)。
+ * @throws std::runtime_error 如果输入包含无效的 UTF-8 序列。
+ */
+inline std::wstring utf8_to_wide(std::u8string_view u8_sv) {
+    return utf8_to_wide(detail::as_bytes_view(u8_sv));
+}
+
+/**
+ * @brief 将 UTF-16 字符串转换为 C++20 u8string，直接写入 u8string 的存储。
+ * @throws std::runtime_error 如果输入包含孤立的代理单元。
+ */
+inline std::u8string utf16_to_u8string(std::u16string_view utf16_sv) {
+    return detail::make_or_throw<std::u8string>(
+        "utf16_to_u8string", [&](std::u8string& out) { return detail::unicode_to_utf8_append(utf16_sv, out); });
 }
 
 #endif  // defined(__cpp_char8_t)
@@ -0,0 +1,53 @@
+// EncodingUtil::encoding_util_static 的实现：把 compiled.hpp 中的声明转发到 header-only 的实现，
+// 使 SIMD 派发、码表与 iconv / Win32 后端只在这一个翻译单元中实例化。
+
+// 完整实现必须先于 compiled.hpp 包含，见 compiled.hpp 末尾的说明
+#include "encoding_util/encoding_util.hpp"
+
+#include "encoding_util/compiled.hpp"
+
+namespace encoding_util::compiled {
+
+EncodingAnalysis analyze_encoding(std::string_view sv) { return encoding_util::analyze_encoding(sv); }
+
+Encoding detect_encoding(std::string_view sv) { return encoding_util::detect_encoding(sv); }
+
+Encoding detect_encoding_with_big5(std::string_view sv) { return encoding_util::detect_encoding_with_big5(sv); }
+
+bool is_utf8(std::string_view sv) { return encoding_util::is_utf8(sv); }
+
+bool is_gbk(std::string_view sv) { return encoding_util::is_gbk(sv); }
+
+std::string gbk_to_utf8(std::string_view gbk_sv, ErrorPolicy policy) {
+    return encoding_util::gbk_to_utf8(gbk_sv, policy);
+}
+
+std::string utf8_to_gbk(std::string_view utf8_sv, ErrorPolicy policy) {
+    return encoding_util::utf8_to_gbk(utf8_sv, policy);
+}
+
+std::string convert(std::string_view input, Encoding from, Encoding to) {
+    return encoding_util::convert(input, from, to);
+}
+
+std::string to_utf8(std::string_view sv) { return encoding_util::to_utf8(sv); }
+
+std::string to_gbk(std::string_view sv) { return encoding_util::to_gbk(sv); }
+
+ConvertError try_gbk_to_utf8(std::string_view gbk_sv, std::string& out, ErrorPolicy policy) noexcept {
+    return encoding_util::try_gbk_to_utf8(gbk_sv, out, policy);
+}
+
+ConvertError try_utf8_to_gbk(std::string_view utf8_sv, std::string& out, ErrorPolicy policy) noexcept {
+    return encoding_util::try_utf8_to_gbk(utf8_sv, out, policy);
+}
+
+ConvertError try_convert(std::string_view input, Encoding from, Encoding to, std::string& out) noexcept {
+    return encoding_util::try_convert(input, from, to, out);
+}
+
+ConvertError try_to_utf8(std::string_view sv, std::string& out) noexcept { return encoding_util::try_to_utf8(sv, out); }
+
+ConvertError try_to_gbk(std::string_view sv, std::string& out) noexcept { return encoding_util::try_to_gbk(sv, out); }
+
+}  // namespace encoding_util::compiled
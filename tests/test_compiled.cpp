@@ -0,0 +1,57 @@
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <string>
+
+#include "encoding_util/compiled.hpp"
+
+// 精简头文件不能引入完整实现与平台头文件
+#if defined(ENCODING_UTIL_TARGET_AVX2) || defined(_ICONV_H) || defined(_WINDOWS_)
+    #error "compiled.hpp 不应引入 encoding_util.hpp、<iconv.h> 或 <windows.h>"
+#endif
+
+// ========== 测试数据 ==========
+const std::string gbk_hello_world = "\xc4\xe3\xba\xc3\xca\xc0\xbd\xe7";                   // "你好世界"
+const std::string utf8_hello_world = "\xe4\xbd\xa0\xe5\xa5\xbd\xe4\xb8\x96\xe7\x95\x8c";  // "你好世界"
+const std::string ascii_str = "Hello, World! 123";
+const std::string invalid_str = "\xFF\xFE\xFD";
+
+// ========== 编译版静态库测试 (Compiled Library) ==========
+TEST(CompiledLibrary, DetectsEncodings) {
+    EXPECT_TRUE(encoding_util::is_ascii(ascii_str));
+    EXPECT_FALSE(encoding_util::is_ascii(ascii_str + gbk_hello_world));
+    EXPECT_EQ(encoding_util::detect_encoding(ascii_str), encoding_util::Encoding::ASCII);
+    EXPECT_EQ(encoding_util::detect_encoding(gbk_hello_world), encoding_util::Encoding::GBK);
+    EXPECT_EQ(encoding_util::detect_encoding(utf8_hello_world), encoding_util::Encoding::UTF8);
+    EXPECT_EQ(encoding_util::detect_encoding(invalid_str), encoding_util::Encoding::UNKNOWN);
+    EXPECT_TRUE(encoding_util::is_utf8(utf8_hello_world));
+    EXPECT_TRUE(encoding_util::is_gbk(gbk_hello_world));
+
+    const encoding_util::EncodingAnalysis analysis = encoding_util::analyze_encoding(ascii_str + "\xC4");
+    EXPECT_EQ(analysis.encoding, encoding_util::Encoding::UNKNOWN);
+    EXPECT_EQ(analysis.gbk_invalid_at, ascii_str.size() + 1);
+}
+
+TEST(CompiledLibrary, ConvertsAndReportsErrors) {
+    EXPECT_EQ(encoding_util::to_utf8(gbk_hello_world), utf8_hello_world);
+    EXPECT_EQ(encoding_util::to_gbk(utf8_hello_world), gbk_hello_world);
+    EXPECT_EQ(encoding_util::gbk_to_utf8(gbk_hello_world), utf8_hello_world);
+    EXPECT_EQ(encoding_util::utf8_to_gbk(utf8_hello_world), gbk_hello_world);
+    EXPECT_EQ(encoding_util::convert(utf8_hello_world, encoding_util::Encoding::UTF8, encoding_util::Encoding::GBK),
+              gbk_hello_world);
+    EXPECT_EQ(encoding_util::gbk_to_utf8("A\xFF" "B", encoding_util::ErrorPolicy::REPLACE), "A\xEF\xBF\xBD" "B");
+    EXPECT_THROW(encoding_util::to_utf8(invalid_str), std::runtime_error);
+
+    std::string out = "prefix:";
+    EXPECT_FALSE(encoding_util::try_to_utf8(gbk_hello_world, out));
+    EXPECT_EQ(out, "prefix:" + utf8_hello_world);
+    const encoding_util::ConvertError error = encoding_util::try_gbk_to_utf8(gbk_hello_world + "\xFF", out);
+    EXPECT_EQ(error.code, encoding_util::ConvertErrc::INVALID_SEQUENCE);
+    EXPECT_EQ(error.offset, gbk_hello_world.size());
+    EXPECT_EQ(out, "prefix:" + utf8_hello_world);
+    EXPECT_EQ(encoding_util::try_to_gbk(invalid_str, out).code, encoding_util::ConvertErrc::UNKNOWN_ENCODING);
+    EXPECT_FALSE(
+        encoding_util::try_convert(ascii_str, encoding_util::Encoding::UTF8, encoding_util::Encoding::GBK, out));
+    EXPECT_FALSE(encoding_util::try_utf8_to_gbk(utf8_hello_world, out));
+    EXPECT_EQ(out, "prefix:" + utf8_hello_world + ascii_str + gbk_hello_world);
+}
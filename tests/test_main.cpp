@@ -1,5 +1,17 @@
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <memory_resource>
+#include <random>
+#include <system_error>
+#include <thread>
+
+#ifndef _WIN32
+    #include <sys/stat.h>
+#endif
+
 #include "encoding_util/encoding_util.hpp"
 
 
@@ -85,6 +97,1707 @@ TEST(LowLevelConversion, FailsOnUnrepresentableChars) {
     EXPECT_THROW(encoding_util::utf8_to_gbk(utf8_with_emoji), std::runtime_error);
 }
 
+TEST(LowLevelConversion, OutputFitsPrecomputedBound) {
+    // 各种字符按随机顺序拼接：ASCII 第二字节、欧元符号 0x80、普通汉字与 ASCII
+    const std::vector<std::string> gbk_pieces = {"\x81\x40", "\x80", "\xC4\xE3", "a", std::string(20, 'b')};
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<size_t> pick(0, gbk_pieces.size() - 1);
+    for (int round = 0; round < 200; ++round) {
+        std::string gbk;
+        const int pieces = round % 50;
+        for (int i = 0; i < pieces; ++i) gbk += gbk_pieces[pick(rng)];
+        const std::string utf8 = encoding_util::gbk_to_utf8(gbk);
+        EXPECT_LE(utf8.size(), encoding_util::detail::converted_size_bound(gbk.data(), gbk.size(), true));
+        EXPECT_LE(encoding_util::utf8_to_gbk(utf8).size(),
+                  encoding_util::detail::converted_size_bound(utf8.data(), utf8.size(), false));
+        EXPECT_EQ(encoding_util::utf8_to_gbk(utf8), gbk);
+    }
+    EXPECT_EQ(encoding_util::detail::converted_size_bound(gbk_hello_world.data(), gbk_hello_world.size(), true),
+              utf8_hello_world.size());
+}
+
+
+// ========== SIMD 验证一致性测试 (SIMD Validation Consistency) ==========
+namespace {
+
+// 由首字节、后续字节、ASCII 和非法字节组成的随机序列，能以较高概率覆盖各种合法/非法/截断的情形
+std::string make_random_utf8_like(std::mt19937& rng, size_t size) {
+    static const unsigned char kAlphabet[] = {0x00, 0x41, 0x7F, 0x80, 0x9F, 0xBF, 0xC0, 0xC1, 0xC2,
+                                              0xDF, 0xE0, 0xE4, 0xED, 0xEF, 0xF0, 0xF4, 0xF5, 0xFF};
+    std::uniform_int_distribution<size_t> pick(0, sizeof(kAlphabet) - 1);
+    std::string s(size, '\0');
+    for (auto& c : s) c = static_cast<char>(kAlphabet[pick(rng)]);
+    return s;
+}
+
+// 将全部可用的 UTF-8 验证实现与标量版本逐一比较
+void expect_all_validators_agree(const std::string& s) {
+    using encoding_util::detail::Utf8Status;
+    bool ref_ascii = false;
+    const Utf8Status ref = encoding_util::detail::validate_utf8_scalar(s.data(), s.size(), ref_ascii);
+
+    bool ascii = false;
+    EXPECT_EQ(encoding_util::detail::validate_utf8(s.data(), s.size(), ascii), ref);
+    EXPECT_EQ(ascii, ref_ascii);
+
+    std::vector<encoding_util::detail::Utf8PrefixValidator> kernels;
+#if defined(ENCODING_UTIL_SIMD_X86)
+    kernels.push_back(&encoding_util::detail::validate_utf8_prefix_sse2);
+    if (encoding_util::detail::cpu_has_avx2()) kernels.push_back(&encoding_util::detail::validate_utf8_prefix_avx2);
+#elif defined(ENCODING_UTIL_SIMD_NEON)
+    kernels.push_back(&encoding_util::detail::validate_utf8_prefix_neon);
+#endif
+    for (auto kernel : kernels) {
+        int ref_pending = 0, pending = 0;
+        bool ref_flag = true, flag = true;
+        size_t ref_pos = encoding_util::detail::validate_utf8_prefix_scalar(s.data(), s.size(), ref_pending, ref_flag);
+        EXPECT_EQ(kernel(s.data(), s.size(), pending, flag), ref_pos);
+        if (ref_pos == s.size()) {
+            EXPECT_EQ(pending, ref_pending);
+            EXPECT_EQ(flag, ref_flag);
+        }
+    }
+}
+
+}  // namespace
+
+TEST(SimdValidation, MatchesScalarOnRandomInput) {
+    std::mt19937 rng(20240601);
+    for (size_t size = 0; size < 300; ++size) {
+        for (int round = 0; round < 20; ++round) {
+            expect_all_validators_agree(make_random_utf8_like(rng, size));
+        }
+    }
+}
+
+TEST(SimdValidation, MatchesScalarOnCorruptedValidText) {
+    std::string text;
+    while (text.size() < 200) text += utf8_hello_world + ascii_str + utf8_with_emoji;
+    expect_all_validators_agree(text);
+    for (size_t i = 0; i < text.size(); ++i) {
+        expect_all_validators_agree(text.substr(0, i));  // 所有截断位置
+        for (unsigned char bad : {0x20, 0x80, 0xC0, 0xE4, 0xFF}) {
+            std::string corrupted = text;
+            corrupted[i] = static_cast<char>(bad);
+            expect_all_validators_agree(corrupted);
+        }
+    }
+}
+
+TEST(SimdValidation, LongAsciiAndUtf8Buffers) {
+    const std::string long_ascii(4096 + 7, 'a');
+    bool ascii = false;
+    EXPECT_EQ(encoding_util::detail::validate_utf8(long_ascii.data(), long_ascii.size(), ascii),
+              encoding_util::detail::Utf8Status::VALID);
+    EXPECT_TRUE(ascii);
+
+    std::string long_utf8;
+    for (int i = 0; i < 500; ++i) long_utf8 += utf8_hello_world;
+    EXPECT_EQ(encoding_util::detect_encoding(long_utf8), encoding_util::Encoding::UTF8);
+    EXPECT_EQ(encoding_util::detect_encoding(long_utf8 + incomplete_utf8), encoding_util::Encoding::UNKNOWN);
+}
+
+
+// ========== ASCII 快速跳过测试 (ASCII Fast Path) ==========
+TEST(AsciiFastPath, FindNonAsciiMatchesNaiveScan) {
+    for (size_t size = 0; size < 200; ++size) {
+        for (size_t hit = 0; hit <= size; ++hit) {
+            std::string s(size, 'x');
+            if (hit < size) s[hit] = '\x80';
+            EXPECT_EQ(encoding_util::detail::find_non_ascii(s.data(), s.size()), hit);
+            EXPECT_EQ(encoding_util::detail::find_non_ascii_scalar(s.data(), s.size()), hit);
+        }
+    }
+}
+
+TEST(AsciiFastPath, MixedAsciiAndMultibyteText) {
+    // GBK 的第二字节可能落在 ASCII 范围 ("丂" = 0x81 0x40)，ASCII 段的切分不能破坏双字节字符
+    const std::string gbk_with_ascii_trail = "\x81\x40";
+    const std::string utf8_with_ascii_trail = "\xe4\xb8\x82";
+    const std::string long_ascii(100, 'a');
+    std::string gbk, utf8;
+    for (int i = 0; i < 20; ++i) {
+        gbk += long_ascii + gbk_with_ascii_trail + gbk_hello_world + "@" + gbk_with_ascii_trail;
+        utf8 += long_ascii + utf8_with_ascii_trail + utf8_hello_world + "@" + utf8_with_ascii_trail;
+    }
+    EXPECT_EQ(encoding_util::detect_encoding(gbk), encoding_util::Encoding::GBK);
+    EXPECT_EQ(encoding_util::detect_encoding(utf8), encoding_util::Encoding::UTF8);
+    EXPECT_EQ(encoding_util::detect_encoding(long_ascii + long_ascii), encoding_util::Encoding::ASCII);
+    EXPECT_EQ(encoding_util::gbk_to_utf8(gbk), utf8);
+    EXPECT_EQ(encoding_util::utf8_to_gbk(utf8), gbk);
+    EXPECT_THROW(encoding_util::gbk_to_utf8(long_ascii + incomplete_gbk), std::runtime_error);
+    EXPECT_THROW(encoding_util::utf8_to_gbk(long_ascii + utf8_with_emoji + long_ascii), std::runtime_error);
+}
+
+
+// ========== 单遍联合检测测试 (Fused Single-Pass Detection) ==========
+namespace {
+
+// 旧的多遍检测逻辑 (各编码的标量验证器依次判定)，作为参照
+encoding_util::Encoding two_pass_detect(const std::string& s) {
+    using encoding_util::Encoding;
+    using encoding_util::detail::Utf8Status;
+    bool ascii = false;
+    switch (encoding_util::detail::validate_utf8_scalar(s.data(), s.size(), ascii)) {
+        case Utf8Status::VALID: return ascii ? Encoding::ASCII : Encoding::UTF8;
+        case Utf8Status::INCOMPLETE_SEQUENCE: return Encoding::UNKNOWN;
+        case Utf8Status::INVALID_SEQUENCE: break;
+    }
+    if (const Encoding bom = encoding_util::detail::utf16_bom_encoding(s); bom != Encoding::UNKNOWN) return bom;
+    if (encoding_util::detail::is_valid_gbk(s.data(), s.size())) return Encoding::GBK;
+    int pending = 0;
+    if (encoding_util::detail::validate_gb18030_prefix_scalar(s.data(), s.size(), pending) == s.size() &&
+        pending == 0) {
+        return Encoding::GB18030;
+    }
+    return Encoding::UNKNOWN;
+}
+
+void expect_analysis_matches_reference(const std::string& s) {
+    const encoding_util::EncodingAnalysis analysis = encoding_util::analyze_encoding(s);
+    EXPECT_EQ(analysis.encoding, two_pass_detect(s));
+    EXPECT_EQ(encoding_util::detect_encoding(s), analysis.encoding);
+
+    // 两者都被否定时扫描会提前结束，此时只有较早的那个位置是确定的
+    int pending = 0;
+    bool ascii = true;
+    size_t utf8_at = encoding_util::detail::validate_utf8_prefix_scalar(s.data(), s.size(), pending, ascii);
+    if (utf8_at == s.size()) utf8_at = pending > 0 ? s.size() : encoding_util::EncodingAnalysis::npos;
+    bool pending_lead = false;
+    size_t gbk_at = encoding_util::detail::validate_gbk_prefix(s.data(), s.size(), pending_lead);
+    if (gbk_at == s.size()) gbk_at = pending_lead ? s.size() : encoding_util::EncodingAnalysis::npos;
+    if (utf8_at <= gbk_at) {
+        EXPECT_EQ(analysis.utf8_invalid_at, utf8_at);
+    }
+    if (gbk_at <= utf8_at) {
+        EXPECT_EQ(analysis.gbk_invalid_at, gbk_at);
+    }
+    EXPECT_EQ(analysis.is_all_ascii, encoding_util::detail::find_non_ascii(s.data(), s.size()) == s.size());
+}
+
+}  // namespace
+
+TEST(FusedDetection, VectorizedGbkMatchesScalar) {
+    std::mt19937 rng(11);
+    static const unsigned char kAlphabet[] = {0x20, 0x3F, 0x40, 0x7E, 0x7F, 0x80, 0x81, 0xA1, 0xC4, 0xFE};
+    std::uniform_int_distribution<size_t> pick(0, sizeof(kAlphabet) - 1);
+    std::uniform_int_distribution<int> rare(0, 400);
+    for (size_t size = 0; size < 400; size += 3) {
+        for (int round = 0; round < 30; ++round) {
+            // 大多数字节取自合法字节，偶尔混入非法字节，使错误能出现在块的任意位置
+            std::string s(size, '\0');
+            for (auto& c : s) c = static_cast<char>(rare(rng) == 0 ? 0xFF : kAlphabet[pick(rng)]);
+            for (bool pending_in : {false, true}) {
+                bool ref_pending = pending_in, pending = pending_in;
+                const size_t ref = encoding_util::detail::validate_gbk_prefix_scalar(s.data(), s.size(), ref_pending);
+                EXPECT_EQ(encoding_util::detail::validate_gbk_prefix(s.data(), s.size(), pending), ref);
+                if (ref == s.size()) {
+                    EXPECT_EQ(pending, ref_pending);
+                }
+            }
+        }
+    }
+
+    // 跨越块边界的长串首字节区间：只有偶数长度时，其后的空格才是合法的单字节字符
+    for (size_t prefix = 0; prefix < 70; prefix += 7) {
+        for (size_t run = 0; run < 140; ++run) {
+            const std::string s = std::string(prefix, 'a') + std::string(run, '\xA1') + " " + std::string(70, 'b');
+            EXPECT_EQ(encoding_util::detail::is_valid_gbk(s.data(), s.size()), run % 2 == 0);
+        }
+    }
+}
+
+TEST(FusedDetection, MatchesTwoPassOnRandomInput) {
+    std::mt19937 rng(7);
+    static const unsigned char kAlphabet[] = {0x20, 0x41, 0x7F, 0x80, 0x81, 0xA1, 0xBF, 0xC0,
+                                              0xC4, 0xE3, 0xE4, 0xF0, 0xF5, 0xFE, 0xFF};
+    std::uniform_int_distribution<size_t> pick(0, sizeof(kAlphabet) - 1);
+    for (size_t size = 0; size < 100; ++size) {
+        for (int round = 0; round < 50; ++round) {
+            std::string s(size, '\0');
+            for (auto& c : s) c = static_cast<char>(kAlphabet[pick(rng)]);
+            expect_analysis_matches_reference(s);
+        }
+    }
+}
+
+TEST(FusedDetection, MatchesTwoPassOnLongAmbiguousInput) {
+    // "你好" 的 UTF-8 编码恰好也是 3 个合法的 GBK 字符，拼接后两个候选会一直存活，从而走到向量块路径
+    const std::string ambiguous = utf8_hello_world.substr(0, 6);
+    std::mt19937 rng(99);
+    std::uniform_int_distribution<int> piece(0, 3);
+    std::uniform_int_distribution<int> byte(0, 255);
+    for (int round = 0; round < 300; ++round) {
+        std::string s;
+        while (s.size() < 400) s += piece(rng) == 0 ? std::string("a") : ambiguous;
+        expect_analysis_matches_reference(s);
+        std::uniform_int_distribution<size_t> where(0, s.size() - 1);
+        s[where(rng)] = static_cast<char>(byte(rng));
+        expect_analysis_matches_reference(s);
+        expect_analysis_matches_reference(s.substr(0, where(rng)));
+    }
+}
+
+TEST(FusedDetection, ReportsWhereEachCandidateWasRuledOut) {
+    const std::string gbk = ascii_str + gbk_hello_world;
+    auto analysis = encoding_util::analyze_encoding(gbk);
+    EXPECT_EQ(analysis.encoding, encoding_util::Encoding::GBK);
+    EXPECT_EQ(analysis.utf8_invalid_at, ascii_str.size() + 1);  // 0xC4 之后的 0xE3 不是后续字节
+    EXPECT_EQ(analysis.gbk_invalid_at, encoding_util::EncodingAnalysis::npos);
+
+    const std::string utf8_ni = utf8_hello_world.substr(0, 3);  // "你"，按GBK解读时最后一个字节成了首字节
+    analysis = encoding_util::analyze_encoding(utf8_ni + " " + ascii_str);
+    EXPECT_EQ(analysis.encoding, encoding_util::Encoding::UTF8);
+    EXPECT_EQ(analysis.gbk_invalid_at, utf8_ni.size());  // 空格不能作GBK第二字节
+    EXPECT_FALSE(analysis.is_all_ascii);
+
+    analysis = encoding_util::analyze_encoding(incomplete_utf8);
+    EXPECT_EQ(analysis.encoding, encoding_util::Encoding::UNKNOWN);
+    EXPECT_EQ(analysis.utf8_invalid_at, incomplete_utf8.size());
+
+    expect_analysis_matches_reference(gbk_hello_world + utf8_hello_world + broken_gbk);
+    expect_analysis_matches_reference(std::string(1000, 'a') + gbk_hello_world + std::string(1000, 'b'));
+}
+
+
+// ========== 可复用转换器测试 (Reusable Converter) ==========
+TEST(ReusableConverter, ConvertsRepeatedlyAndRecoversFromErrors) {
+    encoding_util::Converter to_utf8(encoding_util::Encoding::GBK, encoding_util::Encoding::UTF8);
+    encoding_util::Converter to_gbk(encoding_util::Encoding::UTF8, encoding_util::Encoding::GBK);
+    EXPECT_EQ(to_utf8.from(), encoding_util::Encoding::GBK);
+    EXPECT_EQ(to_utf8.to(), encoding_util::Encoding::UTF8);
+    for (int i = 0; i < 100; ++i) {
+        EXPECT_EQ(to_utf8.convert(gbk_hello_world), utf8_hello_world);
+        EXPECT_EQ(to_gbk.convert(utf8_hello_world), gbk_hello_world);
+    }
+
+    // 失败的转换不能影响之后的转换
+    EXPECT_THROW(to_utf8.convert(incomplete_gbk), std::runtime_error);
+    EXPECT_EQ(to_utf8.convert(gbk_hello_world), utf8_hello_world);
+    EXPECT_THROW(to_gbk.convert(utf8_hello_world + utf8_with_emoji), std::runtime_error);
+    EXPECT_EQ(to_gbk.convert(utf8_hello_world), gbk_hello_world);
+    EXPECT_THROW(encoding_util::gbk_to_utf8(gbk_hello_world + incomplete_gbk), std::runtime_error);
+    EXPECT_EQ(encoding_util::gbk_to_utf8(gbk_hello_world), utf8_hello_world);
+
+    encoding_util::Converter moved = std::move(to_utf8);
+    EXPECT_EQ(moved.convert(gbk_hello_world + ascii_str), utf8_hello_world + ascii_str);
+
+    EXPECT_THROW(encoding_util::Converter(encoding_util::Encoding::GBK, encoding_util::Encoding::GBK),
+                 std::runtime_error);
+    EXPECT_THROW(encoding_util::Converter(encoding_util::Encoding::ASCII, encoding_util::Encoding::UTF8),
+                 std::runtime_error);
+}
+
+TEST(ReusableConverter, ConcurrentConversionsUseSeparateDescriptors) {
+    std::vector<std::thread> workers;
+    std::vector<int> failures(4, 0);
+    for (int t = 0; t < 4; ++t) {
+        workers.emplace_back([t, &failures] {
+            for (int i = 0; i < 500; ++i) {
+                if (encoding_util::gbk_to_utf8(gbk_hello_world) != utf8_hello_world) ++failures[t];
+                if (encoding_util::utf8_to_gbk(utf8_hello_world) != gbk_hello_world) ++failures[t];
+            }
+        });
+    }
+    for (std::thread& worker : workers) worker.join();
+    for (int count : failures) EXPECT_EQ(count, 0);
+}
+
+
+// ========== 追加/定长缓冲区接口测试 (Caller-Provided Buffers) ==========
+TEST(BufferOutput, AppendsIntoStringAndVector) {
+    std::string out = "prefix:";
+    EXPECT_EQ(encoding_util::gbk_to_utf8(gbk_hello_world, out), utf8_hello_world.size());
+    EXPECT_EQ(out, "prefix:" + utf8_hello_world);
+    EXPECT_EQ(encoding_util::utf8_to_gbk(utf8_hello_world, out), gbk_hello_world.size());
+    EXPECT_EQ(out, "prefix:" + utf8_hello_world + gbk_hello_world);
+
+    std::vector<char> bytes;
+    EXPECT_EQ(encoding_util::to_utf8(gbk_hello_world, bytes), utf8_hello_world.size());
+    EXPECT_EQ(encoding_util::to_utf8(ascii_str, bytes), ascii_str.size());
+    EXPECT_EQ(std::string(bytes.begin(), bytes.end()), utf8_hello_world + ascii_str);
+    bytes.clear();
+    EXPECT_EQ(encoding_util::to_gbk(utf8_hello_world, bytes), gbk_hello_world.size());
+    EXPECT_EQ(std::string(bytes.begin(), bytes.end()), gbk_hello_world);
+
+    // 失败时缓冲区保持原样
+    EXPECT_THROW(encoding_util::gbk_to_utf8(gbk_hello_world + incomplete_gbk, out), std::runtime_error);
+    EXPECT_THROW(encoding_util::to_gbk(utf8_with_emoji, out), std::runtime_error);
+    EXPECT_EQ(out, "prefix:" + utf8_hello_world + gbk_hello_world);
+
+    // 复用同一个缓冲区时不再重新分配
+    std::string reused;
+    encoding_util::gbk_to_utf8(gbk_hello_world + ascii_str, reused);
+    const char* storage = reused.data();
+    for (int i = 0; i < 100; ++i) {
+        reused.clear();
+        encoding_util::gbk_to_utf8(gbk_hello_world + ascii_str, reused);
+    }
+    EXPECT_EQ(reused.data(), storage);
+
+    encoding_util::Converter converter(encoding_util::Encoding::UTF8, encoding_util::Encoding::GBK);
+    std::string converted = "x";
+    EXPECT_EQ(converter.convert(utf8_hello_world, converted), gbk_hello_world.size());
+    EXPECT_EQ(converted, "x" + gbk_hello_world);
+}
+
+TEST(BufferOutput, WritesIntoFixedSpanOrReportsTooSmall) {
+    char buffer[64];
+    size_t n = encoding_util::gbk_to_utf8(gbk_hello_world, std::span<char>(buffer));
+    EXPECT_EQ(std::string(buffer, n), utf8_hello_world);
+    n = encoding_util::to_gbk(utf8_hello_world, buffer);
+    EXPECT_EQ(std::string(buffer, n), gbk_hello_world);
+    n = encoding_util::to_utf8(ascii_str, buffer);
+    EXPECT_EQ(std::string(buffer, n), ascii_str);
+
+    char tiny[4];
+    try {
+        encoding_util::utf8_to_gbk(utf8_hello_world, tiny);
+        ADD_FAILURE() << "缓冲区不足时应抛出异常";
+    } catch (const std::system_error& e) {
+        EXPECT_EQ(e.code(), std::errc::value_too_large);
+    }
+    // 按文档给出的上界准备的缓冲区，结果恰好占满时也放得下
+    const std::string hanzi = gbk_hello_world.substr(0, 4);
+    std::vector<char> exact(hanzi.size() * 3 / 2);
+    EXPECT_EQ(encoding_util::gbk_to_utf8(hanzi, std::span<char>(exact)), exact.size());
+    EXPECT_EQ(std::string(exact.data(), exact.size()), encoding_util::gbk_to_utf8(hanzi));
+    EXPECT_THROW(encoding_util::gbk_to_utf8(broken_gbk, std::span<char>(buffer)), std::runtime_error);
+}
+
+TEST(BufferOutput, BorrowsInputThatNeedsNoConversion) {
+    auto utf8 = encoding_util::to_utf8_view(utf8_hello_world);
+    EXPECT_TRUE(utf8.is_borrowed());
+    EXPECT_EQ(utf8.data(), utf8_hello_world.data());
+    EXPECT_EQ(encoding_util::to_gbk_view(ascii_str).data(), ascii_str.data());
+    EXPECT_EQ(encoding_util::to_gbk_view(gbk_hello_world).view(), gbk_hello_world);
+
+    auto converted = encoding_util::to_utf8_view(gbk_hello_world);
+    EXPECT_FALSE(converted.is_borrowed());
+    EXPECT_EQ(converted, utf8_hello_world);
+    auto copy = converted;
+    EXPECT_EQ(std::string_view(copy), utf8_hello_world);
+    EXPECT_NE(copy.data(), converted.data());
+    EXPECT_EQ(std::move(converted).str(), utf8_hello_world);
+    EXPECT_EQ(encoding_util::to_gbk_view(utf8_hello_world), gbk_hello_world);
+
+    EXPECT_THROW(encoding_util::to_utf8_view(broken_gbk), std::runtime_error);
+    EXPECT_THROW(encoding_util::to_gbk_view(utf8_with_emoji), std::runtime_error);
+}
+
+
+// ========== 不抛异常的转换接口测试 (Error Codes) ==========
+TEST(ErrorCodes, ReportsKindAndOffsetOfFirstBadSequence) {
+    using encoding_util::ConvertErrc;
+    std::string out = "prefix:";
+    auto error = encoding_util::try_gbk_to_utf8(ascii_str + gbk_hello_world, out);
+    EXPECT_FALSE(error);
+    EXPECT_EQ(out, "prefix:" + ascii_str + utf8_hello_world);
+
+    out = "prefix:";
+    error = encoding_util::try_gbk_to_utf8(ascii_str + broken_gbk + gbk_hello_world, out);
+    EXPECT_EQ(error.code, ConvertErrc::INVALID_SEQUENCE);
+    EXPECT_EQ(error.offset, ascii_str.size());
+    EXPECT_EQ(out, "prefix:");  // 失败时缓冲区保持原样
+
+    error = encoding_util::try_gbk_to_utf8(gbk_hello_world + incomplete_gbk, out);
+    EXPECT_EQ(error.code, ConvertErrc::INCOMPLETE_SEQUENCE);
+    EXPECT_EQ(error.offset, gbk_hello_world.size());
+
+    error = encoding_util::try_utf8_to_gbk(utf8_hello_world + utf8_with_emoji, out);
+    EXPECT_EQ(error.code, ConvertErrc::UNREPRESENTABLE);
+    EXPECT_EQ(error.offset, utf8_hello_world.size() + utf8_with_emoji.find("\xF0"));
+
+    error = encoding_util::try_utf8_to_gbk(ascii_str + incomplete_utf8, out);
+    EXPECT_EQ(error.code, ConvertErrc::INCOMPLETE_SEQUENCE);
+    EXPECT_EQ(error.offset, ascii_str.size());
+
+    // 被 ASCII 打断的多字节序列不是“不完整”，而是无效
+    error = encoding_util::try_utf8_to_gbk(incomplete_utf8 + ascii_str, out);
+    EXPECT_EQ(error.code, ConvertErrc::INVALID_SEQUENCE);
+    EXPECT_EQ(error.offset, 0u);
+    error = encoding_util::try_utf8_to_gbk(utf8_hello_world + "\xC0\xAF", out);  // 过长编码
+    EXPECT_EQ(error.code, ConvertErrc::INVALID_SEQUENCE);
+    EXPECT_EQ(error.offset, utf8_hello_world.size());
+    error = encoding_util::try_utf8_to_gbk(utf8_hello_world + "\xFA", out);  // 结尾处无法作为首字节的字节也是无效
+    EXPECT_EQ(error.code, ConvertErrc::INVALID_SEQUENCE);
+    EXPECT_EQ(error.offset, utf8_hello_world.size());
+    EXPECT_EQ(out, "prefix:");
+
+    // 抛异常的接口复用同一份实现，异常信息中带有偏移
+    try {
+        encoding_util::gbk_to_utf8(gbk_hello_world + incomplete_gbk);
+        FAIL() << "expected std::runtime_error";
+    } catch (const std::runtime_error& e) {
+        EXPECT_NE(std::string(e.what()).find(std::to_string(gbk_hello_world.size())), std::string::npos);
+    }
+    static_assert(noexcept(encoding_util::try_gbk_to_utf8(std::string_view(), out)));
+}
+
+TEST(ErrorCodes, SmartConversionAndConverter) {
+    using encoding_util::ConvertErrc;
+    std::vector<char> bytes;
+    EXPECT_FALSE(encoding_util::try_to_utf8(gbk_hello_world, bytes));
+    EXPECT_FALSE(encoding_util::try_to_gbk(ascii_str, bytes));
+    EXPECT_EQ(std::string(bytes.begin(), bytes.end()), utf8_hello_world + ascii_str);
+
+    // 两种候选编码都在末尾的 0xFF 处被否定
+    const std::string unknown = ascii_str + utf8_hello_world + "\xFF";
+    auto error = encoding_util::try_to_gbk(unknown, bytes);
+    EXPECT_EQ(error.code, ConvertErrc::UNKNOWN_ENCODING);
+    EXPECT_EQ(error.offset, unknown.size() - 1);
+    // 只有一个候选给出位置时，报告该位置而不是 npos
+    encoding_util::EncodingAnalysis one_sided;
+    one_sided.encoding = encoding_util::Encoding::UNKNOWN;
+    one_sided.is_all_ascii = false;
+    one_sided.utf8_invalid_at = 5;
+    EXPECT_EQ(encoding_util::try_to_gbk(encoding_util::DetectedView(unknown, one_sided), bytes).offset, 5u);
+    std::swap(one_sided.utf8_invalid_at, one_sided.gbk_invalid_at);
+    EXPECT_EQ(encoding_util::try_to_utf8(encoding_util::DetectedView(unknown, one_sided), bytes).offset, 5u);
+    EXPECT_EQ(encoding_util::try_to_utf8(utf8_with_emoji, bytes).code, ConvertErrc::NONE);
+    EXPECT_EQ(encoding_util::try_to_gbk(utf8_with_emoji, bytes).code, ConvertErrc::UNREPRESENTABLE);
+    EXPECT_EQ(std::string(bytes.begin(), bytes.end()), utf8_hello_world + ascii_str + utf8_with_emoji);
+
+    encoding_util::Converter converter(encoding_util::Encoding::GBK, encoding_util::Encoding::UTF8);
+    std::string out;
+    error = converter.try_convert(gbk_hello_world + broken_gbk, out);
+    EXPECT_EQ(error.code, ConvertErrc::INVALID_SEQUENCE);
+    EXPECT_EQ(error.offset, gbk_hello_world.size());
+    EXPECT_TRUE(out.empty());
+    EXPECT_FALSE(converter.try_convert(gbk_hello_world, out));  // 失败后仍可继续使用
+    EXPECT_EQ(out, utf8_hello_world);
+
+#if defined(__cpp_lib_expected)
+    EXPECT_EQ(encoding_util::try_gbk_to_utf8(gbk_hello_world).value(), utf8_hello_world);
+    EXPECT_EQ(encoding_util::try_utf8_to_gbk(utf8_with_emoji).error().code, ConvertErrc::UNREPRESENTABLE);
+    EXPECT_EQ(encoding_util::try_to_utf8(broken_gbk).error().code, ConvertErrc::UNKNOWN_ENCODING);
+#endif
+}
+
+// ========== 有损转换策略测试 (Lossy Conversion Policies) ==========
+TEST(LossyConversion, AppliesPolicyToUnrepresentableAndInvalidInput) {
+    using encoding_util::ErrorPolicy;
+    const std::string emoji = "\xF0\x9F\x98\x82";  // 😂
+    const std::string utf8 = utf8_hello_world + emoji + "!";
+    EXPECT_THROW(encoding_util::utf8_to_gbk(utf8, ErrorPolicy::STRICT), std::runtime_error);
+    EXPECT_EQ(encoding_util::utf8_to_gbk(utf8, ErrorPolicy::REPLACE), gbk_hello_world + "?!");
+    EXPECT_EQ(encoding_util::utf8_to_gbk(utf8, ErrorPolicy::SKIP), gbk_hello_world + "!");
+    EXPECT_EQ(encoding_util::utf8_to_gbk(utf8, ErrorPolicy::ESCAPE), gbk_hello_world + "&#x1F602;!");
+
+    // 无效的 UTF-8 视为 U+FFFD，每个最大有效前缀替换一次
+    EXPECT_EQ(encoding_util::utf8_to_gbk("a\xC0\xAF" + incomplete_utf8 + "b", ErrorPolicy::REPLACE), "a???b");
+    EXPECT_EQ(encoding_util::utf8_to_gbk("a" + incomplete_utf8, ErrorPolicy::ESCAPE), "a&#xFFFD;");
+    EXPECT_EQ(encoding_util::utf8_to_gbk(incomplete_utf8 + utf8_hello_world, ErrorPolicy::SKIP), gbk_hello_world);
+
+    // 无效的 GBK 首字节只替换它自己，其后的 ASCII 字节照常输出
+    const std::string replacement = "\xEF\xBF\xBD";
+    const std::string gbk = gbk_hello_world + broken_gbk + gbk_hello_world + incomplete_gbk;
+    EXPECT_EQ(encoding_util::gbk_to_utf8(gbk, ErrorPolicy::REPLACE),
+              utf8_hello_world + replacement + " " + utf8_hello_world + replacement);
+    EXPECT_EQ(encoding_util::gbk_to_utf8(gbk, ErrorPolicy::ESCAPE),
+              utf8_hello_world + replacement + " " + utf8_hello_world + replacement);
+    EXPECT_EQ(encoding_util::gbk_to_utf8(gbk, ErrorPolicy::SKIP), utf8_hello_world + " " + utf8_hello_world);
+
+    std::string out = "prefix:";
+    EXPECT_EQ(encoding_util::utf8_to_gbk(utf8, out, ErrorPolicy::REPLACE), gbk_hello_world.size() + 2);
+    EXPECT_EQ(encoding_util::gbk_to_utf8(gbk_hello_world + "\xFF", out, ErrorPolicy::SKIP), utf8_hello_world.size());
+    EXPECT_EQ(out, "prefix:" + gbk_hello_world + "?!" + utf8_hello_world);
+    EXPECT_FALSE(encoding_util::try_utf8_to_gbk(utf8, out, ErrorPolicy::ESCAPE));
+
+    // 替换内容比原序列长时也能放下
+    const std::string many_invalid(1000, '\xFF');
+    EXPECT_EQ(encoding_util::utf8_to_gbk(many_invalid, ErrorPolicy::ESCAPE).size(), 1000 * 8u);
+    EXPECT_EQ(encoding_util::gbk_to_utf8(many_invalid, ErrorPolicy::REPLACE).size(), 1000 * 3u);
+}
+
+TEST(LossyConversion, SystemConverterMatchesNativeCodec) {
+    using encoding_util::ErrorPolicy;
+    std::mt19937 rng(20241014);
+    for (ErrorPolicy policy : {ErrorPolicy::REPLACE, ErrorPolicy::SKIP, ErrorPolicy::ESCAPE}) {
+        for (int round = 0; round < 300; ++round) {
+            const std::string s = make_random_utf8_like(rng, round % 40) + utf8_hello_world + utf8_with_emoji;
+            EXPECT_EQ(encoding_util::utf8_to_gbk(s, policy), encoding_util::native::utf8_to_gbk(s, policy));
+            EXPECT_EQ(encoding_util::gbk_to_utf8(s, policy), encoding_util::native::gbk_to_utf8(s, policy));
+        }
+    }
+}
+
+// ========== 流式转换测试 (Streaming Transcoder) ==========
+namespace {
+
+// 把 input 按随机长度切块送入转换器，返回拼接后的输出
+std::string transcode_in_chunks(encoding_util::StreamTranscoder& transcoder, const std::string& input,
+                                std::mt19937& rng, size_t max_chunk) {
+    std::uniform_int_distribution<size_t> chunk_len(0, max_chunk);
+    std::string out;
+    size_t pos = 0;
+    while (pos < input.size()) {
+        const size_t len = std::min(chunk_len(rng), input.size() - pos);
+        transcoder.feed(std::string_view(input).substr(pos, len), out);
+        pos += len;
+    }
+    transcoder.finish();
+    return out;
+}
+
+}  // namespace
+
+TEST(StreamTranscoder, ChunkedOutputMatchesWholeConversion) {
+    std::string gbk;
+    for (int i = 0; i < 50; ++i) gbk += gbk_hello_world + "\x81\x40" + ascii_str.substr(0, i % 7) + "\x80";
+    const std::string utf8 = encoding_util::gbk_to_utf8(gbk);
+
+    encoding_util::StreamTranscoder to_utf8(encoding_util::Encoding::GBK, encoding_util::Encoding::UTF8);
+    encoding_util::StreamTranscoder to_gbk(encoding_util::Encoding::UTF8, encoding_util::Encoding::GBK);
+    std::mt19937 rng(2024);
+    for (size_t max_chunk : {1, 2, 3, 5, 16, 100}) {
+        EXPECT_EQ(transcode_in_chunks(to_utf8, gbk, rng, max_chunk), utf8) << max_chunk;
+        EXPECT_EQ(transcode_in_chunks(to_gbk, utf8, rng, max_chunk), gbk) << max_chunk;
+    }
+}
+
+TEST(StreamTranscoder, CarriesIncompleteTailsAndRejectsTruncatedStreams) {
+    encoding_util::StreamTranscoder to_gbk(encoding_util::Encoding::UTF8, encoding_util::Encoding::GBK);
+    EXPECT_EQ(to_gbk.feed(utf8_hello_world.substr(0, 4)), gbk_hello_world.substr(0, 2));
+    EXPECT_EQ(to_gbk.pending(), 1u);
+    EXPECT_EQ(to_gbk.feed(utf8_hello_world.substr(4, 1)), "");
+    EXPECT_EQ(to_gbk.pending(), 2u);
+    EXPECT_EQ(to_gbk.feed(utf8_hello_world.substr(5)), gbk_hello_world.substr(2));
+    EXPECT_NO_THROW(to_gbk.finish());
+
+    to_gbk.feed(incomplete_utf8);
+    EXPECT_THROW(to_gbk.finish(), std::runtime_error);
+    EXPECT_EQ(to_gbk.pending(), 0u);  // finish() 之后可以开始新的流
+    EXPECT_EQ(to_gbk.feed(utf8_hello_world), gbk_hello_world);
+    EXPECT_THROW(to_gbk.feed(utf8_with_emoji), std::runtime_error);
+
+    encoding_util::StreamTranscoder to_utf8(encoding_util::Encoding::GBK, encoding_util::Encoding::UTF8);
+    EXPECT_EQ(to_utf8.feed(incomplete_gbk), "");
+    EXPECT_EQ(to_utf8.feed("\xE3"), "\xe4\xbd\xa0");  // 0xC4 0xE3 = "你"
+    EXPECT_THROW(to_utf8.feed(broken_gbk), std::runtime_error);
+    to_utf8.reset();
+    to_utf8.feed(gbk_hello_world + incomplete_gbk);
+    EXPECT_THROW(to_utf8.finish(), std::runtime_error);
+}
+
+
+// ========== 增量与抽样检测测试 (Incremental & Sampled Detection) ==========
+namespace {
+
+// 把 input 按随机长度切块送入检测器，返回 finish() 的结果
+encoding_util::EncodingAnalysis detect_in_chunks(encoding_util::IncrementalDetector& detector,
+                                                 const std::string& input, std::mt19937& rng, size_t max_chunk) {
+    std::uniform_int_distribution<size_t> chunk_len(1, max_chunk);
+    size_t pos = 0;
+    while (pos < input.size() && !detector.done()) {
+        const size_t len = std::min(chunk_len(rng), input.size() - pos);
+        detector.feed(std::string_view(input).substr(pos, len));
+        pos += len;
+    }
+    return detector.finish();
+}
+
+void expect_same_analysis(const encoding_util::EncodingAnalysis& a, const encoding_util::EncodingAnalysis& b) {
+    EXPECT_EQ(a.encoding, b.encoding);
+    EXPECT_EQ(a.is_all_ascii, b.is_all_ascii);
+    EXPECT_EQ(a.utf8_invalid_at, b.utf8_invalid_at);
+    EXPECT_EQ(a.gbk_invalid_at, b.gbk_invalid_at);
+}
+
+}  // namespace
+
+TEST(IncrementalDetection, ExhaustiveMatchesWholeBufferAnalysis) {
+    const std::string ambiguous = utf8_hello_world.substr(0, 6);
+    std::mt19937 rng(11);
+    std::uniform_int_distribution<int> piece(0, 4);
+    std::uniform_int_distribution<int> byte(0, 255);
+    for (int round = 0; round < 300; ++round) {
+        std::string s;
+        const size_t length = 50 + round * 3;
+        while (s.size() < length) {
+            switch (piece(rng)) {
+                case 0: s += std::string(1 + round % 40, 'a'); break;
+                case 1: s += gbk_hello_world; break;
+                case 2: s += utf8_hello_world; break;
+                default: s += ambiguous; break;
+            }
+        }
+        if (round % 3 == 0) s[byte(rng) % s.size()] = static_cast<char>(byte(rng));
+        if (round % 5 == 0) s.resize(s.size() - 1);
+
+        encoding_util::IncrementalDetector detector;
+        for (size_t max_chunk : {1, 7, 64, 1000}) {
+            detector.reset();
+            expect_same_analysis(detect_in_chunks(detector, s, rng, max_chunk), encoding_util::analyze_encoding(s));
+        }
+    }
+    // GBK 先被四字节序列否定、UTF-8 之后才被否定时，GB18030 仍要从 GBK 被否定处接着验证
+    const std::string gb18030 = "\xF0\x9F\x98\x82\xE4\xBD\x81\x30\x81\x30";
+    ASSERT_EQ(encoding_util::analyze_encoding(gb18030).encoding, encoding_util::Encoding::GB18030);
+    for (size_t max_chunk : {1, 3, 100}) {
+        encoding_util::IncrementalDetector chunked;
+        expect_same_analysis(detect_in_chunks(chunked, gb18030, rng, max_chunk),
+                             encoding_util::analyze_encoding(gb18030));
+    }
+
+    encoding_util::IncrementalDetector detector;
+    EXPECT_EQ(detector.finish().encoding, encoding_util::Encoding::ASCII);
+    detector.feed(incomplete_utf8);
+    EXPECT_EQ(detector.finish().encoding, encoding_util::Encoding::UNKNOWN);
+}
+
+TEST(IncrementalDetection, StopsEarlyOnceTheVerdictIsKnown) {
+    using Policy = encoding_util::IncrementalDetector::StopPolicy;
+    std::string gbk = ascii_str + gbk_hello_world;
+    for (int i = 0; i < 1000; ++i) gbk += gbk_hello_world + ascii_str;
+
+    encoding_util::IncrementalDetector first(Policy::FirstDisproof);
+    EXPECT_TRUE(first.feed(gbk));
+    EXPECT_EQ(first.bytes_consumed(), ascii_str.size() + 2);  // 第二个字节 0xE3 否定了 UTF-8
+    EXPECT_EQ(first.finish().encoding, encoding_util::Encoding::GBK);
+    EXPECT_EQ(first.finish().utf8_invalid_at, ascii_str.size() + 1);
+
+    encoding_util::IncrementalDetector evidence(Policy::AfterEvidence, 1000);
+    std::mt19937 rng(5);
+    EXPECT_EQ(detect_in_chunks(evidence, gbk, rng, 100).encoding, encoding_util::Encoding::GBK);
+    EXPECT_TRUE(evidence.done());
+    EXPECT_EQ(evidence.bytes_consumed(), ascii_str.size() + 2 + 1000);
+
+    // 在收集到足够证据之前被否定
+    encoding_util::IncrementalDetector refuted(Policy::AfterEvidence, 1000);
+    EXPECT_TRUE(refuted.feed(ascii_str + gbk_hello_world + broken_gbk + gbk));
+    EXPECT_EQ(refuted.finish().encoding, encoding_util::Encoding::UNKNOWN);
+
+    // 两个候选一直并存时不会提前结束
+    encoding_util::IncrementalDetector ambiguous(Policy::FirstDisproof);
+    EXPECT_FALSE(ambiguous.feed(utf8_hello_world.substr(0, 6)));
+    EXPECT_EQ(ambiguous.finish().encoding, encoding_util::Encoding::UTF8);
+}
+
+
+TEST(SampledDetection, InfersEncodingOfLargeBuffers) {
+    std::string gbk, utf8, ascii;
+    while (gbk.size() < 1000000) {
+        gbk += gbk_hello_world + "\x81\x40" + ascii_str.substr(0, gbk.size() % 5);
+        utf8 += utf8_hello_world + "\xe4\xb8\x82" + ascii_str.substr(0, utf8.size() % 5);
+        ascii += ascii_str;
+    }
+    encoding_util::SamplingOptions options;
+    for (uint64_t seed = 0; seed < 20; ++seed) {
+        options.seed = seed;
+        const auto gbk_result = encoding_util::detect_encoding(gbk, options);
+        EXPECT_EQ(gbk_result.encoding, encoding_util::Encoding::GBK);
+        EXPECT_GT(gbk_result.confidence, 0.99);
+        EXPECT_LT(gbk_result.bytes_examined, gbk.size() / 10);
+        EXPECT_EQ(encoding_util::detect_encoding(utf8, options).encoding, encoding_util::Encoding::UTF8);
+    }
+
+    const auto ascii_result = encoding_util::detect_encoding(ascii, options);
+    EXPECT_EQ(ascii_result.encoding, encoding_util::Encoding::ASCII);
+    EXPECT_LT(ascii_result.confidence, 0.5);
+
+    std::mt19937 rng(1);
+    const std::string noise = make_random_utf8_like(rng, 1000000);
+    EXPECT_EQ(encoding_util::detect_encoding(noise, options).encoding, encoding_util::Encoding::UNKNOWN);
+
+    // 数据量不足以抽样时退化为完整检测
+    const auto small = encoding_util::detect_encoding(gbk_hello_world, options);
+    EXPECT_EQ(small.encoding, encoding_util::Encoding::GBK);
+    EXPECT_EQ(small.confidence, 1.0);
+    EXPECT_EQ(small.bytes_examined, gbk_hello_world.size());
+}
+
+TEST(SampledDetection, BoundsLookbehindOnDenseGbk) {
+    // 全部由首字节范围内的字节组成时，窗口前的连续段一直延伸到输入开头，向前对齐只能读取一个窗口
+    std::string dense;
+    while (dense.size() < (16u << 20)) dense += "\xC4\xE3\xBA\xC3";
+    const encoding_util::SamplingOptions options;
+    const auto result = encoding_util::detect_encoding(dense, options);
+    EXPECT_EQ(result.encoding, encoding_util::Encoding::GBK);
+    EXPECT_GT(result.confidence, 0.99);
+    EXPECT_LE(result.bytes_examined, 2 * options.window_size * (options.random_windows + 2));
+    EXPECT_GT(result.bytes_examined, options.window_size * (options.random_windows + 2));
+}
+
+
+// ========== 批量转换测试 (Batch Conversion) ==========
+TEST(BatchConversion, ConvertsEachElementAndReportsFailuresPerElement) {
+    const std::vector<std::string_view> inputs = {gbk_hello_world, ascii_str, utf8_hello_world, broken_gbk, "",
+                                                  utf8_with_emoji};
+    const encoding_util::BatchResult utf8 = encoding_util::to_utf8_batch(inputs);
+    ASSERT_EQ(utf8.size(), inputs.size());
+    EXPECT_EQ(utf8[0], utf8_hello_world);
+    EXPECT_EQ(utf8[1], ascii_str);
+    EXPECT_EQ(utf8[2], utf8_hello_world);
+    EXPECT_EQ(utf8.status[3], encoding_util::BatchStatus::UNKNOWN_ENCODING);
+    EXPECT_EQ(utf8[3], "");
+    EXPECT_TRUE(utf8.ok(4));
+    EXPECT_EQ(utf8[5], utf8_with_emoji);
+    EXPECT_EQ(utf8.arena, utf8_hello_world + ascii_str + utf8_hello_world + utf8_with_emoji);
+
+    encoding_util::BatchResult gbk;
+    encoding_util::to_gbk_batch(inputs, gbk);
+    EXPECT_EQ(gbk[0], gbk_hello_world);
+    EXPECT_EQ(gbk[2], gbk_hello_world);
+    EXPECT_EQ(gbk.status[5], encoding_util::BatchStatus::CONVERSION_FAILED);
+    EXPECT_EQ(gbk[5], "");
+
+    // 复用同一个结果对象时不再重新分配
+    const char* arena = gbk.arena.data();
+    encoding_util::to_gbk_batch(inputs, gbk);
+    EXPECT_EQ(gbk.arena.data(), arena);
+    EXPECT_EQ(gbk[2], gbk_hello_world);
+}
+
+
+// ========== 并行检测与转换测试 (Parallel Detection & Conversion) ==========
+TEST(Parallel, MatchesSingleThreadedResults) {
+    encoding_util::ParallelOptions options;
+    options.threads = 4;
+    options.min_chunk_size = 64;
+
+    std::string gbk, utf8;
+    for (int i = 0; i < 400; ++i) {
+        gbk += gbk_hello_world + "\x81\x40" + (i % 10 == 0 ? "\n" : "");
+        utf8 += utf8_hello_world + "\xe4\xb8\x82" + (i % 10 == 0 ? "\n" : "");
+    }
+    EXPECT_EQ(encoding_util::gbk_to_utf8(gbk, options), utf8);
+    EXPECT_EQ(encoding_util::utf8_to_gbk(utf8, options), gbk);
+    EXPECT_EQ(encoding_util::detect_encoding(gbk, options), encoding_util::Encoding::GBK);
+    EXPECT_EQ(encoding_util::detect_encoding(utf8, options), encoding_util::Encoding::UTF8);
+    EXPECT_THROW(encoding_util::gbk_to_utf8(gbk + broken_gbk + gbk, options), std::runtime_error);
+    EXPECT_THROW(encoding_util::utf8_to_gbk(utf8 + utf8_with_emoji + utf8, options), std::runtime_error);
+
+    // 在随机位置破坏数据后，被否定的位置也与单线程一致
+    std::mt19937 rng(3);
+    std::uniform_int_distribution<int> byte(0, 255);
+    for (int round = 0; round < 200; ++round) {
+        std::string s = (round % 2 ? gbk : utf8) + std::string(round % 7, ' ');
+        std::uniform_int_distribution<size_t> where(0, s.size() - 1);
+        if (round % 3) s[where(rng)] = static_cast<char>(byte(rng));
+        if (round % 5 == 0) s.resize(where(rng));
+        const auto serial = encoding_util::analyze_encoding(s);
+        const auto parallel = encoding_util::analyze_encoding(s, options);
+        EXPECT_EQ(parallel.encoding, serial.encoding);
+        EXPECT_EQ(parallel.is_all_ascii, serial.is_all_ascii);
+        EXPECT_EQ(parallel.utf8_invalid_at, serial.utf8_invalid_at);
+        EXPECT_EQ(parallel.gbk_invalid_at, serial.gbk_invalid_at);
+    }
+}
+
+TEST(Parallel, ReportsSameErrorAsSingleThreaded) {
+    encoding_util::ParallelOptions options;
+    options.threads = 4;
+    options.min_chunk_size = 1;
+    const auto error_text = [](const auto& convert) {
+        try {
+            convert();
+        } catch (const std::runtime_error& e) {
+            return std::string(e.what());
+        }
+        return std::string();
+    };
+
+    // 坏字节位于输入中部，偏移必须相对整个输入而不是所在的分块
+    const std::string gbk = std::string(64, 'a') + "\xFF" + gbk_hello_world;
+    EXPECT_EQ(error_text([&] { encoding_util::gbk_to_utf8(gbk, options); }),
+              error_text([&] { encoding_util::gbk_to_utf8(gbk); }));
+    EXPECT_NE(error_text([&] { encoding_util::gbk_to_utf8(gbk, options); }).find("64"), std::string::npos);
+    for (const std::string& utf8 : {std::string(64, 'a') + utf8_with_emoji, ascii_str + "\xE4" + ascii_str,
+                                    ascii_str + "\xE4\xBD" + utf8_hello_world, utf8_hello_world + "\xE4\xBD"}) {
+        EXPECT_EQ(error_text([&] { encoding_util::utf8_to_gbk(utf8, options); }),
+                  error_text([&] { encoding_util::utf8_to_gbk(utf8); }));
+    }
+}
+
+
+// ========== 文件接口测试 (Memory-Mapped Files) ==========
+namespace {
+
+void write_file(const std::filesystem::path& path, const std::string& content) {
+    std::ofstream(path, std::ios::binary) << content;
+}
+
+std::string read_file(const std::filesystem::path& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+}  // namespace
+
+TEST(FileApi, DetectsAndConvertsMappedFiles) {
+    namespace fs = std::filesystem;
+    const fs::path dir = fs::temp_directory_path() / "encoding_util_file_test";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+
+    // 跨越多个转换块，每行长度为奇数，块边界会落在双字节字符中间
+    std::string gbk;
+    while (gbk.size() < 3 * encoding_util::detail::kFileChunkSize) gbk += gbk_hello_world + ascii_str + "\n";
+    write_file(dir / "gbk.txt", gbk);
+    EXPECT_EQ(encoding_util::detect_file_encoding(dir / "gbk.txt"), encoding_util::Encoding::GBK);
+
+    const std::string utf8 = encoding_util::gbk_to_utf8(gbk);
+    EXPECT_EQ(encoding_util::convert_file(dir / "gbk.txt", dir / "utf8.txt", encoding_util::Encoding::UTF8),
+              utf8.size());
+    EXPECT_EQ(read_file(dir / "utf8.txt"), utf8);
+    EXPECT_EQ(encoding_util::detect_file_encoding(dir / "utf8.txt"), encoding_util::Encoding::UTF8);
+
+    // 已是目标编码时原样写出；空文件视为 ASCII
+    EXPECT_EQ(encoding_util::convert_file(dir / "utf8.txt", dir / "copy.txt", encoding_util::Encoding::UTF8),
+              utf8.size());
+    EXPECT_EQ(read_file(dir / "copy.txt"), utf8);
+    write_file(dir / "empty.txt", "");
+    EXPECT_EQ(encoding_util::detect_file_encoding(dir / "empty.txt"), encoding_util::Encoding::ASCII);
+    EXPECT_EQ(encoding_util::convert_file(dir / "empty.txt", dir / "empty.out", encoding_util::Encoding::GBK), 0u);
+
+    // 失败时不留下输出文件
+    write_file(dir / "broken.txt", utf8_hello_world + gbk_hello_world + "\xFF");
+    EXPECT_THROW(encoding_util::convert_file(dir / "broken.txt", dir / "broken.out", encoding_util::Encoding::GBK),
+                 std::runtime_error);
+    EXPECT_FALSE(fs::exists(dir / "broken.out"));
+    write_file(dir / "emoji.txt", utf8_with_emoji);
+    EXPECT_THROW(encoding_util::convert_file(dir / "emoji.txt", dir / "emoji.out", encoding_util::Encoding::GBK),
+                 std::runtime_error);
+    EXPECT_FALSE(fs::exists(dir / "emoji.out"));
+
+    // 失败时已存在的输出文件保持原样，也不留下临时文件；成功时整体替换
+    write_file(dir / "kept.out", "previous");
+    EXPECT_THROW(encoding_util::convert_file(dir / "broken.txt", dir / "kept.out", encoding_util::Encoding::GBK),
+                 std::runtime_error);
+    EXPECT_EQ(read_file(dir / "kept.out"), "previous");
+    EXPECT_EQ(encoding_util::convert_file(dir / "utf8.txt", dir / "kept.out", encoding_util::Encoding::GBK),
+              gbk.size());
+    EXPECT_EQ(read_file(dir / "kept.out"), gbk);
+    for (const fs::directory_entry& entry : fs::directory_iterator(dir)) {
+        EXPECT_EQ(entry.path().filename().string().find(".tmp"), std::string::npos) << entry.path();
+    }
+
+    // 不是普通文件的输入报告的长度没有意义，直接拒绝
+    EXPECT_THROW(encoding_util::detect_file_encoding(dir), std::runtime_error);
+    EXPECT_THROW(encoding_util::convert_file(dir, dir / "dir.out", encoding_util::Encoding::UTF8), std::runtime_error);
+#ifndef _WIN32
+    ASSERT_EQ(::mkfifo((dir / "fifo").c_str(), 0600), 0);
+    EXPECT_THROW(encoding_util::detect_file_encoding(dir / "fifo"), std::runtime_error);
+#endif
+#ifdef __linux__
+    // /proc 下的伪文件报告的长度为 0，内容要读到结尾才知道
+    EXPECT_GT(encoding_util::convert_file("/proc/self/status", dir / "status.out", encoding_util::Encoding::UTF8),
+              0u);
+    EXPECT_NE(read_file(dir / "status.out").find("Name:"), std::string::npos);
+#endif
+
+    EXPECT_THROW(encoding_util::detect_file_encoding(dir / "missing.txt"), std::runtime_error);
+    EXPECT_THROW(encoding_util::convert_file(dir / "gbk.txt", dir / "gbk.txt", encoding_util::Encoding::UTF8),
+                 std::runtime_error);
+    EXPECT_EQ(read_file(dir / "gbk.txt"), gbk);
+    fs::remove_all(dir);
+}
+
+TEST(FilePipeline, TranscodesManyFilesAndIsolatesFailures) {
+    namespace fs = std::filesystem;
+    using encoding_util::Encoding;
+    const fs::path dir = fs::temp_directory_path() / "encoding_util_pipeline_test";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+
+    // 块大小为奇数且远小于文件，双字节字符会跨块，读写请求也会有多个同时在途
+    std::vector<encoding_util::FileTranscodeJob> jobs;
+    std::vector<std::string> expected;
+    for (int i = 0; i < 6; ++i) {
+        std::string gbk;
+        while (gbk.size() < 4000u * (i + 1)) gbk += gbk_hello_world + ascii_str + std::to_string(i) + "\n";
+        write_file(dir / ("in" + std::to_string(i)), gbk);
+        jobs.push_back({dir / ("in" + std::to_string(i)), dir / ("out" + std::to_string(i))});
+        expected.push_back(encoding_util::gbk_to_utf8(gbk));
+    }
+    write_file(dir / "empty", "");
+    jobs.push_back({dir / "empty", dir / "empty.out"});
+    write_file(dir / "broken", gbk_hello_world + "\xFF");
+    jobs.push_back({dir / "broken", dir / "broken.out"});
+    jobs.push_back({dir / "missing", dir / "missing.out"});
+    jobs.push_back({dir / "in0", dir / "in0"});
+
+    const auto results =
+        encoding_util::transcode_files(jobs, Encoding::GBK, Encoding::UTF8, {.threads = 3, .chunk_size = 333});
+    ASSERT_EQ(results.size(), jobs.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        EXPECT_TRUE(results[i].ok) << results[i].error;
+        EXPECT_EQ(results[i].bytes_read, fs::file_size(jobs[i].src));
+        EXPECT_EQ(results[i].bytes_written, expected[i].size());
+        EXPECT_EQ(read_file(jobs[i].dst), expected[i]);
+    }
+    EXPECT_TRUE(results[6].ok);
+    EXPECT_EQ(read_file(dir / "empty.out"), "");
+    for (size_t i = 7; i < jobs.size(); ++i) {
+        EXPECT_FALSE(results[i].ok);
+        EXPECT_FALSE(results[i].error.empty());
+    }
+    EXPECT_FALSE(fs::exists(dir / "broken.out"));
+    EXPECT_FALSE(fs::exists(dir / "missing.out"));
+    EXPECT_EQ(encoding_util::gbk_to_utf8(read_file(dir / "in0")), expected[0]);
+
+    // 反方向，且使用默认选项
+    const std::vector<encoding_util::FileTranscodeJob> back = {{dir / "out5", dir / "back5"}};
+    EXPECT_TRUE(encoding_util::transcode_files(back, Encoding::UTF8, Encoding::GBK)[0].ok);
+    EXPECT_EQ(encoding_util::gbk_to_utf8(read_file(dir / "back5")), expected[5]);
+    EXPECT_THROW(encoding_util::transcode_files(back, Encoding::UTF8, Encoding::UTF8), std::runtime_error);
+    EXPECT_TRUE(encoding_util::transcode_files({}, Encoding::GBK, Encoding::UTF8).empty());
+    fs::remove_all(dir);
+}
+
+// ========== 扩展编码测试 (GB18030 / Big5 / UTF-16) ==========
+namespace {
+
+// GB18030 四字节序列 (U+0080、U+1F602) 与 Big5 的 "一，中文"，前两个字落在 GBK 的用户自定义区
+const std::string gb18030_sample = gbk_hello_world + "\x81\x30\x81\x30" + ascii_str + "\x94\x39\xFC\x38";
+const std::string big5_sample = "\xA4\x40\xA1\x41\xA4\xA4\xA4\xE5";
+const std::string big5_utf8 = "\xE4\xB8\x80\xEF\xBC\x8C\xE4\xB8\xAD\xE6\x96\x87";  // "一，中文"
+
+}  // namespace
+
+TEST(ExtendedEncodings, DetectsBomGb18030AndBig5) {
+    using encoding_util::Encoding;
+    using namespace std::string_literals;
+    EXPECT_EQ(encoding_util::detect_encoding(gb18030_sample), Encoding::GB18030);
+    EXPECT_EQ(encoding_util::detect_encoding(gb18030_sample.substr(0, gb18030_sample.size() - 1)), Encoding::UNKNOWN);
+    // Big5 的字节范围是 GBK 的子集，默认总是判为 GBK，只有显式选用时才推定为 Big5
+    EXPECT_EQ(encoding_util::detect_encoding(big5_sample), Encoding::GBK);
+    EXPECT_EQ(encoding_util::detect_encoding_with_big5(big5_sample), Encoding::BIG5);
+    EXPECT_EQ(encoding_util::detect_encoding_with_big5(big5_sample.substr(4)), Encoding::GBK);  // 只有 "中文" 时无法区分
+    EXPECT_EQ(encoding_util::detect_encoding_with_big5(big5_sample + "\x81\x40"), Encoding::GBK);  // 0x81 不是 Big5 首字节
+    EXPECT_EQ(encoding_util::detect_encoding_with_big5(gb18030_sample), Encoding::GB18030);
+    EXPECT_EQ(encoding_util::detect_encoding_with_big5(utf8_hello_world), Encoding::UTF8);
+
+    EXPECT_EQ(encoding_util::detect_encoding("\xFF\xFE" "a\0"s), Encoding::UTF16LE);
+    EXPECT_EQ(encoding_util::detect_encoding("\xFE\xFF\0a"s), Encoding::UTF16BE);
+    EXPECT_EQ(encoding_util::detect_encoding("\xFF\xFE"), Encoding::UNKNOWN);
+    EXPECT_EQ(encoding_util::detect_encoding("\xFF\xFE" "a"), Encoding::UNKNOWN);
+
+    static_assert(encoding_util::detect_encoding("\x81\x30\x81\x30") == Encoding::GB18030);
+    static_assert(encoding_util::detect_encoding("\xA4\x40\xA1\x41") == Encoding::GBK);
+    static_assert(encoding_util::detect_encoding_with_big5("\xA4\x40\xA1\x41") == Encoding::BIG5);
+
+    // 增量检测与并行检测给出相同结论
+    encoding_util::ParallelOptions options;
+    options.threads = 4;
+    options.min_chunk_size = 64;
+    std::mt19937 rng(21);
+    for (const std::string& s : {gb18030_sample, big5_sample, "\xFF\xFE" "a\0b\0"s, "\xFE\xFF\0a\0b"s}) {
+        std::string repeated;
+        for (int i = 0; i < 100; ++i) repeated += s;
+        for (const std::string& input : {s, repeated}) {
+            encoding_util::IncrementalDetector detector;
+            for (size_t max_chunk : {1, 3, 64}) {
+                detector.reset();
+                expect_same_analysis(detect_in_chunks(detector, input, rng, max_chunk),
+                                     encoding_util::analyze_encoding(input));
+            }
+            EXPECT_EQ(encoding_util::detect_encoding(input, options), encoding_util::detect_encoding(input));
+        }
+    }
+}
+
+TEST(ExtendedEncodings, VectorizedScansMatchScalar) {
+    // 首字节与第二字节取各区间的边界，使用户自定义区、Big5 不允许的字节和四字节序列都经常出现
+    const unsigned char leads[] = {0x81, 0x84, 0xA0, 0xA1, 0xA7, 0xA8, 0xAA, 0xAF, 0xB0, 0xF8, 0xF9, 0xFA, 0xFE};
+    const unsigned char trails[] = {0x40, 0x7E, 0x80, 0xA0, 0xA1, 0xFE};
+    std::mt19937 rng(22);
+    std::uniform_int_distribution<int> piece(0, 5);
+    std::uniform_int_distribution<size_t> lead(0, sizeof(leads) - 1), trail(0, sizeof(trails) - 1);
+    std::uniform_int_distribution<int> byte(0, 255);
+    for (int round = 0; round < 2000; ++round) {
+        std::string s;
+        while (s.size() < static_cast<size_t>(1 + round % 300)) {
+            switch (piece(rng)) {
+                case 0: s += std::string(1 + round % 70, 'a'); break;
+                case 1: s += "\x81\x30\x81\x30"; break;
+                default:
+                    s += static_cast<char>(leads[lead(rng)]);
+                    s += static_cast<char>(trails[trail(rng)]);
+                    break;
+            }
+        }
+        if (round % 4 == 0) s[byte(rng) % s.size()] = static_cast<char>(byte(rng));
+        if (round % 7 == 0) s.resize(s.size() - 1);
+
+        // 证据只对合法的前缀有意义
+        encoding_util::detail::Big5Evidence simd, scalar;
+        unsigned char simd_lead = 0, scalar_lead = 0;
+        const size_t gbk_valid =
+            encoding_util::detail::validate_gbk_prefix_big5_scalar(s.data(), s.size(), scalar_lead, scalar);
+        EXPECT_EQ(encoding_util::detail::validate_gbk_prefix_big5(s.data(), s.size(), simd_lead, simd), gbk_valid);
+        bool pending_lead = false;
+        EXPECT_EQ(encoding_util::detail::validate_gbk_prefix_scalar(s.data(), s.size(), pending_lead), gbk_valid);
+        if (gbk_valid == s.size()) {
+            EXPECT_EQ(simd_lead != 0, scalar_lead != 0);
+            EXPECT_EQ(simd.not_big5, scalar.not_big5);
+            EXPECT_EQ(simd.is_big5(), scalar.is_big5());
+        }
+        std::vector<encoding_util::detail::GbkBig5PrefixValidator> kernels;
+#if defined(ENCODING_UTIL_SIMD_X86)
+        namespace detail = encoding_util::detail;
+        kernels.push_back(&detail::validate_gbk_prefix_big5_blocks<&detail::load_gbk_masks_sse2,
+                                                                   &detail::load_big5_masks_sse2>);
+        if (detail::cpu_has_avx2()) {
+            kernels.push_back(&detail::validate_gbk_prefix_big5_blocks<&detail::load_gbk_masks_avx2,
+                                                                       &detail::load_big5_masks_avx2>);
+        }
+#elif defined(ENCODING_UTIL_SIMD_NEON)
+        namespace detail = encoding_util::detail;
+        kernels.push_back(&detail::validate_gbk_prefix_big5_blocks<&detail::load_gbk_masks_neon,
+                                                                   &detail::load_big5_masks_neon>);
+#endif
+        for (auto kernel : kernels) {
+            encoding_util::detail::Big5Evidence evidence;
+            unsigned char lead = 0;
+            EXPECT_EQ(kernel(s.data(), s.size(), lead, evidence), gbk_valid);
+            if (gbk_valid == s.size()) {
+                EXPECT_EQ(evidence.is_big5(), scalar.is_big5());
+            }
+        }
+
+        // 未完的字节数只在整段合法时才有意义
+        int simd_pending = 0, scalar_pending = 0;
+        const size_t valid = encoding_util::detail::validate_gb18030_prefix_scalar(s.data(), s.size(), scalar_pending);
+        EXPECT_EQ(encoding_util::detail::validate_gb18030_prefix(s.data(), s.size(), simd_pending), valid);
+        if (valid == s.size()) {
+            EXPECT_EQ(simd_pending, scalar_pending);
+        }
+        expect_analysis_matches_reference(s);
+    }
+}
+
+TEST(ExtendedEncodings, ConvertsBetweenAllEncodings) {
+    using encoding_util::Encoding;
+    using namespace std::string_literals;
+    const std::string text = utf8_hello_world + ascii_str + "😂";
+    for (Encoding encoding : {Encoding::GB18030, Encoding::UTF16LE, Encoding::UTF16BE}) {
+        const std::string encoded = encoding_util::convert(text, Encoding::UTF8, encoding);
+        EXPECT_EQ(encoding_util::detect_encoding(encoded), encoding);
+        EXPECT_EQ(encoding_util::convert(encoded, encoding, Encoding::UTF8), text);
+        EXPECT_EQ(encoding_util::to_utf8(encoded), text);
+    }
+    EXPECT_EQ(encoding_util::convert(text, Encoding::UTF8, Encoding::GB18030).substr(0, 8), gbk_hello_world);
+    EXPECT_EQ(encoding_util::convert("a", Encoding::UTF8, Encoding::UTF16LE), "\xFF\xFE" "a\0"s);
+    EXPECT_EQ(encoding_util::convert("a", Encoding::UTF8, Encoding::UTF16BE), "\xFE\xFF\0a"s);
+    EXPECT_EQ(encoding_util::convert("", Encoding::UTF8, Encoding::UTF16LE), "");
+
+    EXPECT_EQ(encoding_util::convert(big5_utf8, Encoding::UTF8, Encoding::BIG5), big5_sample);
+    const Encoding big5 = encoding_util::detect_encoding_with_big5(big5_sample);
+    EXPECT_EQ(encoding_util::convert(big5_sample, big5, Encoding::UTF8), big5_utf8);
+    EXPECT_EQ(encoding_util::convert(big5_sample, big5, Encoding::GBK), encoding_util::utf8_to_gbk(big5_utf8));
+    EXPECT_EQ(encoding_util::convert(big5_sample, Encoding::BIG5, Encoding::UTF16BE),
+              encoding_util::convert(big5_utf8, Encoding::UTF8, Encoding::UTF16BE));
+    EXPECT_EQ(encoding_util::to_utf8_batch(std::vector<std::string_view>{big5_sample, gbk_hello_world}).size(), 2u);
+
+    encoding_util::Converter from_gb18030(Encoding::GB18030, Encoding::UTF8);
+    EXPECT_EQ(from_gb18030.convert(gb18030_sample), encoding_util::convert(gb18030_sample, Encoding::GB18030,
+                                                                           Encoding::UTF8));
+    encoding_util::Converter from_utf16(Encoding::UTF16LE, Encoding::GBK);
+    EXPECT_EQ(from_utf16.convert(encoding_util::convert(utf8_hello_world, Encoding::UTF8, Encoding::UTF16LE)),
+              gbk_hello_world);
+    EXPECT_THROW(encoding_util::Converter(Encoding::UTF8, Encoding::ASCII), std::runtime_error);
+
+    // 错误码：孤立或不成对的代理项、奇数长度、不支持的编码
+    std::string out = "keep";
+    auto error = encoding_util::try_convert("\xFF\xFE\x00\xD8"s, Encoding::UTF16LE, Encoding::UTF8, out);
+    EXPECT_EQ(error.code, encoding_util::ConvertErrc::INCOMPLETE_SEQUENCE);
+    EXPECT_EQ(error.offset, 2u);
+    error = encoding_util::try_convert("\xFF\xFE\x00\xDC" "a\0"s, Encoding::UTF16LE, Encoding::UTF8, out);
+    EXPECT_EQ(error.code, encoding_util::ConvertErrc::INVALID_SEQUENCE);
+    EXPECT_EQ(error.offset, 2u);
+    error = encoding_util::try_convert("\xFE\xFF\0a\0"s, Encoding::UTF16BE, Encoding::UTF8, out);
+    EXPECT_EQ(error.code, encoding_util::ConvertErrc::INCOMPLETE_SEQUENCE);
+    EXPECT_EQ(encoding_util::try_convert(incomplete_utf8, Encoding::UTF8, Encoding::UTF16LE, out).code,
+              encoding_util::ConvertErrc::INCOMPLETE_SEQUENCE);
+    EXPECT_EQ(encoding_util::try_convert(text, Encoding::UTF8, Encoding::ASCII, out).code,
+              encoding_util::ConvertErrc::UNKNOWN_ENCODING);
+    EXPECT_EQ(out, "keep");
+    EXPECT_THROW(encoding_util::convert(text, Encoding::UTF8, Encoding::BIG5), std::runtime_error);
+}
+
+// ========== 宽字符串转换测试 (UTF-16 / UTF-32 / wchar_t) ==========
+TEST(WideStrings, ConvertsBetweenUtf8AndUtf16Utf32) {
+    const std::string utf8 = utf8_hello_world + ascii_str + "\xC3\xA9\xF0\x9F\x98\x82";  // ... "é😂"
+    const std::u16string utf16 = u"你好世界Hello C++ World 123!@#é😂";
+    const std::u32string utf32 = U"你好世界Hello C++ World 123!@#é😂";
+    EXPECT_EQ(encoding_util::utf8_to_utf16(utf8), utf16);
+    EXPECT_EQ(encoding_util::utf8_to_utf32(utf8), utf32);
+    EXPECT_EQ(encoding_util::utf16_to_utf8(utf16), utf8);
+    EXPECT_EQ(encoding_util::utf32_to_utf8(utf32), utf8);
+    EXPECT_EQ(encoding_util::utf8_to_wide(utf8), L"你好世界Hello C++ World 123!@#é😂");
+    EXPECT_EQ(encoding_util::wide_to_utf8(encoding_util::utf8_to_wide(utf8)), utf8);
+    EXPECT_TRUE(encoding_util::utf8_to_utf16("").empty());
+    EXPECT_TRUE(encoding_util::utf16_to_utf8(u"").empty());
+
+    // GBK 一步转换为 UTF-16，与经由 UTF-8 的结果一致
+    EXPECT_EQ(encoding_util::gbk_to_utf16(gbk_hello_world + ascii_str), u"你好世界Hello C++ World 123!@#");
+    EXPECT_EQ(encoding_util::gbk_to_wide(gbk_hello_world), L"你好世界");
+    EXPECT_EQ(encoding_util::gbk_to_utf16("\x80"), u"€");
+}
+
+TEST(WideStrings, ReportsErrorsAndKeepsOutputOnFailure) {
+    using encoding_util::ConvertErrc;
+    // 字节输入报告字节偏移，宽字符串输入报告代码单元下标
+    std::u16string utf16 = u"prefix";
+    auto error = encoding_util::try_utf8_to_utf16(utf8_hello_world + "\xFF", utf16);
+    EXPECT_EQ(error.code, ConvertErrc::INVALID_SEQUENCE);
+    EXPECT_EQ(error.offset, utf8_hello_world.size());
+    error = encoding_util::try_utf8_to_utf16(ascii_str + incomplete_utf8, utf16);
+    EXPECT_EQ(error.code, ConvertErrc::INCOMPLETE_SEQUENCE);
+    EXPECT_EQ(error.offset, ascii_str.size());
+    error = encoding_util::try_utf8_to_utf16(utf8_hello_world + "\xED\xA0\x80", utf16);  // 代理区
+    EXPECT_EQ(error.code, ConvertErrc::INVALID_SEQUENCE);
+    EXPECT_EQ(error.offset, utf8_hello_world.size());
+    error = encoding_util::try_gbk_to_utf16(gbk_hello_world + broken_gbk, utf16);
+    EXPECT_EQ(error.code, ConvertErrc::INVALID_SEQUENCE);
+    EXPECT_EQ(error.offset, gbk_hello_world.size());
+    error = encoding_util::try_gbk_to_utf16(gbk_hello_world + incomplete_gbk, utf16);
+    EXPECT_EQ(error.code, ConvertErrc::INCOMPLETE_SEQUENCE);
+    EXPECT_EQ(error.offset, gbk_hello_world.size());
+    EXPECT_EQ(utf16, u"prefix");  // 失败时缓冲区保持原样
+    EXPECT_FALSE(encoding_util::try_gbk_to_utf16(gbk_hello_world, utf16));
+    EXPECT_EQ(utf16, u"prefix你好世界");
+
+    std::string utf8 = "prefix";
+    error = encoding_util::try_utf16_to_utf8(std::u16string_view(u"ab\xDC00"), utf8);  // 孤立的低位代理
+    EXPECT_EQ(error.code, ConvertErrc::INVALID_SEQUENCE);
+    EXPECT_EQ(error.offset, 2u);
+    error = encoding_util::try_utf16_to_utf8(std::u16string_view(u"ab\xD800"), utf8);
+    EXPECT_EQ(error.code, ConvertErrc::INCOMPLETE_SEQUENCE);
+    EXPECT_EQ(error.offset, 2u);
+    error = encoding_util::try_utf16_to_utf8(std::u16string_view(u"\xD800x"), utf8);
+    EXPECT_EQ(error.code, ConvertErrc::INVALID_SEQUENCE);
+    EXPECT_EQ(error.offset, 0u);
+    EXPECT_EQ(utf8, "prefix");
+    std::wstring wide = L"prefix";
+    EXPECT_FALSE(encoding_util::try_utf8_to_wide(utf8_hello_world, wide));
+    EXPECT_FALSE(encoding_util::try_gbk_to_wide(gbk_hello_world, wide));
+    EXPECT_FALSE(encoding_util::try_wide_to_utf8(wide, utf8));
+    EXPECT_EQ(utf8, "prefixprefix" + utf8_hello_world + utf8_hello_world);
+
+    EXPECT_THROW(encoding_util::utf32_to_utf8(std::u32string(1, char32_t(0x110000))), std::runtime_error);
+    EXPECT_THROW(encoding_util::utf32_to_utf8(std::u32string(1, char32_t(0xD800))), std::runtime_error);
+    EXPECT_THROW(encoding_util::utf8_to_wide(utf8_hello_world + "\xFF"), std::runtime_error);
+    EXPECT_THROW(encoding_util::gbk_to_utf16(broken_gbk), std::runtime_error);
+}
+
+TEST(WideStrings, VectorizedKernelsMatchScalarReference) {
+    // 按类别随机生成码位，覆盖整块 ASCII、连续的三字节汉字与中英混排，并随机破坏一个字节或单元
+    std::mt19937 rng(2024);
+    for (int iter = 0; iter < 3000; ++iter) {
+        std::u32string utf32;
+        const int mode = static_cast<int>(rng() % 3);
+        const int count = static_cast<int>(rng() % 80);
+        for (int k = 0; k < count; ++k) {
+            const unsigned r = rng() % 10;
+            char32_t cp;
+            if (mode == 0 || r < 2) {
+                cp = 0x20 + rng() % 0x5F;
+            } else if (mode == 1 || r < 8) {
+                cp = 0x4E00 + rng() % 0x5000;
+            } else if (r < 9) {
+                cp = 0x80 + rng() % 0x780;
+            } else {
+                cp = 0x10000 + rng() % 0x100000;
+            }
+            utf32 += cp;
+        }
+        std::string utf8;
+        std::u16string utf16;
+        for (const char32_t cp : utf32) {
+            char bytes[4];
+            utf8.append(bytes, encoding_util::detail::encode_utf8_char(cp, bytes));
+            char16_t units[2];
+            utf16.append(units, encoding_util::detail::put_code_point(cp, units));
+        }
+        ASSERT_EQ(encoding_util::utf8_to_utf16(utf8), utf16) << iter;
+        ASSERT_EQ(encoding_util::utf8_to_utf32(utf8), utf32) << iter;
+        ASSERT_EQ(encoding_util::utf16_to_utf8(utf16), utf8) << iter;
+        ASSERT_EQ(encoding_util::utf32_to_utf8(utf32), utf8) << iter;
+        if (utf8.empty()) continue;
+
+        // 损坏后与逐字符的严格解码比较出错位置
+        std::string broken = utf8;
+        broken[rng() % broken.size()] = static_cast<char>(rng());
+        size_t expected_offset = encoding_util::ConvertError::npos;
+        const auto* p = reinterpret_cast<const unsigned char*>(broken.data());
+        for (size_t i = 0; i < broken.size();) {
+            char32_t cp;
+            const size_t len = p[i] < 0x80 ? 1 : encoding_util::detail::decode_utf8_char(p + i, broken.size() - i, cp);
+            if (len == 0) {
+                expected_offset = i;
+                break;
+            }
+            i += len;
+        }
+        std::u16string out;
+        ASSERT_EQ(encoding_util::try_utf8_to_utf16(broken, out).offset, expected_offset) << iter;
+
+        std::u16string broken16 = utf16;
+        broken16[rng() % broken16.size()] = static_cast<char16_t>(0xD800 + rng() % 0x800);
+        std::string out8;
+        const encoding_util::ConvertError error = encoding_util::try_utf16_to_utf8(broken16, out8);
+        size_t expected_unit = encoding_util::ConvertError::npos;
+        for (size_t i = 0; i < broken16.size(); ++i) {
+            const char16_t unit = broken16[i];
+            if (unit >= 0xD800 && unit <= 0xDBFF && i + 1 < broken16.size() && broken16[i + 1] >= 0xDC00 &&
+                broken16[i + 1] <= 0xDFFF) {
+                ++i;
+            } else if (unit >= 0xD800 && unit <= 0xDFFF) {
+                expected_unit = i;
+                break;
+            }
+        }
+        ASSERT_EQ(error.offset, expected_unit) << iter;
+    }
+
+    std::string gbk;
+    while (gbk.size() < 5000) gbk += gbk_hello_world + gbk_hello_world + ascii_str + "\x80";
+    EXPECT_EQ(encoding_util::gbk_to_utf16(gbk), encoding_util::utf8_to_utf16(encoding_util::gbk_to_utf8(gbk)));
+}
+
+// ========== 内置码表转换测试 (Native Codec) ==========
+namespace {
+
+// 平台自带的转换器，作为内置码表的参照
+std::string system_gbk_to_utf8(std::string_view s) {
+#ifdef _WIN32
+    return encoding_util::detail::convert_win32(s, 936, CP_UTF8);
+#else
+    return encoding_util::detail::iconv_convert(s, "UTF-8", "GBK");
+#endif
+}
+
+std::string system_utf8_to_gbk(std::string_view s) {
+#ifdef _WIN32
+    return encoding_util::detail::convert_win32(s, CP_UTF8, 936);
+#else
+    return encoding_util::detail::iconv_convert(s, "GBK", "UTF-8");
+#endif
+}
+
+}  // namespace
+
+TEST(NativeCodec, RoundTripAndStrictErrors) {
+    EXPECT_EQ(encoding_util::native::gbk_to_utf8(gbk_hello_world), utf8_hello_world);
+    EXPECT_EQ(encoding_util::native::utf8_to_gbk(utf8_hello_world), gbk_hello_world);
+    EXPECT_EQ(encoding_util::native::gbk_to_utf8(ascii_str), ascii_str);
+    EXPECT_EQ(encoding_util::native::gbk_to_utf8(""), "");
+    EXPECT_EQ(encoding_util::native::gbk_to_utf8("\x80"), "\xE2\x82\xAC");  // 欧元符号
+    EXPECT_EQ(encoding_util::native::utf8_to_gbk("\xE2\x82\xAC"), "\x80");
+
+    EXPECT_THROW(encoding_util::native::gbk_to_utf8(broken_gbk), std::runtime_error);
+    EXPECT_THROW(encoding_util::native::gbk_to_utf8(incomplete_gbk), std::runtime_error);
+    EXPECT_THROW(encoding_util::native::gbk_to_utf8("\xFF"), std::runtime_error);
+    EXPECT_THROW(encoding_util::native::utf8_to_gbk(utf8_with_emoji), std::runtime_error);
+    EXPECT_THROW(encoding_util::native::utf8_to_gbk(incomplete_utf8), std::runtime_error);
+    EXPECT_THROW(encoding_util::native::utf8_to_gbk("\xC0\xAF"), std::runtime_error);      // 过长编码
+    EXPECT_THROW(encoding_util::native::utf8_to_gbk("\xED\xA0\x80"), std::runtime_error);  // 代理区
+}
+
+// Windows 代码页 936 对用户自定义区的处理与 glibc 不同，因此只在 iconv 平台上逐码位比较
+#ifndef _WIN32
+TEST(NativeCodec, MatchesSystemConverterOnEveryDoubleByteCode) {
+    std::string all_gbk;
+    for (int lead = 0x81; lead <= 0xFE; ++lead) {
+        for (int trail = 0x40; trail <= 0xFE; ++trail) {
+            const std::string code{static_cast<char>(lead), static_cast<char>(trail)};
+            bool system_ok = true;
+            std::string expected;
+            try {
+                expected = system_gbk_to_utf8(code);
+            } catch (const std::runtime_error&) {
+                system_ok = false;
+            }
+            if (!system_ok) {
+                EXPECT_THROW(encoding_util::native::gbk_to_utf8(code), std::runtime_error);
+                continue;
+            }
+            ASSERT_EQ(encoding_util::native::gbk_to_utf8(code), expected);
+            ASSERT_EQ(encoding_util::native::utf8_to_gbk(expected), code);
+            all_gbk += code;
+        }
+    }
+    const std::string all_utf8 = system_gbk_to_utf8(all_gbk);
+    EXPECT_EQ(encoding_util::native::gbk_to_utf8(all_gbk), all_utf8);
+    EXPECT_EQ(encoding_util::native::utf8_to_gbk(all_utf8), system_utf8_to_gbk(all_utf8));
+}
+#endif
+
+TEST(NativeCodec, MatchesSystemConverterOnMixedText) {
+    const std::string gbk = ascii_str + gbk_hello_world + "\x80" + std::string(100, 'x') + gbk_hello_world;
+    const std::string utf8 = system_gbk_to_utf8(gbk);
+    EXPECT_EQ(encoding_util::native::gbk_to_utf8(gbk), utf8);
+    EXPECT_EQ(encoding_util::native::utf8_to_gbk(utf8), system_utf8_to_gbk(utf8));
+}
+
+// ========== 编译期检测与转换测试 (Compile-Time Literals) ==========
+TEST(CompileTime, ValidatesAndConvertsLiterals) {
+    using namespace encoding_util::literals;
+    using encoding_util::Encoding;
+    static_assert(encoding_util::detect_encoding("Hello") == Encoding::ASCII);
+    static_assert(encoding_util::detect_encoding("你好世界") == Encoding::UTF8);
+    static_assert(encoding_util::detect_encoding("\xC4\xE3\xBA\xC3") == Encoding::GBK);
+    static_assert(encoding_util::detect_encoding("\xE4\xBD") == Encoding::UNKNOWN);
+    static_assert(encoding_util::is_gbk("\xC4\xE3") && !encoding_util::is_gbk("\x81\x20"));
+    static_assert(encoding_util::is_utf8("你好") && !encoding_util::is_utf8("\xC4\xE3"));
+
+    constexpr auto gbk = "你好世界"_gbk;
+    static_assert(gbk.size() == 8 && gbk[0] == '\xC4' && gbk[7] == '\xE7');
+    EXPECT_EQ(std::string(gbk.data(), gbk.size()), gbk_hello_world);
+    EXPECT_EQ(std::string_view(("A€B"_gbk).data(), 3), "A\x80" "B");
+
+    constexpr auto utf8 = "\xC4\xE3\xBA\xC3\xCA\xC0\xBD\xE7"_utf8;
+    EXPECT_EQ(std::string(utf8.data(), utf8.size()), utf8_hello_world);
+    static_assert(""_gbk.empty());
+
+    // 非编译期调用与运行时的内置码表转换结果一致
+    const std::string mixed = ascii_str + utf8_hello_world + "\xE2\x82\xAC" + utf8_hello_world;
+    std::string out(mixed.size(), '\0');
+    size_t written = 0;
+    EXPECT_FALSE(encoding_util::detail::constexpr_convert(mixed, false, out.data(), written));
+    out.resize(written);
+    EXPECT_EQ(out, encoding_util::native::utf8_to_gbk(mixed));
+    EXPECT_EQ(encoding_util::detail::constexpr_convert(utf8_with_emoji, false, nullptr, written).offset,
+              utf8_with_emoji.find("😂"));
+    EXPECT_EQ(encoding_util::detail::constexpr_convert(incomplete_gbk, true, nullptr, written).code,
+              encoding_util::ConvertErrc::INCOMPLETE_SEQUENCE);
+}
+
+
+// ========== 打分检测测试 (Confidence Scoring) ==========
+TEST(ScoredDetection, ResolvesInputsValidInBothEncodings) {
+    using encoding_util::Encoding;
+    const encoding_util::ScoringOptions options;
+    // "学校" 与 "实时" 的 GBK 编码恰好也是合法的 UTF-8，detect_encoding() 会选择 UTF-8
+    const std::string gbk_words[] = {"\xD1\xA7\xD0\xA3", "\xCA\xB5\xCA\xB1", "QQ\xC8\xBA"};
+    for (const std::string& word : gbk_words) {
+        ASSERT_EQ(encoding_util::detect_encoding(word), Encoding::UTF8);
+        const auto result = encoding_util::detect_encoding(word, options);
+        EXPECT_EQ(result.encoding, Encoding::GBK);
+        EXPECT_GT(result.gbk_confidence, 0.75);
+        EXPECT_DOUBLE_EQ(result.utf8_confidence + result.gbk_confidence, 1.0);
+    }
+
+    // 同样两种解释都合法的 UTF-8 中文、带重音的拉丁字母单词与西里尔字母单词
+    const std::string utf8_words[] = {"\xE4\xBD\xA0\xE5\xA5\xBD", utf8_hello_world, "caf\xC3\xA9", "M\xC3\xBCller",
+                                      "\xD0\xBF\xD1\x80\xD0\xB8\xD0\xB2\xD0\xB5\xD1\x82"};
+    for (const std::string& word : utf8_words) {
+        ASSERT_EQ(encoding_util::analyze_encoding(word).gbk_invalid_at, encoding_util::EncodingAnalysis::npos);
+        const auto result = encoding_util::detect_encoding(word, options);
+        EXPECT_EQ(result.encoding, Encoding::UTF8);
+        EXPECT_GT(result.utf8_confidence, 0.75);
+    }
+
+    // 先验可以推翻较弱的证据
+    encoding_util::ScoringOptions utf8_biased;
+    utf8_biased.utf8_prior = 0.99;
+    EXPECT_EQ(encoding_util::detect_encoding("QQ\xC8\xBA", utf8_biased).encoding, Encoding::UTF8);
+}
+
+TEST(ScoredDetection, FollowsDetectEncodingWhenUnambiguous) {
+    using encoding_util::Encoding;
+    const encoding_util::ScoringOptions options;
+    const auto gbk = encoding_util::detect_encoding(gbk_hello_world, options);
+    EXPECT_EQ(gbk.encoding, Encoding::GBK);
+    EXPECT_EQ(gbk.gbk_confidence, 1.0);
+    EXPECT_EQ(gbk.utf8_confidence, 0.0);
+
+    const auto ascii = encoding_util::detect_encoding(ascii_str, options);
+    EXPECT_EQ(ascii.encoding, Encoding::ASCII);
+    EXPECT_EQ(ascii.utf8_confidence, 1.0);
+    EXPECT_EQ(ascii.gbk_confidence, 1.0);
+
+    const auto invalid = encoding_util::detect_encoding(incomplete_gbk + "\xFF", options);
+    EXPECT_EQ(invalid.encoding, Encoding::UNKNOWN);
+    EXPECT_EQ(invalid.utf8_confidence + invalid.gbk_confidence, 0.0);
+
+    // 在不同编码的随机输入上，结论只在两种解释都合法时与 detect_encoding() 不同
+    std::mt19937 rng(7);
+    for (int round = 0; round < 2000; ++round) {
+        const std::string input = make_random_utf8_like(rng, 1 + round % 12);
+        const auto analysis = encoding_util::analyze_encoding(input);
+        const auto result = encoding_util::detect_encoding(input, options);
+        const bool ambiguous = !analysis.is_all_ascii && analysis.utf8_invalid_at == analysis.npos &&
+                               analysis.gbk_invalid_at == analysis.npos;
+        if (!ambiguous) {
+            EXPECT_EQ(result.encoding, analysis.encoding);
+        } else {
+            EXPECT_TRUE(result.encoding == Encoding::UTF8 || result.encoding == Encoding::GBK);
+        }
+        EXPECT_GE(result.utf8_confidence, 0.0);
+        EXPECT_LE(result.gbk_confidence, 1.0);
+    }
+}
+
+
+// ========== 运行时统计测试 (Instrumentation Counters) ==========
+TEST(Metrics, CountsOperationsAcrossThreads) {
+    using encoding_util::metrics::Operation;
+    const std::string invalid = "\xFF\xFF";
+    encoding_util::metrics::reset();
+    EXPECT_EQ(encoding_util::to_utf8(gbk_hello_world), utf8_hello_world);
+    EXPECT_EQ(encoding_util::to_utf8(utf8_hello_world), utf8_hello_world);
+    EXPECT_THROW(encoding_util::to_utf8(invalid), std::runtime_error);
+    std::thread([] { EXPECT_EQ(encoding_util::detect_encoding(ascii_str), encoding_util::Encoding::ASCII); }).join();
+
+    const encoding_util::metrics::Snapshot snapshot = encoding_util::metrics::snapshot();
+    const auto timed_calls = [](const encoding_util::metrics::OperationStats& stats) {
+        uint64_t calls = 0;
+        for (const uint64_t bucket : stats.latency) calls += bucket;
+        return calls;
+    };
+    if constexpr (!encoding_util::metrics::kEnabled) {
+        for (const auto& stats : snapshot.operations) {
+            EXPECT_EQ(stats.calls, 0u);
+            EXPECT_EQ(timed_calls(stats), 0u);
+        }
+        EXPECT_EQ(snapshot.exceptions, 0u);
+        return;
+    }
+
+    const size_t smart_bytes = gbk_hello_world.size() + utf8_hello_world.size() + invalid.size();
+    EXPECT_EQ(snapshot[Operation::SMART_CONVERT].calls, 3u);
+    EXPECT_EQ(snapshot[Operation::SMART_CONVERT].bytes, smart_bytes);
+    EXPECT_EQ(timed_calls(snapshot[Operation::SMART_CONVERT]), 3u);
+    EXPECT_EQ(snapshot[Operation::PASSTHROUGH].calls, 1u);
+    EXPECT_EQ(snapshot[Operation::PASSTHROUGH].bytes, utf8_hello_world.size());
+    // 智能转换先乐观转换，只有无法识别的输入才回到完整检测；已退出线程的检测也计入总和
+    EXPECT_EQ(snapshot[Operation::DETECT].calls, 2u);
+    EXPECT_EQ(snapshot[Operation::DETECT].bytes, invalid.size() + ascii_str.size());
+    EXPECT_EQ(timed_calls(snapshot[Operation::DETECT]), 2u);
+    // GBK 输入转换成功，无效输入的乐观转换失败；走系统转换器还是内置码表取决于 ENCODING_UTIL_USE_NATIVE_CODEC
+    EXPECT_EQ(snapshot[Operation::SYSTEM_CONVERT].calls + snapshot[Operation::NATIVE_CONVERT].calls, 2u);
+    EXPECT_EQ(snapshot.exceptions, 1u);
+    EXPECT_STREQ(encoding_util::metrics::operation_name(Operation::PASSTHROUGH), "passthrough");
+
+    encoding_util::metrics::reset();
+    const encoding_util::metrics::Snapshot cleared = encoding_util::metrics::snapshot();
+    EXPECT_EQ(cleared[Operation::DETECT].calls, 0u);
+    EXPECT_EQ(cleared.exceptions, 0u);
+}
+
+
+// ========== 自定义分配器测试 (Allocators / PMR) ==========
+namespace {
+// 记录分配次数的上游资源，用来确认结果确实来自调用方提供的 arena
+class CountingResource : public std::pmr::memory_resource {
+public:
+    size_t allocations = 0;
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        ++allocations;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+};
+
+std::string repeat(const std::string& s, size_t times) {
+    std::string result;
+    for (size_t i = 0; i < times; ++i) result += s;
+    return result;
+}
+}  // namespace
+
+TEST(Allocators, ReturnsStringsFromMemoryResource) {
+    const std::string gbk = repeat(gbk_hello_world, 16);
+    const std::string utf8 = repeat(utf8_hello_world, 16);
+    CountingResource upstream;
+    std::pmr::monotonic_buffer_resource arena(&upstream);
+    // 转换不应退回到默认资源
+    std::pmr::memory_resource* const previous = std::pmr::set_default_resource(std::pmr::null_memory_resource());
+
+    const std::pmr::string smart_utf8 = encoding_util::to_utf8(gbk, &arena);
+    const std::pmr::string smart_gbk = encoding_util::to_gbk(utf8, &arena);
+    const std::pmr::string utf8_result =
+        encoding_util::gbk_to_utf8(gbk + "\xFF", &arena, encoding_util::ErrorPolicy::SKIP);
+    const std::pmr::string gbk_result = encoding_util::utf8_to_gbk(utf8, &arena);
+    EXPECT_THROW(encoding_util::to_utf8(broken_gbk, &arena), std::runtime_error);
+    std::pmr::set_default_resource(previous);
+
+    EXPECT_EQ(std::string_view(smart_utf8), utf8);
+    EXPECT_EQ(std::string_view(smart_gbk), gbk);
+    EXPECT_EQ(std::string_view(utf8_result), utf8);
+    EXPECT_EQ(std::string_view(gbk_result), gbk);
+    for (const std::pmr::string* s : {&smart_utf8, &smart_gbk, &utf8_result, &gbk_result}) {
+        EXPECT_EQ(s->get_allocator().resource(), &arena);
+    }
+    EXPECT_GT(upstream.allocations, 0u);
+}
+
+TEST(Allocators, AcceptsAllocatorObjects) {
+    const std::string gbk = repeat(gbk_hello_world, 16);
+    CountingResource resource;
+    const std::pmr::polymorphic_allocator<char> alloc(&resource);
+    const std::pmr::string result = encoding_util::gbk_to_utf8(gbk, alloc);
+    EXPECT_EQ(std::string_view(result), repeat(utf8_hello_world, 16));
+    EXPECT_EQ(result.get_allocator().resource(), &resource);
+    EXPECT_GT(resource.allocations, 0u);
+    // 标准分配器得到的就是 std::string
+    const std::string plain = encoding_util::to_gbk(result, std::allocator<char>());
+    EXPECT_EQ(plain, gbk);
+}
+
+TEST(Allocators, AppendsIntoPmrStrings) {
+    std::pmr::monotonic_buffer_resource arena;
+    std::pmr::string out("prefix:", &arena);
+    EXPECT_FALSE(encoding_util::try_to_utf8(gbk_hello_world, out));
+    EXPECT_EQ(encoding_util::to_gbk(utf8_hello_world, out), gbk_hello_world.size());
+    // GBK 到 UTF-16 经 UTF-8 中转，中转缓冲区同样来自 out 的内存资源
+    EXPECT_FALSE(encoding_util::try_convert("a", encoding_util::Encoding::GBK, encoding_util::Encoding::UTF16LE, out));
+    const std::string utf16 = std::string("\xFF\xFE" "a") + '\0';
+    EXPECT_EQ(std::string_view(out), "prefix:" + utf8_hello_world + gbk_hello_world + utf16);
+    EXPECT_EQ(out.get_allocator().resource(), &arena);
+}
+
+
+// ========== 检测与转换合并测试 (Fused Detect-and-Convert) ==========
+TEST(FusedSmartConversion, MatchesDetectThenConvert) {
+    using encoding_util::Encoding;
+    // 智能转换在乐观转换失败或结果可能有歧义时回到完整检测，结论必须与先检测再转换一致
+    // 合法的 GBK 即使含有落在用户自定义区的字符也按 GBK 处理，不会被当作 Big5 解码成别的字
+    const std::string gbk_user_defined = gbk_hello_world.substr(0, 4) + "\xAA\xA1";  // "你好" 加一个自定义区字符
+    EXPECT_EQ(encoding_util::detect_encoding(gbk_user_defined), Encoding::GBK);
+    EXPECT_TRUE(encoding_util::is_gbk(gbk_user_defined));
+    EXPECT_TRUE(encoding_util::is_gbk(big5_sample));
+    std::string fused = "x", reference = "x";
+    const encoding_util::ConvertError fused_error = encoding_util::try_to_utf8(gbk_user_defined, fused);
+    const encoding_util::ConvertError reference_error = encoding_util::try_gbk_to_utf8(gbk_user_defined, reference);
+    EXPECT_EQ(fused_error.code, reference_error.code);
+    EXPECT_EQ(fused_error.offset, reference_error.offset);
+    EXPECT_EQ(fused, reference);
+    EXPECT_NE(fused, "x\xE6\x96\x95\xE7\x96\x91\xE7\x82\x95");  // 按 Big5 解码得到的 "斕疑炕"
+    EXPECT_THROW(encoding_util::to_utf8("a\x80" "b"), std::runtime_error);  // 转换器接受单字节欧元符号，检测不接受
+    EXPECT_THROW(encoding_util::to_utf8(ascii_str + "\xE4\xBD"), std::runtime_error);  // 截断的 UTF-8 恰为合法 GBK
+    EXPECT_EQ(encoding_util::to_gbk(gbk_hello_world), gbk_hello_world);
+    EXPECT_THROW(encoding_util::to_gbk("\xF0\x9F\x98\x82"), std::runtime_error);  // GBK 无法表示
+    EXPECT_TRUE(encoding_util::to_gbk_view(ascii_str).is_borrowed());
+    EXPECT_TRUE(encoding_util::to_utf8_view(utf8_hello_world).is_borrowed());
+    EXPECT_EQ(encoding_util::to_gbk_view(ascii_str + utf8_hello_world), ascii_str + gbk_hello_world);
+
+    std::mt19937 rng(2024);
+    const std::vector<std::string> pieces = {"a", " ", gbk_hello_world, utf8_hello_world, "\x80", "\xA4\x40",
+                                             "\xE4\xBD", "\xFF", "\xF0\x9F\x98\x82", "\xA1\xA1"};
+    for (int i = 0; i < 2000; ++i) {
+        std::string input;
+        const int count = static_cast<int>(rng() % 6);
+        for (int j = 0; j < count; ++j) input += pieces[rng() % pieces.size()];
+        const encoding_util::DetectedView detected(input);
+        std::string fused = "x", reference = "x";
+        encoding_util::ConvertError fused_error = encoding_util::try_to_utf8(input, fused);
+        encoding_util::ConvertError reference_error = encoding_util::try_to_utf8(detected, reference);
+        EXPECT_EQ(fused_error.code, reference_error.code);
+        EXPECT_EQ(fused_error.offset, reference_error.offset);
+        EXPECT_EQ(fused, reference);
+        fused.assign(1, 'x');
+        reference.assign(1, 'x');
+        fused_error = encoding_util::try_to_gbk(input, fused);
+        reference_error = encoding_util::try_to_gbk(detected, reference);
+        EXPECT_EQ(fused_error.code, reference_error.code);
+        EXPECT_EQ(fused_error.offset, reference_error.offset);
+        EXPECT_EQ(fused, reference);
+    }
+}
+
+
+// ========== 预检测视图与检测缓存测试 (Detected Views & Cache) ==========
+TEST(DetectedView, TrustsPrecomputedResult) {
+    using encoding_util::DetectedView;
+    using encoding_util::Encoding;
+    const DetectedView gbk(gbk_hello_world);
+    EXPECT_EQ(gbk.encoding(), Encoding::GBK);
+    EXPECT_FALSE(gbk.is_all_ascii());
+    EXPECT_TRUE(encoding_util::is_gbk(gbk));
+    EXPECT_FALSE(encoding_util::is_utf8(gbk));
+    EXPECT_EQ(encoding_util::to_utf8(gbk), utf8_hello_world);
+    EXPECT_TRUE(encoding_util::to_gbk_view(gbk).is_borrowed());
+
+    // 给出的结果被直接采用：声称是 GBK 的 UTF-8 输入会被原样返回，说明没有重新检测
+    encoding_util::EncodingAnalysis claimed;
+    claimed.encoding = Encoding::GBK;
+    claimed.is_all_ascii = false;
+    const DetectedView trusted(utf8_hello_world, claimed);
+    EXPECT_EQ(encoding_util::detect_encoding(trusted), Encoding::GBK);
+    EXPECT_EQ(encoding_util::to_gbk(trusted), utf8_hello_world);
+
+    const DetectedView unknown(broken_gbk);
+    EXPECT_THROW(encoding_util::to_utf8(unknown), std::runtime_error);
+    EXPECT_THROW(encoding_util::to_gbk_view(unknown), std::runtime_error);
+    std::string out = "prefix:";
+    const encoding_util::ConvertError error = encoding_util::try_to_utf8(unknown, out);
+    EXPECT_EQ(error.code, encoding_util::ConvertErrc::UNKNOWN_ENCODING);
+    EXPECT_EQ(error.offset, unknown.analysis().gbk_invalid_at);
+    EXPECT_EQ(out, "prefix:");
+    EXPECT_FALSE(encoding_util::try_to_gbk(DetectedView(utf8_hello_world), out));
+    EXPECT_EQ(out, "prefix:" + gbk_hello_world);
+}
+
+TEST(DetectionCache, ReusesResultsForSameBuffer) {
+    using encoding_util::Encoding;
+    encoding_util::DetectionCache cache;
+    const std::string payload = gbk_hello_world + ascii_str + gbk_hello_world;
+    encoding_util::metrics::reset();
+    EXPECT_EQ(cache.detect(payload).encoding(), Encoding::GBK);
+    EXPECT_TRUE(encoding_util::is_gbk(cache.detect(payload)));
+    EXPECT_EQ(encoding_util::to_utf8(cache.detect(payload)), utf8_hello_world + ascii_str + utf8_hello_world);
+    if constexpr (encoding_util::metrics::kEnabled) {
+        EXPECT_EQ(encoding_util::metrics::snapshot()[encoding_util::metrics::Operation::DETECT].calls, 1u);
+    }
+
+    // 同一地址上长度不同的视图是不同的键
+    EXPECT_EQ(cache.detect(std::string_view(payload).substr(0, 1)).encoding(), Encoding::UNKNOWN);
+    EXPECT_EQ(cache.detect(std::string_view(payload).substr(0, gbk_hello_world.size())).encoding(), Encoding::GBK);
+
+    // 同一地址、同样长度但内容变化时，抽样哈希使缓存失效
+    std::string reused(gbk_hello_world.size(), 'a');
+    EXPECT_EQ(cache.detect(reused).encoding(), Encoding::ASCII);
+    reused = gbk_hello_world;
+    EXPECT_EQ(cache.detect(reused).encoding(), Encoding::GBK);
+
+    // 抽样以外的字节被改写时，会原样输出的结论要重新验证，不能把 GBK 字节当作 UTF-8 输出
+    std::string pooled = std::string(20, 'a') + utf8_hello_world + std::string(200, 'a');
+    const char* const address = pooled.data();
+    EXPECT_EQ(cache.detect(pooled).encoding(), Encoding::UTF8);
+    pooled.replace(20, utf8_hello_world.size(), gbk_hello_world + std::string(4, 'a'));
+    ASSERT_EQ(pooled.data(), address);
+    EXPECT_EQ(cache.detect(pooled).encoding(), Encoding::GBK);
+    EXPECT_EQ(encoding_util::to_utf8(cache.detect(pooled)), encoding_util::to_utf8(pooled));
+
+    cache.clear();
+    EXPECT_EQ(cache.detect(payload).analysis().gbk_invalid_at, encoding_util::EncodingAnalysis::npos);
+}
+
+TEST(DetectionCache, IsSafeUnderConcurrentUse) {
+    using encoding_util::Encoding;
+    encoding_util::DetectionCache cache;
+    std::vector<std::string> payloads;
+    std::vector<Encoding> expected;
+    for (int i = 0; i < 256; ++i) {
+        const std::string& base = (i % 3 == 0) ? gbk_hello_world : (i % 3 == 1) ? utf8_hello_world : ascii_str;
+        payloads.push_back(std::to_string(i) + base);
+        expected.push_back(encoding_util::detect_encoding(payloads.back()));
+    }
+    std::vector<std::thread> threads;
+    std::atomic<int> mismatches{0};
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&, t] {
+            for (int round = 0; round < 50; ++round) {
+                for (size_t i = t; i < payloads.size(); i += 2) {
+                    if (cache.detect(payloads[i]).encoding() != expected[i]) ++mismatches;
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads) thread.join();
+    EXPECT_EQ(mismatches.load(), 0);
+}
+
 
 // ========== C++20 专属功能测试 ==========
 #if defined(__cpp_char8_t)
@@ -109,4 +1822,37 @@ TEST(ConversionCpp20, ToU8String) {
     EXPECT_THROW(encoding_util::to_u8string(broken_gbk), std::runtime_error);
 }
 
-#endif  // defined(__cpp_char8_t)
\ No newline at end of file
+TEST(ConversionCpp20, DetectsU8StringView) {
+    EXPECT_EQ(encoding_util::detect_encoding(u8s_hello_world), encoding_util::Encoding::UTF8);
+    EXPECT_EQ(encoding_util::detect_encoding(u8s_ascii), encoding_util::Encoding::ASCII);
+    EXPECT_TRUE(encoding_util::is_utf8(u8s_hello_world));
+    // char8_t 本身并不保证内容是合法的 UTF-8
+    const std::u8string not_utf8(reinterpret_cast<const char8_t*>(gbk_hello_world.data()), gbk_hello_world.size());
+    EXPECT_EQ(encoding_util::detect_encoding(not_utf8), encoding_util::Encoding::GBK);
+    EXPECT_FALSE(encoding_util::is_utf8(not_utf8));
+}
+
+TEST(ConversionCpp20, AppendsIntoU8String) {
+    std::u8string out = u8"前缀";
+    EXPECT_EQ(encoding_util::to_u8string(gbk_hello_world, out), utf8_hello_world.size());
+    EXPECT_EQ(out, u8"前缀你好世界");
+    EXPECT_THROW(encoding_util::to_u8string(broken_gbk, out), std::runtime_error);
+    EXPECT_EQ(out, u8"前缀你好世界");
+}
+
+TEST(ConversionCpp20, ConvertsBetweenU8StringAndUtf16) {
+    EXPECT_EQ(encoding_util::utf8_to_utf16(u8"你好世界😂"), u"你好世界😂");
+    EXPECT_EQ(encoding_util::utf8_to_wide(u8"你好世界"), L"你好世界");
+    EXPECT_EQ(encoding_util::utf16_to_u8string(u"你好世界😂"), u8"你好世界😂");
+    EXPECT_THROW(encoding_util::utf16_to_u8string(std::u16string_view(u"\xDC00")), std::runtime_error);
+}
+
+TEST(ConversionCpp20, ReturnsPmrU8String) {
+    std::pmr::monotonic_buffer_resource arena;
+    const std::pmr::u8string result = encoding_util::to_u8string(gbk_hello_world, &arena);
+    EXPECT_EQ(std::u8string_view(result), u8s_hello_world);
+    EXPECT_EQ(result.get_allocator().resource(), &arena);
+    EXPECT_EQ(std::string_view(encoding_util::to_gbk(u8s_hello_world, &arena)), gbk_hello_world);
+}
+
+#endif  // defined(__cpp_char8_t)
@@ -0,0 +1,89 @@
+#!/usr/bin/env python3
+"""生成 include/encoding_util/detail/gbk_tables.hpp 中的 GBK <-> Unicode 映射表。
+
+映射取自 Python 内置的 gbk 编解码器，它与 glibc iconv 的 "GBK" 完全一致
+(另外 glibc 与 Windows 代码页 936 都把单字节 0x80 映射为欧元符号 U+20AC，这里一并加入)。
+
+用法: python3 tools/gen_gbk_tables.py > include/encoding_util/detail/gbk_tables.hpp
+"""
+
+LEAD_FIRST, LEAD_LAST = 0x81, 0xFE
+TRAIL_FIRST, TRAIL_LAST = 0x40, 0xFE
+
+
+def build_decode():
+    table = []
+    for lead in range(LEAD_FIRST, LEAD_LAST + 1):
+        for trail in range(TRAIL_FIRST, TRAIL_LAST + 1):
+            try:
+                cp = ord(bytes([lead, trail]).decode("gbk")) if trail != 0x7F else 0
+            except UnicodeDecodeError:
+                cp = 0
+            table.append(cp)
+    return table
+
+
+def build_encode(decode):
+    pages = {}
+    trails = TRAIL_LAST - TRAIL_FIRST + 1
+    for index, cp in enumerate(decode):
+        if cp == 0:
+            continue
+        code = ((LEAD_FIRST + index // trails) << 8) | (TRAIL_FIRST + index % trails)
+        page = pages.setdefault(cp >> 8, [0] * 256)
+        assert page[cp & 0xFF] == 0, "GBK 映射必须是一一对应的"
+        page[cp & 0xFF] = code
+    return pages
+
+
+def emit_array(values, indent="    ", per_line=12, digits=4):
+    lines = []
+    for i in range(0, len(values), per_line):
+        lines.append(indent + ", ".join("0x%0*X" % (digits, v) for v in values[i:i + per_line]) + ",")
+    return "\n".join(lines)
+
+
+def main():
+    decode = build_decode()
+    pages = build_encode(decode)
+    page_ids = sorted(pages)
+    index = [0] * 256
+    for number, high in enumerate(page_ids, start=1):
+        index[high] = number
+
+    print("// 本文件由 tools/gen_gbk_tables.py 生成，请勿手工修改。")
+    print("#pragma once")
+    print()
+    print("#include <cstdint>")
+    print()
+    print("namespace encoding_util::detail::gbk_tables {")
+    print()
+    print("inline constexpr unsigned kLeadFirst = 0x%02X;" % LEAD_FIRST)
+    print("inline constexpr unsigned kTrailFirst = 0x%02X;" % TRAIL_FIRST)
+    print("inline constexpr unsigned kTrailCount = %d;" % (TRAIL_LAST - TRAIL_FIRST + 1))
+    print("inline constexpr unsigned kEncodePageCount = %d;  // 含第 0 页 (全空)" % (len(page_ids) + 1))
+    print()
+    print("// 解码表：kDecode[(首字节 - 0x81) * kTrailCount + (第二字节 - 0x40)] 为对应的 Unicode 码位，0 表示未定义")
+    print("inline constexpr uint16_t kDecode[%d] = {" % len(decode))
+    print(emit_array(decode))
+    print("};")
+    print()
+    print("// 编码表第一级：kEncodeIndex[码位 >> 8] 为第二级页号，0 表示该页没有可编码的字符")
+    print("inline constexpr uint8_t kEncodeIndex[256] = {")
+    print(emit_array(index, per_line=16, digits=2))
+    print("};")
+    print()
+    print("// 编码表第二级：kEncodePages[页号][码位 & 0xFF] 为 GBK 双字节编码 (首字节在高 8 位)，0 表示无法编码")
+    print("inline constexpr uint16_t kEncodePages[kEncodePageCount][256] = {")
+    print("    {},")
+    for high in page_ids:
+        print("    {  // U+%02X00" % high)
+        print(emit_array(pages[high], indent="        "))
+        print("    },")
+    print("};")
+    print()
+    print("}  // namespace encoding_util::detail::gbk_tables")
+
+
+if __name__ == "__main__":
+    main()